@@ -0,0 +1,588 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "../src/hips_common.h"
+
+/*
+ * HIPS 匹配引擎微基准
+ *
+ * 在用户空间链接 src/hips_rules.c，分别对 exec（精确路径、目录）/DNS/网络/哈希规则表
+ * 以不同规则规模和命中率测量 hips_match_rule 的 ns/op 与 cache miss。
+ * 引擎的每次改动都应与这里的基线结果对比。
+ * -N 比较哈希规则的摘要表查找与 NUMA 副本：副本分别绑定在本节点和最远节点上，线程固定在节点 0。
+ */
+
+#define BENCH_QUERY_COUNT   4096
+#define BENCH_MAX_SIZES     16
+#define BENCH_MAX_MIXES     16
+#define BENCH_MAX_TYPES     5
+
+// 目录规则 ("/dir/*") 作为 exec 规则加载，单独计时
+#define BENCH_TYPE_DIR      100
+
+// mbind(2) 的策略和标志，避免依赖 libnuma
+#define BENCH_MPOL_BIND     2
+#define BENCH_MPOL_MF_MOVE  (1 << 1)
+
+struct bench_options {
+    unsigned long sizes[BENCH_MAX_SIZES];
+    int size_count;
+    unsigned int mixes[BENCH_MAX_MIXES];
+    int mix_count;
+    int types[BENCH_MAX_TYPES];
+    int type_count;
+    unsigned long time_ms;
+    unsigned long min_ops;
+    int numa;
+};
+
+static const char *bench_type_name(int type)
+{
+    switch (type) {
+        case HIPS_RULE_EXEC:
+            return "exec";
+        case HIPS_RULE_DNS:
+            return "dns";
+        case HIPS_RULE_NETWORK:
+            return "network";
+        case HIPS_RULE_HASH:
+            return "hash";
+        case BENCH_TYPE_DIR:
+            return "dir";
+        default:
+            return "unknown";
+    }
+}
+
+static int bench_rule_type(int type)
+{
+    return type == BENCH_TYPE_DIR ? HIPS_RULE_EXEC : type;
+}
+
+// splitmix64，用于生成分布均匀的伪摘要
+static unsigned long long bench_mix64(unsigned long long x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// 生成第 i 条规则（或未命中查询）的目标字符串，格式与各钩子传入的一致
+static void bench_format_target(int type, unsigned long i, int miss, char *buf, size_t size)
+{
+    unsigned long long seed;
+
+    switch (type) {
+        case HIPS_RULE_EXEC:
+            snprintf(buf, size, "/opt/hips-bench/bin/%s-%lu", miss ? "miss" : "tool", i);
+            break;
+        case BENCH_TYPE_DIR:
+            // 查询为目录下两层的文件，规则见 bench_load_rules
+            snprintf(buf, size, "/opt/hips-bench/%s-%lu/bin/tool", miss ? "miss" : "dir", i);
+            break;
+        case HIPS_RULE_DNS:
+            snprintf(buf, size, "%s-%lu.bench.example", miss ? "miss" : "host", i);
+            break;
+        case HIPS_RULE_NETWORK:
+            snprintf(buf, size, "%s.%lu.%lu.%lu:443", miss ? "172" : "10",
+                     (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+            break;
+        case HIPS_RULE_HASH:
+            // 十六进制 SHA-256，未命中的查询使用另一组种子
+            seed = ((unsigned long long)i << 1 | (miss != 0)) << 2;
+            snprintf(buf, size, "%016llx%016llx%016llx%016llx", bench_mix64(seed),
+                     bench_mix64(seed + 1), bench_mix64(seed + 2), bench_mix64(seed + 3));
+            break;
+        default:
+            buf[0] = '\0';
+            break;
+    }
+}
+
+static unsigned long long bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 打开 cache miss 计数器，不可用时返回 -1（容器、虚拟机中常见）
+static int bench_open_cache_counter(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// 填充规则表，返回每条规则的平均插入耗时，first_id 为第一条规则的 ID（ID 连续分配）
+static double bench_load_rules(int type, unsigned long count, u32 *first_id)
+{
+    struct hips_rule rule;
+    unsigned long long start;
+    unsigned long i;
+
+    start = bench_now_ns();
+    for (i = 0; i < count; i++) {
+        memset(&rule, 0, sizeof(rule));
+        rule.rule_type = bench_rule_type(type);
+        rule.action = HIPS_ACTION_BLOCK;
+        rule.priority = 100;
+        if (type == BENCH_TYPE_DIR) {
+            snprintf(rule.target, sizeof(rule.target), "/opt/hips-bench/dir-%lu/*", i);
+        } else {
+            bench_format_target(type, i, 0, rule.target, sizeof(rule.target));
+        }
+        if (hips_add_rule(&rule) != HIPS_SUCCESS) {
+            fprintf(stderr, "错误: 添加规则失败 (%lu)\n", i);
+            exit(1);
+        }
+        if (i == 0) {
+            *first_id = rule.rule_id;
+        }
+    }
+
+    return count ? (double)(bench_now_ns() - start) / count : 0.0;
+}
+
+static void bench_run_mix(int type, unsigned long rules, unsigned int hit_pct,
+                          double add_ns, const struct bench_options *opts)
+{
+    static char queries[BENCH_QUERY_COUNT][HIPS_SHA256_SIZE * 2 + 1];
+    struct hips_rule matched;
+    unsigned long long start, elapsed, budget;
+    unsigned long long misses = 0;
+    unsigned long ops = 0, hits = 0;
+    int counter_fd;
+    int i;
+
+    // 预先生成查询，避免把字符串格式化算进 ns/op
+    for (i = 0; i < BENCH_QUERY_COUNT; i++) {
+        int hit = (unsigned int)(rand() % 100) < hit_pct;
+        unsigned long n = ((unsigned long)rand() << 15 ^ rand()) % rules;
+
+        bench_format_target(type, n, !hit, queries[i], sizeof(queries[i]));
+    }
+
+    counter_fd = bench_open_cache_counter();
+    if (counter_fd >= 0) {
+        ioctl(counter_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    budget = opts->time_ms * 1000000ULL;
+    start = bench_now_ns();
+    do {
+        for (i = 0; i < 16; i++) {
+            if (hips_match_rule(bench_rule_type(type), queries[ops % BENCH_QUERY_COUNT],
+                                &matched) == HIPS_SUCCESS) {
+                hits++;
+            }
+            ops++;
+        }
+        elapsed = bench_now_ns() - start;
+    } while (elapsed < budget || ops < opts->min_ops);
+
+    if (counter_fd >= 0) {
+        ioctl(counter_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter_fd, &misses, sizeof(misses)) != sizeof(misses)) {
+            misses = 0;
+        }
+        close(counter_fd);
+    }
+
+    printf("%-8s %9lu %5u %10lu %8.1f %12.1f ", bench_type_name(type), rules, hit_pct,
+           ops, add_ns, (double)elapsed / ops);
+    if (counter_fd >= 0) {
+        printf("%12.2f", (double)misses / ops);
+    } else {
+        printf("%12s", "-");
+    }
+    printf(" %7.1f\n", 100.0 * hits / ops);
+    fflush(stdout);
+}
+
+// 随机删除 1/10 的规则，输出每条的平均删除耗时
+static void bench_delete_rules(int type, unsigned long rules, u32 first_id)
+{
+    unsigned long long start, elapsed;
+    unsigned long count = rules / 10, i, deleted = 0;
+    u32 *ids;
+
+    if (count == 0) {
+        return;
+    }
+
+    // 从连续的 ID 中不重复地抽取：步长与规则数互质时遍历整个区间
+    ids = malloc(count * sizeof(*ids));
+    if (!ids) {
+        return;
+    }
+    for (i = 0; i < count; i++) {
+        ids[i] = first_id + (u32)((i * 7919UL) % rules);
+    }
+
+    start = bench_now_ns();
+    for (i = 0; i < count; i++) {
+        if (hips_del_rule(ids[i]) == HIPS_SUCCESS) {
+            deleted++;
+        }
+    }
+    elapsed = bench_now_ns() - start;
+
+    printf("# %s %lu 条规则中删除 %lu 条: %.2f ms, %.1f ns/条\n", bench_type_name(type),
+           rules, deleted, elapsed / 1e6, (double)elapsed / count);
+    fflush(stdout);
+    free(ids);
+}
+
+// 读取节点 0 的距离表，返回最远节点（只有一个节点时返回 0）
+static int bench_numa_far_node(void)
+{
+    FILE *fp;
+    int node = 0, far = 0, dist, max = 0;
+
+    fp = fopen("/sys/devices/system/node/node0/distance", "r");
+    if (!fp) {
+        return 0;
+    }
+    while (fscanf(fp, "%d", &dist) == 1) {
+        if (dist > max) {
+            max = dist;
+            far = node;
+        }
+        node++;
+    }
+    fclose(fp);
+
+    return far;
+}
+
+// 把当前线程固定到节点 0 的第一个 CPU 上，失败时返回 -1
+static int bench_numa_pin(void)
+{
+    cpu_set_t cpus;
+    FILE *fp;
+    int cpu;
+
+    fp = fopen("/sys/devices/system/node/node0/cpulist", "r");
+    if (!fp) {
+        return -1;
+    }
+    if (fscanf(fp, "%d", &cpu) != 1) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return sched_setaffinity(0, sizeof(cpus), &cpus);
+}
+
+// 在指定节点上分配副本（mmap 后先绑定再首次写入），bound 返回绑定是否成功
+static struct hips_digest_replica *bench_numa_alloc(int node, size_t bytes, int *bound)
+{
+    unsigned long mask = 1UL << node;
+    void *addr;
+
+    addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+    *bound = syscall(__NR_mbind, addr, bytes, BENCH_MPOL_BIND, &mask, sizeof(mask) * 8,
+                     BENCH_MPOL_MF_MOVE) == 0;
+    return addr;
+}
+
+// 在规定时间内循环查找，返回 ns/op；rep 为 NULL 时走摘要表查找（hips_match_digest）
+static double bench_numa_time(const struct hips_digest_replica *rep, u8 (*queries)[HIPS_SHA256_SIZE],
+                              const struct bench_options *opts, unsigned long *hits)
+{
+    struct hips_rule matched;
+    unsigned long long start, elapsed, budget = opts->time_ms * 1000000ULL;
+    unsigned long ops = 0;
+    int i;
+
+    *hits = 0;
+    start = bench_now_ns();
+    do {
+        for (i = 0; i < 16; i++) {
+            const u8 *digest = queries[ops % BENCH_QUERY_COUNT];
+            u32 rule_id;
+
+            // 副本命中后与钩子一样经 ID 索引取出规则
+            if (rep) {
+                rule_id = hips_replica_lookup(rep, rcu_access_pointer(hips_config->rules), NULL, 0, 0,
+                                              digest);
+                if (rule_id && hips_get_rule(rule_id, &matched) == HIPS_SUCCESS) {
+                    (*hits)++;
+                }
+            } else if (hips_match_digest(NULL, 0, digest, &matched) == HIPS_SUCCESS) {
+                (*hits)++;
+            }
+            ops++;
+        }
+        elapsed = bench_now_ns() - start;
+    } while (elapsed < budget || ops < opts->min_ops);
+
+    return (double)elapsed / ops;
+}
+
+// 已加载哈希规则时比较摘要表查找、本节点副本和远端副本的 ns/op
+static void bench_run_numa(unsigned long rules, const struct bench_options *opts)
+{
+    static u8 queries[BENCH_QUERY_COUNT][HIPS_SHA256_SIZE];
+    char hex[HIPS_SHA256_SIZE * 2 + 1];
+    struct hips_digest_replica *local, *remote = NULL;
+    unsigned long hits;
+    int far = bench_numa_far_node(), local_bound = 0, remote_bound = 0, i, m;
+    u32 capacity = hips_replica_capacity(rules);
+    size_t bytes = hips_replica_bytes(capacity);
+    double table_ns, local_ns, remote_ns = 0;
+
+    if (bench_numa_pin() != 0) {
+        printf("# numa: 无法固定到节点 0 的 CPU，结果包含迁移噪声\n");
+    }
+
+    local = bench_numa_alloc(0, bytes, &local_bound);
+    if (far) {
+        remote = bench_numa_alloc(far, bytes, &remote_bound);
+    }
+    if (!local || (far && !remote)) {
+        fprintf(stderr, "错误: 无法分配副本 (%zu 字节)\n", bytes);
+        exit(1);
+    }
+
+    // 编译在 RCU 下遍历摘要表，不持有 config_lock；基准期间规则表不变
+    if (hips_replica_compile(local, capacity) != HIPS_SUCCESS ||
+        (remote && hips_replica_compile(remote, capacity) != HIPS_SUCCESS)) {
+        fprintf(stderr, "错误: 编译副本失败\n");
+        exit(1);
+    }
+
+    printf("# numa: %lu 条哈希规则, 每个副本 %zu 字节, 本节点 0%s, 远端节点 %d%s\n", rules,
+           bytes, local_bound ? "" : " (未绑定)", far,
+           remote ? (remote_bound ? "" : " (未绑定)") : " (单节点主机)");
+
+    for (m = 0; m < opts->mix_count; m++) {
+        for (i = 0; i < BENCH_QUERY_COUNT; i++) {
+            int hit = (unsigned int)(rand() % 100) < opts->mixes[m];
+            unsigned long n = ((unsigned long)rand() << 15 ^ rand()) % rules;
+
+            bench_format_target(HIPS_RULE_HASH, n, !hit, hex, sizeof(hex));
+            hex2bin(queries[i], hex, HIPS_SHA256_SIZE);
+        }
+
+        table_ns = bench_numa_time(NULL, queries, opts, &hits);
+        local_ns = bench_numa_time(local, queries, opts, &hits);
+        if (remote) {
+            remote_ns = bench_numa_time(remote, queries, opts, &hits);
+        }
+
+        printf("%-8s %9lu %5u %12.1f %12.1f ", "hash", rules, opts->mixes[m], table_ns, local_ns);
+        if (remote) {
+            printf("%12.1f\n", remote_ns);
+        } else {
+            printf("%12s\n", "-");
+        }
+        fflush(stdout);
+    }
+
+    munmap(local, bytes);
+    if (remote) {
+        munmap(remote, bytes);
+    }
+}
+
+static int bench_parse_list(const char *arg, unsigned long *out, int max)
+{
+    char *copy, *token, *saveptr;
+    int count = 0;
+
+    copy = strdup(arg);
+    for (token = strtok_r(copy, ",", &saveptr); token && count < max;
+         token = strtok_r(NULL, ",", &saveptr)) {
+        char *end;
+        unsigned long val = strtoul(token, &end, 10);
+
+        if (*end == 'k' || *end == 'K') {
+            val *= 1000;
+        } else if (*end == 'm' || *end == 'M') {
+            val *= 1000000;
+        }
+        out[count++] = val;
+    }
+    free(copy);
+    return count;
+}
+
+static void print_help(void)
+{
+    printf("HIPS 匹配引擎微基准 - 版本 %s\n", HIPS_MODULE_VERSION);
+    printf("\n用法: hips-microbench [选项]\n");
+    printf("\n选项:\n");
+    printf("  -s, --sizes <列表>   规则规模 (默认: 1k,100k,1m)\n");
+    printf("  -m, --mix <列表>     命中率百分比 (默认: 0,50,100)\n");
+    printf("  -t, --type <类型>    只测试 exec|dir|dns|network|hash (可重复)\n");
+    printf("  -T, --time <毫秒>    每组测量时长 (默认: 200)\n");
+    printf("  -n, --min-ops <次数> 每组最少操作数 (默认: 32)\n");
+    printf("  -N, --numa           比较哈希规则的摘要表查找与本节点/远端节点上的副本\n");
+    printf("  -v, --verbose        输出 printk 日志\n");
+    printf("  -h, --help           显示此帮助信息\n");
+}
+
+int main(int argc, char *argv[])
+{
+    struct bench_options opts = {
+        .sizes = { 1000, 100000, 1000000 },
+        .size_count = 3,
+        .mixes = { 0, 50, 100 },
+        .mix_count = 3,
+        .time_ms = 200,
+        .min_ops = 32,
+    };
+    unsigned long values[BENCH_MAX_MIXES];
+    int opt, t, s, m;
+
+    static struct option long_options[] = {
+        {"sizes", required_argument, 0, 's'},
+        {"mix", required_argument, 0, 'm'},
+        {"type", required_argument, 0, 't'},
+        {"time", required_argument, 0, 'T'},
+        {"min-ops", required_argument, 0, 'n'},
+        {"numa", no_argument, 0, 'N'},
+        {"verbose", no_argument, 0, 'v'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "s:m:t:T:n:Nvh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                opts.size_count = bench_parse_list(optarg, opts.sizes, BENCH_MAX_SIZES);
+                break;
+            case 'm':
+                opts.mix_count = bench_parse_list(optarg, values, BENCH_MAX_MIXES);
+                for (m = 0; m < opts.mix_count; m++) {
+                    opts.mixes[m] = values[m] > 100 ? 100 : values[m];
+                }
+                break;
+            case 't':
+                if (opts.type_count >= BENCH_MAX_TYPES) {
+                    break;
+                }
+                if (strcmp(optarg, "exec") == 0) {
+                    opts.types[opts.type_count++] = HIPS_RULE_EXEC;
+                } else if (strcmp(optarg, "dir") == 0) {
+                    opts.types[opts.type_count++] = BENCH_TYPE_DIR;
+                } else if (strcmp(optarg, "dns") == 0) {
+                    opts.types[opts.type_count++] = HIPS_RULE_DNS;
+                } else if (strcmp(optarg, "network") == 0) {
+                    opts.types[opts.type_count++] = HIPS_RULE_NETWORK;
+                } else if (strcmp(optarg, "hash") == 0) {
+                    opts.types[opts.type_count++] = HIPS_RULE_HASH;
+                } else {
+                    fprintf(stderr, "错误: 无效的规则类型: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'T':
+                opts.time_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                opts.min_ops = strtoul(optarg, NULL, 10);
+                break;
+            case 'N':
+                opts.numa = 1;
+                break;
+            case 'v':
+                hips_user_verbose = 1;
+                break;
+            case 'h':
+                print_help();
+                return 0;
+            default:
+                print_help();
+                return 1;
+        }
+    }
+
+    if (opts.type_count == 0) {
+        opts.types[0] = HIPS_RULE_EXEC;
+        opts.types[1] = BENCH_TYPE_DIR;
+        opts.types[2] = HIPS_RULE_DNS;
+        opts.types[3] = HIPS_RULE_NETWORK;
+        opts.types[4] = HIPS_RULE_HASH;
+        opts.type_count = BENCH_MAX_TYPES;
+    }
+
+    if (hips_user_init() != 0) {
+        fprintf(stderr, "错误: 无法初始化规则表\n");
+        return 1;
+    }
+
+    srand(12345);
+
+    if (opts.numa) {
+        printf("# HIPS 哈希规则 NUMA 副本微基准 (ns/op)\n");
+        printf("%-8s %9s %5s %12s %12s %12s\n", "type", "rules", "mix%", "table", "local",
+               "remote");
+        for (s = 0; s < opts.size_count; s++) {
+            u32 first_id = 0;
+
+            if (opts.sizes[s] == 0) {
+                continue;
+            }
+            bench_load_rules(HIPS_RULE_HASH, opts.sizes[s], &first_id);
+            bench_run_numa(opts.sizes[s], &opts);
+            hips_cleanup_rules();
+        }
+        hips_user_exit();
+        return 0;
+    }
+
+    printf("# HIPS 匹配引擎微基准 (add_ns: 每条规则插入耗时, hit%%: 实际命中率)\n");
+    printf("%-8s %9s %5s %10s %8s %12s %12s %7s\n",
+           "type", "rules", "mix%", "ops", "add_ns", "ns/op", "misses/op", "hit%");
+
+    for (t = 0; t < opts.type_count; t++) {
+        for (s = 0; s < opts.size_count; s++) {
+            double add_ns;
+            u32 first_id = 0;
+
+            if (opts.sizes[s] == 0) {
+                continue;
+            }
+
+            add_ns = bench_load_rules(opts.types[t], opts.sizes[s], &first_id);
+            for (m = 0; m < opts.mix_count; m++) {
+                bench_run_mix(opts.types[t], opts.sizes[s], opts.mixes[m], add_ns, &opts);
+            }
+            bench_delete_rules(opts.types[t], opts.sizes[s], first_id);
+            hips_cleanup_rules();
+        }
+    }
+
+    hips_user_exit();
+    return 0;
+}
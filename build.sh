@@ -183,36 +183,16 @@ create_config() {
     
     mkdir -p /etc/hips
     
-    if [ ! -f "/etc/hips/config.json" ]; then
-        cat > /etc/hips/config.json << 'EOF'
-{
-  "enabled": true,
-  "log_level": 2,
-  "max_rules": 1000,
-  "rules": [
-    {
-      "type": "exec",
-      "action": "block",
-      "priority": 100,
-      "target": "/usr/bin/malware.exe",
-      "description": "示例恶意软件"
-    },
-    {
-      "type": "dns",
-      "action": "block",
-      "priority": 50,
-      "target": "evil.com",
-      "description": "示例恶意域名"
-    },
-    {
-      "type": "network",
-      "action": "block",
-      "priority": 75,
-      "target": "192.168.1.100",
-      "description": "示例恶意IP"
-    }
-  ]
-}
+    if [ ! -f "/etc/hips/hips.conf" ]; then
+        cat > /etc/hips/hips.conf << 'EOF'
+# 设置项为 键=值；规则行: 类型|动作|优先级|目标|描述[|网络命名空间 inode[|cgroup ID[|过期时间[|规则 ID]]]]
+enabled=1
+log_level=2
+max_rules=1000
+
+exec|block|100|/usr/bin/malware.exe|示例恶意软件
+dns|block|50|evil.com|示例恶意域名
+network|block|75|192.168.1.100|示例恶意IP
 EOF
         print_success "配置文件创建完成"
     else
@@ -240,7 +220,7 @@ show_usage() {
     echo "  查看日志:    cat /proc/hips/logs"
     echo
     echo "配置文件："
-    echo "  编辑配置:    vi /etc/hips/config.json"
+    echo "  编辑配置:    vi /etc/hips/hips.conf"
     echo "  重新加载:    ./hipsctl reload"
 }
 
@@ -12,12 +12,38 @@
 #define HIPS_RULE_EXEC     1
 #define HIPS_RULE_DNS      2
 #define HIPS_RULE_NETWORK  3
+#define HIPS_RULE_HASH     4   // 可执行文件内容，target 为 64 位十六进制 SHA-256
+
+// 哈希规则的摘要长度
+#define HIPS_SHA256_SIZE   32
 
 // 动作类型
 #define HIPS_ACTION_BLOCK  0
 #define HIPS_ACTION_ALLOW  1
 #define HIPS_ACTION_LOG    2
 
+// 结构化网络规则的方向
+#define HIPS_DIR_ANY       0
+#define HIPS_DIR_OUT       1   // 本机发出的连接
+#define HIPS_DIR_IN        2   // 进入本机的连接
+
+// 规则标志
+#define HIPS_RULE_F_STRUCTURED  0x1   // 网络规则按 net 字段分类，而不是比较 target 字符串
+#define HIPS_RULE_F_CONFIG      0x2   // 来自配置文件，重新加载时与新配置比对，未出现的删除
+#define HIPS_RULE_F_SHADOW      0x4   // 属于影子规则集：只在抽样事件上评估并记录分歧，不执行
+
+// 结构化网络匹配条件（远端地址前缀、协议、目的端口范围、方向）
+struct hips_net_match {
+    __u32 family;      // AF_INET 或 AF_INET6
+    __u8 addr[16];     // 远端地址，IPv4 使用前 4 字节
+    __u8 prefix_len;   // 前缀长度，0 表示任意地址
+    __u8 protocol;     // IPPROTO_*，0 表示任意协议
+    __u8 direction;    // HIPS_DIR_*
+    __u8 reserved;
+    __u16 port_min;    // 目的端口范围（出站为远端端口，入站为本地端口），0-0 表示任意端口
+    __u16 port_max;
+};
+
 // 规则结构体
 struct hips_rule {
     __u32 rule_id;
@@ -26,6 +52,13 @@ struct hips_rule {
     __u32 priority;
     char target[256];
     char description[512];
+    __u32 netns_ino;   // 网络命名空间 inode 号，0 表示全局规则
+    __u32 flags;       // HIPS_RULE_F_*
+    __u64 cgroup_id;   // cgroup v2 ID（cgroup 目录 inode 号），0 表示全局规则
+    __u64 expires_at;  // 过期时间（Unix 秒），0 表示永不过期
+    struct hips_net_match net;   // 结构化网络规则的匹配条件
+    __u32 log_sample;  // 记录动作每 N 个事件记录一个（每 CPU），0 或 1 表示全部记录
+    __u32 log_rate;    // 记录动作每 CPU 每秒最多记录的事件数，0 表示不限
 };
 
 // 配置结构体
@@ -43,6 +76,69 @@ struct hips_stats {
     __u64 network_blocks;
     __u64 total_events;
     __u64 last_event_time;
+    __u64 dns_nxdomain;    // 合成的 NXDOMAIN 应答
+    __u64 dns_sinkhole;    // 合成的 sinkhole 应答
+    __u64 dns_dropped;     // 直接丢弃的 DNS 查询
+    __u64 ingress_drops;   // 网卡入口丢弃的入站报文
+    __u64 log_dropped;     // 事件池已满而丢弃的事件
+    __u64 shadow_rules;        // 影子规则集中的规则数
+    __u64 shadow_samples;      // 抽样评估影子规则集的事件
+    __u64 shadow_would_block;  // 影子规则集将阻止而生效规则集放行
+    __u64 shadow_would_allow;  // 影子规则集将放行而生效规则集阻止
+    __u64 shadow_live_ns;      // 抽样事件上生效规则集匹配的累计耗时
+    __u64 shadow_ns;           // 抽样事件上影子规则集匹配的累计耗时
+    __u64 shadow_max_ns;       // 影子规则集单次匹配的最大耗时
+    __u64 log_suppressed;      // 因规则的抽样或限速未记录的事件（已汇总部分）
+    __u64 replica_nodes;       // 摘要索引的 NUMA 副本数，未启用时为 0
+    __u64 replica_bytes;       // 所有 NUMA 副本占用的内存
+};
+
+// 钩子类型，按钩子统计评估次数和耗时
+#define HIPS_HOOK_EXEC     0
+#define HIPS_HOOK_DNS      1
+#define HIPS_HOOK_NETWORK  2
+#define HIPS_HOOK_MAX      3
+
+// 钩子耗时直方图：第 i 个桶的上界为 2^(i + HIPS_LAT_SHIFT) 纳秒（256 ns 到 4.2 ms），
+// 最后一个桶收纳更长的耗时
+#define HIPS_LAT_SHIFT     8
+#define HIPS_LAT_BUCKETS   16
+
+// 单个钩子的统计（各 CPU 计数之和）
+struct hips_hook_stats {
+    __u64 evals;               // 完成规则匹配的事件
+    __u64 matches;             // 命中规则的事件
+    __u64 blocks;              // 被阻止的事件
+    __u64 ns_sum;              // 累计耗时
+    __u64 lat[HIPS_LAT_BUCKETS];   // 耗时直方图（非累积）
+};
+
+// 单条规则的命中次数
+struct hips_rule_hits {
+    __u32 rule_id;
+    __u32 rule_type;
+    __u32 action;
+    __u32 priority;
+    __u64 hits;                // 加载以来的命中次数（各 CPU 计数之和）
+    char target[256];
+};
+
+// 一次取回 hipsctl top 所需的计数。命中过的规则按 ID 升序分页返回，
+// 每页最多 HIPS_BATCH_MAX 条；续页请求同样刷新其余计数
+struct hips_metrics {
+    __u64 timestamp;           // 取样时刻（单调时钟，纳秒）
+    struct hips_stats stats;
+    struct hips_hook_stats hooks[HIPS_HOOK_MAX];
+    __u64 digest_entries;      // 文件摘要缓存的条目数
+    __u64 digest_hits;
+    __u64 digest_misses;
+    __u64 digest_deferred;     // 交给工作队列计算摘要的次数
+    __u64 log_events;          // 写入日志环的事件数
+    __u32 start_id;            // 本页起始规则 ID，首页为 0
+    __u32 count;               // 输入为 rules 数组容量（可为 0），输出为本页条数
+    __u32 next_id;             // 输出：下一页的起始 ID，0 表示已返回全部命中过的规则
+    __u32 reserved;
+    __u64 rules;               // struct hips_rule_hits 数组
 };
 
 // 日志条目结构体
@@ -55,6 +151,36 @@ struct hips_log_entry {
     char process_name[256];
     char target[256];
     char details[512];
+    __u32 uid;
+    __u32 suppressed;  // 汇总记录：该规则在汇总周期内被抽样或限速略过的事件数
+    __u64 cgroup_id;
+    char exe[256];
+};
+
+// 批量规则操作，每次最多 HIPS_BATCH_MAX 项；指针字段为用户空间地址
+#define HIPS_BATCH_MAX  1024
+
+struct hips_rule_batch {
+    __u32 count;       // 规则条数
+    __u32 reserved;
+    __u64 rules;       // struct hips_rule 数组，按各条 flags 区分结构化规则，成功的条目回填规则 ID
+    __u64 status;      // __s32 数组，每项 0 或负的 errno
+};
+
+struct hips_id_batch {
+    __u32 count;       // 规则 ID 个数
+    __u32 reserved;
+    __u64 ids;         // __u32 数组
+    __u64 status;      // __s32 数组，每项 0 或负的 errno
+};
+
+// 分页导出规则：按 ID 升序返回 ID 不小于 start_id 的规则，每页最多 HIPS_BATCH_MAX 条
+struct hips_rule_dump {
+    __u32 start_id;    // 本页起始 ID，首页为 0
+    __u32 count;       // 输入为 rules 数组容量，输出为本页条数
+    __u32 next_id;     // 输出：下一页的起始 ID，0 表示已导出完毕
+    __u32 reserved;
+    __u64 rules;       // struct hips_rule 数组
 };
 
 // IOCTL 命令
@@ -70,6 +196,13 @@ struct hips_log_entry {
 #define HIPS_IOCTL_ENABLE       _IO(HIPS_MAGIC, 8)
 #define HIPS_IOCTL_DISABLE      _IO(HIPS_MAGIC, 9)
 #define HIPS_IOCTL_RELOAD       _IO(HIPS_MAGIC, 10)
+#define HIPS_IOCTL_ADD_NET_RULE _IOWR(HIPS_MAGIC, 11, struct hips_rule)
+#define HIPS_IOCTL_ADD_RULES    _IOW(HIPS_MAGIC, 12, struct hips_rule_batch)
+#define HIPS_IOCTL_DEL_RULES    _IOW(HIPS_MAGIC, 13, struct hips_id_batch)
+#define HIPS_IOCTL_DUMP_RULES   _IOWR(HIPS_MAGIC, 14, struct hips_rule_dump)
+#define HIPS_IOCTL_SHADOW_PROMOTE _IO(HIPS_MAGIC, 15)
+#define HIPS_IOCTL_SHADOW_CLEAR   _IO(HIPS_MAGIC, 16)
+#define HIPS_IOCTL_GET_METRICS    _IOWR(HIPS_MAGIC, 17, struct hips_metrics)
 
 // 错误码
 #define HIPS_SUCCESS            0
@@ -105,4 +238,95 @@ struct hips_process_info {
     char exe[256];
 };
 
+/*
+ * Generic netlink 接口
+ *
+ * 族名 "hips"。规则增删以批量消息提交：一条 HIPS_CMD_RULE_ADD 可带多个 HIPS_ATTR_RULE，
+ * 一条 HIPS_CMD_RULE_DEL 可带多个 HIPS_ATTR_RULE_ID，应答中每项对应一个 HIPS_ATTR_RESULT。
+ * HIPS_CMD_RULE_GET 以 NLM_F_DUMP 分页导出全部规则，每条消息一个 HIPS_ATTR_RULE。
+ * 事件以 HIPS_CMD_EVENT 发往多播组 "events"，可同时有多个订阅者。
+ * 新增属性只追加在末尾，老版本的客户端可以忽略不认识的属性。
+ */
+#define HIPS_GENL_NAME          "hips"
+#define HIPS_GENL_VERSION       1
+#define HIPS_GENL_MCGRP_EVENTS  "events"
+
+enum {
+    HIPS_CMD_UNSPEC,
+    HIPS_CMD_RULE_ADD,      // 批量添加规则
+    HIPS_CMD_RULE_DEL,      // 批量删除规则
+    HIPS_CMD_RULE_GET,      // 导出规则（dump）
+    HIPS_CMD_EVENT,         // 事件通知（多播）
+    __HIPS_CMD_MAX,
+};
+#define HIPS_CMD_MAX (__HIPS_CMD_MAX - 1)
+
+// 顶层属性
+enum {
+    HIPS_ATTR_UNSPEC,
+    HIPS_ATTR_RULE,         // 嵌套 HIPS_RATTR_*，可重复
+    HIPS_ATTR_RULE_ID,      // u32，可重复
+    HIPS_ATTR_RESULT,       // 嵌套 HIPS_RESATTR_*，每个请求项一个
+    HIPS_ATTR_EVENT,        // 嵌套 HIPS_EATTR_*
+    __HIPS_ATTR_MAX,
+};
+#define HIPS_ATTR_MAX (__HIPS_ATTR_MAX - 1)
+
+// 规则属性，对应 struct hips_rule 的字段
+enum {
+    HIPS_RATTR_UNSPEC,
+    HIPS_RATTR_ID,          // u32
+    HIPS_RATTR_TYPE,        // u32 HIPS_RULE_*
+    HIPS_RATTR_ACTION,      // u32 HIPS_ACTION_*
+    HIPS_RATTR_PRIORITY,    // u32
+    HIPS_RATTR_TARGET,      // string
+    HIPS_RATTR_DESC,        // string
+    HIPS_RATTR_NETNS,       // u32
+    HIPS_RATTR_CGROUP,      // u64
+    HIPS_RATTR_EXPIRES,     // u64
+    HIPS_RATTR_FLAGS,       // u32 HIPS_RULE_F_*
+    HIPS_RATTR_NET_FAMILY,  // u32
+    HIPS_RATTR_NET_ADDR,    // binary，4 或 16 字节
+    HIPS_RATTR_NET_PREFIX,  // u8
+    HIPS_RATTR_NET_PROTO,   // u8
+    HIPS_RATTR_NET_DIR,     // u8 HIPS_DIR_*
+    HIPS_RATTR_NET_PORT_MIN,    // u16
+    HIPS_RATTR_NET_PORT_MAX,    // u16
+    HIPS_RATTR_PAD,
+    HIPS_RATTR_LOG_SAMPLE,  // u32
+    HIPS_RATTR_LOG_RATE,    // u32
+    __HIPS_RATTR_MAX,
+};
+#define HIPS_RATTR_MAX (__HIPS_RATTR_MAX - 1)
+
+// 批量操作中单项的结果
+enum {
+    HIPS_RESATTR_UNSPEC,
+    HIPS_RESATTR_INDEX,     // u32，请求中的序号（从 0 开始）
+    HIPS_RESATTR_ID,        // u32，规则 ID
+    HIPS_RESATTR_ERROR,     // s32，0 或负的 errno
+    __HIPS_RESATTR_MAX,
+};
+#define HIPS_RESATTR_MAX (__HIPS_RESATTR_MAX - 1)
+
+// 事件属性，对应 struct hips_log_entry 的字段
+enum {
+    HIPS_EATTR_UNSPEC,
+    HIPS_EATTR_TIMESTAMP,   // u64，纳秒
+    HIPS_EATTR_RULE_ID,     // u32
+    HIPS_EATTR_RULE_TYPE,   // u32
+    HIPS_EATTR_ACTION,      // u32
+    HIPS_EATTR_PID,         // u32
+    HIPS_EATTR_UID,         // u32
+    HIPS_EATTR_CGROUP,      // u64
+    HIPS_EATTR_COMM,        // string
+    HIPS_EATTR_EXE,         // string
+    HIPS_EATTR_TARGET,      // string
+    HIPS_EATTR_DETAILS,     // string
+    HIPS_EATTR_PAD,
+    HIPS_EATTR_SUPPRESSED,  // u32，仅汇总记录
+    __HIPS_EATTR_MAX,
+};
+#define HIPS_EATTR_MAX (__HIPS_EATTR_MAX - 1)
+
 #endif /* HIPS_H */ 
\ No newline at end of file
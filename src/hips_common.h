@@ -1,6 +1,10 @@
 #ifndef HIPS_COMMON_H
 #define HIPS_COMMON_H
 
+#ifdef HIPS_USERSPACE
+// 用户空间构建（微基准、sanitizer、valgrind），内核接口由 shim 提供
+#include "../user/hips_shim.h"
+#else
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
@@ -10,6 +14,10 @@
 #include <linux/uaccess.h>
 #include <linux/slab.h>
 #include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
+#include <linux/xarray.h>
+#include <linux/rcupdate.h>
 #include <linux/spinlock.h>
 #include <linux/rwlock.h>
 #include <linux/security.h>
@@ -20,6 +28,9 @@
 #include <linux/ipv6.h>
 #include <linux/udp.h>
 #include <linux/tcp.h>
+#include <linux/inet.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
 #include <linux/string.h>
 #include <linux/time.h>
 #include <linux/version.h>
@@ -29,6 +40,13 @@
 #include <linux/nsproxy.h>
 #include <linux/ns_common.h>
 #include <linux/user_namespace.h>
+#include <linux/vmalloc.h>
+#include <linux/nodemask.h>
+#include <linux/topology.h>
+#include <linux/log2.h>
+#include <linux/rhashtable.h>
+#include <linux/workqueue.h>
+#endif
 
 #include "../include/hips.h"
 
@@ -36,7 +54,7 @@
 static int hips_enabled = 1;
 static int hips_log_level = HIPS_LOG_INFO;
 static int hips_max_rules = 1000;
-static char hips_config_file[256] = "/etc/hips/config.json";
+static char hips_config_file[256] = "/etc/hips/hips.conf";
 
 module_param(hips_enabled, int, 0644);
 module_param(hips_log_level, int, 0644);
@@ -46,17 +64,163 @@ module_param_string(hips_config_file, hips_config_file, sizeof(hips_config_file)
 // 规则结构体
 struct hips_rule_entry {
     struct list_head list;
+    struct list_head expire_list;   // 挂在过期时间轮上（仅限有过期时间的规则）
+    union {
+        struct hlist_node cls_node;     // 哈希规则挂在摘要表上
+        struct rhlist_head cls_list;    // 结构化网络规则挂在分类器元组的哈希表上
+    };
+    u8 digest[HIPS_SHA256_SIZE];    // 哈希规则的文件摘要，紧跟 cls_node，遍历摘要表的桶时不必访问 rule
+    struct hips_netcls_tuple *tuple;
+    struct list_head path_list;     // 挂在路径字典树节点上（可按目录组件匹配的 exec 规则）
+    struct hips_path_node *path_node;
+    struct hips_rule_set *set;      // 所属规则集
     struct hips_rule rule;
-    spinlock_t lock;
-    atomic_t ref_count;
+    u32 hash;                       // 规则内容哈希（不含 ID），重新加载配置时比对
+    u64 seq;                        // 加入顺序，同优先级时先加入的规则优先
+    u64 __percpu *hits;             // 每 CPU 命中计数，第一次命中时分配
+    struct hips_log_limit __percpu *limits; // 每 CPU 日志抽样和限速状态，第一次判定时分配
+    struct rcu_head rcu;            // 经 RCU 延迟释放，按 ID 查询不持有 config_lock
+};
+
+// 规则 a 是否优先于 b：优先级高者优先，同优先级时先加入的优先
+static inline bool hips_rule_precedes(const struct hips_rule_entry *a,
+                                      const struct hips_rule_entry *b)
+{
+    return a->rule.priority > b->rule.priority ||
+           (a->rule.priority == b->rule.priority && a->seq < b->seq);
+}
+
+// exec 路径规则的目录组件字典树
+// 规则模式按 '/' 拆成组件，每个组件一个节点；整个组件为 "*" 的通配节点匹配一个或多个组件，
+// 与 hips_match_pattern 对规范路径的匹配结果一致。子节点按 (父节点, 组件名) 存放在全局哈希表中，
+// 一次沿路径的遍历即可找到所有命中的目录规则。节点经 RCU 发布和释放，查找不持有 config_lock。
+struct hips_path_node {
+    struct hlist_node node;         // 挂在 path_table 上（通配节点除外）
+    struct hips_path_node *parent;  // 准备阶段尚未插入时用于串联备用节点
+    struct hips_path_node __rcu *wild;  // 通配子节点
+    struct list_head rules;         // 终止于本节点的规则，按优先级降序
+    u32 refs;                       // 子节点数加规则数，降为 0 时释放
+    u32 hash;
+    u16 len;
+    bool wildcard;
+    struct rcu_head rcu;
+    char name[];
+};
+
+struct hips_path_trie {
+    struct hips_path_node __rcu *root;
+    u32 count;
+};
+
+// 结构化网络规则分类器（元组空间搜索）
+// 规则按 (地址族, 前缀长度) 分成元组，每个元组内以掩码后的地址为键做哈希；
+// 查找时每个元组一次哈希，再比较同一地址下各规则的协议、端口范围和方向。
+// 已有命中不低于元组最高优先级时跳过该元组。元组链表是 RCU 链表，元组内是随规则数自动扩缩的
+// rhltable（同一地址的规则串在一起），查找不持有 config_lock
+struct hips_netcls_tuple {
+    struct list_head list;
+    u32 family;
+    u8 prefix_len;
+    u32 max_priority;   // 元组内规则优先级上界（删除规则后不回调，仍是有效上界）
+    u32 count;
+    struct rhltable table;
+    struct list_head free_list;     // 空了之后等待释放（rhltable_destroy 可能睡眠，由工作项完成）
+};
+
+struct hips_netcls {
+    struct list_head tuples;
+    u32 count;
+};
+
+// 分类器查找键：远端地址、协议、目的端口、方向
+struct hips_net_key {
+    u32 family;
+    u8 addr[16];
+    u8 protocol;
+    u8 direction;
+    u16 port;
 };
 
+// 规则集：全局规则、某个网络命名空间或某个 cgroup 的规则，各列表按优先级降序
+struct hips_rule_set {
+    struct list_head list;          // 挂在 net_rule_sets 上（网络命名空间规则集）
+    struct hlist_node node;         // 挂在 cgroup_rule_sets 上（cgroup 规则集）
+    struct list_head exec_rules;
+    struct list_head dns_rules;
+    struct list_head network_rules; // 字符串网络规则
+    struct list_head hash_rules;    // 哈希规则（由全局摘要表匹配，列表只用于管理）
+    struct list_head path_rules;    // 由路径字典树匹配的 exec 规则（字典树无法容纳时逐条匹配）
+    struct list_head netcls_rules;  // 结构化网络规则（由分类器匹配，列表只用于管理）
+    struct hips_path_trie paths;
+    struct hips_netcls netcls;
+    u32 network_strings;            // network_rules 中的规则数，为 0 时网络钩子不格式化地址也不遍历
+    u32 netns_ino;      // 网络命名空间 inode 号，0 表示不限命名空间
+    u64 cgroup_id;      // cgroup v2 ID，0 表示不限 cgroup
+    u32 rule_count;
+    struct rcu_head rcu;    // cgroup 规则集变空后经 RCU 宽限期释放
+};
+
+// 按 NUMA 节点复制的摘要索引
+// 哈希规则（IOC 摘要）编译成不可变的开放寻址表，每个有内存的节点一份，同一代的副本一起发布。
+// 每个槽位一条缓存行，包含判断范围、过期和优先级所需的全部字段，查找时不访问规则条目和规则集
+struct hips_replica_slot {
+    u8 digest[HIPS_SHA256_SIZE];
+    u32 rule_id;                        // 0 表示空槽
+    u32 priority;
+    u64 expires_at;
+    const struct hips_rule_set *set;    // 所属规则集，只用于比较
+    u64 cgroup_id;                      // 所属规则集的 cgroup ID，0 表示非 cgroup 规则集
+};
+
+struct hips_digest_replica {
+    u32 mask;                           // 槽位数减 1（槽位数为 2 的幂）
+    u32 count;
+    struct hips_replica_slot slots[];
+};
+
+struct hips_replica_set {
+    u64 gen;                            // 编译时的摘要表代数，与当前代数不同时不再使用
+    u64 bytes;                          // 所有副本占用的内存
+    u32 nodes;                          // 副本数
+    struct hips_digest_replica *primary;    // 没有副本的节点使用的副本
+    struct hips_digest_replica *node[];     // 按节点号，nr_node_ids 项
+};
+
+// cgroup 规则集哈希表大小
+#define HIPS_CGROUP_HASH_BITS  10
+
+// 规则过期时间轮：每格 64 秒，共 1024 格（约 18 小时一圈）
+#define HIPS_EXPIRE_SLOT_SECS   64
+#define HIPS_EXPIRE_WHEEL_SLOTS 1024
+
+// 配置文件规则集在 global_sets 中的下标，始终生效
+#define HIPS_CONFIG_SET         2
+
 // 全局配置结构体
+// config_lock 只由修改规则表的一方获取，匹配路径（包括软中断中的网络钩子）在 RCU 读临界区内查找
 struct hips_global_config {
     spinlock_t config_lock;
-    struct list_head exec_rules;
-    struct list_head dns_rules;
-    struct list_head network_rules;
+    struct xarray rule_index;       // 规则 ID 到条目的索引，覆盖所有规则集
+    struct hips_rule_set __rcu *rules;  // 生效的全局规则集
+    struct hips_rule_set __rcu *shadow; // 影子全局规则集：只在抽样事件上评估，不执行
+    struct hips_rule_set global_sets[3];    // rules 和 shadow 指向前两个之一，提升时交换指针；
+                                            // global_sets[HIPS_CONFIG_SET] 存放全局范围的配置文件规则，不参与交换
+    struct list_head net_rule_sets;
+    DECLARE_HASHTABLE(cgroup_rule_sets, HIPS_CGROUP_HASH_BITS);
+    u32 cgroup_set_count;
+    struct list_head expire_wheel[HIPS_EXPIRE_WHEEL_SLOTS];
+    u64 expire_clock;       // 过期水位：expires_at 不晚于它的规则一律不再匹配
+    u64 expire_next;        // 时间轮下一次回收的起点（秒）
+    u32 expire_count;       // 时间轮上的规则数
+    u32 netcls_count;       // 所有规则集中的结构化网络规则数
+    struct hlist_head *digest_table;    // 所有规则集的哈希规则按摘要分桶，第一条哈希规则加入时分配
+    u32 digest_bits;
+    u32 hash_count;         // 所有规则集中的哈希规则数
+    u64 digest_gen;         // 摘要表代数，哈希规则加入或移除时递增
+    struct hips_replica_set __rcu *replicas;    // 摘要索引的 NUMA 副本，未启用或尚未编译时为 NULL
+    struct hlist_head *path_table;      // 所有规则集的路径字典树节点，第一条目录规则加入时分配
+    u32 path_bits;
+    u64 rule_seq;           // 规则加入顺序计数
     struct hips_stats stats;
     struct hips_config config;
     struct proc_dir_entry *proc_dir;
@@ -64,52 +228,273 @@ struct hips_global_config {
     dev_t dev_num;
 };
 
-// 日志条目结构体
-struct hips_log_entry_internal {
-    struct list_head list;
-    struct hips_log_entry entry;
-    unsigned long timestamp;
+// 被阻止 DNS 查询的处理方式
+#define HIPS_DNS_RESPONSE_DROP      0   // 丢弃查询
+#define HIPS_DNS_RESPONSE_NXDOMAIN  1   // 合成 NXDOMAIN 应答
+#define HIPS_DNS_RESPONSE_SINKHOLE  2   // 合成指向 sinkhole 地址的 A/AAAA 应答
+
+// DNS 查询信息
+struct hips_dns_query {
+    u8 protocol;        // IPPROTO_UDP 或 IPPROTO_TCP
+    __be16 sport;
+    __be16 dport;
+    int l4_offset;      // 传输层头偏移
+    int dns_offset;     // DNS 报文偏移
+    int question_len;   // 问题节长度（QNAME + QTYPE + QCLASS）
+    u16 id;
+    u16 flags;
+    u16 qtype;
 };
 
+// 事件归属的进程信息
+struct hips_owner {
+    u32 pid;
+    u32 uid;
+    u64 cgroup_id;
+    u64 exe_ino;        // 可执行文件的 inode 号和设备号，路径由日志工作项按 pid 解析
+    u32 exe_dev;
+    char comm[TASK_COMM_LEN];
+};
+
+// 事件标志，日志工作项据此生成说明文字
+#define HIPS_EVENT_F_DYNIP      0x1     // 命中 DNS 动态 IP
+#define HIPS_EVENT_F_INBOUND    0x2     // 入站方向
+#define HIPS_EVENT_F_INGRESS    0x4     // 在网卡入口丢弃
+#define HIPS_EVENT_F_SHADOW_BLOCK   0x8     // 影子规则集将阻止（生效规则集放行）
+#define HIPS_EVENT_F_SHADOW_ALLOW   0x10    // 影子规则集将放行（生效规则集阻止）
+#define HIPS_EVENT_F_SUMMARY        0x20    // 抽样/限速略过事件的汇总记录
+
 // 全局变量
 extern struct hips_global_config *hips_config;
 
+// 持有 config_lock 时读取规则表中的 RCU 指针，匹配路径在 RCU 读临界区内用 rcu_dereference
+#define hips_deref_locked(p) \
+    rcu_dereference_protected(p, lockdep_is_held(&hips_config->config_lock))
+
 // 函数声明
 // 主模块函数
 int hips_init_module(void);
 void hips_exit_module(void);
 
 // 钩子函数
+int hips_register_hooks(void);
+void hips_unregister_hooks(void);
 int hips_exec_hook(struct linux_binprm *bprm);
 int hips_dns_hook(struct sk_buff *skb, const struct nf_hook_state *state);
 int hips_network_hook(struct sk_buff *skb, const struct nf_hook_state *state);
+struct hips_rule_set *hips_net_rules(struct net *net);
+
+// 网卡入口早期丢弃
+int hips_ingress_init(void);
+void hips_ingress_exit(void);
+unsigned int hips_ingress_filter(struct sk_buff *skb, struct net *net);
+u64 hips_ingress_get_drops(void);
+
+// 报文解析函数
+int hips_get_l4_ports(struct sk_buff *skb, u8 pf, u8 *protocol, __be16 *sport, __be16 *dport);
+int hips_parse_dns_query(struct sk_buff *skb, u8 pf, struct hips_dns_query *query,
+                         char *domain, size_t domain_size);
+int hips_dns_respond(struct sk_buff *skb, const struct nf_hook_state *state,
+                     const struct hips_dns_query *query);
+void hips_dns_track_query(struct sk_buff *skb, const struct nf_hook_state *state,
+                          const struct hips_dns_query *query, const char *domain,
+                          const struct hips_rule *rule);
+int hips_dns_learn_response(struct sk_buff *skb, const struct nf_hook_state *state);
+int hips_parse_network_addr(struct sk_buff *skb, struct hips_network_addr *addr);
+void hips_format_network_addr(struct hips_network_addr *addr, char *str, size_t size);
+
+// 套接字归属函数
+void hips_current_owner(struct hips_owner *owner, u64 cgroup_id);
+void hips_sock_owner_capture(struct sock *sk, u64 cgroup_id, gfp_t gfp);
+void hips_sock_owner_release(struct sock *sk);
+int hips_sock_owner_get(const struct sock *sk, struct hips_owner *owner);
+void hips_skb_owner(struct sk_buff *skb, u64 cgroup_id, struct hips_owner *owner);
+void hips_sock_owner_cleanup(void);
+
+// 动态 IP 表函数
+int hips_dynip_init(void);
+void hips_dynip_exit(void);
+int hips_dynip_add(u32 family, const u8 *addr, u32 ttl, const struct hips_rule *rule);
+int hips_dynip_lookup(const struct hips_network_addr *addr, u32 netns_ino,
+                      struct hips_rule *rule);
+void hips_dynip_flush(void);
+void hips_dynip_forget(u32 *rule_ids, int count);
+void hips_dynip_get_stats(u32 *entries, u64 *inserted, u64 *expired, u64 *overflow);
+
+// 可执行文件摘要缓存
+int hips_digest_init(void);
+void hips_digest_exit(void);
+int hips_digest_file(struct file *file, u8 *digest);
+void hips_digest_get_stats(u32 *entries, u64 *hits, u64 *misses, u64 *deferred);
 
 // 规则管理函数
 int hips_add_rule(struct hips_rule *rule);
 int hips_del_rule(u32 rule_id);
+int hips_add_rules(struct hips_rule *rules, int count, int *status);
+int hips_del_rules(const u32 *rule_ids, int count, int *status);
 int hips_get_rule(u32 rule_id, struct hips_rule *rule);
+int hips_dump_rules(u32 start_id, struct hips_rule *rules, int max);
 int hips_match_rule(u32 rule_type, const char *target, struct hips_rule *matched_rule);
+int hips_match_rule_scoped(struct hips_rule_set *net_set, u64 cgroup_id, u32 rule_type,
+                           const char *target, struct hips_rule *matched_rule);
+int hips_match_network(struct hips_rule_set *net_set, u64 cgroup_id, const struct hips_net_key *key,
+                       const char *target, struct hips_rule *matched_rule);
+bool hips_network_strings(struct hips_rule_set *net_set, u64 cgroup_id, bool shadow);
+int hips_match_digest(struct hips_rule_set *net_set, u64 cgroup_id, const u8 *digest,
+                      struct hips_rule *matched_rule);
+void hips_cleanup_rules(void);
+int hips_expire_rules(u64 now);
+int hips_shadow_match_rule(struct hips_rule_set *net_set, u64 cgroup_id, u32 rule_type,
+                           const char *target, struct hips_rule *matched_rule);
+int hips_shadow_match_network(struct hips_rule_set *net_set, u64 cgroup_id,
+                              const struct hips_net_key *key, const char *target,
+                              struct hips_rule *matched_rule);
+int hips_shadow_match_digest(struct hips_rule_set *net_set, u64 cgroup_id, const u8 *digest,
+                             struct hips_rule *matched_rule);
+u32 hips_shadow_rule_count(void);
+int hips_shadow_promote(void);
+int hips_shadow_clear(void);
+int hips_parse_rules_command(const char *data, size_t size);
+int hips_parse_rule_line(const char *line);
+int hips_parse_rule(const char *line, struct hips_rule *rule);
+int hips_format_rule_line(const struct hips_rule *rule, char *buf, size_t size);
+
+// 配置文件增量重载的结果
+struct hips_rule_delta {
+    u32 kept;                       // 内容未变而保留的规则
+    u32 added;
+    u32 removed;
+    u32 failed;                     // 无法解析或添加失败的规则行
+    u32 *removed_ids;               // 被删除的规则 ID，由调用者 kvfree
+};
+
+int hips_sync_config_rules(const char *const *lines, int count, struct hips_rule_delta *delta);
+
+// 结构化网络规则分类器函数
+void hips_netcls_init(struct hips_netcls *cls);
+int hips_netcls_normalize(struct hips_net_match *match);
+struct hips_netcls_tuple *hips_netcls_tuple_alloc(void);
+void hips_netcls_tuple_free(struct hips_netcls_tuple *tuple);
+int hips_netcls_insert(struct hips_netcls *cls, struct hips_rule_entry *entry,
+                       struct hips_netcls_tuple **spare);
+void hips_netcls_remove(struct hips_netcls *cls, struct hips_rule_entry *entry);
+void hips_netcls_flush(struct hips_netcls *cls);
+void hips_netcls_drain(void);
+struct hips_rule_entry *hips_netcls_lookup(struct hips_netcls *cls, const struct hips_net_key *key,
+                                           u64 clock, struct hips_rule_entry *best);
+
+// exec 路径字典树函数
+int hips_path_canonicalize(const char *path, char *buf, size_t size);
+u32 hips_pathtrie_table_bits(void);
+int hips_pathtrie_alloc(const char *pattern, struct hips_path_node **chain);
+void hips_pathtrie_free_spare(struct hips_path_node *chain);
+void hips_pathtrie_insert(struct hips_path_trie *trie, struct hips_rule_entry *entry,
+                          struct hips_path_node **spare);
+void hips_pathtrie_remove(struct hips_path_trie *trie, struct hips_rule_entry *entry);
+bool hips_pathtrie_lookup(struct hips_path_trie *trie, const char *path, u64 clock,
+                          struct hips_rule_entry **best);
+
+// 摘要索引的 NUMA 副本
+u32 hips_replica_capacity(u32 count);
+u64 hips_replica_bytes(u32 capacity);
+int hips_replica_compile(struct hips_digest_replica *rep, u32 capacity);
+u32 hips_replica_lookup(const struct hips_digest_replica *rep, const struct hips_rule_set *live,
+                        const struct hips_rule_set *net_set, u64 cgroup_id, u64 clock,
+                        const u8 *digest);
+int hips_replica_match(struct hips_rule_set *net_set, u64 cgroup_id, const u8 *digest,
+                       struct hips_rule *matched_rule);
+int hips_replica_rebuild(void);
+void hips_replica_refresh(void);
+void hips_replica_drop(void);
+void hips_replica_get_stats(u32 *nodes, u64 *bytes, u32 *entries, bool *fresh, u64 *rebuilds,
+                            u64 *build_ns);
+
+// 规则集函数
+void hips_rules_init(void);
+void hips_rule_set_init(struct hips_rule_set *set, u32 netns_ino);
+void hips_register_rule_set(struct hips_rule_set *set);
+void hips_unregister_rule_set(struct hips_rule_set *set);
 
 // 配置管理函数
 int hips_load_config(void);
 int hips_save_config(void);
+int hips_parse_config(char *config_data, size_t size);
+char *hips_generate_config(void);
 int hips_reload_config(void);
 
-// 日志函数
-void hips_log_event(u32 rule_id, u32 rule_type, u32 action, u32 pid, 
-                   const char *process_name, const char *target, const char *details);
+// 日志函数：钩子只写入每 CPU 事件池，格式化由工作队列完成
+int hips_log_init(void);
+void hips_log_exit(void);
+void hips_log_event(u32 rule_id, u32 rule_type, u32 action, const struct hips_owner *owner,
+                    const char *target, u32 flags);
+void hips_log_net_event(u32 rule_id, u32 action, const struct hips_owner *owner,
+                        const struct hips_network_addr *addr, u32 flags);
+void hips_log_exec_event(u32 rule_id, u32 rule_type, u32 action, const struct hips_owner *owner,
+                         struct file *file, const u8 *digest, u32 flags);
 int hips_get_logs(struct hips_log_entry *entries, int max_entries);
+void hips_log_range(u64 *first, u64 *end);
+int hips_log_read(u64 seq, struct hips_log_entry *entry);
+u64 hips_log_get_dropped(void);
+bool hips_log_admit(u32 rule_id, u32 sample, u32 rate);
+u64 hips_log_get_suppressed(void);
+
+// 影子规则集抽样评估：hips_shadow_sampled 为真时钩子记录生效规则集的匹配开始时间和结论，
+// 再调用对应的 hips_shadow_check_* 评估影子规则集、比较结论并记录开销
+struct hips_shadow_live {
+    u64 start;              // 生效规则集匹配开始时间 (ns)
+    u32 rule_id;            // 生效规则集命中的规则，0 表示未命中
+    u32 rule_type;
+    bool blocked;
+};
+
+bool hips_shadow_sampled(void);
+void hips_shadow_check_exec(struct file *file, const char *path, struct hips_rule_set *net_set,
+                            u64 cgroup_id, const struct hips_shadow_live *live);
+void hips_shadow_check_dns(struct sk_buff *skb, struct hips_rule_set *net_set, u64 cgroup_id,
+                           const char *domain, const struct hips_shadow_live *live);
+void hips_shadow_check_network(struct sk_buff *skb, struct hips_rule_set *net_set, u64 cgroup_id,
+                               const struct hips_net_key *key, const struct hips_network_addr *addr,
+                               const char *addr_str, u32 event_flags,
+                               const struct hips_shadow_live *live);
+void hips_shadow_get_stats(struct hips_stats *stats);
+void hips_shadow_reset_stats(void);
 
 // 统计函数
 void hips_update_stats(u32 rule_type, u32 action);
+void hips_update_dns_stats(int response);
 int hips_get_stats(struct hips_stats *stats);
 
+// 钩子和规则命中计数（每 CPU）
+u32 hips_metrics_bucket(u64 ns);
+u64 hips_metrics_begin(void);
+void hips_metrics_eval(u32 hook, u64 start, u32 rule_id, bool blocked);
+void hips_metrics_rule_hit(u32 rule_id);
+u64 hips_metrics_rule_hits(const struct hips_rule_entry *entry);
+void hips_metrics_get_hooks(struct hips_hook_stats *stats);
+int hips_metrics_dump_hits(u32 start_id, struct hips_rule_hits *hits, int max);
+
+// /proc/hips 下的 status、rules、logs、metrics
+int hips_procfs_init(struct proc_dir_entry *proc_dir);
+void hips_procfs_exit(struct proc_dir_entry *proc_dir);
+
+#ifdef CONFIG_HIPS_REPLAY
+// 报文回放测试
+int hips_replay_init(struct proc_dir_entry *proc_dir);
+void hips_replay_exit(struct proc_dir_entry *proc_dir);
+#endif
+
 // 用户空间接口函数
 int hips_open(struct inode *inode, struct file *file);
 int hips_release(struct inode *inode, struct file *file);
 long hips_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
 ssize_t hips_read(struct file *file, char __user *buf, size_t count, loff_t *ppos);
 ssize_t hips_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos);
+long hips_errno(int ret);
+
+// generic netlink 接口：批量规则管理和事件多播
+int hips_genl_init(void);
+void hips_genl_exit(void);
+void hips_genl_notify_event(const struct hips_log_entry *entry);
 
 // 工具函数
 char *hips_get_process_name(struct task_struct *task);
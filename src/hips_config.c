@@ -1,212 +1,15 @@
-#include "hips_common.h"
-
-// 规则计数器
-static atomic_t rule_id_counter = ATOMIC_INIT(0);
-
-// 添加规则
-int hips_add_rule(struct hips_rule *rule)
-{
-    struct hips_rule_entry *entry;
-    struct list_head *rule_list;
-    
-    if (!hips_config || !rule) {
-        return HIPS_ERROR_INVALID;
-    }
-    
-    // 分配规则条目
-    entry = kzalloc(sizeof(struct hips_rule_entry), GFP_KERNEL);
-    if (!entry) {
-        HIPS_ERROR("无法分配规则内存");
-        return HIPS_ERROR_MEMORY;
-    }
-    
-    // 设置规则ID
-    if (rule->rule_id == 0) {
-        rule->rule_id = atomic_inc_return(&rule_id_counter);
-    }
-    
-    // 复制规则数据
-    memcpy(&entry->rule, rule, sizeof(struct hips_rule));
-    
-    // 初始化锁和引用计数
-    spin_lock_init(&entry->lock);
-    atomic_set(&entry->ref_count, 1);
-    
-    // 根据规则类型选择列表
-    switch (rule->rule_type) {
-        case HIPS_RULE_EXEC:
-            rule_list = &hips_config->exec_rules;
-            break;
-        case HIPS_RULE_DNS:
-            rule_list = &hips_config->dns_rules;
-            break;
-        case HIPS_RULE_NETWORK:
-            rule_list = &hips_config->network_rules;
-            break;
-        default:
-            HIPS_ERROR("无效的规则类型: %u", rule->rule_type);
-            kfree(entry);
-            return HIPS_ERROR_INVALID;
-    }
-    
-    // 添加到规则列表
-    spin_lock(&hips_config->config_lock);
-    list_add_tail(&entry->list, rule_list);
-    spin_unlock(&hips_config->config_lock);
-    
-    HIPS_INFO("添加规则成功: ID=%u, 类型=%u, 目标=%s", 
-              rule->rule_id, rule->rule_type, rule->target);
-    
-    return HIPS_SUCCESS;
-}
-
-// 删除规则
-int hips_del_rule(u32 rule_id)
-{
-    struct hips_rule_entry *entry, *tmp;
-    struct list_head *rule_lists[] = {
-        &hips_config->exec_rules,
-        &hips_config->dns_rules,
-        &hips_config->network_rules
-    };
-    int i;
-    
-    if (!hips_config) {
-        return HIPS_ERROR_INVALID;
-    }
-    
-    spin_lock(&hips_config->config_lock);
-    
-    // 在所有规则列表中查找并删除
-    for (i = 0; i < ARRAY_SIZE(rule_lists); i++) {
-        list_for_each_entry_safe(entry, tmp, rule_lists[i], list) {
-            if (entry->rule.rule_id == rule_id) {
-                list_del(&entry->list);
-                spin_unlock(&hips_config->config_lock);
-                
-                // 等待引用计数归零
-                while (atomic_read(&entry->ref_count) > 1) {
-                    schedule();
-                }
-                
-                kfree(entry);
-                HIPS_INFO("删除规则成功: ID=%u", rule_id);
-                return HIPS_SUCCESS;
-            }
-        }
-    }
-    
-    spin_unlock(&hips_config->config_lock);
-    HIPS_WARN("未找到规则: ID=%u", rule_id);
-    return HIPS_ERROR_NOT_FOUND;
-}
+#include <linux/vmalloc.h>
 
-// 获取规则
-int hips_get_rule(u32 rule_id, struct hips_rule *rule)
-{
-    struct hips_rule_entry *entry;
-    struct list_head *rule_lists[] = {
-        &hips_config->exec_rules,
-        &hips_config->dns_rules,
-        &hips_config->network_rules
-    };
-    int i;
-    
-    if (!hips_config || !rule) {
-        return HIPS_ERROR_INVALID;
-    }
-    
-    spin_lock(&hips_config->config_lock);
-    
-    // 在所有规则列表中查找
-    for (i = 0; i < ARRAY_SIZE(rule_lists); i++) {
-        list_for_each_entry(entry, rule_lists[i], list) {
-            if (entry->rule.rule_id == rule_id) {
-                memcpy(rule, &entry->rule, sizeof(struct hips_rule));
-                spin_unlock(&hips_config->config_lock);
-                return HIPS_SUCCESS;
-            }
-        }
-    }
-    
-    spin_unlock(&hips_config->config_lock);
-    return HIPS_ERROR_NOT_FOUND;
-}
-
-// 匹配规则
-int hips_match_rule(u32 rule_type, const char *target, struct hips_rule *matched_rule)
-{
-    struct hips_rule_entry *entry;
-    struct list_head *rule_list;
-    
-    if (!hips_config || !target || !matched_rule) {
-        return HIPS_ERROR_INVALID;
-    }
-    
-    // 根据规则类型选择列表
-    switch (rule_type) {
-        case HIPS_RULE_EXEC:
-            rule_list = &hips_config->exec_rules;
-            break;
-        case HIPS_RULE_DNS:
-            rule_list = &hips_config->dns_rules;
-            break;
-        case HIPS_RULE_NETWORK:
-            rule_list = &hips_config->network_rules;
-            break;
-        default:
-            return HIPS_ERROR_INVALID;
-    }
-    
-    spin_lock(&hips_config->config_lock);
-    
-    // 遍历规则列表进行匹配
-    list_for_each_entry(entry, rule_list, list) {
-        if (entry->rule.rule_type == rule_type) {
-            if (hips_match_pattern(entry->rule.target, target)) {
-                atomic_inc(&entry->ref_count);
-                memcpy(matched_rule, &entry->rule, sizeof(struct hips_rule));
-                spin_unlock(&hips_config->config_lock);
-                return HIPS_SUCCESS;
-            }
-        }
-    }
-    
-    spin_unlock(&hips_config->config_lock);
-    return HIPS_ERROR_NOT_FOUND;
-}
+#include "hips_common.h"
 
-// 模式匹配（支持通配符）
-int hips_match_pattern(const char *pattern, const char *string)
-{
-    if (!pattern || !string) {
-        return 0;
-    }
-    
-    // 精确匹配
-    if (strcmp(pattern, string) == 0) {
-        return 1;
-    }
-    
-    // 通配符匹配（简化实现）
-    if (strstr(pattern, "*") || strstr(pattern, "?")) {
-        // 这里实现通配符匹配逻辑
-        // 简化实现，实际需要更复杂的模式匹配
-        return 0;
-    }
-    
-    // 前缀匹配
-    if (pattern[strlen(pattern) - 1] == '*') {
-        char prefix[256];
-        strncpy(prefix, pattern, strlen(pattern) - 1);
-        prefix[strlen(pattern) - 1] = '\0';
-        if (strncmp(string, prefix, strlen(prefix)) == 0) {
-            return 1;
-        }
-    }
-    
-    return 0;
-}
+/*
+ * 配置文件
+ *
+ * 每行一项：`键=值` 设置模块参数（enabled、log_level、max_rules），
+ * 其余为与 /proc/hips/rules 相同格式的规则行，可在末尾带上规则 ID；# 开头为注释。
+ * 从配置文件加载的规则带 HIPS_RULE_F_CONFIG 标记，重新加载时与新内容增量比对，
+ * 通过 ioctl、proc 和 netlink 添加的规则不受重新加载影响。
+ */
 
 // 加载配置
 int hips_load_config(void)
@@ -214,6 +17,7 @@ int hips_load_config(void)
     struct file *file;
     char *buf;
     loff_t pos = 0;
+    loff_t size;
     int ret = 0;
     
     if (!hips_config) {
@@ -227,27 +31,27 @@ int hips_load_config(void)
         return HIPS_ERROR_INVALID;
     }
     
-    // 读取文件内容
-    buf = kmalloc(file->f_inode->i_size + 1, GFP_KERNEL);
+    // 读取文件内容，情报源可能有上百 MB
+    size = i_size_read(file_inode(file));
+    buf = kvmalloc(size + 1, GFP_KERNEL);
     if (!buf) {
         filp_close(file, NULL);
         return HIPS_ERROR_MEMORY;
     }
     
-    ret = kernel_read(file, buf, file->f_inode->i_size, &pos);
+    ret = kernel_read(file, buf, size, &pos);
     if (ret < 0) {
         HIPS_ERROR("读取配置文件失败: %d", ret);
-        kfree(buf);
+        kvfree(buf);
         filp_close(file, NULL);
         return ret;
     }
     
     buf[ret] = '\0';
     
-    // 解析配置文件（简化实现）
     ret = hips_parse_config(buf, ret);
     
-    kfree(buf);
+    kvfree(buf);
     filp_close(file, NULL);
     
     if (ret == 0) {
@@ -257,13 +61,16 @@ int hips_load_config(void)
     return ret;
 }
 
-// 保存配置
+// 保存配置：设置项之后逐页写出配置规则，不在内存中生成整个文件
 int hips_save_config(void)
 {
+    struct hips_rule *rules;
     struct file *file;
-    char *buf;
+    char *buf, *line;
     loff_t pos = 0;
+    u32 next_id = 0;
     int ret = 0;
+    int count, i;
     
     if (!hips_config) {
         return HIPS_ERROR_INVALID;
@@ -271,91 +78,143 @@ int hips_save_config(void)
     
     // 生成配置内容
     buf = hips_generate_config();
-    if (!buf) {
-        return HIPS_ERROR_MEMORY;
+    rules = kvmalloc_array(HIPS_BATCH_MAX, sizeof(*rules), GFP_KERNEL);
+    line = kmalloc(PAGE_SIZE, GFP_KERNEL);
+    if (!buf || !rules || !line) {
+        ret = HIPS_ERROR_MEMORY;
+        goto out;
     }
     
     // 创建配置文件
     file = filp_open(hips_config->config.config_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (IS_ERR(file)) {
         HIPS_ERROR("无法创建配置文件: %s", hips_config->config.config_file);
-        kfree(buf);
-        return HIPS_ERROR_INVALID;
+        ret = HIPS_ERROR_INVALID;
+        goto out;
     }
     
     // 写入配置内容
     ret = kernel_write(file, buf, strlen(buf), &pos);
+    while (ret >= 0 && (count = hips_dump_rules(next_id, rules, HIPS_BATCH_MAX)) > 0) {
+        for (i = 0; i < count && ret >= 0; i++) {
+            // 结构化网络规则无法用规则行表示，影子规则集中的配置规则是提升前的旧内容
+            if (!(rules[i].flags & HIPS_RULE_F_CONFIG) ||
+                (rules[i].flags & (HIPS_RULE_F_STRUCTURED | HIPS_RULE_F_SHADOW))) {
+                continue;
+            }
+            ret = hips_format_rule_line(&rules[i], line, PAGE_SIZE);
+            if (ret >= 0) {
+                ret = kernel_write(file, line, ret, &pos);
+            }
+        }
+        next_id = rules[count - 1].rule_id + 1;
+        if (count < HIPS_BATCH_MAX || next_id == 0) {
+            break;
+        }
+    }
     if (ret < 0) {
         HIPS_ERROR("写入配置文件失败: %d", ret);
     } else {
         HIPS_INFO("配置文件保存成功");
     }
     
-    kfree(buf);
     filp_close(file, NULL);
     
+out:
+    kfree(line);
+    kvfree(rules);
+    kfree(buf);
     return ret;
 }
 
-// 重新加载配置
+// 重新加载配置：只添加和删除相对现有配置规则有变化的规则
 int hips_reload_config(void)
 {
-    int ret;
-    
     if (!hips_config) {
         return HIPS_ERROR_INVALID;
     }
     
     HIPS_INFO("重新加载配置");
     
-    // 清理现有规则
-    hips_cleanup_rules();
+    return hips_load_config();
+}
+
+// 设置项，未知的键只告警
+static void hips_parse_setting(char *line)
+{
+    char *key = strim(strsep(&line, "="));
+    char *value = strim(line);
+    u32 number;
     
-    // 加载新配置
-    ret = hips_load_config();
+    if (kstrtou32(value, 10, &number) != 0) {
+        HIPS_WARN("配置项取值无效: %s=%s", key, value);
+        return;
+    }
     
-    return ret;
+    if (strcmp(key, "enabled") == 0) {
+        WRITE_ONCE(hips_config->config.enabled, !!number);
+    } else if (strcmp(key, "log_level") == 0) {
+        WRITE_ONCE(hips_config->config.log_level, min_t(u32, number, HIPS_LOG_DEBUG));
+    } else if (strcmp(key, "max_rules") == 0) {
+        WRITE_ONCE(hips_config->config.max_rules, number);
+    } else {
+        HIPS_WARN("未知的配置项: %s", key);
+    }
 }
 
-// 清理规则列表
-void hips_cleanup_rules(void)
+// 解析配置文件：设置项立即生效，规则行交给增量重载
+int hips_parse_config(char *config_data, size_t size)
 {
-    struct hips_rule_entry *entry, *tmp;
-    struct list_head *rule_lists[] = {
-        &hips_config->exec_rules,
-        &hips_config->dns_rules,
-        &hips_config->network_rules
-    };
-    int i;
+    struct hips_rule_delta delta;
+    char **lines;
+    char *line, *cursor, *p;
+    int count = 0, capacity = 1;
+    int ret;
     
-    if (!hips_config) {
-        return;
+    for (p = config_data; *p; p++) {
+        if (*p == '\n') {
+            capacity++;
+        }
     }
     
-    spin_lock(&hips_config->config_lock);
+    lines = kvmalloc_array(capacity, sizeof(*lines), GFP_KERNEL);
+    if (!lines) {
+        return HIPS_ERROR_MEMORY;
+    }
+    
+    // 逐行分类：第一个 | 之前出现 = 的是设置项
+    cursor = config_data;
+    while ((line = strsep(&cursor, "\n")) != NULL && count < capacity) {
+        char *eq = strchr(line, '=');
+        char *bar = strchr(line, '|');
     
-    for (i = 0; i < ARRAY_SIZE(rule_lists); i++) {
-        list_for_each_entry_safe(entry, tmp, rule_lists[i], list) {
-            list_del(&entry->list);
-            kfree(entry);
+        line = skip_spaces(line);
+        if (*line == '#' || *line == '\0') {
+            continue;
+        }
+        if (eq && (!bar || eq < bar)) {
+            hips_parse_setting(line);
+            continue;
         }
+        lines[count++] = line;
     }
     
-    spin_unlock(&hips_config->config_lock);
+    ret = hips_sync_config_rules((const char *const *)lines, count, &delta);
+    kvfree(lines);
+    if (ret != HIPS_SUCCESS) {
+        HIPS_ERROR("应用配置规则失败: %d", ret);
+        return ret;
+    }
     
-    HIPS_INFO("规则列表清理完成");
-}
-
-// 解析配置文件（简化实现）
-int hips_parse_config(const char *config_data, size_t size)
-{
-    // 这里实现配置文件解析
-    // 简化实现，实际需要解析 JSON 或其他格式
-    HIPS_INFO("解析配置文件，大小: %zu", size);
+    // 被删除的规则学习到的动态 IP 已由 hips_del_rules 使之失效
+    kvfree(delta.removed_ids);
+    
+    HIPS_INFO("配置规则: 保留 %u, 添加 %u, 删除 %u, 失败 %u",
+              delta.kept, delta.added, delta.removed, delta.failed);
     return 0;
 }
 
-// 生成配置文件（简化实现）
+// 生成配置文件的设置项部分
 char *hips_generate_config(void)
 {
     char *buf;
@@ -366,15 +225,14 @@ char *hips_generate_config(void)
         return NULL;
     }
     
-    snprintf(buf, size, 
-             "{\n"
-             "  \"enabled\": %u,\n"
-             "  \"log_level\": %u,\n"
-             "  \"max_rules\": %u\n"
-             "}\n",
+    snprintf(buf, size,
+             "# HIPS 配置，由模块卸载时生成\n"
+             "enabled=%u\n"
+             "log_level=%u\n"
+             "max_rules=%u\n",
              hips_config->config.enabled,
              hips_config->config.log_level,
              hips_config->config.max_rules);
     
     return buf;
-} 
\ No newline at end of file
+}
@@ -0,0 +1,395 @@
+#include <linux/hashtable.h>
+#include <linux/rcupdate.h>
+#include <linux/iversion.h>
+#include <linux/workqueue.h>
+#include <linux/file.h>
+#include <linux/sched/signal.h>
+#include <crypto/hash.h>
+
+#include "hips_common.h"
+
+/*
+ * 可执行文件摘要缓存
+ *
+ * 哈希规则按文件内容（SHA-256）匹配，改名、复制都无法绕过，但每次 exec 都读取整个
+ * 文件计算摘要代价太高。这里按 (设备, inode) 缓存摘要，同时记录计算时的 i_generation、
+ * i_version、ctime 和大小：文件被修改或 inode 被重用后其中至少一项变化，缓存随之失效，
+ * 每个二进制只在第一次执行或修改之后计算一次，之后的 exec 只需一次 RCU 查找。
+ *
+ * 不超过 hash_sync_max 的文件在 exec 路径中分块计算，块之间让出 CPU；更大的文件交给
+ * 工作队列异步计算，完成之前的执行不做哈希匹配（按路径的 exec 规则仍然生效）。
+ * 打开 hash_fail_closed 后不再留这个窗口：大文件同样在 exec 路径中分块计算，
+ * 摘要无法取得（读取失败、进程被杀死、计算期间文件被修改）时拒绝执行。
+ * 计算前后各取一次 inode 状态，计算期间文件被修改时丢弃结果。
+ */
+
+#define HIPS_DIGEST_HASH_BITS  12
+#define HIPS_DIGEST_CHUNK      (64 * 1024)
+
+static uint hips_digest_max = 16384;
+module_param_named(digest_cache_max, hips_digest_max, uint, 0644);
+MODULE_PARM_DESC(digest_cache_max, "可执行文件摘要缓存的条目上限");
+
+static uint hips_hash_sync_max = 32;
+module_param_named(hash_sync_max, hips_hash_sync_max, uint, 0644);
+MODULE_PARM_DESC(hash_sync_max, "在 exec 路径中同步计算摘要的文件大小上限（MB），更大的文件异步计算");
+
+static bool hips_hash_fail_closed;
+module_param_named(hash_fail_closed, hips_hash_fail_closed, bool, 0644);
+MODULE_PARM_DESC(hash_fail_closed, "所有文件都在 exec 路径中计算摘要，无法取得时拒绝执行（默认关闭）");
+
+// 文件的身份 (dev, ino) 和判断内容是否变化的状态
+struct hips_digest_key {
+    dev_t dev;
+    unsigned long ino;
+    u32 generation;
+    u64 version;
+    struct timespec64 ctime;
+    loff_t size;
+};
+
+// 缓存条目，加入哈希表后除 referenced 外不再修改，更新时整条替换
+struct hips_digest_entry {
+    struct hlist_node node;
+    struct list_head lru;           // 按加入顺序排列，淘汰时给最近命中的条目第二次机会
+    struct rcu_head rcu;
+    struct hips_digest_key key;
+    bool referenced;
+    bool pending;                   // 正在异步计算，digest 尚无效
+    u8 digest[HIPS_SHA256_SIZE];
+};
+
+// 异步计算请求，持有文件引用直到计算完成
+struct hips_digest_work {
+    struct work_struct work;
+    struct file *file;
+    struct hips_digest_key key;
+};
+
+static DEFINE_HASHTABLE(hips_digest_table, HIPS_DIGEST_HASH_BITS);
+static LIST_HEAD(hips_digest_lru);
+static DEFINE_SPINLOCK(hips_digest_lock);
+static u32 hips_digest_count;
+static struct crypto_shash *hips_digest_tfm;
+static struct workqueue_struct *hips_digest_wq;
+static atomic64_t hips_digest_hits = ATOMIC64_INIT(0);
+static atomic64_t hips_digest_misses = ATOMIC64_INIT(0);
+static atomic64_t hips_digest_deferred = ATOMIC64_INIT(0);
+
+static struct timespec64 hips_inode_ctime(struct inode *inode)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,6,0)
+    return inode_get_ctime(inode);
+#else
+    return inode->i_ctime;
+#endif
+}
+
+// 取 inode 当前状态；inode_query_iversion 同时标记版本已被查询，之后的修改一定会递增版本
+static void hips_digest_key_init(struct inode *inode, struct hips_digest_key *key)
+{
+    key->dev = inode->i_sb->s_dev;
+    key->ino = inode->i_ino;
+    key->generation = inode->i_generation;
+    key->version = inode_query_iversion(inode);
+    key->ctime = hips_inode_ctime(inode);
+    key->size = i_size_read(inode);
+}
+
+// 两次取得的状态是否对应同一份文件内容
+static bool hips_digest_key_same(const struct hips_digest_key *a, const struct hips_digest_key *b)
+{
+    return a->dev == b->dev && a->ino == b->ino && a->generation == b->generation &&
+           a->version == b->version && a->size == b->size &&
+           timespec64_equal(&a->ctime, &b->ctime);
+}
+
+static inline u64 hips_digest_hash(const struct hips_digest_key *key)
+{
+    return ((u64)key->dev << 32) ^ key->ino;
+}
+
+// 按 (dev, ino) 查找条目，不检查内容是否变化（调用者持有 RCU 读锁或 hips_digest_lock）
+static struct hips_digest_entry *hips_digest_find(const struct hips_digest_key *key)
+{
+    struct hips_digest_entry *entry;
+
+    hash_for_each_possible_rcu(hips_digest_table, entry, node, hips_digest_hash(key)) {
+        if (entry->key.dev == key->dev && entry->key.ino == key->ino) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+// 摘除并延迟释放条目（调用者持有 hips_digest_lock）
+static void hips_digest_unlink(struct hips_digest_entry *entry)
+{
+    hash_del_rcu(&entry->node);
+    list_del(&entry->lru);
+    hips_digest_count--;
+    kfree_rcu(entry, rcu);
+}
+
+// 淘汰一个条目：从最早加入的开始，最近命中过的清除标记后移到队尾，
+// 最多走一圈，之后无条件淘汰队首（调用者持有 hips_digest_lock）
+static void hips_digest_evict(void)
+{
+    struct hips_digest_entry *entry;
+    u32 n;
+
+    for (n = 0; n < hips_digest_count; n++) {
+        entry = list_first_entry(&hips_digest_lru, struct hips_digest_entry, lru);
+        if (!READ_ONCE(entry->referenced)) {
+            break;
+        }
+        WRITE_ONCE(entry->referenced, false);
+        list_move_tail(&entry->lru, &hips_digest_lru);
+    }
+
+    if (!list_empty(&hips_digest_lru)) {
+        hips_digest_unlink(list_first_entry(&hips_digest_lru, struct hips_digest_entry, lru));
+    }
+}
+
+// 登记摘要（digest 为 NULL 时登记计算中的占位条目），替换同一文件的旧条目。
+// 登记占位条目时若已有对应当前内容的条目则返回 HIPS_ERROR_EXISTS，避免重复排队
+static int hips_digest_store(const struct hips_digest_key *key, const u8 *digest)
+{
+    struct hips_digest_entry *entry, *old;
+
+    entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+    if (!entry) {
+        return HIPS_ERROR_MEMORY;
+    }
+    entry->key = *key;
+    entry->pending = !digest;
+    if (digest) {
+        memcpy(entry->digest, digest, HIPS_SHA256_SIZE);
+    }
+
+    spin_lock(&hips_digest_lock);
+
+    old = hips_digest_find(key);
+    if (old && !digest && hips_digest_key_same(&old->key, key)) {
+        spin_unlock(&hips_digest_lock);
+        kfree(entry);
+        return HIPS_ERROR_EXISTS;
+    }
+
+    if (old) {
+        hips_digest_unlink(old);
+    } else if (hips_digest_count >= READ_ONCE(hips_digest_max)) {
+        hips_digest_evict();
+    }
+
+    hash_add_rcu(hips_digest_table, &entry->node, hips_digest_hash(key));
+    list_add_tail(&entry->lru, &hips_digest_lru);
+    hips_digest_count++;
+
+    spin_unlock(&hips_digest_lock);
+    return HIPS_SUCCESS;
+}
+
+// 撤销异步计算失败或被放弃的占位条目
+static void hips_digest_cancel(const struct hips_digest_key *key)
+{
+    struct hips_digest_entry *entry;
+
+    spin_lock(&hips_digest_lock);
+    entry = hips_digest_find(key);
+    if (entry && entry->pending && hips_digest_key_same(&entry->key, key)) {
+        hips_digest_unlink(entry);
+    }
+    spin_unlock(&hips_digest_lock);
+}
+
+// 分块读取文件计算 SHA-256，块之间让出 CPU，exec 的进程收到致命信号时放弃
+static int hips_digest_compute(struct file *file, u8 *digest)
+{
+    SHASH_DESC_ON_STACK(desc, hips_digest_tfm);
+    loff_t pos = 0;
+    ssize_t len;
+    void *buf;
+    int ret;
+
+    buf = kvmalloc(HIPS_DIGEST_CHUNK, GFP_KERNEL);
+    if (!buf) {
+        return -ENOMEM;
+    }
+
+    desc->tfm = hips_digest_tfm;
+    ret = crypto_shash_init(desc);
+    while (ret == 0) {
+        len = kernel_read(file, buf, HIPS_DIGEST_CHUNK, &pos);
+        if (len <= 0) {
+            ret = len < 0 ? len : crypto_shash_final(desc, digest);
+            break;
+        }
+        ret = crypto_shash_update(desc, buf, len);
+        if (fatal_signal_pending(current)) {
+            ret = -EINTR;
+        }
+        cond_resched();
+    }
+
+    shash_desc_zero(desc);
+    kvfree(buf);
+    return ret;
+}
+
+// 计算摘要，计算期间文件被修改时不登记结果
+static int hips_digest_update(struct file *file, const struct hips_digest_key *key, u8 *digest)
+{
+    struct hips_digest_key after;
+    int ret;
+
+    ret = hips_digest_compute(file, digest);
+    if (ret < 0) {
+        return ret;
+    }
+
+    hips_digest_key_init(file_inode(file), &after);
+    if (!hips_digest_key_same(key, &after)) {
+        return -EAGAIN;
+    }
+
+    hips_digest_store(key, digest);
+    return 0;
+}
+
+static void hips_digest_work_fn(struct work_struct *work)
+{
+    struct hips_digest_work *dw = container_of(work, struct hips_digest_work, work);
+    u8 digest[HIPS_SHA256_SIZE];
+
+    if (hips_digest_update(dw->file, &dw->key, digest) < 0) {
+        hips_digest_cancel(&dw->key);
+    }
+
+    fput(dw->file);
+    kfree(dw);
+}
+
+// 大文件交给工作队列计算，同一内容只排队一次
+static void hips_digest_queue(struct file *file, const struct hips_digest_key *key)
+{
+    struct hips_digest_work *dw;
+
+    dw = kmalloc(sizeof(*dw), GFP_KERNEL);
+    if (!dw) {
+        return;
+    }
+
+    if (hips_digest_store(key, NULL) != HIPS_SUCCESS) {
+        kfree(dw);
+        return;
+    }
+
+    INIT_WORK(&dw->work, hips_digest_work_fn);
+    dw->file = get_file(file);
+    dw->key = *key;
+    queue_work(hips_digest_wq, &dw->work);
+    atomic64_inc(&hips_digest_deferred);
+}
+
+// 取得正在执行的文件的摘要：命中缓存时直接返回，否则同步计算或排队异步计算。
+// 摘要暂时无法取得（异步计算中、读取失败）时返回 HIPS_ERROR_NOT_FOUND；
+// 打开 hash_fail_closed 时总是同步计算，无法取得时返回 HIPS_ERROR_PERMISSION，由调用者拒绝执行
+int hips_digest_file(struct file *file, u8 *digest)
+{
+    struct hips_digest_entry *entry;
+    struct hips_digest_key key;
+    bool fail_closed = READ_ONCE(hips_hash_fail_closed);
+    int ret = HIPS_ERROR_NOT_FOUND;
+
+    // 没有 SHA-256 实现时任何摘要都无法取得，fail-closed 时同样拒绝执行
+    if (!hips_digest_tfm) {
+        return fail_closed ? HIPS_ERROR_PERMISSION : HIPS_ERROR_NOT_FOUND;
+    }
+
+    hips_digest_key_init(file_inode(file), &key);
+
+    rcu_read_lock();
+    entry = hips_digest_find(&key);
+    if (entry && hips_digest_key_same(&entry->key, &key)) {
+        if (!entry->pending) {
+            memcpy(digest, entry->digest, HIPS_SHA256_SIZE);
+            ret = HIPS_SUCCESS;
+        }
+        if (!READ_ONCE(entry->referenced)) {
+            WRITE_ONCE(entry->referenced, true);
+        }
+        rcu_read_unlock();
+        if (ret == HIPS_SUCCESS) {
+            atomic64_inc(&hips_digest_hits);
+            return ret;
+        }
+        // 异步计算尚未完成；fail-closed 时不等它，自己同步计算
+        if (!fail_closed) {
+            return ret;
+        }
+    } else {
+        rcu_read_unlock();
+    }
+
+    atomic64_inc(&hips_digest_misses);
+
+    if (!fail_closed && key.size > (loff_t)READ_ONCE(hips_hash_sync_max) << 20) {
+        hips_digest_queue(file, &key);
+        return HIPS_ERROR_NOT_FOUND;
+    }
+
+    if (hips_digest_update(file, &key, digest) < 0) {
+        HIPS_DEBUG("无法计算文件摘要: dev=%u ino=%lu", key.dev, key.ino);
+        return fail_closed ? HIPS_ERROR_PERMISSION : HIPS_ERROR_NOT_FOUND;
+    }
+
+    return HIPS_SUCCESS;
+}
+
+void hips_digest_get_stats(u32 *entries, u64 *hits, u64 *misses, u64 *deferred)
+{
+    *entries = READ_ONCE(hips_digest_count);
+    *hits = atomic64_read(&hips_digest_hits);
+    *misses = atomic64_read(&hips_digest_misses);
+    *deferred = atomic64_read(&hips_digest_deferred);
+}
+
+int hips_digest_init(void)
+{
+    hips_digest_wq = alloc_workqueue("hips_digest", WQ_UNBOUND, 0);
+    if (!hips_digest_wq) {
+        HIPS_ERROR("无法创建摘要工作队列");
+        return -ENOMEM;
+    }
+
+    // 没有 SHA-256 实现时只禁用哈希规则，其余功能不受影响
+    hips_digest_tfm = crypto_alloc_shash("sha256", 0, 0);
+    if (IS_ERR(hips_digest_tfm)) {
+        HIPS_WARN("无法分配 SHA-256 算法 (%ld)，哈希规则不会生效", PTR_ERR(hips_digest_tfm));
+        hips_digest_tfm = NULL;
+    }
+
+    return 0;
+}
+
+void hips_digest_exit(void)
+{
+    struct hips_digest_entry *entry, *tmp;
+
+    // 等待已排队的计算完成，它们会向缓存中登记结果
+    destroy_workqueue(hips_digest_wq);
+
+    spin_lock(&hips_digest_lock);
+    list_for_each_entry_safe(entry, tmp, &hips_digest_lru, lru) {
+        hips_digest_unlink(entry);
+    }
+    spin_unlock(&hips_digest_lock);
+
+    if (hips_digest_tfm) {
+        crypto_free_shash(hips_digest_tfm);
+        hips_digest_tfm = NULL;
+    }
+}
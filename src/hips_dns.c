@@ -0,0 +1,620 @@
+#include <linux/ctype.h>
+#include <linux/netdevice.h>
+#include <net/dst.h>
+#include <net/ip6_checksum.h>
+#include <net/checksum.h>
+
+#include "hips_common.h"
+
+/*
+ * DNS 查询解析与应答合成
+ *
+ * 被阻止的查询直接丢弃时，解析器要等待超时重试（通常 5 秒 × 重试次数）。
+ * 开启 dns_response 后，本机发出（NF_INET_LOCAL_OUT）的 UDP 查询被阻止时，
+ * 在原路径上注入一个 NXDOMAIN 或 sinkhole 应答，调用者立即得到结果。
+ *
+ * 命中 DNS 记录规则而放行的查询被登记到待应答表，键为（解析器地址、客户端端口、事务 ID）。
+ * 入站应答（NF_INET_PRE_ROUTING，源端口 53）只有对上一个待应答查询、且问题域名一致时，
+ * 其中的地址才按查询命中的规则加入动态 IP 表（hips_dynip.c），后续直连这些地址的连接
+ * 同样被处理。任意来源伪造的 53 端口报文无法往表里写入地址；被阻止的查询不会发出，
+ * 本模块合成的应答也不会被登记。
+ */
+
+static int hips_dns_response = HIPS_DNS_RESPONSE_DROP;
+module_param_named(dns_response, hips_dns_response, int, 0644);
+MODULE_PARM_DESC(dns_response, "被阻止 DNS 查询的处理方式 (0=丢弃, 1=NXDOMAIN, 2=sinkhole)");
+
+static char hips_dns_sinkhole_ipv4[INET_ADDRSTRLEN] = "0.0.0.0";
+module_param_string(dns_sinkhole_ipv4, hips_dns_sinkhole_ipv4, sizeof(hips_dns_sinkhole_ipv4), 0644);
+MODULE_PARM_DESC(dns_sinkhole_ipv4, "sinkhole 模式下 A 记录的应答地址");
+
+static char hips_dns_sinkhole_ipv6[INET6_ADDRSTRLEN] = "::";
+module_param_string(dns_sinkhole_ipv6, hips_dns_sinkhole_ipv6, sizeof(hips_dns_sinkhole_ipv6), 0644);
+MODULE_PARM_DESC(dns_sinkhole_ipv6, "sinkhole 模式下 AAAA 记录的应答地址");
+
+static uint hips_dns_sinkhole_ttl = 60;
+module_param_named(dns_sinkhole_ttl, hips_dns_sinkhole_ttl, uint, 0644);
+MODULE_PARM_DESC(dns_sinkhole_ttl, "sinkhole 应答的 TTL（秒）");
+
+#define HIPS_DNS_HDR_LEN       12
+#define HIPS_DNS_FLAG_QR       0x8000
+#define HIPS_DNS_FLAG_OPCODE   0x7800
+#define HIPS_DNS_FLAG_RD       0x0100
+#define HIPS_DNS_FLAG_RA       0x0080
+#define HIPS_DNS_FLAG_RCODE    0x000f
+#define HIPS_DNS_RCODE_NXDOMAIN 3
+#define HIPS_DNS_TYPE_A        1
+#define HIPS_DNS_TYPE_AAAA     28
+#define HIPS_DNS_CLASS_IN      1
+
+// DNS 报文头
+struct hips_dnshdr {
+    __be16 id;
+    __be16 flags;
+    __be16 qdcount;
+    __be16 ancount;
+    __be16 nscount;
+    __be16 arcount;
+};
+
+// sinkhole 应答记录（名字使用指向问题节的压缩指针 0xc00c）
+struct hips_dns_answer {
+    __be16 name;
+    __be16 type;
+    __be16 class;
+    __be32 ttl;
+    __be16 rdlength;
+} __packed;
+
+// 资源记录中名字之后的固定部分
+struct hips_dns_rr {
+    __be16 type;
+    __be16 class;
+    __be32 ttl;
+    __be16 rdlength;
+} __packed;
+
+// 单个应答最多处理的资源记录数，防止畸形报文导致长时间循环
+#define HIPS_DNS_MAX_ANSWERS   32
+
+// 待应答查询表：直接映射，冲突时新查询覆盖旧查询；超时未应答的登记失效
+#define HIPS_DNS_PENDING_BITS     10
+#define HIPS_DNS_PENDING_LOCKS    64
+#define HIPS_DNS_PENDING_TIMEOUT  (10 * HZ)
+
+// 待应答查询的键
+struct hips_dns_key {
+    u32 family;
+    u32 netns_ino;      // 看到查询和应答的网络命名空间
+    __be16 port;        // 客户端端口（查询的源端口、应答的目的端口）
+    u16 id;             // 事务 ID
+    u8 server[16];      // 解析器地址（查询的目的地址、应答的源地址）
+};
+
+// 已放行、等待应答的查询，保存其命中的规则
+struct hips_dns_pending {
+    struct hips_dns_key key;
+    u32 name_hash;              // 问题域名的哈希，应答的问题节必须一致
+    unsigned long expires;      // jiffies，0 表示空闲
+    u32 rule_id;
+    u32 action;
+    u32 rule_netns_ino;
+    u32 log_sample;
+    u32 log_rate;
+};
+
+static struct hips_dns_pending hips_dns_pending[1 << HIPS_DNS_PENDING_BITS];
+static spinlock_t hips_dns_pending_lock[HIPS_DNS_PENDING_LOCKS] = {
+    [0 ... HIPS_DNS_PENDING_LOCKS - 1] = __SPIN_LOCK_UNLOCKED(hips_dns_pending_lock),
+};
+
+// 定位 DNS 报文头（UDP 或 TCP），返回其偏移
+static int hips_dns_locate(struct sk_buff *skb, u8 pf, struct hips_dns_query *query)
+{
+    __be16 sport, dport;
+    int offset;
+
+    offset = hips_get_l4_ports(skb, pf, &query->protocol, &sport, &dport);
+    if (offset < 0) {
+        return -1;
+    }
+
+    query->l4_offset = offset;
+    query->sport = sport;
+    query->dport = dport;
+
+    if (query->protocol == IPPROTO_UDP) {
+        offset += sizeof(struct udphdr);
+    } else if (query->protocol == IPPROTO_TCP) {
+        struct tcphdr _th, *th;
+
+        // TCP 上的 DNS 报文前有 2 字节长度
+        th = skb_header_pointer(skb, offset, sizeof(_th), &_th);
+        if (!th) {
+            return -1;
+        }
+        offset += th->doff * 4 + 2;
+    } else {
+        return -1;
+    }
+
+    return offset;
+}
+
+// 读取问题节中的域名并转为小写点分格式，返回域名之后的偏移
+static int hips_dns_read_name(struct sk_buff *skb, int offset, char *domain, size_t domain_size)
+{
+    u8 _label[64], *label;
+    u8 _len, *len;
+    size_t pos = 0;
+    int i;
+
+    // 逐个读取标签，问题节中不应出现压缩指针
+    while (1) {
+        len = skb_header_pointer(skb, offset, 1, &_len);
+        if (!len || (*len & 0xc0)) {
+            return -1;
+        }
+        offset++;
+        if (*len == 0) {
+            break;
+        }
+
+        label = skb_header_pointer(skb, offset, *len, _label);
+        if (!label || pos + *len + 2 > domain_size) {
+            return -1;
+        }
+        if (pos) {
+            domain[pos++] = '.';
+        }
+        for (i = 0; i < *len; i++) {
+            domain[pos++] = tolower(label[i]);
+        }
+        offset += *len;
+    }
+
+    // 根域没有可匹配的名字
+    if (pos == 0) {
+        return -1;
+    }
+    domain[pos] = '\0';
+
+    return offset;
+}
+
+// 跳过资源记录中的名字（可能以压缩指针结尾），返回名字之后的偏移
+static int hips_dns_skip_name(struct sk_buff *skb, int offset)
+{
+    u8 _len, *len;
+    int labels;
+
+    for (labels = 0; labels < 128; labels++) {
+        len = skb_header_pointer(skb, offset, 1, &_len);
+        if (!len) {
+            return -1;
+        }
+        if ((*len & 0xc0) == 0xc0) {
+            return offset + 2;
+        }
+        if (*len & 0xc0) {
+            return -1;
+        }
+        offset += 1 + *len;
+        if (*len == 0) {
+            return offset;
+        }
+    }
+
+    return -1;
+}
+
+// 解析 DNS 查询（UDP 或 TCP 端口 53），域名转为小写点分格式
+int hips_parse_dns_query(struct sk_buff *skb, u8 pf, struct hips_dns_query *query,
+                         char *domain, size_t domain_size)
+{
+    struct hips_dnshdr _hdr, *hdr;
+    __be16 _tail[2], *tail;
+    int offset;
+
+    if (!domain || domain_size == 0) {
+        return -1;
+    }
+    domain[0] = '\0';
+
+    offset = hips_dns_locate(skb, pf, query);
+    if (offset < 0) {
+        return -1;
+    }
+
+    // 只处理标准查询，且只有一个问题
+    hdr = skb_header_pointer(skb, offset, sizeof(_hdr), &_hdr);
+    if (!hdr || (ntohs(hdr->flags) & (HIPS_DNS_FLAG_QR | HIPS_DNS_FLAG_OPCODE)) ||
+        ntohs(hdr->qdcount) != 1) {
+        return -1;
+    }
+
+    query->dns_offset = offset;
+    query->id = ntohs(hdr->id);
+    query->flags = ntohs(hdr->flags);
+
+    offset = hips_dns_read_name(skb, offset + HIPS_DNS_HDR_LEN, domain, domain_size);
+    if (offset < 0) {
+        return -1;
+    }
+
+    tail = skb_header_pointer(skb, offset, sizeof(_tail), _tail);
+    if (!tail) {
+        return -1;
+    }
+    query->qtype = ntohs(tail[0]);
+    query->question_len = offset + sizeof(_tail) - (query->dns_offset + HIPS_DNS_HDR_LEN);
+
+    return 0;
+}
+
+// 构造待应答表的键。查询取目的地址和源端口，应答取源地址和目的端口
+static void hips_dns_make_key(struct sk_buff *skb, u8 pf, u32 netns_ino, __be16 port, u16 id,
+                              bool response, struct hips_dns_key *key)
+{
+    memset(key, 0, sizeof(*key));
+    key->netns_ino = netns_ino;
+    key->port = port;
+    key->id = id;
+
+    if (pf == NFPROTO_IPV4) {
+        struct iphdr *iph = ip_hdr(skb);
+
+        key->family = AF_INET;
+        memcpy(key->server, response ? &iph->saddr : &iph->daddr, 4);
+    }
+#ifdef CONFIG_IPV6
+    else if (pf == NFPROTO_IPV6) {
+        struct ipv6hdr *ip6h = ipv6_hdr(skb);
+
+        key->family = AF_INET6;
+        memcpy(key->server, response ? &ip6h->saddr : &ip6h->daddr, 16);
+    }
+#endif
+}
+
+static inline u32 hips_dns_pending_slot(const struct hips_dns_key *key)
+{
+    return jhash(key, sizeof(*key), 0) & ((1 << HIPS_DNS_PENDING_BITS) - 1);
+}
+
+// 登记一个命中记录规则并放行的查询，其应答中的地址随后被学习。可在软中断中调用
+void hips_dns_track_query(struct sk_buff *skb, const struct nf_hook_state *state,
+                          const struct hips_dns_query *query, const char *domain,
+                          const struct hips_rule *rule)
+{
+    struct hips_dns_pending *pending;
+    struct hips_dns_key key;
+    spinlock_t *lock;
+    u32 slot;
+
+    // 动态 IP 表不区分 cgroup，cgroup 规则学到的地址会对整个命名空间生效
+    if (rule->cgroup_id) {
+        return;
+    }
+
+    hips_dns_make_key(skb, state->pf, state->net->ns.inum, query->sport, query->id,
+                      false, &key);
+    slot = hips_dns_pending_slot(&key);
+    pending = &hips_dns_pending[slot];
+    lock = &hips_dns_pending_lock[slot % HIPS_DNS_PENDING_LOCKS];
+
+    spin_lock_bh(lock);
+    pending->key = key;
+    pending->name_hash = jhash(domain, strlen(domain), 0);
+    pending->expires = jiffies + HIPS_DNS_PENDING_TIMEOUT;
+    pending->rule_id = rule->rule_id;
+    pending->action = rule->action;
+    pending->rule_netns_ino = rule->netns_ino;
+    pending->log_sample = rule->log_sample;
+    pending->log_rate = rule->log_rate;
+    spin_unlock_bh(lock);
+}
+
+// 取出应答对应的待应答查询（一次性），填入查询命中的规则。找到返回 true
+static bool hips_dns_claim_query(const struct hips_dns_key *key, const char *domain,
+                                 struct hips_rule *rule)
+{
+    struct hips_dns_pending *pending;
+    spinlock_t *lock;
+    bool found = false;
+    u32 slot;
+
+    slot = hips_dns_pending_slot(key);
+    pending = &hips_dns_pending[slot];
+    lock = &hips_dns_pending_lock[slot % HIPS_DNS_PENDING_LOCKS];
+
+    spin_lock_bh(lock);
+    if (pending->expires && time_before(jiffies, pending->expires) &&
+        memcmp(&pending->key, key, sizeof(*key)) == 0 &&
+        pending->name_hash == jhash(domain, strlen(domain), 0)) {
+        rule->rule_id = pending->rule_id;
+        rule->rule_type = HIPS_RULE_DNS;
+        rule->action = pending->action;
+        rule->netns_ino = pending->rule_netns_ino;
+        rule->log_sample = pending->log_sample;
+        rule->log_rate = pending->log_rate;
+        pending->expires = 0;
+        found = true;
+    }
+    spin_unlock_bh(lock);
+
+    return found;
+}
+
+// 解析 DNS 应答：应答对上一个已登记的查询时，把其中的 A/AAAA 地址按记录 TTL
+// 和查询命中的规则加入动态 IP 表。返回加入的地址数
+int hips_dns_learn_response(struct sk_buff *skb, const struct nf_hook_state *state)
+{
+    struct hips_dnshdr _hdr, *hdr;
+    struct hips_dns_rr _rr, *rr;
+    struct hips_dns_query query;
+    struct hips_dns_key key;
+    struct hips_rule matched_rule;
+    u8 _rdata[16], *rdata;
+    char domain[256];
+    u16 flags, ancount, rdlength;
+    int offset, i, learned = 0;
+
+    offset = hips_dns_locate(skb, state->pf, &query);
+    if (offset < 0) {
+        return 0;
+    }
+
+    // 只处理成功的标准应答
+    hdr = skb_header_pointer(skb, offset, sizeof(_hdr), &_hdr);
+    if (!hdr) {
+        return 0;
+    }
+    flags = ntohs(hdr->flags);
+    ancount = ntohs(hdr->ancount);
+    if (!(flags & HIPS_DNS_FLAG_QR) || (flags & HIPS_DNS_FLAG_OPCODE) ||
+        (flags & HIPS_DNS_FLAG_RCODE) || ntohs(hdr->qdcount) != 1 || ancount == 0) {
+        return 0;
+    }
+    hips_dns_make_key(skb, state->pf, state->net->ns.inum, query.dport, ntohs(hdr->id),
+                      true, &key);
+
+    offset = hips_dns_read_name(skb, offset + HIPS_DNS_HDR_LEN, domain, sizeof(domain));
+    if (offset < 0) {
+        return 0;
+    }
+    offset += 4;    // QTYPE + QCLASS
+
+    // 没有对应的已放行查询（伪造、过期或被新查询覆盖）时不学习
+    memset(&matched_rule, 0, sizeof(matched_rule));
+    if (!hips_dns_claim_query(&key, domain, &matched_rule)) {
+        return 0;
+    }
+
+    // 应答节中 CNAME 链上的 A/AAAA 都属于被查询的域名
+    for (i = 0; i < min_t(int, ancount, HIPS_DNS_MAX_ANSWERS); i++) {
+        offset = hips_dns_skip_name(skb, offset);
+        if (offset < 0) {
+            break;
+        }
+
+        rr = skb_header_pointer(skb, offset, sizeof(_rr), &_rr);
+        if (!rr) {
+            break;
+        }
+        offset += sizeof(_rr);
+        rdlength = ntohs(rr->rdlength);
+
+        if (ntohs(rr->class) == HIPS_DNS_CLASS_IN &&
+            ((ntohs(rr->type) == HIPS_DNS_TYPE_A && rdlength == 4) ||
+             (ntohs(rr->type) == HIPS_DNS_TYPE_AAAA && rdlength == 16))) {
+            rdata = skb_header_pointer(skb, offset, rdlength, _rdata);
+            if (!rdata) {
+                break;
+            }
+            if (hips_dynip_add(rdlength == 4 ? AF_INET : AF_INET6, rdata,
+                               ntohl(rr->ttl), &matched_rule) == HIPS_SUCCESS) {
+                learned++;
+            }
+        }
+        offset += rdlength;
+    }
+
+    if (learned) {
+        HIPS_DEBUG("DNS 应答学习: %s -> %d 个地址 (规则ID: %u)", domain, learned,
+                   matched_rule.rule_id);
+    }
+
+    return learned;
+}
+
+// 生成应答 DNS 报文，返回长度
+static int hips_dns_build_payload(struct sk_buff *skb, const struct hips_dns_query *query,
+                                  int response, const u8 *rdata, int rdlength, u8 *buf)
+{
+    struct hips_dnshdr *hdr = (struct hips_dnshdr *)buf;
+    struct hips_dns_answer *answer;
+    u16 flags;
+    int len;
+
+    flags = HIPS_DNS_FLAG_QR | HIPS_DNS_FLAG_RA |
+            (query->flags & (HIPS_DNS_FLAG_OPCODE | HIPS_DNS_FLAG_RD));
+    if (response == HIPS_DNS_RESPONSE_NXDOMAIN) {
+        flags |= HIPS_DNS_RCODE_NXDOMAIN;
+    }
+
+    hdr->id = htons(query->id);
+    hdr->flags = htons(flags);
+    hdr->qdcount = htons(1);
+    hdr->ancount = htons(rdlength ? 1 : 0);
+    hdr->nscount = 0;
+    hdr->arcount = 0;
+    len = HIPS_DNS_HDR_LEN;
+
+    // 原样复制问题节
+    if (skb_copy_bits(skb, query->dns_offset + HIPS_DNS_HDR_LEN, buf + len,
+                      query->question_len) < 0) {
+        return -1;
+    }
+    len += query->question_len;
+
+    // sinkhole 对 A/AAAA 之外的查询类型返回无记录的 NOERROR
+    if (rdlength) {
+        answer = (struct hips_dns_answer *)(buf + len);
+        answer->name = htons(0xc000 | HIPS_DNS_HDR_LEN);
+        answer->type = htons(query->qtype);
+        answer->class = htons(HIPS_DNS_CLASS_IN);
+        answer->ttl = htonl(hips_dns_sinkhole_ttl);
+        answer->rdlength = htons(rdlength);
+        len += sizeof(*answer);
+        memcpy(buf + len, rdata, rdlength);
+        len += rdlength;
+    }
+
+    return len;
+}
+
+// 把应答交给协议栈，按接收报文投递到发起查询的套接字
+static void hips_dns_deliver(struct sk_buff *skb, struct sk_buff *nskb, struct net_device *dev)
+{
+    nskb->dev = dev;
+    nskb->pkt_type = PACKET_HOST;
+    nskb->ip_summed = CHECKSUM_UNNECESSARY;
+    skb_reset_mac_header(nskb);
+
+    // 查询发往本机解析器时复用原来的本地路由，避免回环源地址被当作火星地址丢弃
+    if ((dev->flags & IFF_LOOPBACK) && skb_dst(skb)) {
+        skb_dst_set(nskb, dst_clone(skb_dst(skb)));
+    }
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,18,0)
+    netif_rx_ni(nskb);
+#else
+    netif_rx(nskb);
+#endif
+}
+
+// 合成 NXDOMAIN 或 sinkhole 应答；只处理本机发出的 UDP 查询，成功返回 0
+int hips_dns_respond(struct sk_buff *skb, const struct nf_hook_state *state,
+                     const struct hips_dns_query *query)
+{
+    struct net_device *dev;
+    struct sk_buff *nskb;
+    struct udphdr *udph;
+    u8 rdata[16];
+    u8 *payload;
+    int response = READ_ONCE(hips_dns_response);
+    int rdlength = 0;
+    int payload_max, payload_len, udp_len, ip_len;
+
+    if (response != HIPS_DNS_RESPONSE_NXDOMAIN && response != HIPS_DNS_RESPONSE_SINKHOLE) {
+        return -1;
+    }
+
+    if (state->hook != NF_INET_LOCAL_OUT || query->protocol != IPPROTO_UDP) {
+        return -1;
+    }
+
+    dev = skb_dst(skb) ? skb_dst(skb)->dev : state->out;
+    if (!dev) {
+        return -1;
+    }
+
+    // sinkhole 地址无效时退回 NXDOMAIN
+    if (response == HIPS_DNS_RESPONSE_SINKHOLE) {
+        if (query->qtype == HIPS_DNS_TYPE_A) {
+            if (in4_pton(hips_dns_sinkhole_ipv4, -1, rdata, -1, NULL)) {
+                rdlength = 4;
+            } else {
+                response = HIPS_DNS_RESPONSE_NXDOMAIN;
+            }
+        } else if (query->qtype == HIPS_DNS_TYPE_AAAA) {
+            if (in6_pton(hips_dns_sinkhole_ipv6, -1, rdata, -1, NULL)) {
+                rdlength = 16;
+            } else {
+                response = HIPS_DNS_RESPONSE_NXDOMAIN;
+            }
+        }
+    }
+
+    payload_max = HIPS_DNS_HDR_LEN + query->question_len +
+                  sizeof(struct hips_dns_answer) + sizeof(rdata);
+    ip_len = state->pf == NFPROTO_IPV4 ? sizeof(struct iphdr) : sizeof(struct ipv6hdr);
+
+    nskb = alloc_skb(LL_MAX_HEADER + ip_len + sizeof(struct udphdr) + payload_max, GFP_ATOMIC);
+    if (!nskb) {
+        return -1;
+    }
+    skb_reserve(nskb, LL_MAX_HEADER + ip_len + sizeof(struct udphdr));
+
+    payload = skb_put(nskb, payload_max);
+    payload_len = hips_dns_build_payload(skb, query, response, rdata, rdlength, payload);
+    if (payload_len < 0) {
+        kfree_skb(nskb);
+        return -1;
+    }
+    skb_trim(nskb, payload_len);
+    udp_len = sizeof(struct udphdr) + payload_len;
+
+    // UDP 头：端口与查询相反
+    udph = skb_push(nskb, sizeof(struct udphdr));
+    skb_reset_transport_header(nskb);
+    udph->source = query->dport;
+    udph->dest = query->sport;
+    udph->len = htons(udp_len);
+    udph->check = 0;
+
+    if (state->pf == NFPROTO_IPV4) {
+        struct iphdr *oiph = ip_hdr(skb);
+        struct iphdr *iph;
+
+        iph = skb_push(nskb, sizeof(struct iphdr));
+        skb_reset_network_header(nskb);
+        memset(iph, 0, sizeof(*iph));
+        iph->version = 4;
+        iph->ihl = 5;
+        iph->tot_len = htons(sizeof(*iph) + udp_len);
+        iph->frag_off = htons(IP_DF);
+        iph->ttl = 64;
+        iph->protocol = IPPROTO_UDP;
+        iph->saddr = oiph->daddr;
+        iph->daddr = oiph->saddr;
+        ip_send_check(iph);
+
+        udph->check = csum_tcpudp_magic(iph->saddr, iph->daddr, udp_len, IPPROTO_UDP,
+                                        csum_partial(udph, udp_len, 0));
+        nskb->protocol = htons(ETH_P_IP);
+    }
+#ifdef CONFIG_IPV6
+    else if (state->pf == NFPROTO_IPV6) {
+        struct ipv6hdr *oip6h = ipv6_hdr(skb);
+        struct ipv6hdr *ip6h;
+
+        ip6h = skb_push(nskb, sizeof(struct ipv6hdr));
+        skb_reset_network_header(nskb);
+        memset(ip6h, 0, sizeof(*ip6h));
+        ip6h->version = 6;
+        ip6h->payload_len = htons(udp_len);
+        ip6h->nexthdr = IPPROTO_UDP;
+        ip6h->hop_limit = 64;
+        ip6h->saddr = oip6h->daddr;
+        ip6h->daddr = oip6h->saddr;
+
+        udph->check = csum_ipv6_magic(&ip6h->saddr, &ip6h->daddr, udp_len, IPPROTO_UDP,
+                                      csum_partial(udph, udp_len, 0));
+        nskb->protocol = htons(ETH_P_IPV6);
+    }
+#endif
+    else {
+        kfree_skb(nskb);
+        return -1;
+    }
+
+    if (udph->check == 0) {
+        udph->check = CSUM_MANGLED_0;
+    }
+
+    hips_dns_deliver(skb, nskb, dev);
+    hips_update_dns_stats(response);
+    return 0;
+}
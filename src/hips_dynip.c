@@ -0,0 +1,471 @@
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
+#include <linux/rcupdate.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+#include <linux/jiffies.h>
+#include <linux/sort.h>
+#include <linux/bsearch.h>
+
+#include "hips_common.h"
+
+/*
+ * 动态 IP 阻止表
+ *
+ * DNS 应答中命中 DNS 阻止/记录规则的 A/AAAA 地址被加入这张表，随记录的 TTL 过期。
+ * 网络钩子按地址哈希做 RCU 无锁查找，不需要格式化字符串和逐条模式匹配。
+ *
+ * 软中断中的 DNS 钩子不分配内存、不获取全局锁：地址先写入每 CPU 暂存区（只有本 CPU
+ * 和排空工作项访问），由工作项在进程上下文中批量加入表。表的所有写者（排空、过期、
+ * 删除）都在进程上下文中持有 hips_dynip_mutex。条目发布后不再修改，刷新时构造新条目
+ * 用 hlist_replace_rcu 替换，旧条目经 RCU 宽限期释放，读者不会看到新旧字段混合。
+ *
+ * 过期由每秒一格的时间轮处理：插入和删除都是 O(1)，TTL 超过一圈的条目
+ * 每圈被检查一次，直到真正过期。
+ */
+
+#define HIPS_DYNIP_HASH_BITS     14
+#define HIPS_DYNIP_WHEEL_SLOTS   256     // 每格 1 秒
+#define HIPS_DYNIP_STAGE_MAX     64      // 每 CPU 暂存区容量（每半区）
+
+static uint hips_dynip_max = 65536;
+module_param_named(dynip_max, hips_dynip_max, uint, 0644);
+MODULE_PARM_DESC(dynip_max, "DNS 应答学习的动态 IP 条目上限");
+
+static uint hips_dynip_min_ttl = 30;
+module_param_named(dynip_min_ttl, hips_dynip_min_ttl, uint, 0644);
+MODULE_PARM_DESC(dynip_min_ttl, "动态 IP 条目的最短保留时间（秒）");
+
+static uint hips_dynip_max_ttl = 86400;
+module_param_named(dynip_max_ttl, hips_dynip_max_ttl, uint, 0644);
+MODULE_PARM_DESC(dynip_max_ttl, "动态 IP 条目的最长保留时间（秒）");
+
+// 动态 IP 条目，发布后只读
+struct hips_dynip_entry {
+    struct hlist_node node;         // 地址哈希表
+    struct hlist_node wheel;        // 时间轮（只由持有 hips_dynip_mutex 的写者访问）
+    struct rcu_head rcu;
+    u32 family;
+    u8 addr[16];
+    u32 netns_ino;                  // 来源规则的网络命名空间，0 表示全局
+    u32 rule_id;                    // 来源 DNS 规则
+    u32 action;
+    u32 log_sample;                 // 来源规则的日志抽样和限速
+    u32 log_rate;
+    unsigned long expires;          // jiffies
+};
+
+// 暂存的待加入地址
+struct hips_dynip_stage {
+    u32 family;
+    u8 addr[16];
+    u32 netns_ino;
+    u32 rule_id;
+    u32 action;
+    u32 log_sample;
+    u32 log_rate;
+    unsigned long expires;
+};
+
+// 每 CPU 暂存区：DNS 钩子写 active 半区，排空工作项切换半区后在锁外处理另一半。
+// 锁只在本 CPU 的钩子和排空工作项之间竞争
+struct hips_dynip_stage_buf {
+    spinlock_t lock;
+    u32 active;
+    u32 count;
+    struct hips_dynip_stage rec[2][HIPS_DYNIP_STAGE_MAX];
+};
+
+static DEFINE_HASHTABLE(hips_dynip_table, HIPS_DYNIP_HASH_BITS);
+static struct hlist_head hips_dynip_wheel[HIPS_DYNIP_WHEEL_SLOTS];
+static DEFINE_MUTEX(hips_dynip_mutex);
+static struct hips_dynip_stage_buf __percpu *hips_dynip_stage;
+static void hips_dynip_drain_work_fn(struct work_struct *work);
+static DECLARE_WORK(hips_dynip_drain_work, hips_dynip_drain_work_fn);
+static void hips_dynip_tick(struct work_struct *work);
+static DECLARE_DELAYED_WORK(hips_dynip_tick_work, hips_dynip_tick);
+static unsigned long hips_dynip_next_sec;   // 下一个待处理的时间轮秒数
+static u32 hips_dynip_count;
+static atomic64_t hips_dynip_inserted = ATOMIC64_INIT(0);
+static atomic64_t hips_dynip_expired = ATOMIC64_INIT(0);
+static atomic64_t hips_dynip_overflow = ATOMIC64_INIT(0);
+
+static inline u32 hips_dynip_hash(u32 family, const u8 *addr)
+{
+    return jhash(addr, family == AF_INET ? 4 : 16, family);
+}
+
+static inline int hips_dynip_addr_len(u32 family)
+{
+    return family == AF_INET ? 4 : 16;
+}
+
+// 查找条目（调用者持有 RCU 读锁）
+static struct hips_dynip_entry *hips_dynip_find(u32 family, const u8 *addr, u32 netns_ino)
+{
+    struct hips_dynip_entry *entry;
+
+    hash_for_each_possible_rcu(hips_dynip_table, entry, node, hips_dynip_hash(family, addr)) {
+        if (entry->family == family && entry->netns_ino == netns_ino &&
+            memcmp(entry->addr, addr, hips_dynip_addr_len(family)) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static inline struct hlist_head *hips_dynip_slot(unsigned long expires)
+{
+    return &hips_dynip_wheel[(expires / HZ) % HIPS_DYNIP_WHEEL_SLOTS];
+}
+
+// 条目已经包含这次学习的全部信息时无需再暂存
+static bool hips_dynip_current(u32 family, const u8 *addr, unsigned long expires,
+                               const struct hips_rule *rule)
+{
+    struct hips_dynip_entry *entry;
+    bool fresh = false;
+
+    if (!READ_ONCE(hips_dynip_count)) {
+        return false;
+    }
+
+    rcu_read_lock();
+    entry = hips_dynip_find(family, addr, rule->netns_ino);
+    if (entry && !time_after(expires, entry->expires) && entry->rule_id == rule->rule_id &&
+        entry->action == rule->action && entry->log_sample == rule->log_sample &&
+        entry->log_rate == rule->log_rate) {
+        fresh = true;
+    }
+    rcu_read_unlock();
+
+    return fresh;
+}
+
+// 加入或刷新动态 IP，可在软中断中调用：只写入本 CPU 暂存区，由工作项加入表
+int hips_dynip_add(u32 family, const u8 *addr, u32 ttl, const struct hips_rule *rule)
+{
+    struct hips_dynip_stage_buf *buf;
+    struct hips_dynip_stage *rec;
+    unsigned long expires;
+    bool kick;
+
+    if (family != AF_INET && family != AF_INET6) {
+        return HIPS_ERROR_INVALID;
+    }
+    if (!hips_dynip_stage) {
+        return HIPS_ERROR_INVALID;
+    }
+
+    ttl = clamp(ttl, hips_dynip_min_ttl, hips_dynip_max_ttl);
+    expires = jiffies + (unsigned long)ttl * HZ;
+
+    // 同一地址的重复应答最常见，表中已是最新时不进入暂存区
+    if (hips_dynip_current(family, addr, expires, rule)) {
+        return HIPS_SUCCESS;
+    }
+
+    buf = get_cpu_ptr(hips_dynip_stage);
+    spin_lock_bh(&buf->lock);
+    if (buf->count >= HIPS_DYNIP_STAGE_MAX) {
+        spin_unlock_bh(&buf->lock);
+        put_cpu_ptr(hips_dynip_stage);
+        atomic64_inc(&hips_dynip_overflow);
+        return HIPS_ERROR_MEMORY;
+    }
+
+    rec = &buf->rec[buf->active][buf->count];
+    rec->family = family;
+    memcpy(rec->addr, addr, hips_dynip_addr_len(family));
+    rec->netns_ino = rule->netns_ino;
+    rec->rule_id = rule->rule_id;
+    rec->action = rule->action;
+    rec->log_sample = rule->log_sample;
+    rec->log_rate = rule->log_rate;
+    rec->expires = expires;
+    kick = buf->count++ == 0;
+    spin_unlock_bh(&buf->lock);
+    put_cpu_ptr(hips_dynip_stage);
+
+    if (kick) {
+        schedule_work(&hips_dynip_drain_work);
+    }
+
+    return HIPS_SUCCESS;
+}
+
+// 来源规则已被删除或随提升退入影子规则集时不再加入，避免与 hips_dynip_forget 交错后留下失效条目
+static bool hips_dynip_rule_live(u32 rule_id)
+{
+    struct hips_rule_entry *entry;
+    bool live;
+
+    if (!hips_config) {
+        return false;
+    }
+
+    rcu_read_lock();
+    entry = xa_load(&hips_config->rule_index, rule_id);
+    live = entry && entry->set != rcu_access_pointer(hips_config->shadow);
+    rcu_read_unlock();
+
+    return live;
+}
+
+// 把一条暂存记录加入表（调用者持有 hips_dynip_mutex）
+static void hips_dynip_insert(const struct hips_dynip_stage *rec)
+{
+    struct hips_dynip_entry *entry, *old;
+
+    if (!hips_dynip_rule_live(rec->rule_id)) {
+        return;
+    }
+
+    // 写者持有 hips_dynip_mutex，解除 RCU 读锁后找到的条目也不会被释放
+    rcu_read_lock();
+    old = hips_dynip_find(rec->family, rec->addr, rec->netns_ino);
+    rcu_read_unlock();
+    if (!old && hips_dynip_count >= hips_dynip_max) {
+        atomic64_inc(&hips_dynip_overflow);
+        return;
+    }
+
+    entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+    if (!entry) {
+        atomic64_inc(&hips_dynip_overflow);
+        return;
+    }
+
+    entry->family = rec->family;
+    memcpy(entry->addr, rec->addr, hips_dynip_addr_len(rec->family));
+    entry->netns_ino = rec->netns_ino;
+    entry->rule_id = rec->rule_id;
+    entry->action = rec->action;
+    entry->log_sample = rec->log_sample;
+    entry->log_rate = rec->log_rate;
+    entry->expires = rec->expires;
+
+    // 已存在时整体替换，过期时间只延长不缩短
+    if (old) {
+        if (time_after(old->expires, entry->expires)) {
+            entry->expires = old->expires;
+        }
+        hlist_del(&old->wheel);
+        hlist_add_head(&entry->wheel, hips_dynip_slot(entry->expires));
+        hlist_replace_rcu(&old->node, &entry->node);
+        kfree_rcu(old, rcu);
+        return;
+    }
+
+    hlist_add_head(&entry->wheel, hips_dynip_slot(entry->expires));
+    hash_add_rcu(hips_dynip_table, &entry->node, hips_dynip_hash(rec->family, rec->addr));
+    WRITE_ONCE(hips_dynip_count, hips_dynip_count + 1);
+    atomic64_inc(&hips_dynip_inserted);
+}
+
+// 排空所有 CPU 的暂存区（调用者持有 hips_dynip_mutex）
+static void hips_dynip_drain(void)
+{
+    struct hips_dynip_stage_buf *buf;
+    struct hips_dynip_stage *rec;
+    u32 count, i;
+    int cpu;
+
+    if (!hips_dynip_stage) {
+        return;
+    }
+
+    for_each_possible_cpu(cpu) {
+        buf = per_cpu_ptr(hips_dynip_stage, cpu);
+
+        // 切换半区后钩子写另一半，本半区在锁外处理；排空由 hips_dynip_mutex 串行化
+        spin_lock_bh(&buf->lock);
+        count = buf->count;
+        rec = buf->rec[buf->active];
+        buf->active ^= 1;
+        buf->count = 0;
+        spin_unlock_bh(&buf->lock);
+
+        for (i = 0; i < count; i++) {
+            hips_dynip_insert(&rec[i]);
+        }
+    }
+}
+
+static void hips_dynip_drain_work_fn(struct work_struct *work)
+{
+    mutex_lock(&hips_dynip_mutex);
+    hips_dynip_drain();
+    mutex_unlock(&hips_dynip_mutex);
+}
+
+// 查找目的地址：先查包所在命名空间学习到的条目，再查全局条目，无锁。
+// 命中时填入来源规则的 ID、动作和日志抽样/限速设置
+int hips_dynip_lookup(const struct hips_network_addr *addr, u32 netns_ino,
+                      struct hips_rule *rule)
+{
+    struct hips_dynip_entry *entry;
+    const u8 *key = addr->family == AF_INET ? (const u8 *)&addr->addr.ipv4 : addr->addr.ipv6;
+    int ret = HIPS_ERROR_NOT_FOUND;
+
+    // 表为空时不计算哈希
+    if (!READ_ONCE(hips_dynip_count)) {
+        return HIPS_ERROR_NOT_FOUND;
+    }
+
+    rcu_read_lock();
+    entry = hips_dynip_find(addr->family, key, netns_ino);
+    if (!entry && netns_ino) {
+        entry = hips_dynip_find(addr->family, key, 0);
+    }
+
+    // 已过期但尚未被时间轮回收的条目不再生效
+    if (entry && time_before(jiffies, entry->expires)) {
+        rule->rule_id = entry->rule_id;
+        rule->action = entry->action;
+        rule->log_sample = entry->log_sample;
+        rule->log_rate = entry->log_rate;
+        ret = HIPS_SUCCESS;
+    }
+    rcu_read_unlock();
+
+    return ret;
+}
+
+// 从表中摘除条目（调用者持有 hips_dynip_mutex）
+static void hips_dynip_unlink(struct hips_dynip_entry *entry)
+{
+    hlist_del(&entry->wheel);
+    hash_del_rcu(&entry->node);
+    WRITE_ONCE(hips_dynip_count, hips_dynip_count - 1);
+    kfree_rcu(entry, rcu);
+}
+
+// 回收一格中已过期的条目（调用者持有 hips_dynip_mutex）
+static void hips_dynip_expire_slot(struct hlist_head *slot)
+{
+    struct hips_dynip_entry *entry;
+    struct hlist_node *tmp;
+
+    hlist_for_each_entry_safe(entry, tmp, slot, wheel) {
+        if (time_before(jiffies, entry->expires)) {
+            // TTL 超过一圈，下一圈再检查
+            continue;
+        }
+        hips_dynip_unlink(entry);
+        atomic64_inc(&hips_dynip_expired);
+    }
+}
+
+// 时间轮：每秒处理已经过去的格
+static void hips_dynip_tick(struct work_struct *work)
+{
+    unsigned long now_sec = jiffies / HZ;
+    unsigned long steps = 0;
+
+    mutex_lock(&hips_dynip_mutex);
+    while (time_before(hips_dynip_next_sec, now_sec) && steps < HIPS_DYNIP_WHEEL_SLOTS) {
+        hips_dynip_expire_slot(&hips_dynip_wheel[hips_dynip_next_sec % HIPS_DYNIP_WHEEL_SLOTS]);
+        hips_dynip_next_sec++;
+        steps++;
+    }
+    // 工作项延迟超过一圈时每格都已处理过一次
+    hips_dynip_next_sec = max(hips_dynip_next_sec, now_sec);
+    mutex_unlock(&hips_dynip_mutex);
+
+    schedule_delayed_work(&hips_dynip_tick_work, HZ);
+}
+
+// 获取动态 IP 表统计
+void hips_dynip_get_stats(u32 *entries, u64 *inserted, u64 *expired, u64 *overflow)
+{
+    *entries = READ_ONCE(hips_dynip_count);
+    *inserted = atomic64_read(&hips_dynip_inserted);
+    *expired = atomic64_read(&hips_dynip_expired);
+    *overflow = atomic64_read(&hips_dynip_overflow);
+}
+
+// 清空动态 IP 表，暂存区中尚未加入的地址一并丢弃
+void hips_dynip_flush(void)
+{
+    struct hips_dynip_entry *entry;
+    struct hlist_node *tmp;
+    int bkt;
+
+    mutex_lock(&hips_dynip_mutex);
+    hips_dynip_drain();
+    hash_for_each_safe(hips_dynip_table, bkt, tmp, entry, node) {
+        hips_dynip_unlink(entry);
+    }
+    mutex_unlock(&hips_dynip_mutex);
+}
+
+static int hips_dynip_cmp_id(const void *a, const void *b)
+{
+    u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// 删除由指定规则学习到的条目（规则被删除后不再阻止其解析出的地址），其余条目保留。
+// 先排空暂存区，使删除之前学到的地址也被处理。rule_ids 会被排序
+void hips_dynip_forget(u32 *rule_ids, int count)
+{
+    struct hips_dynip_entry *entry;
+    struct hlist_node *tmp;
+    int bkt;
+
+    if (count <= 0) {
+        return;
+    }
+
+    sort(rule_ids, count, sizeof(u32), hips_dynip_cmp_id, NULL);
+
+    mutex_lock(&hips_dynip_mutex);
+    hips_dynip_drain();
+    if (hips_dynip_count) {
+        hash_for_each_safe(hips_dynip_table, bkt, tmp, entry, node) {
+            if (bsearch(&entry->rule_id, rule_ids, count, sizeof(u32), hips_dynip_cmp_id)) {
+                hips_dynip_unlink(entry);
+            }
+        }
+    }
+    mutex_unlock(&hips_dynip_mutex);
+}
+
+int hips_dynip_init(void)
+{
+    int cpu, i;
+
+    hips_dynip_stage = alloc_percpu(struct hips_dynip_stage_buf);
+    if (!hips_dynip_stage) {
+        return -ENOMEM;
+    }
+    for_each_possible_cpu(cpu) {
+        spin_lock_init(&per_cpu_ptr(hips_dynip_stage, cpu)->lock);
+    }
+
+    for (i = 0; i < HIPS_DYNIP_WHEEL_SLOTS; i++) {
+        INIT_HLIST_HEAD(&hips_dynip_wheel[i]);
+    }
+    hips_dynip_next_sec = jiffies / HZ;
+
+    schedule_delayed_work(&hips_dynip_tick_work, HZ);
+
+    return 0;
+}
+
+void hips_dynip_exit(void)
+{
+    struct hips_dynip_stage_buf __percpu *stage = hips_dynip_stage;
+
+    cancel_delayed_work_sync(&hips_dynip_tick_work);
+    hips_dynip_flush();
+
+    // 钩子已注销，排空工作项可能仍在排队
+    WRITE_ONCE(hips_dynip_stage, NULL);
+    cancel_work_sync(&hips_dynip_drain_work);
+    free_percpu(stage);
+}
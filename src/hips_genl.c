@@ -0,0 +1,579 @@
+#include <net/genetlink.h>
+#include <linux/vmalloc.h>
+
+#include "hips_common.h"
+
+/*
+ * generic netlink 接口
+ *
+ * 族名 "hips"。RULE_ADD/RULE_DEL 在一条消息中携带最多 HIPS_BATCH_MAX 个规则（或规则 ID），
+ * 整批作为一次规则表更新，应答中返回每项的结果；RULE_GET 的 dump 在内核侧按 ID 分页导出，
+ * 每页只在复制时持有规则锁，大规则集不会一次占用大块内存或长时间持锁。
+ * 事件由日志工作项格式化后发往 "events" 多播组，多个守护进程可以同时订阅。
+ * 修改规则需要 CAP_NET_ADMIN；事件含进程信息，订阅同样需要 CAP_NET_ADMIN（6.6 及以上内核）。
+ */
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,11,0)
+#define nla_strscpy nla_strlcpy
+#endif
+
+#define HIPS_GENL_DUMP_PAGE  64     // dump 每页从规则表复制的规则数
+
+// 单项结果的消息长度
+#define HIPS_GENL_RESULT_SIZE \
+    (nla_total_size(0) + 2 * nla_total_size(sizeof(u32)) + nla_total_size(sizeof(s32)))
+
+static const struct nla_policy hips_genl_rule_policy[HIPS_RATTR_MAX + 1] = {
+    [HIPS_RATTR_ID]           = { .type = NLA_U32 },
+    [HIPS_RATTR_TYPE]         = { .type = NLA_U32 },
+    [HIPS_RATTR_ACTION]       = { .type = NLA_U32 },
+    [HIPS_RATTR_PRIORITY]     = { .type = NLA_U32 },
+    [HIPS_RATTR_TARGET]       = { .type = NLA_NUL_STRING, .len = 255 },
+    [HIPS_RATTR_DESC]         = { .type = NLA_NUL_STRING, .len = 511 },
+    [HIPS_RATTR_NETNS]        = { .type = NLA_U32 },
+    [HIPS_RATTR_CGROUP]       = { .type = NLA_U64 },
+    [HIPS_RATTR_EXPIRES]      = { .type = NLA_U64 },
+    [HIPS_RATTR_FLAGS]        = { .type = NLA_U32 },
+    [HIPS_RATTR_NET_FAMILY]   = { .type = NLA_U32 },
+    [HIPS_RATTR_NET_ADDR]     = { .type = NLA_BINARY, .len = 16 },
+    [HIPS_RATTR_NET_PREFIX]   = { .type = NLA_U8 },
+    [HIPS_RATTR_NET_PROTO]    = { .type = NLA_U8 },
+    [HIPS_RATTR_NET_DIR]      = { .type = NLA_U8 },
+    [HIPS_RATTR_NET_PORT_MIN] = { .type = NLA_U16 },
+    [HIPS_RATTR_NET_PORT_MAX] = { .type = NLA_U16 },
+    [HIPS_RATTR_LOG_SAMPLE]   = { .type = NLA_U32 },
+    [HIPS_RATTR_LOG_RATE]     = { .type = NLA_U32 },
+};
+
+static const struct nla_policy hips_genl_policy[HIPS_ATTR_MAX + 1] = {
+    [HIPS_ATTR_RULE]    = { .type = NLA_NESTED },
+    [HIPS_ATTR_RULE_ID] = { .type = NLA_U32 },
+};
+
+static struct genl_family hips_genl_family;
+static bool hips_genl_registered;
+
+// 把嵌套的规则属性解析为 struct hips_rule；带 NET_FAMILY 的网络规则按结构化规则处理
+static int hips_genl_parse_rule(const struct nlattr *nest, struct hips_rule *rule,
+                                struct netlink_ext_ack *extack)
+{
+    struct nlattr *tb[HIPS_RATTR_MAX + 1];
+    int ret;
+
+    ret = nla_parse_nested(tb, HIPS_RATTR_MAX, nest, hips_genl_rule_policy, extack);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (!tb[HIPS_RATTR_TYPE]) {
+        NL_SET_ERR_MSG_ATTR(extack, nest, "缺少规则类型");
+        return -EINVAL;
+    }
+
+    memset(rule, 0, sizeof(*rule));
+    rule->rule_type = nla_get_u32(tb[HIPS_RATTR_TYPE]);
+    if (tb[HIPS_RATTR_ACTION]) {
+        rule->action = nla_get_u32(tb[HIPS_RATTR_ACTION]);
+    }
+    if (tb[HIPS_RATTR_PRIORITY]) {
+        rule->priority = nla_get_u32(tb[HIPS_RATTR_PRIORITY]);
+    }
+    if (tb[HIPS_RATTR_TARGET]) {
+        nla_strscpy(rule->target, tb[HIPS_RATTR_TARGET], sizeof(rule->target));
+    }
+    if (tb[HIPS_RATTR_DESC]) {
+        nla_strscpy(rule->description, tb[HIPS_RATTR_DESC], sizeof(rule->description));
+    }
+    if (tb[HIPS_RATTR_NETNS]) {
+        rule->netns_ino = nla_get_u32(tb[HIPS_RATTR_NETNS]);
+    }
+    if (tb[HIPS_RATTR_CGROUP]) {
+        rule->cgroup_id = nla_get_u64(tb[HIPS_RATTR_CGROUP]);
+    }
+    if (tb[HIPS_RATTR_EXPIRES]) {
+        rule->expires_at = nla_get_u64(tb[HIPS_RATTR_EXPIRES]);
+    }
+    if (tb[HIPS_RATTR_LOG_SAMPLE]) {
+        rule->log_sample = nla_get_u32(tb[HIPS_RATTR_LOG_SAMPLE]);
+    }
+    if (tb[HIPS_RATTR_LOG_RATE]) {
+        rule->log_rate = nla_get_u32(tb[HIPS_RATTR_LOG_RATE]);
+    }
+    if (tb[HIPS_RATTR_FLAGS]) {
+        rule->flags = nla_get_u32(tb[HIPS_RATTR_FLAGS]) & ~HIPS_RULE_F_STRUCTURED;
+    }
+
+    if (tb[HIPS_RATTR_NET_FAMILY]) {
+        rule->flags |= HIPS_RULE_F_STRUCTURED;
+        rule->net.family = nla_get_u32(tb[HIPS_RATTR_NET_FAMILY]);
+        if (tb[HIPS_RATTR_NET_ADDR]) {
+            nla_memcpy(rule->net.addr, tb[HIPS_RATTR_NET_ADDR], sizeof(rule->net.addr));
+        }
+        if (tb[HIPS_RATTR_NET_PREFIX]) {
+            rule->net.prefix_len = nla_get_u8(tb[HIPS_RATTR_NET_PREFIX]);
+        }
+        if (tb[HIPS_RATTR_NET_PROTO]) {
+            rule->net.protocol = nla_get_u8(tb[HIPS_RATTR_NET_PROTO]);
+        }
+        if (tb[HIPS_RATTR_NET_DIR]) {
+            rule->net.direction = nla_get_u8(tb[HIPS_RATTR_NET_DIR]);
+        }
+        if (tb[HIPS_RATTR_NET_PORT_MIN]) {
+            rule->net.port_min = nla_get_u16(tb[HIPS_RATTR_NET_PORT_MIN]);
+        }
+        if (tb[HIPS_RATTR_NET_PORT_MAX]) {
+            rule->net.port_max = nla_get_u16(tb[HIPS_RATTR_NET_PORT_MAX]);
+        }
+    }
+
+    return 0;
+}
+
+static int hips_genl_put_rule(struct sk_buff *skb, const struct hips_rule *rule)
+{
+    struct nlattr *nest;
+
+    nest = nla_nest_start(skb, HIPS_ATTR_RULE);
+    if (!nest) {
+        return -EMSGSIZE;
+    }
+
+    if (nla_put_u32(skb, HIPS_RATTR_ID, rule->rule_id) ||
+        nla_put_u32(skb, HIPS_RATTR_TYPE, rule->rule_type) ||
+        nla_put_u32(skb, HIPS_RATTR_ACTION, rule->action) ||
+        nla_put_u32(skb, HIPS_RATTR_PRIORITY, rule->priority) ||
+        nla_put_string(skb, HIPS_RATTR_TARGET, rule->target) ||
+        nla_put_string(skb, HIPS_RATTR_DESC, rule->description) ||
+        nla_put_u32(skb, HIPS_RATTR_NETNS, rule->netns_ino) ||
+        nla_put_u64_64bit(skb, HIPS_RATTR_CGROUP, rule->cgroup_id, HIPS_RATTR_PAD) ||
+        nla_put_u64_64bit(skb, HIPS_RATTR_EXPIRES, rule->expires_at, HIPS_RATTR_PAD) ||
+        nla_put_u32(skb, HIPS_RATTR_FLAGS, rule->flags) ||
+        nla_put_u32(skb, HIPS_RATTR_LOG_SAMPLE, rule->log_sample) ||
+        nla_put_u32(skb, HIPS_RATTR_LOG_RATE, rule->log_rate)) {
+        goto cancel;
+    }
+
+    if ((rule->flags & HIPS_RULE_F_STRUCTURED) &&
+        (nla_put_u32(skb, HIPS_RATTR_NET_FAMILY, rule->net.family) ||
+         nla_put(skb, HIPS_RATTR_NET_ADDR, rule->net.family == AF_INET ? 4 : 16, rule->net.addr) ||
+         nla_put_u8(skb, HIPS_RATTR_NET_PREFIX, rule->net.prefix_len) ||
+         nla_put_u8(skb, HIPS_RATTR_NET_PROTO, rule->net.protocol) ||
+         nla_put_u8(skb, HIPS_RATTR_NET_DIR, rule->net.direction) ||
+         nla_put_u16(skb, HIPS_RATTR_NET_PORT_MIN, rule->net.port_min) ||
+         nla_put_u16(skb, HIPS_RATTR_NET_PORT_MAX, rule->net.port_max))) {
+        goto cancel;
+    }
+
+    nla_nest_end(skb, nest);
+    return 0;
+
+cancel:
+    nla_nest_cancel(skb, nest);
+    return -EMSGSIZE;
+}
+
+static int hips_genl_put_result(struct sk_buff *skb, u32 index, u32 rule_id, int error)
+{
+    struct nlattr *nest;
+
+    nest = nla_nest_start(skb, HIPS_ATTR_RESULT);
+    if (!nest) {
+        return -EMSGSIZE;
+    }
+
+    if (nla_put_u32(skb, HIPS_RESATTR_INDEX, index) ||
+        nla_put_u32(skb, HIPS_RESATTR_ID, rule_id) ||
+        nla_put_s32(skb, HIPS_RESATTR_ERROR, error)) {
+        nla_nest_cancel(skb, nest);
+        return -EMSGSIZE;
+    }
+
+    nla_nest_end(skb, nest);
+    return 0;
+}
+
+// 请求中某类属性的个数（属性可重复，genetlink 的 info->attrs 只保留最后一个）
+static int hips_genl_count_attrs(const struct genl_info *info, int type)
+{
+    const struct nlattr *attr;
+    int count = 0, rem;
+
+    nlmsg_for_each_attr(attr, info->nlhdr, GENL_HDRLEN, rem) {
+        if (nla_type(attr) == type) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+// 批量添加：解析失败的条目单独报错，其余条目与 HIPS_IOCTL_ADD_RULES 一样在一次加锁内插入，
+// 应答中按请求顺序返回每项的规则 ID 或错误码
+static int hips_genl_rule_add(struct sk_buff *skb, struct genl_info *info)
+{
+    const struct nlattr *attr;
+    struct hips_rule *rules = NULL;
+    struct sk_buff *reply = NULL;
+    int *status = NULL, *errors = NULL, *slots = NULL;
+    int count, parsed = 0, index = 0, rem, ret, i;
+    void *hdr;
+
+    count = hips_genl_count_attrs(info, HIPS_ATTR_RULE);
+    if (!count) {
+        NL_SET_ERR_MSG(info->extack, "缺少 HIPS_ATTR_RULE");
+        return -EINVAL;
+    }
+    if (count > HIPS_BATCH_MAX) {
+        NL_SET_ERR_MSG(info->extack, "规则数超过 HIPS_BATCH_MAX");
+        return -E2BIG;
+    }
+
+    rules = kvcalloc(count, sizeof(*rules), GFP_KERNEL);
+    status = kvcalloc(count, sizeof(*status), GFP_KERNEL);
+    errors = kvcalloc(count, sizeof(*errors), GFP_KERNEL);
+    slots = kvcalloc(count, sizeof(*slots), GFP_KERNEL);
+    reply = genlmsg_new(count * HIPS_GENL_RESULT_SIZE, GFP_KERNEL);
+    if (!rules || !status || !errors || !slots || !reply) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    // slots[i] 为请求中第 i 项在 rules 中的位置，解析失败为 -1
+    nlmsg_for_each_attr(attr, info->nlhdr, GENL_HDRLEN, rem) {
+        if (nla_type(attr) != HIPS_ATTR_RULE) {
+            continue;
+        }
+        errors[index] = hips_genl_parse_rule(attr, &rules[parsed], info->extack);
+        slots[index] = errors[index] ? -1 : parsed++;
+        index++;
+    }
+
+    if (parsed) {
+        ret = hips_add_rules(rules, parsed, status);
+        if (ret < 0) {
+            ret = hips_errno(ret);
+            goto out;
+        }
+    }
+
+    hdr = genlmsg_put_reply(reply, info, &hips_genl_family, 0, HIPS_CMD_RULE_ADD);
+    if (!hdr) {
+        ret = -EMSGSIZE;
+        goto out;
+    }
+
+    for (i = 0; i < count; i++) {
+        int slot = slots[i];
+        int err = slot < 0 ? errors[i] : (int)hips_errno(status[slot]);
+
+        if (hips_genl_put_result(reply, i, err == 0 ? rules[slot].rule_id : 0, err) < 0) {
+            ret = -EMSGSIZE;
+            goto out;
+        }
+    }
+
+    genlmsg_end(reply, hdr);
+    ret = genlmsg_reply(reply, info);
+    reply = NULL;
+
+out:
+    nlmsg_free(reply);
+    kvfree(slots);
+    kvfree(errors);
+    kvfree(status);
+    kvfree(rules);
+    return ret;
+}
+
+// 批量删除：每个 HIPS_ATTR_RULE_ID 一项结果，整批在一次加锁内摘除
+static int hips_genl_rule_del(struct sk_buff *skb, struct genl_info *info)
+{
+    const struct nlattr *attr;
+    struct sk_buff *reply = NULL;
+    u32 *ids = NULL;
+    int *status = NULL;
+    int count, index = 0, rem, ret, i;
+    void *hdr;
+
+    count = hips_genl_count_attrs(info, HIPS_ATTR_RULE_ID);
+    if (!count) {
+        NL_SET_ERR_MSG(info->extack, "缺少 HIPS_ATTR_RULE_ID");
+        return -EINVAL;
+    }
+    if (count > HIPS_BATCH_MAX) {
+        NL_SET_ERR_MSG(info->extack, "规则数超过 HIPS_BATCH_MAX");
+        return -E2BIG;
+    }
+
+    ids = kvcalloc(count, sizeof(*ids), GFP_KERNEL);
+    status = kvcalloc(count, sizeof(*status), GFP_KERNEL);
+    reply = genlmsg_new(count * HIPS_GENL_RESULT_SIZE, GFP_KERNEL);
+    if (!ids || !status || !reply) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    nlmsg_for_each_attr(attr, info->nlhdr, GENL_HDRLEN, rem) {
+        if (nla_type(attr) == HIPS_ATTR_RULE_ID) {
+            ids[index++] = nla_get_u32(attr);
+        }
+    }
+
+    ret = hips_del_rules(ids, count, status);
+    if (ret < 0) {
+        ret = hips_errno(ret);
+        goto out;
+    }
+
+    hdr = genlmsg_put_reply(reply, info, &hips_genl_family, 0, HIPS_CMD_RULE_DEL);
+    if (!hdr) {
+        ret = -EMSGSIZE;
+        goto out;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (hips_genl_put_result(reply, i, ids[i], hips_errno(status[i])) < 0) {
+            ret = -EMSGSIZE;
+            goto out;
+        }
+    }
+
+    genlmsg_end(reply, hdr);
+    ret = genlmsg_reply(reply, info);
+    reply = NULL;
+
+out:
+    nlmsg_free(reply);
+    kvfree(status);
+    kvfree(ids);
+    return ret;
+}
+
+// 按 ID 查询单条规则
+static int hips_genl_rule_get(struct sk_buff *skb, struct genl_info *info)
+{
+    struct hips_rule *rule;
+    struct sk_buff *reply;
+    void *hdr;
+    int ret;
+
+    if (!info->attrs[HIPS_ATTR_RULE_ID]) {
+        NL_SET_ERR_MSG(info->extack, "缺少 HIPS_ATTR_RULE_ID");
+        return -EINVAL;
+    }
+
+    rule = kmalloc(sizeof(*rule), GFP_KERNEL);
+    reply = genlmsg_new(NLMSG_GOODSIZE, GFP_KERNEL);
+    if (!rule || !reply) {
+        ret = -ENOMEM;
+        goto error;
+    }
+
+    ret = hips_errno(hips_get_rule(nla_get_u32(info->attrs[HIPS_ATTR_RULE_ID]), rule));
+    if (ret < 0) {
+        goto error;
+    }
+
+    hdr = genlmsg_put_reply(reply, info, &hips_genl_family, 0, HIPS_CMD_RULE_GET);
+    if (!hdr || hips_genl_put_rule(reply, rule) < 0) {
+        ret = -EMSGSIZE;
+        goto error;
+    }
+
+    kfree(rule);
+    genlmsg_end(reply, hdr);
+    return genlmsg_reply(reply, info);
+
+error:
+    nlmsg_free(reply);
+    kfree(rule);
+    return ret;
+}
+
+// dump 的分页状态：rules 中缓存当前一页，next_id 是下一页的起始 ID
+struct hips_genl_dump {
+    u32 next_id;
+    int count;
+    int pos;
+    bool last_page;
+    struct hips_rule rules[HIPS_GENL_DUMP_PAGE];
+};
+
+static int hips_genl_dump_start(struct netlink_callback *cb)
+{
+    struct hips_genl_dump *dump;
+
+    dump = kvzalloc(sizeof(*dump), GFP_KERNEL);
+    if (!dump) {
+        return -ENOMEM;
+    }
+
+    cb->args[0] = (long)dump;
+    return 0;
+}
+
+// 每次调用尽量填满一个 skb；当前页取完时再从规则表复制下一页，
+// 两页之间不持有锁，期间增删的规则按 ID 位置决定是否出现在结果中
+static int hips_genl_dump_rules(struct sk_buff *skb, struct netlink_callback *cb)
+{
+    struct hips_genl_dump *dump = (struct hips_genl_dump *)cb->args[0];
+    struct hips_rule *rule;
+    void *hdr;
+    int ret;
+
+    for (;;) {
+        if (dump->pos == dump->count) {
+            if (dump->last_page) {
+                break;
+            }
+
+            ret = hips_dump_rules(dump->next_id, dump->rules, HIPS_GENL_DUMP_PAGE);
+            if (ret < 0) {
+                return hips_errno(ret);
+            }
+            dump->count = ret;
+            dump->pos = 0;
+            if (ret < HIPS_GENL_DUMP_PAGE || dump->rules[ret - 1].rule_id == U32_MAX) {
+                dump->last_page = true;
+            }
+            if (ret == 0) {
+                break;
+            }
+            dump->next_id = dump->rules[ret - 1].rule_id + 1;
+        }
+
+        rule = &dump->rules[dump->pos];
+        hdr = genlmsg_put(skb, NETLINK_CB(cb->skb).portid, cb->nlh->nlmsg_seq,
+                          &hips_genl_family, NLM_F_MULTI, HIPS_CMD_RULE_GET);
+        if (!hdr) {
+            break;
+        }
+        if (hips_genl_put_rule(skb, rule) < 0) {
+            genlmsg_cancel(skb, hdr);
+            break;
+        }
+        genlmsg_end(skb, hdr);
+        dump->pos++;
+    }
+
+    return skb->len;
+}
+
+static int hips_genl_dump_done(struct netlink_callback *cb)
+{
+    kvfree((void *)cb->args[0]);
+    return 0;
+}
+
+// 事件多播：由日志工作项在进程上下文调用，没有订阅者时直接返回
+void hips_genl_notify_event(const struct hips_log_entry *entry)
+{
+    struct sk_buff *msg;
+    struct nlattr *nest;
+    void *hdr;
+
+    if (!READ_ONCE(hips_genl_registered) ||
+        !genl_has_listeners(&hips_genl_family, &init_net, 0)) {
+        return;
+    }
+
+    msg = genlmsg_new(NLMSG_GOODSIZE, GFP_KERNEL);
+    if (!msg) {
+        return;
+    }
+
+    hdr = genlmsg_put(msg, 0, 0, &hips_genl_family, 0, HIPS_CMD_EVENT);
+    if (!hdr) {
+        goto error;
+    }
+
+    nest = nla_nest_start(msg, HIPS_ATTR_EVENT);
+    if (!nest ||
+        nla_put_u64_64bit(msg, HIPS_EATTR_TIMESTAMP, entry->timestamp, HIPS_EATTR_PAD) ||
+        nla_put_u32(msg, HIPS_EATTR_RULE_ID, entry->rule_id) ||
+        nla_put_u32(msg, HIPS_EATTR_RULE_TYPE, entry->rule_type) ||
+        nla_put_u32(msg, HIPS_EATTR_ACTION, entry->action) ||
+        nla_put_u32(msg, HIPS_EATTR_PID, entry->pid) ||
+        nla_put_u32(msg, HIPS_EATTR_UID, entry->uid) ||
+        nla_put_u64_64bit(msg, HIPS_EATTR_CGROUP, entry->cgroup_id, HIPS_EATTR_PAD) ||
+        nla_put_string(msg, HIPS_EATTR_COMM, entry->process_name) ||
+        nla_put_string(msg, HIPS_EATTR_EXE, entry->exe) ||
+        nla_put_string(msg, HIPS_EATTR_TARGET, entry->target) ||
+        nla_put_string(msg, HIPS_EATTR_DETAILS, entry->details) ||
+        (entry->suppressed && nla_put_u32(msg, HIPS_EATTR_SUPPRESSED, entry->suppressed))) {
+        goto error;
+    }
+    nla_nest_end(msg, nest);
+
+    genlmsg_end(msg, hdr);
+    genlmsg_multicast(&hips_genl_family, msg, 0, 0, GFP_KERNEL);
+    return;
+
+error:
+    nlmsg_free(msg);
+}
+
+static const struct genl_ops hips_genl_ops[] = {
+    {
+        .cmd = HIPS_CMD_RULE_ADD,
+        .doit = hips_genl_rule_add,
+        .flags = GENL_ADMIN_PERM,
+    },
+    {
+        .cmd = HIPS_CMD_RULE_DEL,
+        .doit = hips_genl_rule_del,
+        .flags = GENL_ADMIN_PERM,
+    },
+    {
+        .cmd = HIPS_CMD_RULE_GET,
+        .doit = hips_genl_rule_get,
+        .start = hips_genl_dump_start,
+        .dumpit = hips_genl_dump_rules,
+        .done = hips_genl_dump_done,
+    },
+};
+
+static const struct genl_multicast_group hips_genl_mcgrps[] = {
+    {
+        .name = HIPS_GENL_MCGRP_EVENTS,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,6,0)
+        .flags = GENL_MCAST_CAP_NET_ADMIN,
+#endif
+    },
+};
+
+static struct genl_family hips_genl_family = {
+    .name = HIPS_GENL_NAME,
+    .version = HIPS_GENL_VERSION,
+    .maxattr = HIPS_ATTR_MAX,
+    .policy = hips_genl_policy,
+    .module = THIS_MODULE,
+    .ops = hips_genl_ops,
+    .n_ops = ARRAY_SIZE(hips_genl_ops),
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,1,0)
+    .resv_start_op = HIPS_CMD_EVENT + 1,
+#endif
+    .mcgrps = hips_genl_mcgrps,
+    .n_mcgrps = ARRAY_SIZE(hips_genl_mcgrps),
+};
+
+int hips_genl_init(void)
+{
+    int ret;
+
+    ret = genl_register_family(&hips_genl_family);
+    if (ret < 0) {
+        HIPS_ERROR("无法注册 generic netlink 族: %d", ret);
+        return ret;
+    }
+
+    WRITE_ONCE(hips_genl_registered, true);
+    return 0;
+}
+
+// 在日志工作队列销毁之后调用，此时不会再有事件通知
+void hips_genl_exit(void)
+{
+    WRITE_ONCE(hips_genl_registered, false);
+    genl_unregister_family(&hips_genl_family);
+}
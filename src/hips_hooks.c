@@ -1,8 +1,19 @@
+#include <linux/cgroup.h>
+#include <net/net_namespace.h>
+#include <net/netns/generic.h>
+#include <net/inet_sock.h>
+
 #include "hips_common.h"
 
+static int hips_socket_post_create(struct socket *sock, int family, int type,
+                                   int protocol, int kern);
+static void hips_sk_free_security(struct sock *sk);
+
 // 安全钩子结构体
 static struct security_hook_list hips_hooks[] = {
     LSM_HOOK_INIT(bprm_check, hips_exec_hook),
+    LSM_HOOK_INIT(socket_post_create, hips_socket_post_create),
+    LSM_HOOK_INIT(sk_free_security, hips_sk_free_security),
 };
 
 // Netfilter 钩子结构体
@@ -13,12 +24,24 @@ static struct nf_hook_ops hips_nf_ops[] = {
         .hooknum = NF_INET_PRE_ROUTING,
         .priority = NF_IP_PRI_FIRST,
     },
+    {
+        .hook = hips_dns_hook,
+        .pf = NFPROTO_IPV4,
+        .hooknum = NF_INET_LOCAL_OUT,
+        .priority = NF_IP_PRI_FIRST,
+    },
     {
         .hook = hips_network_hook,
         .pf = NFPROTO_IPV4,
         .hooknum = NF_INET_LOCAL_OUT,
         .priority = NF_IP_PRI_FIRST,
     },
+    {
+        .hook = hips_network_hook,
+        .pf = NFPROTO_IPV4,
+        .hooknum = NF_INET_LOCAL_IN,
+        .priority = NF_IP_PRI_FIRST,
+    },
 #ifdef CONFIG_IPV6
     {
         .hook = hips_dns_hook,
@@ -26,32 +49,148 @@ static struct nf_hook_ops hips_nf_ops[] = {
         .hooknum = NF_INET_PRE_ROUTING,
         .priority = NF_IP_PRI_FIRST,
     },
+    {
+        .hook = hips_dns_hook,
+        .pf = NFPROTO_IPV6,
+        .hooknum = NF_INET_LOCAL_OUT,
+        .priority = NF_IP_PRI_FIRST,
+    },
     {
         .hook = hips_network_hook,
         .pf = NFPROTO_IPV6,
         .hooknum = NF_INET_LOCAL_OUT,
         .priority = NF_IP_PRI_FIRST,
     },
+    {
+        .hook = hips_network_hook,
+        .pf = NFPROTO_IPV6,
+        .hooknum = NF_INET_LOCAL_IN,
+        .priority = NF_IP_PRI_FIRST,
+    },
 #endif
 };
 
+// 网络命名空间私有数据
+struct hips_net {
+    struct hips_rule_set rules;
+};
+
+static unsigned int hips_net_id __read_mostly;
+
+// 取网络命名空间的规则集
+struct hips_rule_set *hips_net_rules(struct net *net)
+{
+    struct hips_net *hn = net_generic(net, hips_net_id);
+    
+    return &hn->rules;
+}
+
+// 网络命名空间创建（含模块加载时已存在的命名空间）：注册钩子和规则集
+static int __net_init hips_net_init(struct net *net)
+{
+    struct hips_net *hn = net_generic(net, hips_net_id);
+    int ret;
+    
+    hips_rule_set_init(&hn->rules, net->ns.inum);
+    
+    ret = nf_register_net_hooks(net, hips_nf_ops, ARRAY_SIZE(hips_nf_ops));
+    if (ret < 0) {
+        HIPS_ERROR("无法注册 Netfilter 钩子 (netns=%u): %d", net->ns.inum, ret);
+        return ret;
+    }
+    
+    hips_register_rule_set(&hn->rules);
+    return 0;
+}
+
+// 网络命名空间销毁：注销钩子并释放该命名空间的规则
+static void __net_exit hips_net_exit(struct net *net)
+{
+    struct hips_net *hn = net_generic(net, hips_net_id);
+    
+    nf_unregister_net_hooks(net, hips_nf_ops, ARRAY_SIZE(hips_nf_ops));
+    hips_unregister_rule_set(&hn->rules);
+}
+
+static struct pernet_operations hips_net_ops = {
+    .init = hips_net_init,
+    .exit = hips_net_exit,
+    .id = &hips_net_id,
+    .size = sizeof(struct hips_net),
+};
+
+// 当前进程所在 cgroup v2 的 ID
+static u64 hips_current_cgroup_id(void)
+{
+#ifdef CONFIG_CGROUPS
+    u64 id;
+    
+    rcu_read_lock();
+    id = cgroup_id(task_dfl_cgroup(current));
+    rcu_read_unlock();
+    return id;
+#else
+    return 0;
+#endif
+}
+
+// 报文所属套接字的 cgroup v2 ID，没有关联套接字时返回 0
+static u64 hips_skb_cgroup_id(struct sk_buff *skb)
+{
+#ifdef CONFIG_SOCK_CGROUP_DATA
+    struct sock *sk = skb_to_full_sk(skb);
+    
+    if (sk && sk_fullsock(sk)) {
+        return cgroup_id(sock_cgroup_ptr(&sk->sk_cgrp_data));
+    }
+#endif
+    return 0;
+}
+
 // 注册安全钩子
 int hips_register_hooks(void)
 {
     int ret;
     
+    // 动态 IP 表由 DNS 钩子填充、网络钩子查询，需在 Netfilter 钩子之前就绪
+    ret = hips_dynip_init();
+    if (ret < 0) {
+        return ret;
+    }
+    
+    // 文件摘要缓存由 exec 钩子使用
+    ret = hips_digest_init();
+    if (ret < 0) {
+        hips_dynip_exit();
+        return ret;
+    }
+    
+    // 在每个网络命名空间注册 Netfilter 钩子，exec 钩子依赖命名空间私有数据，需先注册
+    ret = register_pernet_subsys(&hips_net_ops);
+    if (ret < 0) {
+        HIPS_ERROR("无法注册 Netfilter 钩子: %d", ret);
+        hips_digest_exit();
+        hips_dynip_exit();
+        return ret;
+    }
+    
     // 注册 LSM 钩子
     ret = security_add_hooks(hips_hooks, ARRAY_SIZE(hips_hooks), "hips");
     if (ret < 0) {
         HIPS_ERROR("无法注册 LSM 钩子: %d", ret);
+        unregister_pernet_subsys(&hips_net_ops);
+        hips_digest_exit();
+        hips_dynip_exit();
         return ret;
     }
     
-    // 注册 Netfilter 钩子
-    ret = nf_register_net_hooks(&init_net, hips_nf_ops, ARRAY_SIZE(hips_nf_ops));
+    // 入口钩子按网卡注册，使用命名空间规则集，需在 pernet 注册之后
+    ret = hips_ingress_init();
     if (ret < 0) {
-        HIPS_ERROR("无法注册 Netfilter 钩子: %d", ret);
         security_delete_hooks(hips_hooks, ARRAY_SIZE(hips_hooks));
+        unregister_pernet_subsys(&hips_net_ops);
+        hips_digest_exit();
+        hips_dynip_exit();
         return ret;
     }
     
@@ -62,49 +201,144 @@ int hips_register_hooks(void)
 // 注销安全钩子
 void hips_unregister_hooks(void)
 {
-    nf_unregister_net_hooks(&init_net, hips_nf_ops, ARRAY_SIZE(hips_nf_ops));
     security_delete_hooks(hips_hooks, ARRAY_SIZE(hips_hooks));
+    hips_ingress_exit();
+    unregister_pernet_subsys(&hips_net_ops);
+    hips_digest_exit();
+    hips_dynip_exit();
+    hips_sock_owner_cleanup();
     HIPS_INFO("安全钩子注销完成");
 }
 
+// 套接字创建钩子：在创建者的进程上下文中记录归属，供网络事件使用
+static int hips_socket_post_create(struct socket *sock, int family, int type,
+                                   int protocol, int kern)
+{
+    if (kern || !sock->sk || (family != AF_INET && family != AF_INET6)) {
+        return 0;
+    }
+    
+    hips_sock_owner_capture(sock->sk, hips_current_cgroup_id(), GFP_KERNEL);
+    return 0;
+}
+
+// 套接字释放钩子
+static void hips_sk_free_security(struct sock *sk)
+{
+    hips_sock_owner_release(sk);
+}
+
 // 进程执行钩子
 int hips_exec_hook(struct linux_binprm *bprm)
 {
     struct hips_rule matched_rule;
+    struct hips_rule_set *net_set;
+    struct hips_shadow_live live;
+    struct hips_owner owner;
+    u8 digest[HIPS_SHA256_SIZE];
+    u32 rule_id = 0, rule_type = 0, action = 0, priority = 0, log_sample = 0, log_rate = 0;
     char *process_name;
     char *exe_path;
+    char *path_buf;
+    bool matched = false, shadow;
+    u64 cgroup_id, start;
     int ret = 0;
     
     if (!hips_config || !hips_config->config.enabled) {
         return 0;
     }
+    start = hips_metrics_begin();
     
     // 获取进程信息
     process_name = hips_get_process_name(current);
+    
+    // 按打开的文件取规范的绝对路径，相对路径、".." 和符号链接都无法绕过目录规则；
+    // 取不到时退回调用者传入的文件名，由匹配函数做词法规范化
     exe_path = bprm->filename;
+    path_buf = kmalloc(PATH_MAX, GFP_KERNEL);
+    if (path_buf) {
+        char *path = file_path(bprm->file, path_buf, PATH_MAX);
+        
+        if (!IS_ERR(path)) {
+            exe_path = path;
+        }
+    }
     
     HIPS_DEBUG("进程执行检查: %s (%s)", process_name, exe_path);
     
-    // 检查执行规则
-    if (hips_match_rule(HIPS_RULE_EXEC, exe_path, &matched_rule) == 0) {
-        if (matched_rule.action == HIPS_ACTION_BLOCK) {
-            HIPS_WARN("阻止进程执行: %s (规则ID: %u)", exe_path, matched_rule.rule_id);
-            
-            // 记录事件
-            hips_log_event(matched_rule.rule_id, HIPS_RULE_EXEC, HIPS_ACTION_BLOCK,
-                          current->pid, process_name, exe_path, "进程执行被阻止");
+    // 检查执行规则（全局规则叠加进程所在 cgroup 和网络命名空间的规则）
+    cgroup_id = hips_current_cgroup_id();
+    net_set = hips_net_rules(current->nsproxy->net_ns);
+    shadow = hips_shadow_sampled();
+    if (shadow) {
+        live.start = ktime_get_ns();
+    }
+    if (hips_match_rule_scoped(net_set, cgroup_id, HIPS_RULE_EXEC, exe_path, &matched_rule) == 0) {
+        matched = true;
+        rule_id = matched_rule.rule_id;
+        rule_type = HIPS_RULE_EXEC;
+        action = matched_rule.action;
+        priority = matched_rule.priority;
+        log_sample = matched_rule.log_sample;
+        log_rate = matched_rule.log_rate;
+    }
+    
+    // 哈希规则按文件内容匹配，摘要来自按 inode 的缓存。路径规则已经阻止时不必取摘要，
+    // 两类规则都命中时取优先级高的，同优先级时路径规则优先
+    if ((!matched || action != HIPS_ACTION_BLOCK) && READ_ONCE(hips_config->hash_count)) {
+        ret = hips_digest_file(bprm->file, digest);
+        if (ret == HIPS_SUCCESS &&
+            hips_match_digest(net_set, cgroup_id, digest, &matched_rule) == 0 &&
+            (!matched || matched_rule.priority > priority)) {
+            matched = true;
+            rule_id = matched_rule.rule_id;
+            rule_type = HIPS_RULE_HASH;
+            action = matched_rule.action;
+            log_sample = matched_rule.log_sample;
+            log_rate = matched_rule.log_rate;
+        } else if (ret == HIPS_ERROR_PERMISSION && !(matched && action == HIPS_ACTION_ALLOW)) {
+            // hash_fail_closed：摘要无法取得时按阻止处理，事件中规则 ID 为 0。
+            // 路径规则明确允许的程序不受影响，记录规则不表示允许，仍然拒绝
+            matched = true;
+            rule_id = 0;
+            rule_type = HIPS_RULE_HASH;
+            action = HIPS_ACTION_BLOCK;
+        }
+        ret = 0;
+    }
+    
+    // 抽样事件上以同样的方式匹配影子规则集，只比较和记录，不影响判决
+    if (shadow) {
+        live.rule_id = rule_id;
+        live.rule_type = rule_type;
+        live.blocked = matched && action == HIPS_ACTION_BLOCK;
+        hips_shadow_check_exec(bprm->file, exe_path, net_set, cgroup_id, &live);
+    }
+    
+    if (matched) {
+        if (action == HIPS_ACTION_BLOCK) {
+            // 记录事件（由日志工作项格式化并输出）
+            hips_current_owner(&owner, cgroup_id);
+            hips_log_exec_event(rule_id, rule_type, HIPS_ACTION_BLOCK, &owner, bprm->file,
+                                rule_type == HIPS_RULE_HASH && rule_id ? digest : NULL, 0);
             
             // 更新统计
-            hips_update_stats(HIPS_RULE_EXEC, HIPS_ACTION_BLOCK);
+            hips_update_stats(rule_type, HIPS_ACTION_BLOCK);
             
-            return -EPERM;
-        } else if (matched_rule.action == HIPS_ACTION_LOG) {
-            HIPS_INFO("记录进程执行: %s (规则ID: %u)", exe_path, matched_rule.rule_id);
-            hips_log_event(matched_rule.rule_id, HIPS_RULE_EXEC, HIPS_ACTION_LOG,
-                          current->pid, process_name, exe_path, "进程执行被记录");
+            ret = -EPERM;
+        } else if (action == HIPS_ACTION_LOG &&
+                   hips_log_admit(rule_id, log_sample, log_rate)) {
+            // 记录动作先按规则的抽样和每秒上限判定，略过的事件不取进程归属
+            hips_current_owner(&owner, cgroup_id);
+            hips_log_exec_event(rule_id, rule_type, HIPS_ACTION_LOG, &owner, bprm->file,
+                                rule_type == HIPS_RULE_HASH ? digest : NULL, 0);
         }
     }
     
+    // 耗时包括取路径、摘要和记录事件
+    hips_metrics_eval(HIPS_HOOK_EXEC, start, rule_id, ret != 0);
+    
+    kfree(path_buf);
     return ret;
 }
 
@@ -112,174 +346,305 @@ int hips_exec_hook(struct linux_binprm *bprm)
 int hips_dns_hook(struct sk_buff *skb, const struct nf_hook_state *state)
 {
     struct hips_rule matched_rule;
-    struct udphdr *udp;
-    struct tcphdr *tcp;
+    struct hips_dns_query query;
+    struct hips_shadow_live live;
+    struct hips_owner owner;
+    struct hips_rule_set *net_set;
+    __be16 sport, dport;
+    u8 protocol;
     char domain[256];
+    u64 cgroup_id, start;
+    bool matched, shadow;
     int ret = NF_ACCEPT;
     
     if (!hips_config || !hips_config->config.enabled) {
         return NF_ACCEPT;
     }
     
-    // 检查是否是 DNS 查询
-    if (state->pf == NFPROTO_IPV4) {
-        struct iphdr *iph = ip_hdr(skb);
-        if (iph->protocol == IPPROTO_UDP) {
-            udp = udp_hdr(skb);
-            if (ntohs(udp->dest) != 53) {
-                return NF_ACCEPT;
-            }
-        } else if (iph->protocol == IPPROTO_TCP) {
-            tcp = tcp_hdr(skb);
-            if (ntohs(tcp->dest) != 53) {
-                return NF_ACCEPT;
-            }
-        } else {
-            return NF_ACCEPT;
-        }
+    // 检查是否是 DNS 查询（端口 53）
+    if (hips_get_l4_ports(skb, state->pf, &protocol, &sport, &dport) < 0) {
+        return NF_ACCEPT;
     }
-#ifdef CONFIG_IPV6
-    else if (state->pf == NFPROTO_IPV6) {
-        struct ipv6hdr *ip6h = ipv6_hdr(skb);
-        if (ip6h->nexthdr == IPPROTO_UDP) {
-            udp = udp_hdr(skb);
-            if (ntohs(udp->dest) != 53) {
-                return NF_ACCEPT;
-            }
-        } else if (ip6h->nexthdr == IPPROTO_TCP) {
-            tcp = tcp_hdr(skb);
-            if (ntohs(tcp->dest) != 53) {
-                return NF_ACCEPT;
-            }
-        } else {
-            return NF_ACCEPT;
-        }
+    
+    if (protocol != IPPROTO_UDP && protocol != IPPROTO_TCP) {
+        return NF_ACCEPT;
     }
-#endif
-    else {
+    
+    // 入站应答：对上已登记查询时学习其解析出的地址，应答本身放行
+    if (ntohs(sport) == 53 && state->hook == NF_INET_PRE_ROUTING) {
+        hips_dns_learn_response(skb, state);
+        return NF_ACCEPT;
+    }
+    
+    if (ntohs(dport) != 53) {
+        return NF_ACCEPT;
+    }
+    
+    // 发往本机解析器（如 127.0.0.53）的查询在 LOCAL_OUT 已经检查过，经回环接口再次进入时不重复匹配、记录和登记
+    if (state->hook == NF_INET_PRE_ROUTING && skb->dev && (skb->dev->flags & IFF_LOOPBACK)) {
         return NF_ACCEPT;
     }
+    start = hips_metrics_begin();
     
-    // 解析域名（简化实现）
-    if (hips_parse_dns_query(skb, domain, sizeof(domain)) == 0) {
+    // 解析域名
+    if (hips_parse_dns_query(skb, state->pf, &query, domain, sizeof(domain)) == 0) {
         HIPS_DEBUG("DNS 查询检查: %s", domain);
         
         // 检查 DNS 规则
-        if (hips_match_rule(HIPS_RULE_DNS, domain, &matched_rule) == 0) {
+        cgroup_id = hips_skb_cgroup_id(skb);
+        shadow = hips_shadow_sampled();
+        if (shadow) {
+            live.start = ktime_get_ns();
+        }
+        net_set = hips_net_rules(state->net);
+        matched = hips_match_rule_scoped(net_set, cgroup_id, HIPS_RULE_DNS, domain,
+                                         &matched_rule) == 0;
+        if (shadow) {
+            live.rule_id = matched ? matched_rule.rule_id : 0;
+            live.rule_type = HIPS_RULE_DNS;
+            live.blocked = matched && matched_rule.action == HIPS_ACTION_BLOCK;
+            hips_shadow_check_dns(skb, net_set, cgroup_id, domain, &live);
+        }
+        if (matched) {
             if (matched_rule.action == HIPS_ACTION_BLOCK) {
-                HIPS_WARN("阻止 DNS 查询: %s (规则ID: %u)", domain, matched_rule.rule_id);
-                
-                // 记录事件
+                // 记录事件（由日志工作项格式化并输出），只在命中时查询归属，不增加逐包开销
+                hips_skb_owner(skb, cgroup_id, &owner);
                 hips_log_event(matched_rule.rule_id, HIPS_RULE_DNS, HIPS_ACTION_BLOCK,
-                              current->pid, "dns", domain, "DNS 查询被阻止");
+                              &owner, domain, 0);
                 
                 // 更新统计
                 hips_update_stats(HIPS_RULE_DNS, HIPS_ACTION_BLOCK);
                 
+                // 本机发出的查询尽量合成应答，让调用者立即失败而不是等待重试超时
+                if (hips_dns_respond(skb, state, &query) < 0) {
+                    hips_update_dns_stats(HIPS_DNS_RESPONSE_DROP);
+                }
+                
+                hips_metrics_eval(HIPS_HOOK_DNS, start, matched_rule.rule_id, true);
                 return NF_DROP;
             } else if (matched_rule.action == HIPS_ACTION_LOG) {
-                HIPS_INFO("记录 DNS 查询: %s (规则ID: %u)", domain, matched_rule.rule_id);
-                hips_log_event(matched_rule.rule_id, HIPS_RULE_DNS, HIPS_ACTION_LOG,
-                              current->pid, "dns", domain, "DNS 查询被记录");
+                // 查询会被放行，登记后只学习它的应答（与日志抽样无关）
+                hips_dns_track_query(skb, state, &query, domain, &matched_rule);
+                if (hips_log_admit(matched_rule.rule_id, matched_rule.log_sample,
+                                   matched_rule.log_rate)) {
+                    hips_skb_owner(skb, cgroup_id, &owner);
+                    hips_log_event(matched_rule.rule_id, HIPS_RULE_DNS, HIPS_ACTION_LOG,
+                                  &owner, domain, 0);
+                }
             }
         }
+        hips_metrics_eval(HIPS_HOOK_DNS, start, matched ? matched_rule.rule_id : 0, false);
     }
     
     return ret;
 }
 
-// 网络连接钩子
+// 构造分类器查找键：出站取目的地址，入站取源地址（远端），端口均为目的端口
+static int hips_build_net_key(struct sk_buff *skb, u8 pf, u8 direction, struct hips_net_key *key)
+{
+    __be16 sport, dport;
+    
+    memset(key, 0, sizeof(*key));
+    key->direction = direction;
+    
+    if (pf == NFPROTO_IPV4) {
+        struct iphdr *iph = ip_hdr(skb);
+        
+        key->family = AF_INET;
+        memcpy(key->addr, direction == HIPS_DIR_IN ? &iph->saddr : &iph->daddr, 4);
+    }
+#ifdef CONFIG_IPV6
+    else if (pf == NFPROTO_IPV6) {
+        struct ipv6hdr *ip6h = ipv6_hdr(skb);
+        
+        key->family = AF_INET6;
+        memcpy(key->addr, direction == HIPS_DIR_IN ? &ip6h->saddr : &ip6h->daddr, 16);
+    }
+#endif
+    else {
+        return -1;
+    }
+    
+    // 非首分片等无法取得传输层信息时只按地址匹配
+    if (hips_get_l4_ports(skb, pf, &key->protocol, &sport, &dport) < 0) {
+        key->protocol = 0;
+        dport = 0;
+    }
+    key->port = ntohs(dport);
+    
+    return 0;
+}
+
+// 网络连接钩子：出站检查动态 IP、字符串规则和结构化规则，入站只检查结构化规则
 int hips_network_hook(struct sk_buff *skb, const struct nf_hook_state *state)
 {
     struct hips_rule matched_rule;
     struct hips_network_addr addr;
+    struct hips_net_key key;
+    struct hips_shadow_live live;
+    struct hips_owner owner;
+    struct hips_rule_set *net_set;
     char addr_str[64];
+    const char *target = NULL;
+    u64 cgroup_id, start;
+    u8 direction;
+    u32 event_flags;
+    bool dynamic = false, matched, shadow;
     int ret = NF_ACCEPT;
     
     if (!hips_config || !hips_config->config.enabled) {
         return NF_ACCEPT;
     }
     
+    direction = state->hook == NF_INET_LOCAL_IN ? HIPS_DIR_IN : HIPS_DIR_OUT;
+    
+    // 没有结构化规则时入站方向无需检查
+    if (direction == HIPS_DIR_IN && !READ_ONCE(hips_config->netcls_count)) {
+        return NF_ACCEPT;
+    }
+    start = hips_metrics_begin();
+    
     // 解析网络地址
-    if (hips_parse_network_addr(skb, &addr) == 0) {
+    if (hips_build_net_key(skb, state->pf, direction, &key) != 0) {
+        return NF_ACCEPT;
+    }
+    
+    addr.family = key.family;
+    memcpy(&addr.addr, key.addr, sizeof(addr.addr));
+    addr.port = key.port;
+    
+    // 先按二进制地址查 DNS 应答学习到的动态 IP，命中时不再做规则匹配
+    if (direction == HIPS_DIR_OUT) {
+        dynamic = hips_dynip_lookup(&addr, state->net->ns.inum, &matched_rule) == 0;
+    }
+    
+    // 检查网络规则（动态 IP 命中来自生效规则集的 DNS 规则，影子规则集无从比较，不抽样）
+    cgroup_id = hips_skb_cgroup_id(skb);
+    net_set = hips_net_rules(state->net);
+    shadow = !dynamic && hips_shadow_sampled();
+    
+    // 字符串规则只描述出站目的地址，且只在适用的规则集中有字符串网络规则时才格式化，
+    // 只有结构化规则时每个出站报文不必生成地址字符串
+    if (direction == HIPS_DIR_OUT && !dynamic && hips_network_strings(net_set, cgroup_id, shadow)) {
         hips_format_network_addr(&addr, addr_str, sizeof(addr_str));
         HIPS_DEBUG("网络连接检查: %s", addr_str);
-        
-        // 检查网络规则
-        if (hips_match_rule(HIPS_RULE_NETWORK, addr_str, &matched_rule) == 0) {
-            if (matched_rule.action == HIPS_ACTION_BLOCK) {
-                HIPS_WARN("阻止网络连接: %s (规则ID: %u)", addr_str, matched_rule.rule_id);
-                
-                // 记录事件
-                hips_log_event(matched_rule.rule_id, HIPS_RULE_NETWORK, HIPS_ACTION_BLOCK,
-                              current->pid, "network", addr_str, "网络连接被阻止");
-                
-                // 更新统计
-                hips_update_stats(HIPS_RULE_NETWORK, HIPS_ACTION_BLOCK);
-                
-                return NF_DROP;
-            } else if (matched_rule.action == HIPS_ACTION_LOG) {
-                HIPS_INFO("记录网络连接: %s (规则ID: %u)", addr_str, matched_rule.rule_id);
-                hips_log_event(matched_rule.rule_id, HIPS_RULE_NETWORK, HIPS_ACTION_LOG,
-                              current->pid, "network", addr_str, "网络连接被记录");
-            }
+        target = addr_str;
+    }
+    
+    if (shadow) {
+        live.start = ktime_get_ns();
+    }
+    matched = dynamic || hips_match_network(net_set, cgroup_id, &key, target, &matched_rule) == 0;
+    event_flags = (dynamic ? HIPS_EVENT_F_DYNIP : 0) |
+                  (direction == HIPS_DIR_IN ? HIPS_EVENT_F_INBOUND : 0);
+    if (shadow) {
+        live.rule_id = matched ? matched_rule.rule_id : 0;
+        live.rule_type = HIPS_RULE_NETWORK;
+        live.blocked = matched && matched_rule.action == HIPS_ACTION_BLOCK;
+        hips_shadow_check_network(skb, net_set, cgroup_id, &key, &addr, target, event_flags,
+                                  &live);
+    }
+    if (matched) {
+        if (matched_rule.action == HIPS_ACTION_BLOCK) {
+            // 记录事件（地址以二进制形式记录，由日志工作项格式化），只在命中时查询归属
+            hips_skb_owner(skb, cgroup_id, &owner);
+            hips_log_net_event(matched_rule.rule_id, HIPS_ACTION_BLOCK, &owner, &addr, event_flags);
+            
+            // 更新统计
+            hips_update_stats(HIPS_RULE_NETWORK, HIPS_ACTION_BLOCK);
+            
+            hips_metrics_eval(HIPS_HOOK_NETWORK, start, matched_rule.rule_id, true);
+            return NF_DROP;
+        } else if (matched_rule.action == HIPS_ACTION_LOG &&
+                   hips_log_admit(matched_rule.rule_id, matched_rule.log_sample,
+                                  matched_rule.log_rate)) {
+            // 动态 IP 命中沿用来源 DNS 规则的抽样和上限（共用其限速状态）
+            hips_skb_owner(skb, cgroup_id, &owner);
+            hips_log_net_event(matched_rule.rule_id, HIPS_ACTION_LOG, &owner, &addr, event_flags);
         }
     }
+    hips_metrics_eval(HIPS_HOOK_NETWORK, start, matched ? matched_rule.rule_id : 0, false);
     
     return ret;
 }
 
-// 解析 DNS 查询（简化实现）
-int hips_parse_dns_query(struct sk_buff *skb, char *domain, size_t domain_size)
+// 定位传输层头并读取端口（兼容非线性 skb 和分片）
+// 返回传输层头偏移，非首分片或无法解析时返回 -1
+int hips_get_l4_ports(struct sk_buff *skb, u8 pf, u8 *protocol, __be16 *sport, __be16 *dport)
 {
-    // 这里实现 DNS 查询解析
-    // 简化实现，实际需要解析 DNS 包结构
-    memset(domain, 0, domain_size);
-    strncpy(domain, "example.com", domain_size - 1);
-    return 0;
+    __be16 _ports[2], *ports;
+    int offset;
+    
+    if (pf == NFPROTO_IPV4) {
+        struct iphdr *iph = ip_hdr(skb);
+        
+        // 非首分片不含传输层头
+        if (ntohs(iph->frag_off) & IP_OFFSET) {
+            return -1;
+        }
+        *protocol = iph->protocol;
+        offset = skb_network_offset(skb) + iph->ihl * 4;
+    }
+#ifdef CONFIG_IPV6
+    else if (pf == NFPROTO_IPV6) {
+        u8 nexthdr = ipv6_hdr(skb)->nexthdr;
+        __be16 frag_off = 0;
+        
+        offset = ipv6_skip_exthdr(skb, skb_network_offset(skb) + sizeof(struct ipv6hdr),
+                                  &nexthdr, &frag_off);
+        if (offset < 0 || (frag_off & htons(~0x7))) {
+            return -1;
+        }
+        *protocol = nexthdr;
+    }
+#endif
+    else {
+        return -1;
+    }
+    
+    *sport = 0;
+    *dport = 0;
+    
+    if (*protocol == IPPROTO_TCP || *protocol == IPPROTO_UDP) {
+        // TCP 和 UDP 头的前 4 字节均为源端口和目的端口
+        ports = skb_header_pointer(skb, offset, sizeof(_ports), _ports);
+        if (!ports) {
+            return -1;
+        }
+        *sport = ports[0];
+        *dport = ports[1];
+    }
+    
+    return offset;
 }
 
 // 解析网络地址
 int hips_parse_network_addr(struct sk_buff *skb, struct hips_network_addr *addr)
 {
-    struct iphdr *iph;
-    struct ipv6hdr *ip6h;
-    struct tcphdr *tcp;
-    struct udphdr *udp;
+    __be16 sport, dport;
+    u8 protocol;
     
     if (skb->protocol == htons(ETH_P_IP)) {
-        iph = ip_hdr(skb);
         addr->family = AF_INET;
-        addr->addr.ipv4 = iph->daddr;
+        addr->addr.ipv4 = ip_hdr(skb)->daddr;
         
         // 解析端口信息
-        if (iph->protocol == IPPROTO_TCP) {
-            tcp = tcp_hdr(skb);
-            addr->port = ntohs(tcp->dest);
-        } else if (iph->protocol == IPPROTO_UDP) {
-            udp = udp_hdr(skb);
-            addr->port = ntohs(udp->dest);
-        } else {
-            addr->port = 0;
+        if (hips_get_l4_ports(skb, NFPROTO_IPV4, &protocol, &sport, &dport) < 0) {
+            dport = 0;
         }
+        addr->port = ntohs(dport);
         return 0;
     }
 #ifdef CONFIG_IPV6
     else if (skb->protocol == htons(ETH_P_IPV6)) {
-        ip6h = ipv6_hdr(skb);
         addr->family = AF_INET6;
-        memcpy(addr->addr.ipv6, &ip6h->daddr, 16);
+        memcpy(addr->addr.ipv6, &ipv6_hdr(skb)->daddr, 16);
         
         // 解析端口信息
-        if (ip6h->nexthdr == IPPROTO_TCP) {
-            tcp = tcp_hdr(skb);
-            addr->port = ntohs(tcp->dest);
-        } else if (ip6h->nexthdr == IPPROTO_UDP) {
-            udp = udp_hdr(skb);
-            addr->port = ntohs(udp->dest);
-        } else {
-            addr->port = 0;
+        if (hips_get_l4_ports(skb, NFPROTO_IPV6, &protocol, &sport, &dport) < 0) {
+            dport = 0;
         }
+        addr->port = ntohs(dport);
         return 0;
     }
 #endif
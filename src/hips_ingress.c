@@ -0,0 +1,293 @@
+#include <linux/netdevice.h>
+#include <linux/percpu.h>
+#include <linux/ratelimit.h>
+#include <linux/rtnetlink.h>
+#include <net/net_namespace.h>
+
+#include "hips_common.h"
+
+/*
+ * 网卡入口早期丢弃
+ *
+ * 在选定网卡的 NF_NETDEV_INGRESS 上按源地址查结构化网络规则（入站方向），
+ * 命中阻止规则的报文在路由和连接跟踪之前丢弃，洪泛时省去整条协议栈的开销。
+ * 与 LOCAL_IN 共用同一套规则和分类器，查找在 RCU 读临界区内进行，不获取 config_lock；
+ * 记录、允许规则仍由 LOCAL_IN 处理。
+ * 丢弃计数使用每 CPU 计数器，事件日志限速，避免洪泛时在全局锁上竞争或占满事件池。
+ */
+
+static char hips_ingress_devs[256];
+module_param_string(ingress_devs, hips_ingress_devs, sizeof(hips_ingress_devs), 0444);
+MODULE_PARM_DESC(ingress_devs, "启用入口早期丢弃的网卡，逗号分隔，\"*\" 表示除回环外的所有网卡");
+
+static DEFINE_PER_CPU(u64, hips_ingress_drops);
+static DEFINE_RATELIMIT_STATE(hips_ingress_log_rs, HZ, 10);
+
+// 按源地址和目的端口构造入站查找键，报文头未经校验，需先确认长度
+static int hips_ingress_build_key(struct sk_buff *skb, struct hips_net_key *key)
+{
+    __be16 sport, dport;
+    u8 pf;
+
+    memset(key, 0, sizeof(*key));
+    key->direction = HIPS_DIR_IN;
+
+    if (skb->protocol == htons(ETH_P_IP)) {
+        const struct iphdr *iph;
+
+        if (!pskb_may_pull(skb, skb_network_offset(skb) + sizeof(struct iphdr))) {
+            return -1;
+        }
+        iph = ip_hdr(skb);
+        if (iph->version != 4 || iph->ihl < 5) {
+            return -1;
+        }
+        key->family = AF_INET;
+        memcpy(key->addr, &iph->saddr, 4);
+        pf = NFPROTO_IPV4;
+    }
+#ifdef CONFIG_IPV6
+    else if (skb->protocol == htons(ETH_P_IPV6)) {
+        if (!pskb_may_pull(skb, skb_network_offset(skb) + sizeof(struct ipv6hdr))) {
+            return -1;
+        }
+        key->family = AF_INET6;
+        memcpy(key->addr, &ipv6_hdr(skb)->saddr, 16);
+        pf = NFPROTO_IPV6;
+    }
+#endif
+    else {
+        return -1;
+    }
+
+    // 非首分片等无法取得传输层信息时只按地址匹配
+    if (hips_get_l4_ports(skb, pf, &key->protocol, &sport, &dport) < 0) {
+        key->protocol = 0;
+        dport = 0;
+    }
+    key->port = ntohs(dport);
+
+    return 0;
+}
+
+// 入口判决，只丢弃命中阻止规则的报文（报文回放测试也直接调用）
+unsigned int hips_ingress_filter(struct sk_buff *skb, struct net *net)
+{
+    struct hips_rule matched_rule;
+    struct hips_net_key key;
+
+    if (!hips_config || !READ_ONCE(hips_config->config.enabled) ||
+        !READ_ONCE(hips_config->netcls_count)) {
+        return NF_ACCEPT;
+    }
+
+    if (hips_ingress_build_key(skb, &key) != 0) {
+        return NF_ACCEPT;
+    }
+
+    if (hips_match_network(hips_net_rules(net), 0, &key, NULL, &matched_rule) != 0 ||
+        matched_rule.action != HIPS_ACTION_BLOCK) {
+        return NF_ACCEPT;
+    }
+
+    this_cpu_inc(hips_ingress_drops);
+
+    // 洪泛时同一来源的事件大量重复，限速后再写入事件池
+    if (__ratelimit(&hips_ingress_log_rs)) {
+        struct hips_network_addr addr;
+        struct hips_owner owner;
+
+        memset(&owner, 0, sizeof(owner));
+        addr.family = key.family;
+        memcpy(&addr.addr, key.addr, sizeof(addr.addr));
+        addr.port = key.port;
+        hips_log_net_event(matched_rule.rule_id, HIPS_ACTION_BLOCK, &owner, &addr,
+                           HIPS_EVENT_F_INBOUND | HIPS_EVENT_F_INGRESS);
+    }
+
+    return NF_DROP;
+}
+
+u64 hips_ingress_get_drops(void)
+{
+    u64 sum = 0;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        sum += per_cpu(hips_ingress_drops, cpu);
+    }
+
+    return sum;
+}
+
+#ifdef CONFIG_NETFILTER_INGRESS
+
+// 已挂载入口钩子的网卡，由 RTNL 保护
+struct hips_ingress_dev {
+    struct list_head list;
+    struct net_device *dev;
+    struct nf_hook_ops ops;
+};
+
+static LIST_HEAD(hips_ingress_list);
+
+static unsigned int hips_ingress_hook(void *priv, struct sk_buff *skb,
+                                      const struct nf_hook_state *state)
+{
+    return hips_ingress_filter(skb, state->net);
+}
+
+// 网卡名是否在 ingress_devs 列表中
+static bool hips_ingress_selected(const struct net_device *dev)
+{
+    const char *p = hips_ingress_devs;
+    size_t len = strlen(dev->name);
+
+    if (strcmp(p, "*") == 0) {
+        return !(dev->flags & IFF_LOOPBACK);
+    }
+
+    while (*p) {
+        const char *end = strchrnul(p, ',');
+
+        if ((size_t)(end - p) == len && strncmp(p, dev->name, len) == 0) {
+            return true;
+        }
+        p = *end ? end + 1 : end;
+    }
+
+    return false;
+}
+
+static struct hips_ingress_dev *hips_ingress_find(const struct net_device *dev)
+{
+    struct hips_ingress_dev *idev;
+
+    list_for_each_entry(idev, &hips_ingress_list, list) {
+        if (idev->dev == dev) {
+            return idev;
+        }
+    }
+
+    return NULL;
+}
+
+static void hips_ingress_attach(struct net_device *dev)
+{
+    struct hips_ingress_dev *idev;
+    int ret;
+
+    if (!hips_ingress_selected(dev) || hips_ingress_find(dev)) {
+        return;
+    }
+
+    idev = kzalloc(sizeof(*idev), GFP_KERNEL);
+    if (!idev) {
+        return;
+    }
+
+    idev->dev = dev;
+    idev->ops.hook = hips_ingress_hook;
+    idev->ops.pf = NFPROTO_NETDEV;
+    idev->ops.hooknum = NF_NETDEV_INGRESS;
+    idev->ops.priority = INT_MIN;
+    idev->ops.dev = dev;
+
+    ret = nf_register_net_hook(dev_net(dev), &idev->ops);
+    if (ret < 0) {
+        HIPS_ERROR("无法在网卡 %s 上注册入口钩子: %d", dev->name, ret);
+        kfree(idev);
+        return;
+    }
+
+    list_add(&idev->list, &hips_ingress_list);
+    HIPS_INFO("网卡 %s 启用入口早期丢弃", dev->name);
+}
+
+static void hips_ingress_detach(struct net_device *dev)
+{
+    struct hips_ingress_dev *idev = hips_ingress_find(dev);
+
+    if (!idev) {
+        return;
+    }
+
+    nf_unregister_net_hook(dev_net(dev), &idev->ops);
+    list_del(&idev->list);
+    kfree(idev);
+}
+
+// 网卡注册、注销和改名时挂载或卸载钩子；注册通知器时会对已有网卡重放 REGISTER
+static int hips_ingress_netdev_event(struct notifier_block *nb, unsigned long event, void *ptr)
+{
+    struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+
+    switch (event) {
+        case NETDEV_REGISTER:
+            hips_ingress_attach(dev);
+            break;
+        case NETDEV_UNREGISTER:
+            hips_ingress_detach(dev);
+            break;
+        case NETDEV_CHANGENAME:
+            hips_ingress_detach(dev);
+            hips_ingress_attach(dev);
+            break;
+    }
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block hips_ingress_notifier = {
+    .notifier_call = hips_ingress_netdev_event,
+};
+
+int hips_ingress_init(void)
+{
+    int ret;
+
+    if (!hips_ingress_devs[0]) {
+        return 0;
+    }
+
+    ret = register_netdevice_notifier(&hips_ingress_notifier);
+    if (ret < 0) {
+        HIPS_ERROR("无法注册网卡通知器: %d", ret);
+    }
+
+    return ret;
+}
+
+void hips_ingress_exit(void)
+{
+    struct hips_ingress_dev *idev, *tmp;
+
+    if (!hips_ingress_devs[0]) {
+        return;
+    }
+
+    // 注销通知器会对已有网卡重放 UNREGISTER，这里只清理剩余条目
+    unregister_netdevice_notifier(&hips_ingress_notifier);
+
+    rtnl_lock();
+    list_for_each_entry_safe(idev, tmp, &hips_ingress_list, list) {
+        hips_ingress_detach(idev->dev);
+    }
+    rtnl_unlock();
+}
+
+#else
+
+int hips_ingress_init(void)
+{
+    if (hips_ingress_devs[0]) {
+        HIPS_WARN("内核未启用 CONFIG_NETFILTER_INGRESS，忽略 ingress_devs");
+    }
+    return 0;
+}
+
+void hips_ingress_exit(void)
+{
+}
+
+#endif
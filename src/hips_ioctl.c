@@ -0,0 +1,481 @@
+#include <linux/capability.h>
+#include <linux/vmalloc.h>
+
+#include "hips_common.h"
+
+/*
+ * 字符设备 /dev/hips
+ *
+ * ioctl 是 hipsctl 使用的控制接口；write 接受与 /proc/hips/rules 相同格式的规则行。
+ * 修改规则和配置需要 CAP_NET_ADMIN。
+ */
+
+// 每次打开设备时快照的日志条目数
+#define HIPS_IOCTL_LOG_BATCH  100
+
+// 打开设备的私有数据：GET_LOGS 逐条返回快照中的日志
+struct hips_file {
+    struct hips_log_entry *logs;
+    int log_count;
+    int log_pos;
+};
+
+// 将 HIPS_ERROR_* 转换为 errno（generic netlink 接口也使用）
+long hips_errno(int ret)
+{
+    switch (ret) {
+        case HIPS_SUCCESS:
+            return 0;
+        case HIPS_ERROR_NOT_FOUND:
+            return -ENOENT;
+        case HIPS_ERROR_EXISTS:
+            return -EEXIST;
+        case HIPS_ERROR_PERMISSION:
+            return -EPERM;
+        case HIPS_ERROR_MEMORY:
+            return -ENOMEM;
+        default:
+            return -EINVAL;
+    }
+}
+
+int hips_open(struct inode *inode, struct file *file)
+{
+    struct hips_file *hf;
+
+    hf = kzalloc(sizeof(*hf), GFP_KERNEL);
+    if (!hf) {
+        return -ENOMEM;
+    }
+
+    file->private_data = hf;
+    return 0;
+}
+
+int hips_release(struct inode *inode, struct file *file)
+{
+    struct hips_file *hf = file->private_data;
+
+    if (hf) {
+        vfree(hf->logs);
+        kfree(hf);
+    }
+    return 0;
+}
+
+// 设备不提供读取，状态请使用 ioctl 或 /proc/hips/status
+ssize_t hips_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+    return 0;
+}
+
+// 写入规则行，格式同 /proc/hips/rules
+ssize_t hips_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+    char *data;
+    int ret;
+
+    if (!capable(CAP_NET_ADMIN)) {
+        return -EPERM;
+    }
+
+    if (count == 0 || count > PAGE_SIZE * 16) {
+        return -EINVAL;
+    }
+
+    data = memdup_user(buf, count);
+    if (IS_ERR(data)) {
+        return PTR_ERR(data);
+    }
+
+    ret = hips_parse_rules_command(data, count);
+    kfree(data);
+
+    return ret < 0 ? hips_errno(ret) : count;
+}
+
+// 添加规则，结构化网络规则由 HIPS_IOCTL_ADD_NET_RULE 设置标志
+static long hips_ioctl_add_rule(unsigned long arg, bool structured)
+{
+    struct hips_rule rule;
+    int ret;
+
+    if (copy_from_user(&rule, (void __user *)arg, sizeof(rule))) {
+        return -EFAULT;
+    }
+
+    if (structured) {
+        rule.flags |= HIPS_RULE_F_STRUCTURED;
+    } else {
+        rule.flags &= ~HIPS_RULE_F_STRUCTURED;
+    }
+    rule.target[sizeof(rule.target) - 1] = '\0';
+    rule.description[sizeof(rule.description) - 1] = '\0';
+
+    ret = hips_add_rule(&rule);
+    if (ret != HIPS_SUCCESS) {
+        return hips_errno(ret);
+    }
+
+    // 回传分配的规则 ID 和规范化后的匹配条件
+    if (copy_to_user((void __user *)arg, &rule, sizeof(rule))) {
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+// 批量添加：整批规则在一次加锁内插入，逐项返回结果，单项失败不影响其余各项
+static long hips_ioctl_add_rules(unsigned long arg)
+{
+    struct hips_rule_batch batch;
+    struct hips_rule *rules = NULL;
+    int *status = NULL;
+    long ret;
+    u32 i;
+
+    if (copy_from_user(&batch, (void __user *)arg, sizeof(batch))) {
+        return -EFAULT;
+    }
+    if (batch.count == 0 || batch.count > HIPS_BATCH_MAX) {
+        return -EINVAL;
+    }
+
+    rules = vmemdup_user(u64_to_user_ptr(batch.rules), array_size(batch.count, sizeof(*rules)));
+    if (IS_ERR(rules)) {
+        return PTR_ERR(rules);
+    }
+    status = kvmalloc_array(batch.count, sizeof(*status), GFP_KERNEL);
+    if (!status) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    for (i = 0; i < batch.count; i++) {
+        rules[i].target[sizeof(rules[i].target) - 1] = '\0';
+        rules[i].description[sizeof(rules[i].description) - 1] = '\0';
+    }
+
+    ret = hips_add_rules(rules, batch.count, status);
+    if (ret < 0) {
+        ret = hips_errno(ret);
+        goto out;
+    }
+
+    for (i = 0; i < batch.count; i++) {
+        status[i] = hips_errno(status[i]);
+    }
+
+    // 回传分配的规则 ID 和每项的结果
+    ret = 0;
+    if (copy_to_user(u64_to_user_ptr(batch.rules), rules, array_size(batch.count, sizeof(*rules))) ||
+        copy_to_user(u64_to_user_ptr(batch.status), status, array_size(batch.count, sizeof(*status)))) {
+        ret = -EFAULT;
+    }
+
+out:
+    kvfree(status);
+    kvfree(rules);
+    return ret;
+}
+
+// 批量删除，结果格式同批量添加
+static long hips_ioctl_del_rules(unsigned long arg)
+{
+    struct hips_id_batch batch;
+    u32 *ids;
+    int *status = NULL;
+    long ret;
+    u32 i;
+
+    if (copy_from_user(&batch, (void __user *)arg, sizeof(batch))) {
+        return -EFAULT;
+    }
+    if (batch.count == 0 || batch.count > HIPS_BATCH_MAX) {
+        return -EINVAL;
+    }
+
+    ids = vmemdup_user(u64_to_user_ptr(batch.ids), array_size(batch.count, sizeof(*ids)));
+    if (IS_ERR(ids)) {
+        return PTR_ERR(ids);
+    }
+    status = kvmalloc_array(batch.count, sizeof(*status), GFP_KERNEL);
+    if (!status) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    ret = hips_del_rules(ids, batch.count, status);
+    if (ret < 0) {
+        ret = hips_errno(ret);
+        goto out;
+    }
+
+    for (i = 0; i < batch.count; i++) {
+        status[i] = hips_errno(status[i]);
+    }
+
+    ret = 0;
+    if (copy_to_user(u64_to_user_ptr(batch.status), status, array_size(batch.count, sizeof(*status)))) {
+        ret = -EFAULT;
+    }
+
+out:
+    kvfree(status);
+    kvfree(ids);
+    return ret;
+}
+
+// 分页导出规则，不持有 config_lock，每页开销与规则总数无关
+static long hips_ioctl_dump_rules(unsigned long arg)
+{
+    struct hips_rule_dump dump;
+    struct hips_rule *rules;
+    int count;
+    long ret = 0;
+
+    if (copy_from_user(&dump, (void __user *)arg, sizeof(dump))) {
+        return -EFAULT;
+    }
+    if (dump.count == 0) {
+        return -EINVAL;
+    }
+    dump.count = min_t(u32, dump.count, HIPS_BATCH_MAX);
+
+    rules = kvmalloc_array(dump.count, sizeof(*rules), GFP_KERNEL);
+    if (!rules) {
+        return -ENOMEM;
+    }
+
+    count = hips_dump_rules(dump.start_id, rules, dump.count);
+    if (count < 0) {
+        ret = hips_errno(count);
+        goto out;
+    }
+
+    // 不满一页即已导出完毕；ID 为 U32_MAX 的规则之后加一回绕为 0，同样表示结束
+    dump.next_id = count == dump.count ? rules[count - 1].rule_id + 1 : 0;
+    dump.count = count;
+
+    if (copy_to_user(u64_to_user_ptr(dump.rules), rules, array_size(count, sizeof(*rules))) ||
+        copy_to_user((void __user *)arg, &dump, sizeof(dump))) {
+        ret = -EFAULT;
+    }
+
+out:
+    kvfree(rules);
+    return ret;
+}
+
+// 一次取回钩子、缓存、日志计数和一页规则命中计数（hipsctl top 每个刷新周期调用）
+static long hips_ioctl_get_metrics(unsigned long arg)
+{
+    struct hips_metrics *metrics;
+    struct hips_rule_hits *hits = NULL;
+    u64 log_first;
+    u32 digest_entries;
+    int count = 0;
+    long ret = 0;
+
+    metrics = kzalloc(sizeof(*metrics), GFP_KERNEL);
+    if (!metrics) {
+        return -ENOMEM;
+    }
+    if (copy_from_user(metrics, (void __user *)arg, sizeof(*metrics))) {
+        ret = -EFAULT;
+        goto out;
+    }
+    metrics->count = min_t(u32, metrics->count, HIPS_BATCH_MAX);
+
+    // 清零分配：目标字符串之后的字节同样复制到用户空间
+    if (metrics->count) {
+        hits = kvcalloc(metrics->count, sizeof(*hits), GFP_KERNEL);
+        if (!hits) {
+            ret = -ENOMEM;
+            goto out;
+        }
+        count = hips_metrics_dump_hits(metrics->start_id, hits, metrics->count);
+        if (count < 0) {
+            ret = hips_errno(count);
+            goto out;
+        }
+    }
+
+    metrics->timestamp = ktime_get_ns();
+    ret = hips_get_stats(&metrics->stats);
+    if (ret != HIPS_SUCCESS) {
+        ret = hips_errno(ret);
+        goto out;
+    }
+    hips_metrics_get_hooks(metrics->hooks);
+    hips_digest_get_stats(&digest_entries, &metrics->digest_hits, &metrics->digest_misses,
+                          &metrics->digest_deferred);
+    metrics->digest_entries = digest_entries;
+    hips_log_range(&log_first, &metrics->log_events);
+
+    // 规则 ID 为 U32_MAX 时加一回绕为 0，同样表示结束
+    metrics->next_id = count && count == metrics->count ? hits[count - 1].rule_id + 1 : 0;
+    metrics->count = count;
+    metrics->reserved = 0;
+
+    if ((count && copy_to_user(u64_to_user_ptr(metrics->rules), hits,
+                               array_size(count, sizeof(*hits)))) ||
+        copy_to_user((void __user *)arg, metrics, sizeof(*metrics))) {
+        ret = -EFAULT;
+    }
+
+out:
+    kvfree(hits);
+    kfree(metrics);
+    return ret;
+}
+
+// 逐条返回日志：第一次调用时快照最近的日志，之后每次返回一条，取完返回 -ENOENT
+static long hips_ioctl_get_logs(struct hips_file *hf, unsigned long arg)
+{
+    if (!hf->logs) {
+        hf->logs = vzalloc(sizeof(struct hips_log_entry) * HIPS_IOCTL_LOG_BATCH);
+        if (!hf->logs) {
+            return -ENOMEM;
+        }
+        hf->log_count = hips_get_logs(hf->logs, HIPS_IOCTL_LOG_BATCH);
+        if (hf->log_count < 0) {
+            hf->log_count = 0;
+        }
+        hf->log_pos = 0;
+    }
+
+    if (hf->log_pos >= hf->log_count) {
+        return -ENOENT;
+    }
+
+    if (copy_to_user((void __user *)arg, &hf->logs[hf->log_pos], sizeof(struct hips_log_entry))) {
+        return -EFAULT;
+    }
+    hf->log_pos++;
+
+    return 0;
+}
+
+long hips_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct hips_file *hf = file->private_data;
+    struct hips_config config;
+    struct hips_stats stats;
+    struct hips_rule rule;
+    int ret;
+
+    if (!hips_config) {
+        return -ENODEV;
+    }
+
+    // 只读命令之外都需要 CAP_NET_ADMIN
+    switch (cmd) {
+        case HIPS_IOCTL_GET_RULE:
+        case HIPS_IOCTL_GET_CONFIG:
+        case HIPS_IOCTL_GET_STATS:
+        case HIPS_IOCTL_GET_LOGS:
+        case HIPS_IOCTL_DUMP_RULES:
+        case HIPS_IOCTL_GET_METRICS:
+            break;
+        default:
+            if (!capable(CAP_NET_ADMIN)) {
+                return -EPERM;
+            }
+            break;
+    }
+
+    switch (cmd) {
+        case HIPS_IOCTL_ADD_RULE:
+            return hips_ioctl_add_rule(arg, false);
+
+        case HIPS_IOCTL_ADD_NET_RULE:
+            return hips_ioctl_add_rule(arg, true);
+
+        case HIPS_IOCTL_ADD_RULES:
+            return hips_ioctl_add_rules(arg);
+
+        case HIPS_IOCTL_DEL_RULES:
+            return hips_ioctl_del_rules(arg);
+
+        case HIPS_IOCTL_DUMP_RULES:
+            return hips_ioctl_dump_rules(arg);
+
+        case HIPS_IOCTL_DEL_RULE:
+            // 规则 ID 按值传递
+            return hips_errno(hips_del_rule((u32)arg));
+
+        case HIPS_IOCTL_GET_RULE:
+            if (copy_from_user(&rule, (void __user *)arg, sizeof(rule))) {
+                return -EFAULT;
+            }
+            ret = hips_get_rule(rule.rule_id, &rule);
+            if (ret != HIPS_SUCCESS) {
+                return hips_errno(ret);
+            }
+            return copy_to_user((void __user *)arg, &rule, sizeof(rule)) ? -EFAULT : 0;
+
+        case HIPS_IOCTL_SET_CONFIG:
+            if (copy_from_user(&config, (void __user *)arg, sizeof(config))) {
+                return -EFAULT;
+            }
+            config.config_file[sizeof(config.config_file) - 1] = '\0';
+            spin_lock_bh(&hips_config->config_lock);
+            memcpy(&hips_config->config, &config, sizeof(config));
+            spin_unlock_bh(&hips_config->config_lock);
+            HIPS_INFO("配置已更新: enabled=%u, log_level=%u", config.enabled, config.log_level);
+            return 0;
+
+        case HIPS_IOCTL_GET_CONFIG:
+            spin_lock_bh(&hips_config->config_lock);
+            memcpy(&config, &hips_config->config, sizeof(config));
+            spin_unlock_bh(&hips_config->config_lock);
+            return copy_to_user((void __user *)arg, &config, sizeof(config)) ? -EFAULT : 0;
+
+        case HIPS_IOCTL_GET_STATS:
+            ret = hips_get_stats(&stats);
+            if (ret != HIPS_SUCCESS) {
+                return hips_errno(ret);
+            }
+            return copy_to_user((void __user *)arg, &stats, sizeof(stats)) ? -EFAULT : 0;
+
+        case HIPS_IOCTL_GET_LOGS:
+            return hips_ioctl_get_logs(hf, arg);
+
+        case HIPS_IOCTL_GET_METRICS:
+            return hips_ioctl_get_metrics(arg);
+
+        case HIPS_IOCTL_ENABLE:
+            WRITE_ONCE(hips_config->config.enabled, 1);
+            HIPS_INFO("HIPS 已启用");
+            return 0;
+
+        case HIPS_IOCTL_DISABLE:
+            WRITE_ONCE(hips_config->config.enabled, 0);
+            HIPS_INFO("HIPS 已禁用");
+            return 0;
+
+        case HIPS_IOCTL_RELOAD:
+            return hips_errno(hips_reload_config());
+
+        case HIPS_IOCTL_SHADOW_PROMOTE:
+            ret = hips_shadow_promote();
+            if (ret < 0) {
+                return hips_errno(ret);
+            }
+            // 比较结果不再对应当前的两个规则集
+            hips_shadow_reset_stats();
+            return 0;
+
+        case HIPS_IOCTL_SHADOW_CLEAR:
+            ret = hips_shadow_clear();
+            if (ret < 0) {
+                return hips_errno(ret);
+            }
+            hips_shadow_reset_stats();
+            return 0;
+
+        default:
+            return -ENOTTY;
+    }
+}
@@ -0,0 +1,704 @@
+#include <linux/percpu.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+#include <linux/log2.h>
+#include <linux/file.h>
+#include <linux/pid.h>
+#include <linux/sched/mm.h>
+#include <linux/sched/task.h>
+
+#include "hips_common.h"
+
+/*
+ * 事件日志
+ *
+ * 钩子只把 128 字节的原始事件（规则 ID、进程 ID 和可执行文件 inode、二进制地址、
+ * 被执行文件的引用和摘要、截短的域名）写入本 CPU 预分配的环形池，不分配内存、不取路径、
+ * 不格式化、不调用 printk。工作队列异步取出事件，解析路径、生成说明文字、格式化地址、
+ * 写入 dmesg 和用户可见的日志环，并发往 generic netlink 事件多播组。
+ *
+ * 每个 CPU 的池是单生产者单消费者环：生产者关本地中断后写入并以 release 语义推进 head，
+ * 唯一的消费者（日志工作项）以 acquire 语义读取 head 后处理并推进 tail。
+ * 池满时丢弃事件并计数。
+ *
+ * 记录动作的规则可以设置抽样（每 N 个事件记录一个）和每秒上限（令牌桶，允许一秒的突发），
+ * 在钩子取进程归属、占用池槽位之前按 CPU 判定。限速状态挂在规则条目上，与命中计数一样
+ * 在规则第一次需要判定时分配一组每 CPU 状态，不同规则互不干扰；被略过的事件只在本 CPU 上计数。
+ * 汇总工作项每 log_summary_secs 秒按 ID 索引取走各规则的计数，每条规则生成一条汇总记录；
+ * 规则删除时尚未汇总的计数随条目一起释放。
+ */
+
+#define HIPS_LOG_DRAIN_BUDGET  256     // 每个 CPU 每次最多处理的事件数
+#define HIPS_LOG_SUMMARY_SCAN  1024    // 汇总时每段 RCU 读临界区遍历的规则数
+#define HIPS_LOG_NAME_LEN      64      // 事件中保留的域名长度，更长时保留末尾部分
+
+// 只在原始事件中使用的标志
+#define HIPS_EVENT_F_FILE       0x2000  // target.exec.file 持有引用，处理后释放
+#define HIPS_EVENT_F_DIGEST     0x4000  // target.exec.digest 有效
+#define HIPS_EVENT_F_TRUNCATED  0x8000  // target.name 只保留了末尾部分
+
+static uint hips_log_pool_size = 256;
+module_param_named(log_pool_size, hips_log_pool_size, uint, 0444);
+MODULE_PARM_DESC(log_pool_size, "每个 CPU 预分配的原始事件数（向上取 2 的幂）");
+
+static uint hips_log_entries = 1024;
+module_param_named(log_entries, hips_log_entries, uint, 0444);
+MODULE_PARM_DESC(log_entries, "/proc/hips/logs 保留的日志条数");
+
+static uint hips_log_summary_secs = 10;
+module_param_named(log_summary_secs, hips_log_summary_secs, uint, 0644);
+MODULE_PARM_DESC(log_summary_secs, "抽样和限速略过事件的汇总周期（秒，1-3600）");
+
+// 钩子记录的原始事件，两个缓存行
+struct hips_raw_event {
+    u64 timestamp;
+    u32 rule_id;
+    u8 rule_type;
+    u8 action;
+    u16 flags;                      // HIPS_EVENT_F_*
+    u32 suppressed;                 // 汇总记录的略过事件数
+    u32 pid;
+    u32 uid;
+    u32 exe_dev;                    // 进程可执行文件，工作项按 pid 取路径时核对
+    u64 exe_ino;
+    u64 cgroup_id;
+    char comm[TASK_COMM_LEN];
+    union {
+        struct hips_network_addr addr;  // 网络事件
+        struct {
+            struct file *file;          // 被执行的文件
+            u8 digest[HIPS_SHA256_SIZE];
+        } exec;
+        char name[HIPS_LOG_NAME_LEN];   // 域名
+    } target;
+};
+
+// 每 CPU 原始事件池
+struct hips_log_pool {
+    u32 head;                       // 生产者写入位置
+    u32 tail;                       // 消费者读取位置
+    u64 dropped;
+    struct hips_raw_event *events;
+};
+
+static struct hips_log_pool __percpu *hips_log_pools;
+static u32 hips_log_pool_mask;
+
+static struct workqueue_struct *hips_log_wq;
+static void hips_log_work_fn(struct work_struct *work);
+static DECLARE_WORK(hips_log_work, hips_log_work_fn);
+
+// 用户可见的日志环，由 hips_log_mutex 保护
+static DEFINE_MUTEX(hips_log_mutex);
+static struct hips_log_entry *hips_log_ring;
+static u32 hips_log_ring_size;
+static u64 hips_log_written;
+
+// 规则在每个 CPU 上的限速状态，只由本 CPU 在关中断时修改；略过计数由汇总工作项从其他 CPU 取走
+struct hips_log_limit {
+    u32 tick;                       // 抽样计数
+    atomic_t suppressed;            // 尚未汇总的略过事件数
+    u64 credit;                     // 令牌桶余额（纳秒，每个事件消耗 1 秒 / 每秒上限）
+    u64 last;                       // 上次补充余额的时间
+};
+
+static int hips_log_suppress_pending;          // 有尚未汇总的略过事件
+static atomic64_t hips_log_suppressed = ATOMIC64_INIT(0);
+
+static void hips_log_summary_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(hips_log_summary_work, hips_log_summary_fn);
+
+// 汇总记录只由汇总工作项生成，复用一个原始事件
+static struct hips_raw_event hips_log_summary_event;
+
+// 工作项解析路径用的缓冲区，由 hips_log_mutex 保护
+static char hips_log_path[PATH_MAX];
+
+// 取本 CPU 池中的空闲槽位，成功时返回时保持中断关闭
+static struct hips_raw_event *hips_log_reserve(struct hips_log_pool **poolp, unsigned long *flags)
+{
+    struct hips_log_pool *pool;
+    u32 head;
+
+    if (!hips_log_pools) {
+        return NULL;
+    }
+
+    local_irq_save(*flags);
+    pool = this_cpu_ptr(hips_log_pools);
+    head = pool->head;
+    if (head - smp_load_acquire(&pool->tail) > hips_log_pool_mask) {
+        pool->dropped++;
+        local_irq_restore(*flags);
+        return NULL;
+    }
+
+    *poolp = pool;
+    return &pool->events[head & hips_log_pool_mask];
+}
+
+// 提交事件并唤醒日志工作项（已排队时只是一次位测试）
+static void hips_log_commit(struct hips_log_pool *pool, unsigned long flags)
+{
+    smp_store_release(&pool->head, pool->head + 1);
+    local_irq_restore(flags);
+    queue_work(hips_log_wq, &hips_log_work);
+}
+
+static void hips_log_fill(struct hips_raw_event *ev, u32 rule_id, u32 rule_type, u32 action,
+                          const struct hips_owner *owner, u32 flags)
+{
+    ev->timestamp = ktime_get_real_ns();
+    ev->rule_id = rule_id;
+    ev->rule_type = rule_type;
+    ev->action = action;
+    ev->flags = flags;
+    ev->pid = owner->pid;
+    ev->uid = owner->uid;
+    ev->exe_dev = owner->exe_dev;
+    ev->exe_ino = owner->exe_ino;
+    ev->cgroup_id = owner->cgroup_id;
+    memcpy(ev->comm, owner->comm, sizeof(ev->comm));
+}
+
+// 取规则的每 CPU 限速状态，第一次判定时分配（可能在软中断中，调用者持有 RCU 读锁）。
+// 各 CPU 的令牌桶在发布前装满，允许一秒的突发
+static struct hips_log_limit __percpu *hips_log_rule_limits(u32 rule_id)
+{
+    struct hips_rule_entry *entry;
+    struct hips_log_limit __percpu *limits, *fresh;
+    u64 now;
+    int cpu;
+
+    entry = xa_load(&hips_config->rule_index, rule_id);
+    if (!entry) {
+        return NULL;
+    }
+
+    limits = READ_ONCE(entry->limits);
+    if (limits) {
+        return limits;
+    }
+
+    fresh = alloc_percpu_gfp(struct hips_log_limit, GFP_ATOMIC | __GFP_NOWARN);
+    if (!fresh) {
+        return NULL;
+    }
+    now = ktime_get_ns();
+    for_each_possible_cpu(cpu) {
+        per_cpu_ptr(fresh, cpu)->credit = NSEC_PER_SEC;
+        per_cpu_ptr(fresh, cpu)->last = now;
+    }
+
+    limits = cmpxchg(&entry->limits, NULL, fresh);
+    if (limits) {
+        free_percpu(fresh);
+        return limits;
+    }
+    return fresh;
+}
+
+// 按规则的抽样和每秒上限判定本 CPU 上的这个事件是否记录，不记录时只计数。
+// 只用于记录动作，调用者在取进程归属之前判定。规则已删除或限速状态分配失败时照常记录
+bool hips_log_admit(u32 rule_id, u32 sample, u32 rate)
+{
+    struct hips_log_limit __percpu *limits;
+    struct hips_log_limit *limit;
+    unsigned long flags;
+    bool admit = true;
+    u64 now;
+
+    if (sample <= 1 && !rate) {
+        return true;
+    }
+
+    // 条目经 RCU 宽限期后才连同限速状态释放
+    rcu_read_lock();
+    limits = hips_log_rule_limits(rule_id);
+    if (!limits) {
+        rcu_read_unlock();
+        return true;
+    }
+
+    local_irq_save(flags);
+    limit = this_cpu_ptr(limits);
+    now = ktime_get_ns();
+
+    // 抽样的第一个事件记录；抽中的事件再受每秒上限约束
+    if (sample > 1 && limit->tick++ % sample) {
+        admit = false;
+    } else if (rate) {
+        limit->credit = min_t(u64, limit->credit + (now - limit->last), NSEC_PER_SEC);
+        limit->last = now;
+        if (limit->credit >= NSEC_PER_SEC / rate) {
+            limit->credit -= NSEC_PER_SEC / rate;
+        } else {
+            admit = false;
+        }
+    }
+
+    if (!admit) {
+        atomic_inc(&limit->suppressed);
+        if (!READ_ONCE(hips_log_suppress_pending)) {
+            WRITE_ONCE(hips_log_suppress_pending, 1);
+        }
+    }
+    local_irq_restore(flags);
+    rcu_read_unlock();
+
+    return admit;
+}
+
+// 记录以域名为目标的事件，过长的域名保留末尾部分（区分域名的部分在末尾）
+void hips_log_event(u32 rule_id, u32 rule_type, u32 action, const struct hips_owner *owner,
+                    const char *target, u32 flags)
+{
+    struct hips_log_pool *pool;
+    struct hips_raw_event *ev;
+    unsigned long irqflags;
+    size_t len = strlen(target);
+
+    if (len >= HIPS_LOG_NAME_LEN) {
+        target += len - (HIPS_LOG_NAME_LEN - 1);
+        flags |= HIPS_EVENT_F_TRUNCATED;
+    }
+
+    ev = hips_log_reserve(&pool, &irqflags);
+    if (!ev) {
+        return;
+    }
+
+    hips_log_fill(ev, rule_id, rule_type, action, owner, flags);
+    strscpy(ev->target.name, target, sizeof(ev->target.name));
+    hips_log_commit(pool, irqflags);
+}
+
+// 记录进程执行事件：只持有被执行文件的引用，路径由工作项解析。digest 可为 NULL
+void hips_log_exec_event(u32 rule_id, u32 rule_type, u32 action, const struct hips_owner *owner,
+                         struct file *file, const u8 *digest, u32 flags)
+{
+    struct hips_log_pool *pool;
+    struct hips_raw_event *ev;
+    unsigned long irqflags;
+
+    ev = hips_log_reserve(&pool, &irqflags);
+    if (!ev) {
+        return;
+    }
+
+    hips_log_fill(ev, rule_id, rule_type, action, owner, flags | HIPS_EVENT_F_FILE);
+    ev->target.exec.file = get_file(file);
+    if (digest) {
+        memcpy(ev->target.exec.digest, digest, HIPS_SHA256_SIZE);
+        ev->flags |= HIPS_EVENT_F_DIGEST;
+    }
+    hips_log_commit(pool, irqflags);
+}
+
+// 记录网络事件，地址保持二进制形式，由工作项格式化
+void hips_log_net_event(u32 rule_id, u32 action, const struct hips_owner *owner,
+                        const struct hips_network_addr *addr, u32 flags)
+{
+    struct hips_log_pool *pool;
+    struct hips_raw_event *ev;
+    unsigned long irqflags;
+
+    ev = hips_log_reserve(&pool, &irqflags);
+    if (!ev) {
+        return;
+    }
+
+    hips_log_fill(ev, rule_id, HIPS_RULE_NETWORK, action, owner, flags);
+    ev->target.addr = *addr;
+    hips_log_commit(pool, irqflags);
+}
+
+// 事件说明
+static const char *hips_log_details(const struct hips_raw_event *ev)
+{
+    bool block = ev->action == HIPS_ACTION_BLOCK;
+
+    // 影子规则集与生效规则集的分歧，均未执行
+    if (ev->flags & HIPS_EVENT_F_SHADOW_BLOCK) {
+        return "影子规则集将阻止 (生效规则集放行)";
+    }
+    if (ev->flags & HIPS_EVENT_F_SHADOW_ALLOW) {
+        return "影子规则集将放行 (生效规则集阻止)";
+    }
+
+    switch (ev->rule_type) {
+        case HIPS_RULE_EXEC:
+            return block ? "进程执行被阻止" : "进程执行被记录";
+        case HIPS_RULE_HASH:
+            return block ? "进程执行被阻止 (文件哈希)" : "进程执行被记录 (文件哈希)";
+        case HIPS_RULE_DNS:
+            return block ? "DNS 查询被阻止" : "DNS 查询被记录";
+        case HIPS_RULE_NETWORK:
+            if (ev->flags & HIPS_EVENT_F_INGRESS) {
+                return "入站报文在网卡入口被丢弃";
+            }
+            if (ev->flags & HIPS_EVENT_F_DYNIP) {
+                return block ? "网络连接被阻止 (DNS 动态 IP)" : "网络连接被记录 (DNS 动态 IP)";
+            }
+            if (ev->flags & HIPS_EVENT_F_INBOUND) {
+                return block ? "入站连接被阻止" : "入站连接被记录";
+            }
+            return block ? "网络连接被阻止" : "网络连接被记录";
+        default:
+            return "";
+    }
+}
+
+// 按 pid 取进程的可执行文件路径（调用者持有 hips_log_mutex）。进程已退出、pid 被复用
+// 或之后执行了别的程序时 inode 对不上，留空
+static void hips_log_resolve_exe(const struct hips_raw_event *ev, char *exe, size_t size)
+{
+    struct task_struct *task;
+    struct file *exe_file;
+    struct inode *inode;
+    char *path;
+
+    if (!ev->pid || !ev->exe_ino) {
+        return;
+    }
+
+    rcu_read_lock();
+    task = pid_task(find_pid_ns(ev->pid, &init_pid_ns), PIDTYPE_PID);
+    if (task) {
+        get_task_struct(task);
+    }
+    rcu_read_unlock();
+    if (!task) {
+        return;
+    }
+
+    exe_file = get_task_exe_file(task);
+    put_task_struct(task);
+    if (!exe_file) {
+        return;
+    }
+
+    inode = file_inode(exe_file);
+    if (inode->i_ino == ev->exe_ino && inode->i_sb->s_dev == ev->exe_dev) {
+        path = file_path(exe_file, hips_log_path, sizeof(hips_log_path));
+        if (!IS_ERR(path)) {
+            strscpy(exe, path, size);
+        }
+    }
+    fput(exe_file);
+}
+
+// 生成事件目标（调用者持有 hips_log_mutex）
+static void hips_log_target(const struct hips_raw_event *ev, char *target, size_t size)
+{
+    char *path;
+
+    if (ev->flags & HIPS_EVENT_F_FILE) {
+        path = file_path(ev->target.exec.file, hips_log_path, sizeof(hips_log_path));
+        strscpy(target, IS_ERR(path) ? "-" : path, size);
+    } else if (ev->rule_type == HIPS_RULE_NETWORK) {
+        struct hips_network_addr addr = ev->target.addr;
+
+        hips_format_network_addr(&addr, target, size);
+    } else if (ev->flags & HIPS_EVENT_F_TRUNCATED) {
+        snprintf(target, size, "...%s", ev->target.name);
+    } else {
+        strscpy(target, ev->target.name, size);
+    }
+}
+
+// 释放原始事件持有的引用
+static void hips_log_release(struct hips_raw_event *ev)
+{
+    if (ev->flags & HIPS_EVENT_F_FILE) {
+        fput(ev->target.exec.file);
+    }
+}
+
+// 格式化一个原始事件，写入 dmesg 和日志环，有订阅者时多播。
+// 汇总记录的目标是规则的目标，由调用者传入 summary_target
+static void hips_log_format(const struct hips_raw_event *ev, const char *summary_target)
+{
+    struct hips_log_entry *entry;
+    u32 log_level = READ_ONCE(hips_config->config.log_level);
+
+    mutex_lock(&hips_log_mutex);
+    entry = &hips_log_ring[hips_log_written % hips_log_ring_size];
+    memset(entry, 0, sizeof(*entry));
+
+    entry->timestamp = ev->timestamp;
+    entry->rule_id = ev->rule_id;
+    entry->rule_type = ev->rule_type;
+    entry->action = ev->action;
+    entry->pid = ev->pid;
+    entry->uid = ev->uid;
+    entry->cgroup_id = ev->cgroup_id;
+    strscpy(entry->process_name, ev->comm[0] ? ev->comm : "-", sizeof(entry->process_name));
+    hips_log_resolve_exe(ev, entry->exe, sizeof(entry->exe));
+    if (ev->flags & HIPS_EVENT_F_SUMMARY) {
+        entry->suppressed = ev->suppressed;
+        snprintf(entry->details, sizeof(entry->details), "抽样/限速略过了 %u 个事件",
+                 ev->suppressed);
+        strscpy(entry->target, summary_target, sizeof(entry->target));
+    } else {
+        if (ev->flags & HIPS_EVENT_F_DIGEST) {
+            snprintf(entry->details, sizeof(entry->details), "%s sha256:%*phN",
+                     hips_log_details(ev), HIPS_SHA256_SIZE, ev->target.exec.digest);
+        } else {
+            strscpy(entry->details, hips_log_details(ev), sizeof(entry->details));
+        }
+        hips_log_target(ev, entry->target, sizeof(entry->target));
+    }
+    hips_log_written++;
+
+    if (ev->action == HIPS_ACTION_BLOCK && log_level >= HIPS_LOG_WARN) {
+        HIPS_WARN("%s: %s (规则ID: %u, 进程: %s/%u)", entry->details, entry->target,
+                  entry->rule_id, entry->process_name, entry->pid);
+    } else if (ev->action != HIPS_ACTION_BLOCK && log_level >= HIPS_LOG_INFO) {
+        HIPS_INFO("%s: %s (规则ID: %u, 进程: %s/%u)", entry->details, entry->target,
+                  entry->rule_id, entry->process_name, entry->pid);
+    }
+
+    hips_genl_notify_event(entry);
+    mutex_unlock(&hips_log_mutex);
+}
+
+// 依次处理各 CPU 池中的事件，超出预算时重新排队，避免长时间占用工作线程
+static void hips_log_work_fn(struct work_struct *work)
+{
+    bool more = false;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        struct hips_log_pool *pool = per_cpu_ptr(hips_log_pools, cpu);
+        u32 tail = pool->tail;
+        u32 head = smp_load_acquire(&pool->head);
+        int budget = HIPS_LOG_DRAIN_BUDGET;
+
+        while (tail != head && budget--) {
+            struct hips_raw_event *ev = &pool->events[tail & hips_log_pool_mask];
+
+            hips_log_format(ev, NULL);
+            hips_log_release(ev);
+            tail++;
+            smp_store_release(&pool->tail, tail);
+        }
+        if (tail != head) {
+            more = true;
+        }
+        cond_resched();
+    }
+
+    if (more) {
+        queue_work(hips_log_wq, &hips_log_work);
+    }
+}
+
+static void hips_log_summary_schedule(void)
+{
+    queue_delayed_work(hips_log_wq, &hips_log_summary_work,
+                       clamp_t(u32, READ_ONCE(hips_log_summary_secs), 1, 3600) * HZ);
+}
+
+// 写入一条汇总记录，目标取规则当前的目标（规则已删除或无法归属时为空）
+static void hips_log_summary_emit(u32 rule_id, u32 rule_type, u32 count)
+{
+    struct hips_raw_event *ev = &hips_log_summary_event;
+    struct hips_rule rule;
+
+    memset(ev, 0, sizeof(*ev));
+    ev->timestamp = ktime_get_real_ns();
+    ev->rule_id = rule_id;
+    ev->rule_type = rule_type;
+    ev->action = HIPS_ACTION_LOG;
+    ev->flags = HIPS_EVENT_F_SUMMARY;
+    ev->suppressed = count;
+    rule.target[0] = '\0';
+    if (rule_id && hips_get_rule(rule_id, &rule) == HIPS_SUCCESS) {
+        ev->rule_type = rule.rule_type;
+    }
+
+    atomic64_add(count, &hips_log_suppressed);
+    hips_log_format(ev, rule.target);
+}
+
+// 取走各规则在各 CPU 上的略过计数并生成汇总记录。按 ID 索引分段遍历，只看分配过限速状态的规则；
+// 生成记录时离开 RCU 读临界区，之后从下一个 ID 继续
+static void hips_log_summary_fn(struct work_struct *work)
+{
+    struct hips_log_limit __percpu *limits;
+    struct hips_rule_entry *entry;
+    unsigned long index = 0;
+    u32 count, rule_id, rule_type;
+    int cpu, scanned = 0;
+
+    if (xchg(&hips_log_suppress_pending, 0) && hips_config) {
+        rcu_read_lock();
+        entry = xa_find(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+        while (entry) {
+            limits = READ_ONCE(entry->limits);
+            count = 0;
+            if (limits) {
+                for_each_possible_cpu(cpu) {
+                    count += atomic_xchg(&per_cpu_ptr(limits, cpu)->suppressed, 0);
+                }
+            }
+            if (count) {
+                rule_id = entry->rule.rule_id;
+                rule_type = entry->rule.rule_type;
+                rcu_read_unlock();
+                hips_log_summary_emit(rule_id, rule_type, count);
+                cond_resched();
+                rcu_read_lock();
+            } else if (++scanned % HIPS_LOG_SUMMARY_SCAN == 0) {
+                rcu_read_unlock();
+                cond_resched();
+                rcu_read_lock();
+            }
+            entry = xa_find_after(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+        }
+        rcu_read_unlock();
+    }
+
+    hips_log_summary_schedule();
+}
+
+// 按时间顺序复制最近的日志，返回条数
+int hips_get_logs(struct hips_log_entry *entries, int max_entries)
+{
+    u64 start;
+    int count, i;
+
+    if (!hips_log_ring || !entries || max_entries <= 0) {
+        return 0;
+    }
+
+    mutex_lock(&hips_log_mutex);
+    count = min_t(u64, hips_log_written, min_t(u32, hips_log_ring_size, max_entries));
+    start = hips_log_written - count;
+    for (i = 0; i < count; i++) {
+        entries[i] = hips_log_ring[(start + i) % hips_log_ring_size];
+    }
+    mutex_unlock(&hips_log_mutex);
+
+    return count;
+}
+
+// 日志环中仍保留的序号范围 [*first, *end)，供逐条读取的迭代器定位
+void hips_log_range(u64 *first, u64 *end)
+{
+    mutex_lock(&hips_log_mutex);
+    *end = hips_log_written;
+    *first = hips_log_written - min_t(u64, hips_log_written, hips_log_ring_size);
+    mutex_unlock(&hips_log_mutex);
+}
+
+// 按序号复制一条日志，已被覆盖或尚未写入时返回 HIPS_ERROR_NOT_FOUND
+int hips_log_read(u64 seq, struct hips_log_entry *entry)
+{
+    int ret = HIPS_ERROR_NOT_FOUND;
+
+    if (!hips_log_ring) {
+        return ret;
+    }
+
+    mutex_lock(&hips_log_mutex);
+    if (seq < hips_log_written && hips_log_written - seq <= hips_log_ring_size) {
+        *entry = hips_log_ring[seq % hips_log_ring_size];
+        ret = HIPS_SUCCESS;
+    }
+    mutex_unlock(&hips_log_mutex);
+
+    return ret;
+}
+
+// 因池满丢弃的事件数
+u64 hips_log_get_dropped(void)
+{
+    u64 sum = 0;
+    int cpu;
+
+    if (!hips_log_pools) {
+        return 0;
+    }
+
+    for_each_possible_cpu(cpu) {
+        sum += per_cpu_ptr(hips_log_pools, cpu)->dropped;
+    }
+
+    return sum;
+}
+
+// 已汇总的抽样和限速略过事件数
+u64 hips_log_get_suppressed(void)
+{
+    return atomic64_read(&hips_log_suppressed);
+}
+
+void hips_log_exit(void)
+{
+    int cpu;
+
+    if (hips_log_wq) {
+        cancel_delayed_work_sync(&hips_log_summary_work);
+        destroy_workqueue(hips_log_wq);
+        hips_log_wq = NULL;
+    }
+
+    if (hips_log_pools) {
+        for_each_possible_cpu(cpu) {
+            struct hips_log_pool *pool = per_cpu_ptr(hips_log_pools, cpu);
+
+            // 正常卸载时工作队列已处理完池中事件，这里只释放残留事件持有的文件引用
+            for (; pool->events && pool->tail != pool->head; pool->tail++) {
+                hips_log_release(&pool->events[pool->tail & hips_log_pool_mask]);
+            }
+            kvfree(pool->events);
+        }
+        free_percpu(hips_log_pools);
+        hips_log_pools = NULL;
+    }
+
+    vfree(hips_log_ring);
+    hips_log_ring = NULL;
+}
+
+int hips_log_init(void)
+{
+    u32 pool_size;
+    int cpu;
+
+    BUILD_BUG_ON(sizeof(struct hips_raw_event) > 128);
+
+    pool_size = roundup_pow_of_two(clamp_t(u32, hips_log_pool_size, 16, 65536));
+    hips_log_pool_mask = pool_size - 1;
+    hips_log_ring_size = clamp_t(u32, hips_log_entries, 16, 65536);
+    hips_log_written = 0;
+
+    hips_log_ring = vzalloc(array_size(hips_log_ring_size, sizeof(struct hips_log_entry)));
+    hips_log_pools = alloc_percpu(struct hips_log_pool);
+    hips_log_wq = alloc_workqueue("hips_log", WQ_UNBOUND, 1);
+    if (!hips_log_ring || !hips_log_pools || !hips_log_wq) {
+        goto error;
+    }
+
+    // 池放在各 CPU 所在的 NUMA 节点上
+    for_each_possible_cpu(cpu) {
+        struct hips_log_pool *pool = per_cpu_ptr(hips_log_pools, cpu);
+
+        pool->events = kvmalloc_node(array_size(pool_size, sizeof(struct hips_raw_event)),
+                                     GFP_KERNEL, cpu_to_node(cpu));
+        if (!pool->events) {
+            goto error;
+        }
+    }
+
+    hips_log_summary_schedule();
+    return 0;
+
+error:
+    HIPS_ERROR("无法分配事件日志缓冲区");
+    hips_log_exit();
+    return -ENOMEM;
+}
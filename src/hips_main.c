@@ -1,8 +1,24 @@
+#include <linux/workqueue.h>
+
 #include "hips_common.h"
 
 // 全局配置
 struct hips_global_config *hips_config = NULL;
 
+// 规则过期处理间隔
+#define HIPS_EXPIRE_INTERVAL  HZ
+
+static void hips_expire_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(hips_expire_work, hips_expire_work_fn);
+
+// 每秒推进一次过期水位并批量回收到期规则，随后按需重新编译 NUMA 副本
+static void hips_expire_work_fn(struct work_struct *work)
+{
+    hips_expire_rules(ktime_get_real_seconds());
+    hips_replica_refresh();
+    schedule_delayed_work(&hips_expire_work, HIPS_EXPIRE_INTERVAL);
+}
+
 // 文件操作结构体
 static const struct file_operations hips_fops = {
     .owner = THIS_MODULE,
@@ -30,9 +46,7 @@ static int __init hips_init(void)
     
     // 初始化配置
     spin_lock_init(&hips_config->config_lock);
-    INIT_LIST_HEAD(&hips_config->exec_rules);
-    INIT_LIST_HEAD(&hips_config->dns_rules);
-    INIT_LIST_HEAD(&hips_config->network_rules);
+    hips_rules_init();
     
     // 初始化统计信息
     memset(&hips_config->stats, 0, sizeof(struct hips_stats));
@@ -44,6 +58,12 @@ static int __init hips_init(void)
     hips_config->config.max_rules = hips_max_rules;
     strncpy(hips_config->config.config_file, hips_config_file, sizeof(hips_config->config.config_file) - 1);
     
+    // 事件池和日志工作队列，需在钩子注册之前就绪
+    ret = hips_log_init();
+    if (ret < 0) {
+        goto error_log;
+    }
+    
     // 注册字符设备
     ret = alloc_chrdev_region(&hips_config->dev_num, 0, 1, HIPS_MODULE_NAME);
     if (ret < 0) {
@@ -75,25 +95,24 @@ static int __init hips_init(void)
         goto error_proc_dir;
     }
     
-    // 创建 /proc/hips/status
-    if (!proc_create("status", 0444, hips_config->proc_dir, NULL)) {
-        HIPS_ERROR("无法创建 /proc/hips/status");
-        ret = -ENOMEM;
-        goto error_proc_status;
+    // 创建 /proc/hips/status、rules、logs
+    ret = hips_procfs_init(hips_config->proc_dir);
+    if (ret < 0) {
+        goto error_procfs;
     }
     
-    // 创建 /proc/hips/rules
-    if (!proc_create("rules", 0644, hips_config->proc_dir, NULL)) {
-        HIPS_ERROR("无法创建 /proc/hips/rules");
-        ret = -ENOMEM;
-        goto error_proc_rules;
+#ifdef CONFIG_HIPS_REPLAY
+    // 创建 /proc/hips/replay
+    ret = hips_replay_init(hips_config->proc_dir);
+    if (ret < 0) {
+        goto error_proc_replay;
     }
+#endif
     
-    // 创建 /proc/hips/logs
-    if (!proc_create("logs", 0444, hips_config->proc_dir, NULL)) {
-        HIPS_ERROR("无法创建 /proc/hips/logs");
-        ret = -ENOMEM;
-        goto error_proc_logs;
+    // 注册 generic netlink 族
+    ret = hips_genl_init();
+    if (ret < 0) {
+        goto error_genl;
     }
     
     // 注册安全钩子
@@ -109,16 +128,21 @@ static int __init hips_init(void)
         HIPS_WARN("无法加载配置文件，使用默认配置");
     }
     
+    // 启动规则过期处理，首次立即执行以设置过期水位
+    schedule_delayed_work(&hips_expire_work, 0);
+    
     HIPS_INFO("HIPS 内核模块初始化完成");
     return 0;
     
 error_hooks:
-    remove_proc_entry("logs", hips_config->proc_dir);
-error_proc_logs:
-    remove_proc_entry("rules", hips_config->proc_dir);
-error_proc_rules:
-    remove_proc_entry("status", hips_config->proc_dir);
-error_proc_status:
+    hips_genl_exit();
+error_genl:
+#ifdef CONFIG_HIPS_REPLAY
+    hips_replay_exit(hips_config->proc_dir);
+error_proc_replay:
+#endif
+    hips_procfs_exit(hips_config->proc_dir);
+error_procfs:
     proc_remove(hips_config->proc_dir);
 error_proc_dir:
     cdev_del(hips_config->cdev);
@@ -127,6 +151,8 @@ error_add_cdev:
 error_alloc_cdev:
     unregister_chrdev_region(hips_config->dev_num, 1);
 error_alloc_dev:
+    hips_log_exit();
+error_log:
     kfree(hips_config);
     hips_config = NULL;
     
@@ -145,17 +171,28 @@ static void __exit hips_exit(void)
     // 注销安全钩子
     hips_unregister_hooks();
     
+    // 停止规则过期处理
+    cancel_delayed_work_sync(&hips_expire_work);
+    
+    // 钩子已注销，处理完池中剩余的事件后释放
+    hips_log_exit();
+    
+    // 事件已处理完，注销 generic netlink 族，之后不再接受规则请求
+    hips_genl_exit();
+    
     // 保存配置
     hips_save_config();
     
-    // 清理规则列表
+    // 清理规则列表，等待规则条目的 RCU 回调（释放命中计数器）执行完
     hips_cleanup_rules();
+    rcu_barrier();
     
     // 移除 /proc 接口
     if (hips_config->proc_dir) {
-        remove_proc_entry("logs", hips_config->proc_dir);
-        remove_proc_entry("rules", hips_config->proc_dir);
-        remove_proc_entry("status", hips_config->proc_dir);
+#ifdef CONFIG_HIPS_REPLAY
+        hips_replay_exit(hips_config->proc_dir);
+#endif
+        hips_procfs_exit(hips_config->proc_dir);
         proc_remove(hips_config->proc_dir);
     }
     
@@ -0,0 +1,163 @@
+#include <linux/percpu.h>
+#include <linux/sched/clock.h>
+
+#include "hips_common.h"
+
+/*
+ * 钩子和规则命中计数
+ *
+ * 每个钩子在每个 CPU 上各有一组计数和耗时直方图，只用 this_cpu 操作更新，读取时按 CPU 求和，
+ * 钩子之间不共享任何缓存行。耗时用 local_clock() 测量，不做跨 CPU 同步。
+ * 规则命中计数同样按 CPU 存放：规则第一次命中时为条目分配一个每 CPU 计数器，
+ * 之后每次命中只是一次 ID 索引查找和本 CPU 上的加一；从未命中的规则（大多数 IOC 摘要）不占内存。
+ * 计数器随条目经 RCU 宽限期释放。
+ */
+
+#define HIPS_METRICS_SCAN  1024    // 导出命中计数时每段 RCU 读临界区遍历的规则数
+
+static DEFINE_PER_CPU(struct hips_hook_stats, hips_hook_metrics[HIPS_HOOK_MAX]);
+
+// 耗时所在的直方图桶，等于上界的耗时计入该桶（与 OpenMetrics 的 le 一致）
+u32 hips_metrics_bucket(u64 ns)
+{
+    if (!ns) {
+        return 0;
+    }
+
+    return min_t(u32, fls64((ns - 1) >> HIPS_LAT_SHIFT), HIPS_LAT_BUCKETS - 1);
+}
+
+// 钩子开始评估时取时间戳
+u64 hips_metrics_begin(void)
+{
+    return local_clock();
+}
+
+// 累计规则的一次命中，计数器在第一次命中时分配（可能在软中断中）
+void hips_metrics_rule_hit(u32 rule_id)
+{
+    struct hips_rule_entry *entry;
+    u64 __percpu *hits, *fresh;
+
+    rcu_read_lock();
+    entry = xa_load(&hips_config->rule_index, rule_id);
+    if (entry) {
+        hits = READ_ONCE(entry->hits);
+        if (!hits) {
+            fresh = alloc_percpu_gfp(u64, GFP_ATOMIC | __GFP_NOWARN);
+            if (fresh) {
+                hits = cmpxchg(&entry->hits, NULL, fresh);
+                if (hits) {
+                    free_percpu(fresh);
+                } else {
+                    hits = fresh;
+                }
+            }
+        }
+        if (hits) {
+            this_cpu_inc(*hits);
+        }
+    }
+    rcu_read_unlock();
+}
+
+// 规则的命中次数（调用者持有 RCU 读锁）
+u64 hips_metrics_rule_hits(const struct hips_rule_entry *entry)
+{
+    u64 __percpu *hits = READ_ONCE(entry->hits);
+    u64 sum = 0;
+    int cpu;
+
+    if (!hits) {
+        return 0;
+    }
+
+    for_each_possible_cpu(cpu) {
+        sum += *per_cpu_ptr(hits, cpu);
+    }
+
+    return sum;
+}
+
+// 钩子完成一次评估：rule_id 为命中的规则（0 表示未命中），blocked 表示事件被阻止
+void hips_metrics_eval(u32 hook, u64 start, u32 rule_id, bool blocked)
+{
+    s64 ns = local_clock() - start;
+
+    // 进程上下文的钩子可能在评估中途迁移到时钟略慢的 CPU
+    if (ns < 0) {
+        ns = 0;
+    }
+
+    this_cpu_inc(hips_hook_metrics[hook].evals);
+    this_cpu_add(hips_hook_metrics[hook].ns_sum, ns);
+    this_cpu_inc(hips_hook_metrics[hook].lat[hips_metrics_bucket(ns)]);
+    if (blocked) {
+        this_cpu_inc(hips_hook_metrics[hook].blocks);
+    }
+    if (rule_id) {
+        this_cpu_inc(hips_hook_metrics[hook].matches);
+        hips_metrics_rule_hit(rule_id);
+    }
+}
+
+// 各钩子的统计，stats 为 HIPS_HOOK_MAX 项
+void hips_metrics_get_hooks(struct hips_hook_stats *stats)
+{
+    const struct hips_hook_stats *src;
+    int cpu, hook, i;
+
+    memset(stats, 0, HIPS_HOOK_MAX * sizeof(*stats));
+    for_each_possible_cpu(cpu) {
+        for (hook = 0; hook < HIPS_HOOK_MAX; hook++) {
+            src = per_cpu_ptr(&hips_hook_metrics[hook], cpu);
+            stats[hook].evals += READ_ONCE(src->evals);
+            stats[hook].matches += READ_ONCE(src->matches);
+            stats[hook].blocks += READ_ONCE(src->blocks);
+            stats[hook].ns_sum += READ_ONCE(src->ns_sum);
+            for (i = 0; i < HIPS_LAT_BUCKETS; i++) {
+                stats[hook].lat[i] += READ_ONCE(src->lat[i]);
+            }
+        }
+    }
+}
+
+// 按 ID 升序导出 ID 不小于 start_id、命中过的规则，最多 max 条，返回条数。
+// 遍历分段进行，百万条 IOC 规则时不长时间占用 RCU 读临界区
+int hips_metrics_dump_hits(u32 start_id, struct hips_rule_hits *hits, int max)
+{
+    struct hips_rule_entry *entry;
+    unsigned long index = start_id;
+    int count = 0, scanned = 0;
+    u64 sum;
+
+    if (!hips_config || !hits || max <= 0) {
+        return HIPS_ERROR_INVALID;
+    }
+
+    rcu_read_lock();
+    entry = xa_find(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+    while (entry) {
+        sum = hips_metrics_rule_hits(entry);
+        if (sum) {
+            hits[count].rule_id = entry->rule.rule_id;
+            hits[count].rule_type = entry->rule.rule_type;
+            hits[count].action = entry->rule.action;
+            hits[count].priority = entry->rule.priority;
+            hits[count].hits = sum;
+            strscpy(hits[count].target, entry->rule.target, sizeof(hits[count].target));
+            if (++count == max) {
+                break;
+            }
+        }
+        if (++scanned % HIPS_METRICS_SCAN == 0) {
+            rcu_read_unlock();
+            cond_resched();
+            rcu_read_lock();
+        }
+        entry = xa_find_after(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+    }
+    rcu_read_unlock();
+
+    return count;
+}
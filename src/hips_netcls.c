@@ -0,0 +1,296 @@
+#include "hips_common.h"
+
+/*
+ * 结构化网络规则分类器
+ *
+ * 字符串网络规则只能逐条比较 "地址:端口"，"10.0.0.0/8 tcp 1-1024 出站" 这类条件
+ * 需要展开成成千上万条规则。结构化规则按 (地址族, 前缀长度) 分成元组，
+ * 每个元组内以掩码后的远端地址为键建哈希表（元组空间搜索）：
+ * 查找开销与不同前缀长度的数目成正比，与规则数基本无关。
+ * 元组内的哈希表是 rhltable，随规则数在后台扩缩，十万条 /32 IOC 放在同一个元组中，
+ * 每次查找仍只比较同一地址下的几条规则。
+ * 修改函数由调用者持有 config_lock；元组链表是 RCU 链表，rhltable 的查找同样只需处于 RCU 读临界区，
+ * 网络钩子不与规则更新竞争锁。元组位置在创建时确定之后不再移动；空了之后摘下，
+ * 由工作项等待 RCU 宽限期后销毁哈希表并释放。
+ */
+
+// 以规范化后的地址（按前缀掩码，其余字节为 0）为键，同一地址的规则串在同一个链上
+static const struct rhashtable_params hips_netcls_params = {
+    .key_len = sizeof_field(struct hips_net_match, addr),
+    .key_offset = offsetof(struct hips_rule_entry, rule.net.addr),
+    .head_offset = offsetof(struct hips_rule_entry, cls_list),
+    .automatic_shrinking = true,
+};
+
+// 等待释放的空元组，由 hips_netcls_free_lock 保护
+static LIST_HEAD(hips_netcls_free_tuples);
+static DEFINE_SPINLOCK(hips_netcls_free_lock);
+
+static void hips_netcls_free_fn(struct work_struct *work);
+static DECLARE_WORK(hips_netcls_free_work, hips_netcls_free_fn);
+
+static inline int hips_netcls_addr_len(u32 family)
+{
+    return family == AF_INET ? 4 : 16;
+}
+
+// 按前缀长度掩码地址
+static void hips_netcls_mask(u32 family, const u8 *src, u8 prefix_len, u8 *dst)
+{
+    int len = hips_netcls_addr_len(family);
+    int bytes = prefix_len / 8;
+    int bits = prefix_len % 8;
+
+    memset(dst, 0, 16);
+    memcpy(dst, src, bytes);
+    if (bits && bytes < len) {
+        dst[bytes] = src[bytes] & (u8)(0xff << (8 - bits));
+    }
+}
+
+// 初始化分类器
+void hips_netcls_init(struct hips_netcls *cls)
+{
+    INIT_LIST_HEAD(&cls->tuples);
+    cls->count = 0;
+}
+
+// 校验并规范化匹配条件：地址按前缀掩码，端口 0-0 展开为任意端口
+int hips_netcls_normalize(struct hips_net_match *match)
+{
+    u8 masked[16];
+
+    if (match->family == AF_INET) {
+        if (match->prefix_len > 32) {
+            return HIPS_ERROR_INVALID;
+        }
+    } else if (match->family == AF_INET6) {
+        if (match->prefix_len > 128) {
+            return HIPS_ERROR_INVALID;
+        }
+    } else {
+        return HIPS_ERROR_INVALID;
+    }
+
+    if (match->direction > HIPS_DIR_IN) {
+        return HIPS_ERROR_INVALID;
+    }
+
+    if (match->port_min == 0 && match->port_max == 0) {
+        match->port_max = 65535;
+    }
+    if (match->port_min > match->port_max) {
+        return HIPS_ERROR_INVALID;
+    }
+
+    hips_netcls_mask(match->family, match->addr, match->prefix_len, masked);
+    memcpy(match->addr, masked, sizeof(match->addr));
+    match->reserved = 0;
+
+    return HIPS_SUCCESS;
+}
+
+// 分配元组，在锁外调用
+struct hips_netcls_tuple *hips_netcls_tuple_alloc(void)
+{
+    struct hips_netcls_tuple *tuple;
+
+    tuple = kzalloc(sizeof(*tuple), GFP_KERNEL);
+    if (!tuple) {
+        return NULL;
+    }
+
+    if (rhltable_init(&tuple->table, &hips_netcls_params) != 0) {
+        kfree(tuple);
+        return NULL;
+    }
+    INIT_LIST_HEAD(&tuple->list);
+    INIT_LIST_HEAD(&tuple->free_list);
+
+    return tuple;
+}
+
+// 释放未发布或已经没有读者的元组，可能睡眠
+void hips_netcls_tuple_free(struct hips_netcls_tuple *tuple)
+{
+    if (tuple) {
+        rhltable_destroy(&tuple->table);
+        kfree(tuple);
+    }
+}
+
+static void hips_netcls_free_fn(struct work_struct *work)
+{
+    struct hips_netcls_tuple *tuple, *tmp;
+    LIST_HEAD(tuples);
+
+    spin_lock_bh(&hips_netcls_free_lock);
+    list_splice_init(&hips_netcls_free_tuples, &tuples);
+    spin_unlock_bh(&hips_netcls_free_lock);
+
+    if (list_empty(&tuples)) {
+        return;
+    }
+
+    // 摘下时可能仍有读者停在元组上
+    synchronize_rcu();
+    list_for_each_entry_safe(tuple, tmp, &tuples, free_list) {
+        hips_netcls_tuple_free(tuple);
+    }
+}
+
+// 摘下元组并交给工作项释放（调用者持有 config_lock）
+static void hips_netcls_retire(struct hips_netcls_tuple *tuple)
+{
+    list_del_rcu(&tuple->list);
+
+    spin_lock_bh(&hips_netcls_free_lock);
+    list_add_tail(&tuple->free_list, &hips_netcls_free_tuples);
+    spin_unlock_bh(&hips_netcls_free_lock);
+    schedule_work(&hips_netcls_free_work);
+}
+
+// 等待已摘下的元组全部释放，卸载模块或清空规则表后在进程上下文调用
+void hips_netcls_drain(void)
+{
+    flush_work(&hips_netcls_free_work);
+}
+
+// 新元组按最高优先级降序插入。已发布的元组不再移动（读者可能正停在它上面，
+// 移动会使读者跳过中间的元组），之后提高的上界只更新 max_priority，顺序仅作为近似
+static void hips_netcls_publish_tuple(struct hips_netcls *cls, struct hips_netcls_tuple *tuple)
+{
+    struct hips_netcls_tuple *pos;
+    struct list_head *insert_after = &cls->tuples;
+
+    list_for_each_entry(pos, &cls->tuples, list) {
+        if (pos->max_priority < tuple->max_priority) {
+            break;
+        }
+        insert_after = &pos->list;
+    }
+    list_add_rcu(&tuple->list, insert_after);
+}
+
+// 加入规则；需要新元组时使用 *spare 并将其置空。rhltable 在锁内插入不睡眠，
+// 扩容由其工作项完成，极端情况下（原子分配失败）返回 HIPS_ERROR_MEMORY
+int hips_netcls_insert(struct hips_netcls *cls, struct hips_rule_entry *entry,
+                       struct hips_netcls_tuple **spare)
+{
+    const struct hips_net_match *match = &entry->rule.net;
+    struct hips_netcls_tuple *tuple;
+
+    list_for_each_entry(tuple, &cls->tuples, list) {
+        if (tuple->family == match->family && tuple->prefix_len == match->prefix_len) {
+            goto found;
+        }
+    }
+
+    // 新元组先放入规则再发布，读者看到它时哈希表已经就绪
+    tuple = *spare;
+    tuple->family = match->family;
+    tuple->prefix_len = match->prefix_len;
+    tuple->max_priority = entry->rule.priority;
+    if (rhltable_insert(&tuple->table, &entry->cls_list, hips_netcls_params) != 0) {
+        return HIPS_ERROR_MEMORY;
+    }
+    *spare = NULL;
+    entry->tuple = tuple;
+    tuple->count = 1;
+    hips_netcls_publish_tuple(cls, tuple);
+    WRITE_ONCE(cls->count, cls->count + 1);
+    return HIPS_SUCCESS;
+
+found:
+    // 先提高上界再发布规则，读者不会因为过期的上界跳过新规则
+    if (entry->rule.priority > tuple->max_priority) {
+        WRITE_ONCE(tuple->max_priority, entry->rule.priority);
+    }
+    if (rhltable_insert(&tuple->table, &entry->cls_list, hips_netcls_params) != 0) {
+        return HIPS_ERROR_MEMORY;
+    }
+    entry->tuple = tuple;
+    tuple->count++;
+    WRITE_ONCE(cls->count, cls->count + 1);
+    return HIPS_SUCCESS;
+}
+
+// 移除规则，元组空了之后摘下，经 RCU 宽限期释放（条目同样由调用者经 RCU 释放，读者可以继续遍历）
+void hips_netcls_remove(struct hips_netcls *cls, struct hips_rule_entry *entry)
+{
+    struct hips_netcls_tuple *tuple = entry->tuple;
+
+    if (!tuple) {
+        return;
+    }
+
+    rhltable_remove(&tuple->table, &entry->cls_list, hips_netcls_params);
+    entry->tuple = NULL;
+    tuple->count--;
+    WRITE_ONCE(cls->count, cls->count - 1);
+
+    if (tuple->count == 0) {
+        hips_netcls_retire(tuple);
+    }
+}
+
+// 摘下所有元组（规则条目由调用者释放）
+void hips_netcls_flush(struct hips_netcls *cls)
+{
+    struct hips_netcls_tuple *tuple, *tmp;
+
+    list_for_each_entry_safe(tuple, tmp, &cls->tuples, list) {
+        hips_netcls_retire(tuple);
+    }
+    WRITE_ONCE(cls->count, 0);
+}
+
+// 同一地址下的条件比较（地址已由哈希表按键比较）
+static bool hips_netcls_match(const struct hips_net_match *match, const struct hips_net_key *key)
+{
+    if (match->protocol && match->protocol != key->protocol) {
+        return false;
+    }
+    if (match->direction != HIPS_DIR_ANY && match->direction != key->direction) {
+        return false;
+    }
+    return key->port >= match->port_min && key->port <= match->port_max;
+}
+
+// 查找优先级高于 best 的命中，跳过已过期的规则，返回新的最佳命中（调用者处于 RCU 读临界区）
+struct hips_rule_entry *hips_netcls_lookup(struct hips_netcls *cls, const struct hips_net_key *key,
+                                           u64 clock, struct hips_rule_entry *best)
+{
+    struct hips_netcls_tuple *tuple;
+    struct hips_rule_entry *entry;
+    struct rhlist_head *pos, *list;
+    u8 masked[16];
+
+    if (!READ_ONCE(cls->count)) {
+        return best;
+    }
+
+    list_for_each_entry_rcu(tuple, &cls->tuples, list) {
+        // 元组内不可能有更好的命中
+        if (best && best->rule.priority >= READ_ONCE(tuple->max_priority)) {
+            continue;
+        }
+        if (tuple->family != key->family) {
+            continue;
+        }
+
+        hips_netcls_mask(key->family, key->addr, tuple->prefix_len, masked);
+        list = rhltable_lookup(&tuple->table, masked, hips_netcls_params);
+        rhl_for_each_entry_rcu(entry, pos, list, cls_list) {
+            if (entry->rule.expires_at && entry->rule.expires_at <= clock) {
+                continue;
+            }
+            if ((!best || entry->rule.priority > best->rule.priority) &&
+                hips_netcls_match(&entry->rule.net, key)) {
+                best = entry;
+            }
+        }
+    }
+
+    return best;
+}
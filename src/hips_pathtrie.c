@@ -0,0 +1,383 @@
+#include "hips_common.h"
+
+/*
+ * exec 路径规则的目录组件字典树
+ *
+ * exec 策略大多按目录编写（/tmp 和 /dev/shm 下的任意文件、每个用户的 Downloads 目录等），
+ * 逐条调用 hips_match_pattern 时每条规则都要复制、比较一次前缀，开销与规则数成正比。
+ * 绝对路径且每个组件要么是普通名字、要么整个是 "*" 的模式放进字典树：
+ * 查找时把路径按组件走一遍，同时跟踪所有可能的节点（通配节点可以吸收多个组件），
+ * 开销只与路径深度相关。其他模式（"*.sh"、"/usr/bin/py*" 等）仍逐条匹配。
+ * 修改函数由调用者持有 config_lock。节点先初始化再经 RCU 发布，摘除后经 RCU 宽限期释放，
+ * 节点哈希链、通配子节点和节点上的规则链表都按 RCU 方式读取，查找只需处于 RCU 读临界区。
+ */
+
+
+// 查找时同时跟踪的节点数上限，超过时由调用者改为逐条匹配
+#define HIPS_PATH_MAX_STATES   16
+
+static uint hips_path_hash_bits = 16;
+module_param_named(path_hash_bits, hips_path_hash_bits, uint, 0444);
+MODULE_PARM_DESC(path_hash_bits, "路径字典树节点哈希表的桶数（2 的幂次，8-24），目录规则达到百万级时建议 20");
+
+// 节点哈希表的桶数位数，模块参数只读，分配和查找时结果一致
+u32 hips_pathtrie_table_bits(void)
+{
+    return clamp(hips_path_hash_bits, 8U, 24U);
+}
+
+static u32 hips_path_hash(const struct hips_path_node *parent, const char *name, u32 len)
+{
+    u64 key = (u64)(uintptr_t)parent;
+
+    return jhash(name, len, (u32)key ^ (u32)(key >> 32));
+}
+
+static struct hlist_head *hips_path_bucket(u32 hash)
+{
+    return &hips_config->path_table[hash & ((1U << hips_config->path_bits) - 1)];
+}
+
+// 取下一个路径组件，跳过分隔符，没有更多组件时返回 NULL
+static const char *hips_path_next(const char **pos, u32 *len)
+{
+    const char *p = *pos, *end;
+
+    while (*p == '/') {
+        p++;
+    }
+    if (!*p) {
+        return NULL;
+    }
+
+    end = strchrnul(p, '/');
+    *len = end - p;
+    *pos = end;
+    return p;
+}
+
+static inline bool hips_path_is_wild(const char *name, u32 len)
+{
+    return len == 1 && name[0] == '*';
+}
+
+// 词法规范化路径：合并重复的 '/'，去掉 "." 组件，按 ".." 回退，去掉末尾的 '/'。
+// 不解析符号链接（exec 钩子传入的是 d_path 得到的真实路径）。结果放不下时返回 -1
+int hips_path_canonicalize(const char *path, char *buf, size_t size)
+{
+    const char *comp, *pos = path;
+    size_t base, len, start;
+    u32 n;
+
+    if (size < 2) {
+        return -1;
+    }
+
+    base = len = *path == '/' ? 1 : 0;
+    buf[0] = '/';
+
+    while ((comp = hips_path_next(&pos, &n))) {
+        if (n == 1 && comp[0] == '.') {
+            continue;
+        }
+
+        if (n == 2 && comp[0] == '.' && comp[1] == '.') {
+            // 回退上一个组件；绝对路径在根目录停住，相对路径无法回退时保留 ".."
+            for (start = len; start > base && buf[start - 1] != '/'; start--) {
+            }
+            if (len > base && !(len - start == 2 && buf[start] == '.' && buf[start + 1] == '.')) {
+                len = start > base ? start - 1 : base;
+                continue;
+            }
+            if (base) {
+                continue;
+            }
+        }
+
+        if (len + (len > base) + n + 1 > size) {
+            return -1;
+        }
+        if (len > base) {
+            buf[len++] = '/';
+        }
+        memcpy(buf + len, comp, n);
+        len += n;
+    }
+
+    if (len == 0) {
+        buf[len++] = '.';
+    }
+    buf[len] = '\0';
+
+    return 0;
+}
+
+// 模式能否放进字典树：绝对路径，组件非空、不是 "." 或 ".."，不含通配符或整个是 "*"
+static bool hips_pathtrie_suitable(const char *pattern)
+{
+    const char *p = pattern, *end;
+    u32 len, i;
+
+    if (p[0] != '/' || !p[1]) {
+        return false;
+    }
+
+    while (*p) {
+        p++;
+        end = strchrnul(p, '/');
+        len = end - p;
+
+        if (len == 0 || (len == 1 && p[0] == '.') || (len == 2 && p[0] == '.' && p[1] == '.')) {
+            return false;
+        }
+        if (!hips_path_is_wild(p, len)) {
+            for (i = 0; i < len; i++) {
+                if (p[i] == '*' || p[i] == '?') {
+                    return false;
+                }
+            }
+        }
+
+        p = end;
+    }
+
+    return true;
+}
+
+static struct hips_path_node *hips_path_node_alloc(const char *name, u32 len)
+{
+    struct hips_path_node *node;
+
+    node = kzalloc(sizeof(*node) + len + 1, GFP_KERNEL);
+    if (!node) {
+        return NULL;
+    }
+
+    INIT_HLIST_NODE(&node->node);
+    INIT_LIST_HEAD(&node->rules);
+    RCU_INIT_POINTER(node->wild, NULL);
+    memcpy(node->name, name, len);
+    node->len = len;
+    node->wildcard = hips_path_is_wild(name, len);
+
+    return node;
+}
+
+// 释放准备阶段分配而未被使用的节点
+void hips_pathtrie_free_spare(struct hips_path_node *chain)
+{
+    struct hips_path_node *next;
+
+    while (chain) {
+        next = chain->parent;
+        kfree(chain);
+        chain = next;
+    }
+}
+
+// 在锁外为模式的根节点和每个组件各分配一个节点，按组件顺序经 parent 串成链。
+// 返回分配的节点数，模式不适合放进字典树时返回 0
+int hips_pathtrie_alloc(const char *pattern, struct hips_path_node **chain)
+{
+    struct hips_path_node *head, **tail;
+    const char *comp, *pos = pattern;
+    int count = 1;
+    u32 len;
+
+    *chain = NULL;
+    if (!hips_pathtrie_suitable(pattern)) {
+        return 0;
+    }
+
+    head = hips_path_node_alloc("", 0);
+    if (!head) {
+        return HIPS_ERROR_MEMORY;
+    }
+    tail = &head->parent;
+
+    while ((comp = hips_path_next(&pos, &len))) {
+        *tail = hips_path_node_alloc(comp, len);
+        if (!*tail) {
+            hips_pathtrie_free_spare(head);
+            return HIPS_ERROR_MEMORY;
+        }
+        tail = &(*tail)->parent;
+        count++;
+    }
+
+    *chain = head;
+    return count;
+}
+
+// 查找普通子节点（调用者持有 config_lock 或处于 RCU 读临界区）
+static struct hips_path_node *hips_pathtrie_child(struct hips_path_node *parent, const char *name,
+                                                  u32 len)
+{
+    struct hips_path_node *node;
+    u32 hash = hips_path_hash(parent, name, len);
+
+    hlist_for_each_entry_rcu(node, hips_path_bucket(hash), node) {
+        if (node->hash == hash && node->parent == parent && node->len == len &&
+            memcmp(node->name, name, len) == 0) {
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
+// 加入规则，沿途缺少的节点从 *spare 链中取用，未用到的节点留在 *spare 中由调用者释放。
+// 节点哈希表由调用者预先安装。新节点的字段在发布前填好，读者看到的节点总是完整的
+void hips_pathtrie_insert(struct hips_path_trie *trie, struct hips_rule_entry *entry,
+                          struct hips_path_node **spare)
+{
+    struct hips_path_node *node, *child, *next, *unused = NULL;
+    struct hips_rule_entry *pos;
+    const char *comp, *p = entry->rule.target;
+    u32 len;
+
+    next = *spare;
+    *spare = next->parent;
+    if (!hips_deref_locked(trie->root)) {
+        next->parent = NULL;
+        rcu_assign_pointer(trie->root, next);
+    } else {
+        next->parent = unused;
+        unused = next;
+    }
+    node = hips_deref_locked(trie->root);
+
+    while ((comp = hips_path_next(&p, &len))) {
+        next = *spare;
+        *spare = next->parent;
+
+        child = hips_path_is_wild(comp, len) ? hips_deref_locked(node->wild) :
+                                               hips_pathtrie_child(node, comp, len);
+        if (child) {
+            next->parent = unused;
+            unused = next;
+            node = child;
+            continue;
+        }
+
+        next->parent = node;
+        if (next->wildcard) {
+            rcu_assign_pointer(node->wild, next);
+        } else {
+            next->hash = hips_path_hash(node, comp, len);
+            hlist_add_head_rcu(&next->node, hips_path_bucket(next->hash));
+        }
+        node->refs++;
+        node = next;
+    }
+
+    // 节点内按优先级降序，同优先级保持加入顺序
+    list_for_each_entry(pos, &node->rules, path_list) {
+        if (pos->rule.priority < entry->rule.priority) {
+            break;
+        }
+    }
+    list_add_tail_rcu(&entry->path_list, &pos->path_list);
+    node->refs++;
+    entry->path_node = node;
+    WRITE_ONCE(trie->count, trie->count + 1);
+
+    *spare = unused;
+}
+
+// 移除规则，不再使用的节点摘除后经 RCU 宽限期释放，正在查找的读者可以继续访问
+void hips_pathtrie_remove(struct hips_path_trie *trie, struct hips_rule_entry *entry)
+{
+    struct hips_path_node *node = entry->path_node, *parent;
+
+    list_del_rcu(&entry->path_list);
+    entry->path_node = NULL;
+    WRITE_ONCE(trie->count, trie->count - 1);
+
+    while (node && --node->refs == 0) {
+        parent = node->parent;
+        if (!parent) {
+            RCU_INIT_POINTER(trie->root, NULL);
+        } else if (node->wildcard) {
+            RCU_INIT_POINTER(parent->wild, NULL);
+        } else {
+            hlist_del_init_rcu(&node->node);
+        }
+        kfree_rcu(node, rcu);
+        node = parent;
+    }
+}
+
+static bool hips_path_state_add(struct hips_path_node **states, int *count,
+                                struct hips_path_node *node)
+{
+    int i;
+
+    for (i = 0; i < *count; i++) {
+        if (states[i] == node) {
+            return true;
+        }
+    }
+
+    if (*count == HIPS_PATH_MAX_STATES) {
+        return false;
+    }
+    states[(*count)++] = node;
+    return true;
+}
+
+// 沿规范路径走一遍字典树，命中规则优先于 *best 时更新 *best，跳过已过期但尚未回收的规则。
+// 同时跟踪的节点超过上限时返回 false，结果不完整，由调用者改为逐条匹配（调用者处于 RCU 读临界区）
+bool hips_pathtrie_lookup(struct hips_path_trie *trie, const char *path, u64 clock,
+                          struct hips_rule_entry **best)
+{
+    struct hips_path_node *states[2][HIPS_PATH_MAX_STATES];
+    struct hips_path_node *node, *child, *root;
+    struct hips_rule_entry *entry;
+    const char *comp, *pos = path;
+    int cur = 0, count = 1, next, i;
+    u32 len;
+
+    root = rcu_dereference(trie->root);
+    if (!root || *path != '/') {
+        return true;
+    }
+
+    states[0][0] = root;
+    while (count && (comp = hips_path_next(&pos, &len))) {
+        next = 0;
+        for (i = 0; i < count; i++) {
+            node = states[cur][i];
+
+            // 通配节点继续吸收组件
+            if (node->wildcard && !hips_path_state_add(states[!cur], &next, node)) {
+                return false;
+            }
+            child = hips_pathtrie_child(node, comp, len);
+            if (child && !hips_path_state_add(states[!cur], &next, child)) {
+                return false;
+            }
+            child = rcu_dereference(node->wild);
+            if (child && !hips_path_state_add(states[!cur], &next, child)) {
+                return false;
+            }
+        }
+        cur = !cur;
+        count = next;
+    }
+
+    // 每个终止节点的规则按优先级排列，第一条未过期的即为该节点的结果
+    for (i = 0; i < count; i++) {
+        list_for_each_entry_rcu(entry, &states[cur][i]->rules, path_list) {
+            if (entry->rule.expires_at && entry->rule.expires_at <= clock) {
+                continue;
+            }
+            if (!*best || hips_rule_precedes(entry, *best)) {
+                *best = entry;
+            }
+            break;
+        }
+    }
+
+    return true;
+}
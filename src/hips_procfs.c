@@ -1,35 +1,24 @@
-#include "hips_common.h"
-
-// 文件操作结构体
-static const struct file_operations hips_status_fops = {
-    .owner = THIS_MODULE,
-    .read = hips_status_read,
-    .llseek = seq_lseek,
-    .release = single_release,
-    .open = hips_status_open,
-};
+#include <linux/seq_file.h>
 
-static const struct file_operations hips_rules_fops = {
-    .owner = THIS_MODULE,
-    .read = hips_rules_read,
-    .write = hips_rules_write,
-    .llseek = seq_lseek,
-    .release = single_release,
-    .open = hips_rules_open,
-};
+#include "hips_common.h"
 
-static const struct file_operations hips_logs_fops = {
-    .owner = THIS_MODULE,
-    .read = hips_logs_read,
-    .llseek = seq_lseek,
-    .release = single_release,
-    .open = hips_logs_open,
-};
+/*
+ * /proc/hips 接口
+ *
+ * rules 和 logs 使用 seq_operations 迭代器，以位置编码游标（规则 ID、日志序号），
+ * seq_file 每填满一个缓冲区就调用 stop 再从游标处 start，不在整个读取过程中持锁，
+ * 也不在栈上或一次性缓冲整张表。规则按 ID 索引在 RCU 下遍历，不持有 config_lock。
+ */
 
 // 状态文件操作
 static int hips_status_show(struct seq_file *m, void *v)
 {
     struct hips_stats stats;
+    u64 dynip_inserted, dynip_expired, dynip_overflow;
+    u64 digest_hits, digest_misses, digest_deferred;
+    u64 replica_bytes, replica_rebuilds, replica_build_ns;
+    u32 dynip_entries, digest_entries, replica_nodes, replica_entries;
+    bool replica_current;
     
     if (!hips_config) {
         seq_printf(m, "HIPS 模块未加载\n");
@@ -48,8 +37,57 @@ static int hips_status_show(struct seq_file *m, void *v)
         seq_printf(m, "  执行阻止: %llu\n", stats.exec_blocks);
         seq_printf(m, "  DNS阻止: %llu\n", stats.dns_blocks);
         seq_printf(m, "  网络阻止: %llu\n", stats.network_blocks);
+        seq_printf(m, "  DNS NXDOMAIN 应答: %llu\n", stats.dns_nxdomain);
+        seq_printf(m, "  DNS sinkhole 应答: %llu\n", stats.dns_sinkhole);
+        seq_printf(m, "  DNS 丢弃: %llu\n", stats.dns_dropped);
+        seq_printf(m, "  入口丢弃: %llu\n", stats.ingress_drops);
+        seq_printf(m, "  日志丢弃: %llu\n", stats.log_dropped);
+        seq_printf(m, "  日志抑制: %llu\n", stats.log_suppressed);
         seq_printf(m, "  总事件数: %llu\n", stats.total_events);
         seq_printf(m, "  最后事件: %llu\n", stats.last_event_time);
+        
+        hips_dynip_get_stats(&dynip_entries, &dynip_inserted, &dynip_expired, &dynip_overflow);
+        seq_printf(m, "\nDNS 动态 IP:\n");
+        seq_printf(m, "  当前条目: %u\n", dynip_entries);
+        seq_printf(m, "  累计加入: %llu\n", dynip_inserted);
+        seq_printf(m, "  已过期: %llu\n", dynip_expired);
+        seq_printf(m, "  超出上限: %llu\n", dynip_overflow);
+        
+        hips_digest_get_stats(&digest_entries, &digest_hits, &digest_misses, &digest_deferred);
+        seq_printf(m, "\n文件摘要缓存:\n");
+        seq_printf(m, "  哈希规则: %u\n", READ_ONCE(hips_config->hash_count));
+        seq_printf(m, "  缓存条目: %u\n", digest_entries);
+        seq_printf(m, "  命中: %llu\n", digest_hits);
+        seq_printf(m, "  未命中: %llu\n", digest_misses);
+        seq_printf(m, "  异步计算: %llu\n", digest_deferred);
+        
+        hips_replica_get_stats(&replica_nodes, &replica_bytes, &replica_entries, &replica_current,
+                               &replica_rebuilds, &replica_build_ns);
+        seq_printf(m, "\nNUMA 副本:\n");
+        if (replica_nodes) {
+            seq_printf(m, "  节点数: %u\n", replica_nodes);
+            seq_printf(m, "  条目数: %u\n", replica_entries);
+            seq_printf(m, "  内存: %llu 字节 (每节点 %llu)\n", replica_bytes,
+                       div_u64(replica_bytes, replica_nodes));
+            seq_printf(m, "  状态: %s\n", replica_current ? "最新" : "等待重新编译");
+        } else {
+            seq_printf(m, "  未启用\n");
+        }
+        seq_printf(m, "  编译次数: %llu\n", replica_rebuilds);
+        seq_printf(m, "  最近编译耗时: %llu us\n", div_u64(replica_build_ns, 1000));
+        
+        seq_printf(m, "\n影子规则集:\n");
+        seq_printf(m, "  规则数: %llu\n", stats.shadow_rules);
+        seq_printf(m, "  抽样事件: %llu\n", stats.shadow_samples);
+        seq_printf(m, "  将阻止 (生效放行): %llu\n", stats.shadow_would_block);
+        seq_printf(m, "  将放行 (生效阻止): %llu\n", stats.shadow_would_allow);
+        if (stats.shadow_samples) {
+            seq_printf(m, "  生效规则集平均耗时: %llu ns\n",
+                       div64_u64(stats.shadow_live_ns, stats.shadow_samples));
+            seq_printf(m, "  影子规则集平均耗时: %llu ns\n",
+                       div64_u64(stats.shadow_ns, stats.shadow_samples));
+            seq_printf(m, "  影子规则集最大耗时: %llu ns\n", stats.shadow_max_ns);
+        }
     } else {
         seq_printf(m, "无法获取统计信息\n");
     }
@@ -62,61 +100,125 @@ static int hips_status_open(struct inode *inode, struct file *file)
     return single_open(file, hips_status_show, NULL);
 }
 
-static ssize_t hips_status_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+// 规则文件操作
+static void hips_rules_show_net(struct seq_file *m, const struct hips_net_match *net)
 {
-    return seq_read(file, buf, count, ppos);
+    static const char *const directions[] = {"任意", "出站", "入站"};
+
+    if (net->family == AF_INET) {
+        seq_printf(m, "匹配: %pI4/%u", net->addr, net->prefix_len);
+    } else {
+        seq_printf(m, "匹配: %pI6c/%u", net->addr, net->prefix_len);
+    }
+    if (net->protocol) {
+        seq_printf(m, " 协议 %u", net->protocol);
+    }
+    seq_printf(m, " 端口 %u-%u %s\n", net->port_min, net->port_max,
+               directions[net->direction <= HIPS_DIR_IN ? net->direction : HIPS_DIR_ANY]);
 }
 
-// 规则文件操作
-static int hips_rules_show(struct seq_file *m, void *v)
+// 位置 0 为表头，其余位置为规则 ID + 1
+static void *hips_rules_seq_start(struct seq_file *m, loff_t *pos)
+    __acquires(RCU)
 {
-    struct hips_rule_entry *entry;
-    struct list_head *rule_lists[] = {
-        &hips_config->exec_rules,
-        &hips_config->dns_rules,
-        &hips_config->network_rules
-    };
-    const char *rule_types[] = {"执行", "DNS", "网络"};
-    int i;
+    unsigned long index;
     
+    rcu_read_lock();
     if (!hips_config) {
-        seq_printf(m, "HIPS 模块未加载\n");
-        return 0;
+        return NULL;
+    }
+    if (*pos == 0) {
+        return SEQ_START_TOKEN;
+    }
+    if (*pos > U32_MAX + 1ULL) {
+        return NULL;
     }
     
-    seq_printf(m, "HIPS 规则列表:\n");
-    seq_printf(m, "========================================\n");
+    index = *pos - 1;
+    return xa_find(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+}
+
+static void *hips_rules_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+    struct hips_rule_entry *entry;
+    unsigned long index;
     
-    for (i = 0; i < ARRAY_SIZE(rule_lists); i++) {
-        seq_printf(m, "\n%s 规则:\n", rule_types[i]);
-        seq_printf(m, "----------------------------------------\n");
-        
-        spin_lock(&hips_config->config_lock);
-        list_for_each_entry(entry, rule_lists[i], list) {
-            seq_printf(m, "ID: %u\n", entry->rule.rule_id);
-            seq_printf(m, "类型: %s\n", rule_types[entry->rule.rule_type - 1]);
-            seq_printf(m, "动作: %s\n", 
-                      entry->rule.action == HIPS_ACTION_BLOCK ? "阻止" :
-                      entry->rule.action == HIPS_ACTION_ALLOW ? "允许" : "记录");
-            seq_printf(m, "优先级: %u\n", entry->rule.priority);
-            seq_printf(m, "目标: %s\n", entry->rule.target);
-            seq_printf(m, "描述: %s\n", entry->rule.description);
-            seq_printf(m, "----------------------------------------\n");
-        }
-        spin_unlock(&hips_config->config_lock);
+    if (v == SEQ_START_TOKEN) {
+        index = 0;
+        entry = xa_find(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+    } else {
+        index = ((struct hips_rule_entry *)v)->rule.rule_id;
+        entry = xa_find_after(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
     }
     
-    return 0;
+    // 位置记为该规则 ID + 1；没有更多规则时越过最大 ID，之后 start 返回 NULL
+    *pos = entry ? (loff_t)entry->rule.rule_id + 1 : U32_MAX + 2ULL;
+    return entry;
 }
 
-static int hips_rules_open(struct inode *inode, struct file *file)
+static void hips_rules_seq_stop(struct seq_file *m, void *v)
+    __releases(RCU)
 {
-    return single_open(file, hips_rules_show, NULL);
+    rcu_read_unlock();
 }
 
-static ssize_t hips_rules_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+static int hips_rules_seq_show(struct seq_file *m, void *v)
 {
-    return seq_read(file, buf, count, ppos);
+    static const char *const rule_types[] = {"执行", "DNS", "网络", "文件哈希"};
+    struct hips_rule_entry *entry;
+    struct hips_rule *rule;
+    
+    if (v == SEQ_START_TOKEN) {
+        seq_printf(m, "HIPS 规则列表 (按 ID 升序):\n");
+        seq_printf(m, "========================================\n");
+        return 0;
+    }
+    
+    entry = v;
+    rule = &entry->rule;
+    seq_printf(m, "ID: %u\n", rule->rule_id);
+    seq_printf(m, "类型: %s\n", rule_types[rule->rule_type - 1]);
+    seq_printf(m, "动作: %s\n", 
+              rule->action == HIPS_ACTION_BLOCK ? "阻止" :
+              rule->action == HIPS_ACTION_ALLOW ? "允许" : "记录");
+    seq_printf(m, "优先级: %u\n", rule->priority);
+    seq_printf(m, "目标: %s\n", rule->target);
+    seq_printf(m, "描述: %s\n", rule->description);
+    if (rule->cgroup_id) {
+        seq_printf(m, "cgroup: %llu\n", (unsigned long long)rule->cgroup_id);
+    } else if (rule->netns_ino) {
+        seq_printf(m, "网络命名空间: %u\n", rule->netns_ino);
+    }
+    if (rule->flags & HIPS_RULE_F_STRUCTURED) {
+        hips_rules_show_net(m, &rule->net);
+    }
+    if (rule->expires_at) {
+        seq_printf(m, "过期时间: %llu\n", (unsigned long long)rule->expires_at);
+    }
+    if (rule->log_sample > 1) {
+        seq_printf(m, "日志抽样: 每 %u 个事件记录一个\n", rule->log_sample);
+    }
+    if (rule->log_rate) {
+        seq_printf(m, "日志上限: 每 CPU 每秒 %u 条\n", rule->log_rate);
+    }
+    if (entry->set == rcu_access_pointer(hips_config->shadow)) {
+        seq_printf(m, "影子规则集: 是 (不执行)\n");
+    }
+    seq_printf(m, "----------------------------------------\n");
+    
+    return 0;
+}
+
+static const struct seq_operations hips_rules_seq_ops = {
+    .start = hips_rules_seq_start,
+    .next = hips_rules_seq_next,
+    .stop = hips_rules_seq_stop,
+    .show = hips_rules_seq_show,
+};
+
+static int hips_rules_open(struct inode *inode, struct file *file)
+{
+    return seq_open(file, &hips_rules_seq_ops);
 }
 
 static ssize_t hips_rules_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
@@ -146,176 +248,470 @@ static ssize_t hips_rules_write(struct file *file, const char __user *buf, size_
     return ret < 0 ? ret : count;
 }
 
-// 日志文件操作
-static int hips_logs_show(struct seq_file *m, void *v)
+// 日志文件操作：位置 0 为表头，其余位置为日志序号 + 1。
+// 打开时记下日志末尾，只输出打开时已有的日志，读取过程中被覆盖的日志跳过
+struct hips_logs_iter {
+    u64 end;
+    struct hips_log_entry entry;    // 单条日志超过 1KB，不能放在栈上
+};
+
+// 从序号 seq 起取第一条仍保留的日志
+static void *hips_logs_seek(struct hips_logs_iter *iter, u64 seq, loff_t *pos)
+{
+    u64 first, end;
+    
+    for (;;) {
+        hips_log_range(&first, &end);
+        seq = max(seq, first);
+        if (seq >= min(end, iter->end)) {
+            *pos = iter->end + 1;
+            return NULL;
+        }
+        if (hips_log_read(seq, &iter->entry) == HIPS_SUCCESS) {
+            *pos = seq + 1;
+            return &iter->entry;
+        }
+    }
+}
+
+static void *hips_logs_seq_start(struct seq_file *m, loff_t *pos)
 {
-    struct hips_log_entry entries[100];
-    int count, i;
+    if (*pos == 0) {
+        return SEQ_START_TOKEN;
+    }
     
-    if (!hips_config) {
-        seq_printf(m, "HIPS 模块未加载\n");
+    return hips_logs_seek(m->private, *pos - 1, pos);
+}
+
+static void *hips_logs_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+    return hips_logs_seek(m->private, *pos, pos);
+}
+
+static void hips_logs_seq_stop(struct seq_file *m, void *v)
+{
+}
+
+static int hips_logs_seq_show(struct seq_file *m, void *v)
+{
+    struct hips_logs_iter *iter = m->private;
+    struct hips_log_entry *entry = v;
+    u64 first, end;
+    
+    if (v == SEQ_START_TOKEN) {
+        seq_printf(m, "HIPS 日志记录:\n");
+        seq_printf(m, "========================================\n");
+        hips_log_range(&first, &end);
+        if (first >= min(end, iter->end)) {
+            seq_printf(m, "暂无日志记录\n");
+        }
         return 0;
     }
     
-    seq_printf(m, "HIPS 日志记录:\n");
-    seq_printf(m, "========================================\n");
-    
-    count = hips_get_logs(entries, ARRAY_SIZE(entries));
-    if (count > 0) {
-        for (i = 0; i < count; i++) {
-            seq_printf(m, "[%llu] 规则ID: %u, 类型: %u, 动作: %u\n",
-                      entries[i].timestamp, entries[i].rule_id,
-                      entries[i].rule_type, entries[i].action);
-            seq_printf(m, "  进程: %s (PID: %u)\n", 
-                      entries[i].process_name, entries[i].pid);
-            seq_printf(m, "  目标: %s\n", entries[i].target);
-            seq_printf(m, "  详情: %s\n", entries[i].details);
-            seq_printf(m, "----------------------------------------\n");
-        }
-    } else {
-        seq_printf(m, "暂无日志记录\n");
+    seq_printf(m, "[%llu] 规则ID: %u, 类型: %u, 动作: %u\n",
+              entry->timestamp, entry->rule_id, entry->rule_type, entry->action);
+    seq_printf(m, "  进程: %s (PID: %u, UID: %u)\n", 
+              entry->process_name, entry->pid, entry->uid);
+    if (entry->exe[0]) {
+        seq_printf(m, "  程序: %s\n", entry->exe);
     }
+    seq_printf(m, "  目标: %s\n", entry->target);
+    seq_printf(m, "  详情: %s\n", entry->details);
+    seq_printf(m, "----------------------------------------\n");
     
     return 0;
 }
 
+static const struct seq_operations hips_logs_seq_ops = {
+    .start = hips_logs_seq_start,
+    .next = hips_logs_seq_next,
+    .stop = hips_logs_seq_stop,
+    .show = hips_logs_seq_show,
+};
+
 static int hips_logs_open(struct inode *inode, struct file *file)
 {
-    return single_open(file, hips_logs_show, NULL);
+    struct hips_logs_iter *iter;
+    u64 first;
+    
+    iter = __seq_open_private(file, &hips_logs_seq_ops, sizeof(*iter));
+    if (!iter) {
+        return -ENOMEM;
+    }
+    hips_log_range(&first, &iter->end);
+    
+    return 0;
+}
+
+/*
+ * /proc/hips/metrics：OpenMetrics 文本格式
+ *
+ * 打开时取一次全局计数、钩子计数和耗时直方图的快照（每 CPU 计数在此时求和），位置 0 输出快照；
+ * 之后按规则 ID 输出有命中的规则（位置为 ID + 1），规则命中计数在 RCU 下遍历 ID 索引读取；
+ * 最后一个位置输出 "# EOF"。
+ */
+#define HIPS_METRICS_EOF_POS    (U32_MAX + 2ULL)
+#define HIPS_METRICS_EOF        ((void *)2)
+
+struct hips_metrics_snapshot {
+    struct hips_stats stats;
+    struct hips_hook_stats hooks[HIPS_HOOK_MAX];
+    u64 log_first, log_end;
+    u64 dynip_inserted, dynip_expired, dynip_overflow;
+    u64 digest_hits, digest_misses, digest_deferred;
+    u64 replica_bytes, replica_rebuilds, replica_build_ns;
+    u32 dynip_entries, digest_entries, replica_nodes, replica_entries;
+    bool replica_current;
+};
+
+static const char *const hips_metrics_hooks[HIPS_HOOK_MAX] = {"exec", "dns", "network"};
+
+static void hips_metrics_family(struct seq_file *m, const char *name, const char *type,
+                                const char *help)
+{
+    seq_printf(m, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
 }
 
-static ssize_t hips_logs_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+// 纳秒按定点小数输出为秒
+static void hips_metrics_seconds(struct seq_file *m, u64 ns)
 {
-    return seq_read(file, buf, count, ppos);
+    u32 rem;
+    u64 secs = div_u64_rem(ns, NSEC_PER_SEC, &rem);
+
+    seq_printf(m, "%llu.%09u", secs, rem);
 }
 
-// 解析规则命令
-int hips_parse_rules_command(const char *data, size_t size)
+static void hips_metrics_show_hooks(struct seq_file *m, const struct hips_hook_stats *hooks)
 {
-    char *line, *saveptr;
-    char *data_copy;
-    int ret = 0;
-    
-    data_copy = kmalloc(size + 1, GFP_KERNEL);
-    if (!data_copy) {
-        return -ENOMEM;
+    u64 count;
+    int hook, i;
+
+    hips_metrics_family(m, "hips_hook_evaluations", "counter", "钩子完成规则匹配的事件数");
+    for (hook = 0; hook < HIPS_HOOK_MAX; hook++) {
+        seq_printf(m, "hips_hook_evaluations_total{hook=\"%s\"} %llu\n",
+                   hips_metrics_hooks[hook], hooks[hook].evals);
     }
-    
-    memcpy(data_copy, data, size);
-    data_copy[size] = '\0';
-    
-    // 逐行解析
-    line = strtok_r(data_copy, "\n", &saveptr);
-    while (line) {
-        ret = hips_parse_rule_line(line);
-        if (ret < 0) {
-            HIPS_ERROR("解析规则行失败: %s", line);
-            break;
+    hips_metrics_family(m, "hips_hook_matches", "counter", "钩子中命中规则的事件数");
+    for (hook = 0; hook < HIPS_HOOK_MAX; hook++) {
+        seq_printf(m, "hips_hook_matches_total{hook=\"%s\"} %llu\n",
+                   hips_metrics_hooks[hook], hooks[hook].matches);
+    }
+    hips_metrics_family(m, "hips_hook_blocks", "counter", "钩子阻止的事件数");
+    for (hook = 0; hook < HIPS_HOOK_MAX; hook++) {
+        seq_printf(m, "hips_hook_blocks_total{hook=\"%s\"} %llu\n",
+                   hips_metrics_hooks[hook], hooks[hook].blocks);
+    }
+
+    // 直方图的桶是累积的，+Inf 桶与 _count 取各桶之和，保证同一次读取内自洽
+    hips_metrics_family(m, "hips_hook_latency_seconds", "histogram", "钩子单次评估的耗时");
+    seq_printf(m, "# UNIT hips_hook_latency_seconds seconds\n");
+    for (hook = 0; hook < HIPS_HOOK_MAX; hook++) {
+        count = 0;
+        for (i = 0; i < HIPS_LAT_BUCKETS - 1; i++) {
+            count += hooks[hook].lat[i];
+            seq_printf(m, "hips_hook_latency_seconds_bucket{hook=\"%s\",le=\"",
+                       hips_metrics_hooks[hook]);
+            hips_metrics_seconds(m, 1ULL << (i + HIPS_LAT_SHIFT));
+            seq_printf(m, "\"} %llu\n", count);
         }
-        line = strtok_r(NULL, "\n", &saveptr);
+        count += hooks[hook].lat[HIPS_LAT_BUCKETS - 1];
+        seq_printf(m, "hips_hook_latency_seconds_bucket{hook=\"%s\",le=\"+Inf\"} %llu\n",
+                   hips_metrics_hooks[hook], count);
+        seq_printf(m, "hips_hook_latency_seconds_count{hook=\"%s\"} %llu\n",
+                   hips_metrics_hooks[hook], count);
+        seq_printf(m, "hips_hook_latency_seconds_sum{hook=\"%s\"} ", hips_metrics_hooks[hook]);
+        hips_metrics_seconds(m, hooks[hook].ns_sum);
+        seq_printf(m, "\n");
+    }
+}
+
+// 取快照（可能睡眠，不能在 seq_file 迭代的 RCU 读锁内进行）
+static void hips_metrics_snapshot(struct hips_metrics_snapshot *snap)
+{
+    hips_get_stats(&snap->stats);
+    hips_metrics_get_hooks(snap->hooks);
+    hips_log_range(&snap->log_first, &snap->log_end);
+    hips_dynip_get_stats(&snap->dynip_entries, &snap->dynip_inserted, &snap->dynip_expired,
+                         &snap->dynip_overflow);
+    hips_digest_get_stats(&snap->digest_entries, &snap->digest_hits, &snap->digest_misses,
+                          &snap->digest_deferred);
+    hips_replica_get_stats(&snap->replica_nodes, &snap->replica_bytes, &snap->replica_entries,
+                           &snap->replica_current, &snap->replica_rebuilds,
+                           &snap->replica_build_ns);
+}
+
+static void hips_metrics_show_header(struct seq_file *m, const struct hips_metrics_snapshot *snap)
+{
+    const struct hips_stats *stats = &snap->stats;
+
+    hips_metrics_family(m, "hips_enabled", "gauge", "是否执行规则（1 启用，0 禁用）");
+    seq_printf(m, "hips_enabled %u\n", READ_ONCE(hips_config->config.enabled) ? 1 : 0);
+    hips_metrics_family(m, "hips_rules", "gauge", "全局生效、影子和配置文件规则集中的规则数");
+    seq_printf(m, "hips_rules{set=\"live\"} %u\n",
+               READ_ONCE(rcu_access_pointer(hips_config->rules)->rule_count));
+    seq_printf(m, "hips_rules{set=\"shadow\"} %u\n",
+               READ_ONCE(rcu_access_pointer(hips_config->shadow)->rule_count));
+    seq_printf(m, "hips_rules{set=\"config\"} %u\n",
+               READ_ONCE(hips_config->global_sets[HIPS_CONFIG_SET].rule_count));
+    hips_metrics_family(m, "hips_hash_rules", "gauge", "所有规则集中的哈希规则数");
+    seq_printf(m, "hips_hash_rules %u\n", READ_ONCE(hips_config->hash_count));
+
+    hips_metrics_family(m, "hips_blocks", "counter", "按规则类型统计的阻止次数（哈希规则计入 exec）");
+    seq_printf(m, "hips_blocks_total{type=\"exec\"} %llu\n", stats->exec_blocks);
+    seq_printf(m, "hips_blocks_total{type=\"dns\"} %llu\n", stats->dns_blocks);
+    seq_printf(m, "hips_blocks_total{type=\"network\"} %llu\n", stats->network_blocks);
+    hips_metrics_family(m, "hips_events", "counter", "记录到统计中的事件数");
+    seq_printf(m, "hips_events_total %llu\n", stats->total_events);
+    hips_metrics_family(m, "hips_dns_responses", "counter", "被阻止 DNS 查询的处理方式");
+    seq_printf(m, "hips_dns_responses_total{response=\"nxdomain\"} %llu\n", stats->dns_nxdomain);
+    seq_printf(m, "hips_dns_responses_total{response=\"sinkhole\"} %llu\n", stats->dns_sinkhole);
+    seq_printf(m, "hips_dns_responses_total{response=\"drop\"} %llu\n", stats->dns_dropped);
+    hips_metrics_family(m, "hips_ingress_drops", "counter", "网卡入口丢弃的入站报文");
+    seq_printf(m, "hips_ingress_drops_total %llu\n", stats->ingress_drops);
+
+    hips_metrics_family(m, "hips_log_events", "counter", "写入日志环的事件数");
+    seq_printf(m, "hips_log_events_total %llu\n", snap->log_end);
+    hips_metrics_family(m, "hips_log_dropped", "counter", "每 CPU 事件池已满而丢弃的事件数");
+    seq_printf(m, "hips_log_dropped_total %llu\n", stats->log_dropped);
+    hips_metrics_family(m, "hips_log_suppressed", "counter", "因规则的抽样或限速未记录的事件数");
+    seq_printf(m, "hips_log_suppressed_total %llu\n", stats->log_suppressed);
+
+    hips_metrics_show_hooks(m, snap->hooks);
+
+    hips_metrics_family(m, "hips_digest_cache_entries", "gauge", "文件摘要缓存中的条目数");
+    seq_printf(m, "hips_digest_cache_entries %u\n", snap->digest_entries);
+    hips_metrics_family(m, "hips_digest_cache_lookups", "counter", "文件摘要缓存的查找次数");
+    seq_printf(m, "hips_digest_cache_lookups_total{result=\"hit\"} %llu\n", snap->digest_hits);
+    seq_printf(m, "hips_digest_cache_lookups_total{result=\"miss\"} %llu\n", snap->digest_misses);
+    hips_metrics_family(m, "hips_digest_deferred", "counter", "交给工作队列异步计算的文件摘要数");
+    seq_printf(m, "hips_digest_deferred_total %llu\n", snap->digest_deferred);
+
+    hips_metrics_family(m, "hips_dynip_entries", "gauge", "DNS 动态 IP 表中的条目数");
+    seq_printf(m, "hips_dynip_entries %u\n", snap->dynip_entries);
+    hips_metrics_family(m, "hips_dynip_inserted", "counter", "从 DNS 应答学习到的地址数");
+    seq_printf(m, "hips_dynip_inserted_total %llu\n", snap->dynip_inserted);
+    hips_metrics_family(m, "hips_dynip_expired", "counter", "过期移除的动态 IP 数");
+    seq_printf(m, "hips_dynip_expired_total %llu\n", snap->dynip_expired);
+    hips_metrics_family(m, "hips_dynip_overflow", "counter", "超出上限而未加入的动态 IP 数");
+    seq_printf(m, "hips_dynip_overflow_total %llu\n", snap->dynip_overflow);
+
+    hips_metrics_family(m, "hips_shadow_samples", "counter", "抽样评估影子规则集的事件数");
+    seq_printf(m, "hips_shadow_samples_total %llu\n", stats->shadow_samples);
+    hips_metrics_family(m, "hips_shadow_divergences", "counter", "影子规则集与生效规则集结论不同的事件数");
+    seq_printf(m, "hips_shadow_divergences_total{shadow=\"block\"} %llu\n",
+               stats->shadow_would_block);
+    seq_printf(m, "hips_shadow_divergences_total{shadow=\"allow\"} %llu\n",
+               stats->shadow_would_allow);
+
+    hips_metrics_family(m, "hips_replica_nodes", "gauge", "摘要索引的 NUMA 副本数");
+    seq_printf(m, "hips_replica_nodes %u\n", snap->replica_nodes);
+    hips_metrics_family(m, "hips_replica_bytes", "gauge", "摘要索引的 NUMA 副本占用的内存");
+    seq_printf(m, "# UNIT hips_replica_bytes bytes\n");
+    seq_printf(m, "hips_replica_bytes %llu\n", snap->replica_bytes);
+
+    hips_metrics_family(m, "hips_rule_hits", "counter", "规则的命中次数（只列出有命中的规则）");
+}
+
+static void *hips_metrics_seq_start(struct seq_file *m, loff_t *pos)
+    __acquires(RCU)
+{
+    unsigned long index;
+    
+    rcu_read_lock();
+    if (!hips_config) {
+        return NULL;
+    }
+    if (*pos == 0) {
+        return SEQ_START_TOKEN;
+    }
+    if (*pos == HIPS_METRICS_EOF_POS) {
+        return HIPS_METRICS_EOF;
+    }
+    if (*pos > HIPS_METRICS_EOF_POS) {
+        return NULL;
     }
     
-    kfree(data_copy);
-    return ret;
+    index = *pos - 1;
+    return xa_find(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT) ?: HIPS_METRICS_EOF;
 }
 
-// 解析规则行
-int hips_parse_rule_line(const char *line)
+static void *hips_metrics_seq_next(struct seq_file *m, void *v, loff_t *pos)
 {
-    struct hips_rule rule;
-    char *token, *saveptr;
-    char *line_copy;
-    int ret = 0;
+    struct hips_rule_entry *entry;
+    unsigned long index;
     
-    line_copy = kstrdup(line, GFP_KERNEL);
-    if (!line_copy) {
-        return -ENOMEM;
+    if (v == HIPS_METRICS_EOF) {
+        *pos = HIPS_METRICS_EOF_POS + 1;
+        return NULL;
     }
     
-    // 跳过空白字符
-    while (*line_copy == ' ' || *line_copy == '\t') {
-        line_copy++;
+    if (v == SEQ_START_TOKEN) {
+        index = 0;
+        entry = xa_find(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+    } else {
+        index = ((struct hips_rule_entry *)v)->rule.rule_id;
+        entry = xa_find_after(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
     }
     
-    // 跳过注释行
-    if (*line_copy == '#' || *line_copy == '\0') {
-        kfree(line_copy);
+    // 规则遍历完之后是 "# EOF"
+    *pos = entry ? (loff_t)entry->rule.rule_id + 1 : HIPS_METRICS_EOF_POS;
+    return entry ?: HIPS_METRICS_EOF;
+}
+
+static int hips_metrics_seq_show(struct seq_file *m, void *v)
+{
+    static const char *const rule_types[] = {"exec", "dns", "network", "hash"};
+    static const char *const actions[] = {"block", "allow", "log"};
+    struct hips_rule_entry *entry = v;
+    u64 hits;
+    
+    if (v == SEQ_START_TOKEN) {
+        hips_metrics_show_header(m, m->private);
         return 0;
     }
-    
-    // 解析规则格式: 类型|动作|优先级|目标|描述
-    token = strtok_r(line_copy, "|", &saveptr);
-    if (!token) {
-        ret = -EINVAL;
-        goto out;
+    if (v == HIPS_METRICS_EOF) {
+        seq_printf(m, "# EOF\n");
+        return 0;
     }
     
-    // 解析规则类型
-    if (strcmp(token, "exec") == 0) {
-        rule.rule_type = HIPS_RULE_EXEC;
-    } else if (strcmp(token, "dns") == 0) {
-        rule.rule_type = HIPS_RULE_DNS;
-    } else if (strcmp(token, "network") == 0) {
-        rule.rule_type = HIPS_RULE_NETWORK;
-    } else {
-        ret = -EINVAL;
-        goto out;
+    hits = hips_metrics_rule_hits(entry);
+    if (!hits) {
+        return SEQ_SKIP;
     }
+    seq_printf(m, "hips_rule_hits_total{rule_id=\"%u\",type=\"%s\",action=\"%s\"} %llu\n",
+               entry->rule.rule_id, rule_types[entry->rule.rule_type - 1],
+               actions[entry->rule.action <= HIPS_ACTION_LOG ? entry->rule.action : 0], hits);
     
-    // 解析动作
-    token = strtok_r(NULL, "|", &saveptr);
-    if (!token) {
-        ret = -EINVAL;
-        goto out;
-    }
+    return 0;
+}
+
+static const struct seq_operations hips_metrics_seq_ops = {
+    .start = hips_metrics_seq_start,
+    .next = hips_metrics_seq_next,
+    .stop = hips_rules_seq_stop,
+    .show = hips_metrics_seq_show,
+};
+
+static int hips_metrics_open(struct inode *inode, struct file *file)
+{
+    struct hips_metrics_snapshot *snap;
     
-    if (strcmp(token, "block") == 0) {
-        rule.action = HIPS_ACTION_BLOCK;
-    } else if (strcmp(token, "allow") == 0) {
-        rule.action = HIPS_ACTION_ALLOW;
-    } else if (strcmp(token, "log") == 0) {
-        rule.action = HIPS_ACTION_LOG;
-    } else {
-        ret = -EINVAL;
-        goto out;
+    if (!hips_config) {
+        return -ENODEV;
     }
     
-    // 解析优先级
-    token = strtok_r(NULL, "|", &saveptr);
-    if (!token) {
-        ret = -EINVAL;
-        goto out;
+    snap = __seq_open_private(file, &hips_metrics_seq_ops, sizeof(*snap));
+    if (!snap) {
+        return -ENOMEM;
     }
+    hips_metrics_snapshot(snap);
     
-    if (kstrtou32(token, 10, &rule.priority) != 0) {
-        ret = -EINVAL;
-        goto out;
+    return 0;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,6,0)
+static const struct proc_ops hips_status_proc_ops = {
+    .proc_open = hips_status_open,
+    .proc_read = seq_read,
+    .proc_lseek = seq_lseek,
+    .proc_release = single_release,
+};
+
+static const struct proc_ops hips_rules_proc_ops = {
+    .proc_open = hips_rules_open,
+    .proc_read = seq_read,
+    .proc_write = hips_rules_write,
+    .proc_lseek = seq_lseek,
+    .proc_release = seq_release,
+};
+
+static const struct proc_ops hips_logs_proc_ops = {
+    .proc_open = hips_logs_open,
+    .proc_read = seq_read,
+    .proc_lseek = seq_lseek,
+    .proc_release = seq_release_private,
+};
+
+static const struct proc_ops hips_metrics_proc_ops = {
+    .proc_open = hips_metrics_open,
+    .proc_read = seq_read,
+    .proc_lseek = seq_lseek,
+    .proc_release = seq_release_private,
+};
+#else
+static const struct file_operations hips_status_proc_ops = {
+    .owner = THIS_MODULE,
+    .open = hips_status_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static const struct file_operations hips_rules_proc_ops = {
+    .owner = THIS_MODULE,
+    .open = hips_rules_open,
+    .read = seq_read,
+    .write = hips_rules_write,
+    .llseek = seq_lseek,
+    .release = seq_release,
+};
+
+static const struct file_operations hips_logs_proc_ops = {
+    .owner = THIS_MODULE,
+    .open = hips_logs_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = seq_release_private,
+};
+
+static const struct file_operations hips_metrics_proc_ops = {
+    .owner = THIS_MODULE,
+    .open = hips_metrics_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = seq_release_private,
+};
+#endif
+
+// 创建 /proc/hips/status、rules、logs、metrics
+int hips_procfs_init(struct proc_dir_entry *proc_dir)
+{
+    if (!proc_create("status", 0444, proc_dir, &hips_status_proc_ops)) {
+        HIPS_ERROR("无法创建 /proc/hips/status");
+        goto error_status;
     }
     
-    // 解析目标
-    token = strtok_r(NULL, "|", &saveptr);
-    if (!token) {
-        ret = -EINVAL;
-        goto out;
+    if (!proc_create("rules", 0644, proc_dir, &hips_rules_proc_ops)) {
+        HIPS_ERROR("无法创建 /proc/hips/rules");
+        goto error_rules;
     }
     
-    strncpy(rule.target, token, sizeof(rule.target) - 1);
-    rule.target[sizeof(rule.target) - 1] = '\0';
+    if (!proc_create("logs", 0444, proc_dir, &hips_logs_proc_ops)) {
+        HIPS_ERROR("无法创建 /proc/hips/logs");
+        goto error_logs;
+    }
     
-    // 解析描述
-    token = strtok_r(NULL, "|", &saveptr);
-    if (token) {
-        strncpy(rule.description, token, sizeof(rule.description) - 1);
-        rule.description[sizeof(rule.description) - 1] = '\0';
-    } else {
-        strcpy(rule.description, "");
+    if (!proc_create("metrics", 0444, proc_dir, &hips_metrics_proc_ops)) {
+        HIPS_ERROR("无法创建 /proc/hips/metrics");
+        goto error_metrics;
     }
     
-    // 添加规则
-    rule.rule_id = 0; // 自动分配ID
-    ret = hips_add_rule(&rule);
+    return 0;
     
-out:
-    kfree(line_copy);
-    return ret;
-} 
\ No newline at end of file
+error_metrics:
+    remove_proc_entry("logs", proc_dir);
+error_logs:
+    remove_proc_entry("rules", proc_dir);
+error_rules:
+    remove_proc_entry("status", proc_dir);
+error_status:
+    return -ENOMEM;
+}
+
+void hips_procfs_exit(struct proc_dir_entry *proc_dir)
+{
+    remove_proc_entry("metrics", proc_dir);
+    remove_proc_entry("logs", proc_dir);
+    remove_proc_entry("rules", proc_dir);
+    remove_proc_entry("status", proc_dir);
+}
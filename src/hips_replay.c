@@ -0,0 +1,749 @@
+#include "hips_common.h"
+
+#include <linux/vmalloc.h>
+#include <linux/sort.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/if_ether.h>
+#include <net/net_namespace.h>
+
+/*
+ * 报文回放测试（make replay 构建，CONFIG_HIPS_REPLAY）
+ *
+ * 从 pcap 文件或生成的流量模型构造 skb，直接送入 hips_network_hook、
+ * hips_dns_hook 和入口判决 hips_ingress_filter，统计每秒报文数、
+ * 单包延迟分位数和判决计数，用于评估模块在 10/25 GbE 主机上的处理能力。
+ * flood 模型是来自两个 /24 网段、发往 22 端口的 SYN 洪泛，配合入站阻止规则
+ * 比较入口丢弃（hook=ingress）和 LOCAL_IN（hook=input）的每包开销。
+ *
+ * 用法:
+ *   echo "profile=mixed count=1000000" > /proc/hips/replay
+ *   echo "pcap=/tmp/trace.pcap count=500000 hook=dns" > /proc/hips/replay
+ *   echo "profile=flood count=5000000 hook=ingress" > /proc/hips/replay
+ *   cat /proc/hips/replay
+ */
+
+#define HIPS_REPLAY_MAX_TEMPLATES  4096
+#define HIPS_REPLAY_MAX_SAMPLES    (1 << 20)
+#define HIPS_REPLAY_MAX_PCAP       (64 << 20)
+#define HIPS_REPLAY_DEFAULT_COUNT  100000
+#define HIPS_REPLAY_REPORT_SIZE    4096
+
+// 回放的目标钩子
+#define HIPS_REPLAY_HOOK_NETWORK   0x1
+#define HIPS_REPLAY_HOOK_DNS       0x2
+#define HIPS_REPLAY_HOOK_INGRESS   0x4
+#define HIPS_REPLAY_HOOK_INPUT     0x8
+
+// pcap 格式
+#define PCAP_MAGIC                 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC            0xa1b23c4d
+#define PCAP_LINKTYPE_ETHERNET     1
+#define PCAP_LINKTYPE_RAW          101
+#define PCAP_LINKTYPE_IPV4         228
+#define PCAP_LINKTYPE_IPV6         229
+
+struct pcap_file_header {
+    __u32 magic;
+    __u16 version_major;
+    __u16 version_minor;
+    __s32 thiszone;
+    __u32 sigfigs;
+    __u32 snaplen;
+    __u32 linktype;
+};
+
+struct pcap_record_header {
+    __u32 ts_sec;
+    __u32 ts_usec;
+    __u32 caplen;
+    __u32 len;
+};
+
+// 单个钩子的回放结果
+struct hips_replay_hook_result {
+    u64 packets;
+    u64 accept;
+    u64 drop;
+    u64 other;
+    u64 total_ns;
+    u32 p50;
+    u32 p90;
+    u32 p99;
+    u32 p999;
+    u32 max;
+};
+
+struct hips_replay_request {
+    char profile[32];
+    char pcap[256];
+    unsigned long count;
+    unsigned int hooks;
+};
+
+struct hips_replay_ctx {
+    struct sk_buff *skbs[HIPS_REPLAY_MAX_TEMPLATES];
+    int skb_count;
+    // 模板组成
+    u32 ipv4;
+    u32 ipv6;
+    u32 tcp;
+    u32 udp;
+    u32 dns;
+    u32 fragmented;
+    u32 nonlinear;
+};
+
+static DEFINE_MUTEX(hips_replay_mutex);
+static char *hips_replay_report;
+
+// 简单的确定性伪随机数，保证每次回放的流量相同
+static u32 hips_replay_rand(u32 *state)
+{
+    *state = *state * 1103515245 + 12345;
+    return *state >> 8;
+}
+
+// 构造一个 DNS 查询负载，返回长度
+static int hips_replay_build_dns(u8 *buf, size_t size, u32 id, int ipv6)
+{
+    char name[64];
+    char *label, *cursor;
+    int len = 12;
+
+    if (size < 80) {
+        return 0;
+    }
+
+    memset(buf, 0, 12);
+    buf[0] = id >> 8;
+    buf[1] = id & 0xff;
+    buf[2] = 0x01;  // RD
+    buf[5] = 1;     // QDCOUNT
+
+    snprintf(name, sizeof(name), "host-%u.example.com", id % 1000);
+    cursor = name;
+    while ((label = strsep(&cursor, ".")) != NULL) {
+        size_t l = strlen(label);
+
+        buf[len++] = l;
+        memcpy(buf + len, label, l);
+        len += l;
+    }
+    buf[len++] = 0;
+
+    // QTYPE A/AAAA, QCLASS IN
+    buf[len++] = 0;
+    buf[len++] = ipv6 ? 28 : 1;
+    buf[len++] = 0;
+    buf[len++] = 1;
+
+    return len;
+}
+
+// 按给定的 L3 报文内容构造 skb；nonlinear 时只把 IP 头放入线性区
+static struct sk_buff *hips_replay_alloc_skb(const u8 *data, unsigned int len, int nonlinear)
+{
+    struct sk_buff *skb;
+    unsigned int linear, l3len;
+    u8 version;
+
+    if (len < sizeof(struct iphdr)) {
+        return NULL;
+    }
+
+    version = data[0] >> 4;
+    if (version == 4) {
+        l3len = (data[0] & 0x0f) * 4;
+    } else if (version == 6) {
+        l3len = sizeof(struct ipv6hdr);
+    } else {
+        return NULL;
+    }
+
+    if (len < l3len) {
+        return NULL;
+    }
+
+    linear = nonlinear ? l3len : len;
+    if (linear == len || len - linear > PAGE_SIZE) {
+        nonlinear = 0;
+        linear = len;
+    }
+
+    skb = alloc_skb(LL_MAX_HEADER + linear, GFP_KERNEL);
+    if (!skb) {
+        return NULL;
+    }
+
+    skb_reserve(skb, LL_MAX_HEADER);
+    skb_put_data(skb, data, linear);
+
+    if (nonlinear) {
+        struct page *page = alloc_page(GFP_KERNEL);
+
+        if (!page) {
+            kfree_skb(skb);
+            return NULL;
+        }
+        memcpy(page_address(page), data + linear, len - linear);
+        skb_fill_page_desc(skb, 0, page, 0, len - linear);
+        skb->len += len - linear;
+        skb->data_len = len - linear;
+        skb->truesize += PAGE_SIZE;
+    }
+
+    skb_reset_network_header(skb);
+    skb_set_transport_header(skb, l3len);
+    skb->protocol = version == 4 ? htons(ETH_P_IP) : htons(ETH_P_IPV6);
+
+    return skb;
+}
+
+static int hips_replay_add_skb(struct hips_replay_ctx *ctx, struct sk_buff *skb)
+{
+    if (!skb) {
+        return -ENOMEM;
+    }
+
+    if (skb->protocol == htons(ETH_P_IP)) {
+        ctx->ipv4++;
+    } else {
+        ctx->ipv6++;
+    }
+    if (skb_is_nonlinear(skb)) {
+        ctx->nonlinear++;
+    }
+
+    ctx->skbs[ctx->skb_count++] = skb;
+    return 0;
+}
+
+// 生成流量模型: mixed | dns | ipv4 | ipv6 | flood
+static int hips_replay_generate(struct hips_replay_ctx *ctx, const char *profile)
+{
+    u8 *pkt;
+    u32 seed = 0x48495053;
+    int i, ret = 0;
+    int flood = !strcmp(profile, "flood");
+
+    if (strcmp(profile, "mixed") && strcmp(profile, "dns") &&
+        strcmp(profile, "ipv4") && strcmp(profile, "ipv6") && !flood) {
+        return -EINVAL;
+    }
+
+    pkt = kmalloc(2048, GFP_KERNEL);
+    if (!pkt) {
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < HIPS_REPLAY_MAX_TEMPLATES && ret == 0; i++) {
+        u32 r = hips_replay_rand(&seed);
+        int ipv6, dns, udp, frag, nonlinear;
+        unsigned int l3len, l4len, paylen, len;
+        u16 dport;
+        u8 *l4;
+
+        if (!strcmp(profile, "ipv4") || flood) {
+            ipv6 = 0;
+        } else if (!strcmp(profile, "ipv6")) {
+            ipv6 = 1;
+        } else {
+            ipv6 = (r % 100) < 40;
+        }
+        dns = !flood && (!strcmp(profile, "dns") || (r >> 7) % 100 < 20);
+        udp = dns || (!flood && (r >> 14) % 100 < 40);
+        frag = !dns && !flood && (r >> 3) % 100 < 5;
+        nonlinear = !flood && (r >> 21) % 100 < 10;
+        dport = dns ? 53 : (udp ? 443 : (r % 4 && !flood ? 443 : 22));
+
+        memset(pkt, 0, 2048);
+        l3len = ipv6 ? sizeof(struct ipv6hdr) : sizeof(struct iphdr);
+        l4 = pkt + l3len;
+
+        if (udp) {
+            struct udphdr *uh = (struct udphdr *)l4;
+
+            l4len = sizeof(*uh);
+            paylen = dns ? hips_replay_build_dns(l4 + l4len, 256, i, ipv6) : 64 + r % 1200;
+            uh->source = htons(32768 + i);
+            uh->dest = htons(dport);
+            uh->len = htons(l4len + paylen);
+            ctx->udp++;
+        } else {
+            struct tcphdr *th = (struct tcphdr *)l4;
+
+            l4len = sizeof(*th);
+            paylen = flood ? 0 : r % 1400;
+            th->source = htons(32768 + i);
+            th->dest = htons(dport);
+            th->doff = l4len / 4;
+            th->syn = paylen == 0;
+            th->ack = paylen != 0;
+            ctx->tcp++;
+        }
+        if (dns) {
+            ctx->dns++;
+        }
+
+        len = l3len + l4len + paylen;
+
+        if (ipv6) {
+            struct ipv6hdr *ip6h = (struct ipv6hdr *)pkt;
+
+            ip6h->version = 6;
+            ip6h->payload_len = htons(len - l3len);
+            ip6h->nexthdr = udp ? IPPROTO_UDP : IPPROTO_TCP;
+            ip6h->hop_limit = 64;
+            ip6h->saddr.s6_addr32[0] = htonl(0x20010db8);
+            ip6h->saddr.s6_addr32[3] = htonl(1);
+            ip6h->daddr.s6_addr32[0] = htonl(0x20010db8);
+            ip6h->daddr.s6_addr32[3] = htonl(0x100 + i % 256);
+        } else {
+            struct iphdr *iph = (struct iphdr *)pkt;
+
+            iph->version = 4;
+            iph->ihl = 5;
+            iph->tot_len = htons(len);
+            iph->ttl = 64;
+            iph->protocol = udp ? IPPROTO_UDP : IPPROTO_TCP;
+            iph->saddr = htonl(0x0a000001);
+            iph->daddr = htonl(0x0a000000 | ((i % 1024) + 2));
+            // 洪泛来源: 198.51.100.0/24 和 203.0.113.0/24，目的为本机
+            if (flood) {
+                iph->saddr = htonl((i & 1 ? 0xcb007100 : 0xc6336400) | ((i >> 1) & 0xff));
+                iph->daddr = htonl(0x0a000001);
+            }
+            // 非首分片：只有负载，没有传输层头
+            if (frag) {
+                iph->frag_off = htons(185);
+                ctx->fragmented++;
+            }
+            iph->check = ip_fast_csum((u8 *)iph, iph->ihl);
+        }
+
+        ret = hips_replay_add_skb(ctx, hips_replay_alloc_skb(pkt, len, nonlinear));
+    }
+
+    kfree(pkt);
+    return ret;
+}
+
+// 从 pcap 文件加载报文模板
+static int hips_replay_load_pcap(struct hips_replay_ctx *ctx, const char *path)
+{
+    struct pcap_file_header *fh;
+    struct file *file;
+    loff_t pos = 0, size;
+    u8 *buf;
+    size_t off;
+    int swapped, ret;
+
+    file = filp_open(path, O_RDONLY, 0);
+    if (IS_ERR(file)) {
+        HIPS_WARN("无法打开 pcap 文件: %s", path);
+        return PTR_ERR(file);
+    }
+
+    size = i_size_read(file_inode(file));
+    if (size < sizeof(*fh) || size > HIPS_REPLAY_MAX_PCAP) {
+        filp_close(file, NULL);
+        return -EINVAL;
+    }
+
+    buf = kvmalloc(size, GFP_KERNEL);
+    if (!buf) {
+        filp_close(file, NULL);
+        return -ENOMEM;
+    }
+
+    ret = kernel_read(file, buf, size, &pos);
+    filp_close(file, NULL);
+    if (ret != size) {
+        kvfree(buf);
+        return ret < 0 ? ret : -EIO;
+    }
+
+    fh = (struct pcap_file_header *)buf;
+    if (fh->magic == PCAP_MAGIC || fh->magic == PCAP_MAGIC_NSEC) {
+        swapped = 0;
+    } else if (fh->magic == swab32(PCAP_MAGIC) || fh->magic == swab32(PCAP_MAGIC_NSEC)) {
+        swapped = 1;
+    } else {
+        kvfree(buf);
+        return -EINVAL;
+    }
+
+#define PCAP32(x) (swapped ? swab32(x) : (x))
+
+    ret = 0;
+    off = sizeof(*fh);
+    while (off + sizeof(struct pcap_record_header) <= size &&
+           ctx->skb_count < HIPS_REPLAY_MAX_TEMPLATES) {
+        struct pcap_record_header *rh = (struct pcap_record_header *)(buf + off);
+        u32 caplen = PCAP32(rh->caplen);
+        const u8 *data = buf + off + sizeof(*rh);
+        unsigned int skip = 0;
+
+        off += sizeof(*rh) + caplen;
+        if (off > size) {
+            break;
+        }
+
+        switch (PCAP32(fh->linktype)) {
+            case PCAP_LINKTYPE_ETHERNET: {
+                __be16 proto;
+
+                skip = ETH_HLEN;
+                if (caplen < skip) {
+                    continue;
+                }
+                proto = *(__be16 *)(data + 12);
+                // 单层 VLAN
+                if (proto == htons(ETH_P_8021Q) && caplen >= skip + 4) {
+                    proto = *(__be16 *)(data + 16);
+                    skip += 4;
+                }
+                if (proto != htons(ETH_P_IP) && proto != htons(ETH_P_IPV6)) {
+                    continue;
+                }
+                break;
+            }
+            case PCAP_LINKTYPE_RAW:
+            case PCAP_LINKTYPE_IPV4:
+            case PCAP_LINKTYPE_IPV6:
+                break;
+            default:
+                kvfree(buf);
+                return -EOPNOTSUPP;
+        }
+
+        {
+            struct sk_buff *skb = hips_replay_alloc_skb(data + skip, caplen - skip, 0);
+            __be16 sport = 0, dport = 0;
+            u8 protocol;
+
+            if (!skb) {
+                continue;
+            }
+            hips_replay_add_skb(ctx, skb);
+            if (hips_get_l4_ports(skb, skb->protocol == htons(ETH_P_IP) ?
+                                  NFPROTO_IPV4 : NFPROTO_IPV6,
+                                  &protocol, &sport, &dport) < 0) {
+                ctx->fragmented++;
+            } else if (protocol == IPPROTO_TCP) {
+                ctx->tcp++;
+            } else if (protocol == IPPROTO_UDP) {
+                ctx->udp++;
+            }
+            if (dport == htons(53)) {
+                ctx->dns++;
+            }
+        }
+    }
+
+#undef PCAP32
+
+    kvfree(buf);
+    return ctx->skb_count ? 0 : -ENODATA;
+}
+
+static int hips_replay_cmp_u32(const void *a, const void *b)
+{
+    u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// 对一个钩子回放 count 个报文
+static int hips_replay_run_hook(struct hips_replay_ctx *ctx, unsigned int hook,
+                                unsigned long count, struct hips_replay_hook_result *res)
+{
+    struct nf_hook_state state;
+    unsigned long i, stride, nsamples = 0;
+    u32 *samples;
+    u64 start, end, wall;
+
+    stride = count / HIPS_REPLAY_MAX_SAMPLES + 1;
+    samples = kvmalloc_array(count / stride + 1, sizeof(u32), GFP_KERNEL);
+    if (!samples) {
+        return -ENOMEM;
+    }
+
+    memset(res, 0, sizeof(*res));
+    memset(&state, 0, sizeof(state));
+    state.net = &init_net;
+    if (hook == HIPS_REPLAY_HOOK_DNS) {
+        state.hook = NF_INET_PRE_ROUTING;
+    } else if (hook == HIPS_REPLAY_HOOK_INPUT) {
+        state.hook = NF_INET_LOCAL_IN;
+    } else {
+        state.hook = NF_INET_LOCAL_OUT;
+    }
+
+    wall = ktime_get_ns();
+    for (i = 0; i < count; i++) {
+        struct sk_buff *skb = ctx->skbs[i % ctx->skb_count];
+        int verdict;
+
+        state.pf = skb->protocol == htons(ETH_P_IP) ? NFPROTO_IPV4 : NFPROTO_IPV6;
+
+        start = ktime_get_ns();
+        if (hook == HIPS_REPLAY_HOOK_DNS) {
+            verdict = hips_dns_hook(skb, &state);
+        } else if (hook == HIPS_REPLAY_HOOK_INGRESS) {
+            verdict = hips_ingress_filter(skb, &init_net);
+        } else {
+            verdict = hips_network_hook(skb, &state);
+        }
+        end = ktime_get_ns();
+
+        if (verdict == NF_ACCEPT) {
+            res->accept++;
+        } else if (verdict == NF_DROP) {
+            res->drop++;
+        } else {
+            res->other++;
+        }
+
+        if (i % stride == 0) {
+            samples[nsamples++] = min_t(u64, end - start, U32_MAX);
+        }
+
+        if ((i & 4095) == 0) {
+            cond_resched();
+        }
+    }
+    res->total_ns = ktime_get_ns() - wall;
+    res->packets = count;
+
+    sort(samples, nsamples, sizeof(u32), hips_replay_cmp_u32, NULL);
+    res->p50 = samples[nsamples * 50 / 100];
+    res->p90 = samples[nsamples * 90 / 100];
+    res->p99 = samples[nsamples * 99 / 100];
+    res->p999 = samples[nsamples * 999 / 1000];
+    res->max = samples[nsamples - 1];
+
+    kvfree(samples);
+    return 0;
+}
+
+static void hips_replay_format_hook(char *buf, size_t size, size_t *len, const char *name,
+                                    const struct hips_replay_hook_result *res)
+{
+    *len += scnprintf(buf + *len, size - *len,
+                      "%s:\n"
+                      "  报文数: %llu\n"
+                      "  每秒报文数: %llu\n"
+                      "  判决: accept=%llu drop=%llu other=%llu\n"
+                      "  延迟(ns): p50=%u p90=%u p99=%u p99.9=%u max=%u\n",
+                      name, res->packets,
+                      div64_u64(res->packets * NSEC_PER_SEC, res->total_ns ?: 1),
+                      res->accept, res->drop, res->other,
+                      res->p50, res->p90, res->p99, res->p999, res->max);
+}
+
+static int hips_replay_run(const struct hips_replay_request *req)
+{
+    struct hips_replay_hook_result res;
+    struct hips_replay_ctx *ctx;
+    char *report;
+    size_t len = 0;
+    int i, ret;
+
+    ctx = kvzalloc(sizeof(*ctx), GFP_KERNEL);
+    report = kzalloc(HIPS_REPLAY_REPORT_SIZE, GFP_KERNEL);
+    if (!ctx || !report) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    if (req->pcap[0]) {
+        ret = hips_replay_load_pcap(ctx, req->pcap);
+    } else {
+        ret = hips_replay_generate(ctx, req->profile);
+    }
+    if (ret < 0) {
+        goto out;
+    }
+
+    len += scnprintf(report + len, HIPS_REPLAY_REPORT_SIZE - len,
+                     "HIPS 报文回放结果:\n"
+                     "  来源: %s\n"
+                     "  模板: %d (IPv4=%u IPv6=%u TCP=%u UDP=%u DNS=%u 分片=%u 非线性=%u)\n"
+                     "  模块状态: %s\n",
+                     req->pcap[0] ? req->pcap : req->profile, ctx->skb_count,
+                     ctx->ipv4, ctx->ipv6, ctx->tcp, ctx->udp, ctx->dns,
+                     ctx->fragmented, ctx->nonlinear,
+                     hips_config->config.enabled ? "启用" : "禁用");
+
+    if (req->hooks & HIPS_REPLAY_HOOK_NETWORK) {
+        ret = hips_replay_run_hook(ctx, HIPS_REPLAY_HOOK_NETWORK, req->count, &res);
+        if (ret < 0) {
+            goto out;
+        }
+        hips_replay_format_hook(report, HIPS_REPLAY_REPORT_SIZE, &len, "network", &res);
+    }
+
+    if (req->hooks & HIPS_REPLAY_HOOK_DNS) {
+        ret = hips_replay_run_hook(ctx, HIPS_REPLAY_HOOK_DNS, req->count, &res);
+        if (ret < 0) {
+            goto out;
+        }
+        hips_replay_format_hook(report, HIPS_REPLAY_REPORT_SIZE, &len, "dns", &res);
+    }
+
+    if (req->hooks & HIPS_REPLAY_HOOK_INGRESS) {
+        ret = hips_replay_run_hook(ctx, HIPS_REPLAY_HOOK_INGRESS, req->count, &res);
+        if (ret < 0) {
+            goto out;
+        }
+        hips_replay_format_hook(report, HIPS_REPLAY_REPORT_SIZE, &len, "ingress", &res);
+    }
+
+    if (req->hooks & HIPS_REPLAY_HOOK_INPUT) {
+        ret = hips_replay_run_hook(ctx, HIPS_REPLAY_HOOK_INPUT, req->count, &res);
+        if (ret < 0) {
+            goto out;
+        }
+        hips_replay_format_hook(report, HIPS_REPLAY_REPORT_SIZE, &len, "input", &res);
+    }
+
+    kfree(hips_replay_report);
+    hips_replay_report = report;
+    report = NULL;
+    HIPS_INFO("报文回放完成: %lu 个报文", req->count);
+
+out:
+    if (ctx) {
+        for (i = 0; i < ctx->skb_count; i++) {
+            kfree_skb(ctx->skbs[i]);
+        }
+        kvfree(ctx);
+    }
+    kfree(report);
+    return ret;
+}
+
+// 解析回放命令: profile=<名称> pcap=<路径> count=<次数> hook=network|dns|ingress|input|all
+static int hips_replay_parse(char *cmd, struct hips_replay_request *req)
+{
+    char *token;
+
+    memset(req, 0, sizeof(*req));
+    strscpy(req->profile, "mixed", sizeof(req->profile));
+    req->count = HIPS_REPLAY_DEFAULT_COUNT;
+    req->hooks = HIPS_REPLAY_HOOK_NETWORK | HIPS_REPLAY_HOOK_DNS;
+
+    while ((token = strsep(&cmd, " \t\n")) != NULL) {
+        if (*token == '\0') {
+            continue;
+        }
+
+        if (strncmp(token, "profile=", 8) == 0) {
+            strscpy(req->profile, token + 8, sizeof(req->profile));
+        } else if (strncmp(token, "pcap=", 5) == 0) {
+            strscpy(req->pcap, token + 5, sizeof(req->pcap));
+        } else if (strncmp(token, "count=", 6) == 0) {
+            if (kstrtoul(token + 6, 10, &req->count) != 0 || req->count == 0) {
+                return -EINVAL;
+            }
+        } else if (strcmp(token, "hook=network") == 0) {
+            req->hooks = HIPS_REPLAY_HOOK_NETWORK;
+        } else if (strcmp(token, "hook=dns") == 0) {
+            req->hooks = HIPS_REPLAY_HOOK_DNS;
+        } else if (strcmp(token, "hook=ingress") == 0) {
+            req->hooks = HIPS_REPLAY_HOOK_INGRESS;
+        } else if (strcmp(token, "hook=input") == 0) {
+            req->hooks = HIPS_REPLAY_HOOK_INPUT;
+        } else if (strcmp(token, "hook=all") == 0) {
+            req->hooks = HIPS_REPLAY_HOOK_NETWORK | HIPS_REPLAY_HOOK_DNS;
+        } else {
+            return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+static int hips_replay_show(struct seq_file *m, void *v)
+{
+    mutex_lock(&hips_replay_mutex);
+    if (hips_replay_report) {
+        seq_puts(m, hips_replay_report);
+    } else {
+        seq_printf(m, "暂无回放结果，写入 \"profile=mixed count=100000\" 开始回放\n");
+    }
+    mutex_unlock(&hips_replay_mutex);
+    return 0;
+}
+
+static int hips_replay_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, hips_replay_show, NULL);
+}
+
+static ssize_t hips_replay_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+    struct hips_replay_request req;
+    char *data;
+    int ret;
+
+    if (count > 512) {
+        return -EINVAL;
+    }
+
+    data = memdup_user_nul(buf, count);
+    if (IS_ERR(data)) {
+        return PTR_ERR(data);
+    }
+
+    ret = hips_replay_parse(data, &req);
+    kfree(data);
+    if (ret < 0) {
+        return ret;
+    }
+
+    mutex_lock(&hips_replay_mutex);
+    ret = hips_replay_run(&req);
+    mutex_unlock(&hips_replay_mutex);
+
+    return ret < 0 ? ret : count;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,6,0)
+static const struct proc_ops hips_replay_proc_ops = {
+    .proc_open = hips_replay_open,
+    .proc_read = seq_read,
+    .proc_write = hips_replay_write,
+    .proc_lseek = seq_lseek,
+    .proc_release = single_release,
+};
+#else
+static const struct file_operations hips_replay_proc_ops = {
+    .owner = THIS_MODULE,
+    .open = hips_replay_open,
+    .read = seq_read,
+    .write = hips_replay_write,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+#endif
+
+// 创建 /proc/hips/replay
+int hips_replay_init(struct proc_dir_entry *proc_dir)
+{
+    if (!proc_create("replay", 0600, proc_dir, &hips_replay_proc_ops)) {
+        HIPS_ERROR("无法创建 /proc/hips/replay");
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+void hips_replay_exit(struct proc_dir_entry *proc_dir)
+{
+    remove_proc_entry("replay", proc_dir);
+    kfree(hips_replay_report);
+    hips_replay_report = NULL;
+}
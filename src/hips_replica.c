@@ -0,0 +1,335 @@
+#include "hips_common.h"
+
+/*
+ * 按 NUMA 节点复制的摘要索引
+ *
+ * 百万级的 IOC 摘要表在双路主机上只分配在某一个节点，另一个节点上的 exec 钩子每次查找都跨互连访问。
+ * 启用 numa_replicas 后，摘要表被编译成紧凑的开放寻址表，每个有内存的节点在本节点上分配一份，
+ * 所有副本带同一个摘要表代数一起发布。钩子按 numa_mem_id() 读本节点的副本，不持有 config_lock；
+ * 代数与当前摘要表不同（哈希规则刚加入或移除）时退回摘要表查找，结果始终与摘要表一致。
+ * 重新编译由过期工作项在摘要表保持一个周期不变后进行，批量导入期间不会反复编译。
+ * 编译在 RCU 下分段遍历摘要表，不持有 config_lock，百万级规则的编译不会阻塞规则更新；
+ * 开始时和结束时在锁内各取一次摘要表代数，期间有变化则丢弃本次结果，由下个周期重新编译。
+ */
+
+// 编译时每遍历这么多个桶退出一次 RCU 读临界区并让出 CPU
+#define HIPS_REPLICA_CHUNK  4096
+
+static uint hips_numa_replicas;
+module_param_named(numa_replicas, hips_numa_replicas, uint, 0644);
+MODULE_PARM_DESC(numa_replicas, "为哈希规则摘要索引在每个 NUMA 节点上维护一份副本（1 启用，0 关闭）");
+
+static u64 hips_replica_seen_gen;       // 上个周期看到的摘要表代数
+static u64 hips_replica_rebuilds;
+static u64 hips_replica_build_ns;       // 最近一次编译（含复制）的耗时
+
+// 容纳 count 条规则的槽位数：2 的幂，装载率不超过 3/4
+u32 hips_replica_capacity(u32 count)
+{
+    return roundup_pow_of_two(max((u64)count + count / 3 + 1, 16ULL));
+}
+
+u64 hips_replica_bytes(u32 capacity)
+{
+    return sizeof(struct hips_digest_replica) + (u64)capacity * sizeof(struct hips_replica_slot);
+}
+
+static inline u32 hips_replica_index(const u8 *digest, u32 mask)
+{
+    u32 key;
+
+    memcpy(&key, digest, sizeof(key));
+    return key & mask;
+}
+
+// 把摘要表编译进已清零的 rep，同一摘要的规则按摘要表桶内顺序排在探测链上。
+// 在 RCU 下分段遍历，不持有 config_lock：遍历期间摘要表可能变化，结果是否可用由调用者比较代数判断。
+// 槽位不足时返回 HIPS_ERROR_MEMORY，摘要表被清空释放时返回 HIPS_ERROR_NOT_FOUND
+int hips_replica_compile(struct hips_digest_replica *rep, u32 capacity)
+{
+    struct hips_rule_entry *entry;
+    struct hips_replica_slot *slot;
+    struct hlist_head *table;
+    u32 bkt, idx, buckets, count = 0, limit = capacity - capacity / 4;
+    int ret = HIPS_SUCCESS;
+
+    rep->mask = capacity - 1;
+
+    rcu_read_lock();
+    table = smp_load_acquire(&hips_config->digest_table);
+    buckets = table ? 1U << hips_config->digest_bits : 0;
+    for (bkt = 0; bkt < buckets; bkt++) {
+        // 退出读临界区后摘要表可能已被清空规则表释放，回来时确认仍是同一张表
+        if (bkt && bkt % HIPS_REPLICA_CHUNK == 0) {
+            rcu_read_unlock();
+            cond_resched();
+            rcu_read_lock();
+            if (smp_load_acquire(&hips_config->digest_table) != table) {
+                ret = HIPS_ERROR_NOT_FOUND;
+                break;
+            }
+        }
+
+        hlist_for_each_entry_rcu(entry, &table[bkt], cls_node) {
+            // 遍历期间加入的规则可能超出容量
+            if (count == limit) {
+                ret = HIPS_ERROR_MEMORY;
+                goto out;
+            }
+
+            idx = hips_replica_index(entry->digest, rep->mask);
+            while (rep->slots[idx].rule_id) {
+                idx = (idx + 1) & rep->mask;
+            }
+
+            slot = &rep->slots[idx];
+            memcpy(slot->digest, entry->digest, HIPS_SHA256_SIZE);
+            slot->rule_id = entry->rule.rule_id;
+            slot->priority = entry->rule.priority;
+            slot->expires_at = entry->rule.expires_at;
+            slot->set = entry->set;
+            slot->cgroup_id = entry->set->cgroup_id;
+            count++;
+        }
+    }
+out:
+    rcu_read_unlock();
+    rep->count = count;
+
+    return ret;
+}
+
+// 在一份副本中查找，范围和优先级规则与 hips_match_digest 相同：cgroup 规则集优先于
+// 网络命名空间规则集，再优先于全局规则集（live）和配置文件规则集，优先级高者胜出。返回规则 ID，未命中返回 0
+u32 hips_replica_lookup(const struct hips_digest_replica *rep, const struct hips_rule_set *live,
+                        const struct hips_rule_set *net_set, u64 cgroup_id, u64 clock,
+                        const u8 *digest)
+{
+    const struct hips_replica_slot *slot, *best = NULL;
+    int scope, best_scope = 0;
+    u32 idx = hips_replica_index(digest, rep->mask);
+
+    for (slot = &rep->slots[idx]; slot->rule_id; slot = &rep->slots[idx]) {
+        idx = (idx + 1) & rep->mask;
+
+        if (memcmp(slot->digest, digest, HIPS_SHA256_SIZE) != 0) {
+            continue;
+        }
+        if (slot->expires_at && slot->expires_at <= clock) {
+            continue;
+        }
+
+        if (slot->cgroup_id) {
+            if (slot->cgroup_id != cgroup_id) {
+                continue;
+            }
+            scope = 0;
+        } else if (slot->set == live) {
+            scope = 2;
+        } else if (slot->set == &hips_config->global_sets[HIPS_CONFIG_SET]) {
+            scope = 3;
+        } else if (slot->set == net_set) {
+            scope = 1;
+        } else {
+            continue;
+        }
+
+        if (!best || slot->priority > best->priority ||
+            (slot->priority == best->priority && scope < best_scope)) {
+            best = slot;
+            best_scope = scope;
+        }
+    }
+
+    return best ? best->rule_id : 0;
+}
+
+// 按本节点的副本匹配。副本与摘要表一致时返回 HIPS_SUCCESS 或 HIPS_ERROR_NOT_FOUND；
+// 未启用、副本已过时或命中的规则刚被删除时返回 HIPS_ERROR_INVALID，由调用者查摘要表
+int hips_replica_match(struct hips_rule_set *net_set, u64 cgroup_id, const u8 *digest,
+                       struct hips_rule *matched_rule)
+{
+    struct hips_replica_set *set;
+    struct hips_digest_replica *rep;
+    u32 rule_id;
+    int ret = HIPS_ERROR_INVALID;
+
+    rcu_read_lock();
+    set = rcu_dereference(hips_config->replicas);
+    if (set && set->gen == READ_ONCE(hips_config->digest_gen)) {
+        rep = set->node[numa_mem_id()];
+        if (!rep) {
+            rep = set->primary;
+        }
+
+        rule_id = hips_replica_lookup(rep, rcu_dereference(hips_config->rules), net_set,
+                                      cgroup_id, READ_ONCE(hips_config->expire_clock), digest);
+        if (!rule_id) {
+            ret = HIPS_ERROR_NOT_FOUND;
+        } else if (hips_get_rule(rule_id, matched_rule) == HIPS_SUCCESS) {
+            ret = HIPS_SUCCESS;
+        }
+    }
+    rcu_read_unlock();
+
+    return ret;
+}
+
+static void hips_replica_free_set(struct hips_replica_set *set)
+{
+    int node;
+
+    if (!set) {
+        return;
+    }
+
+    for_each_node_state(node, N_MEMORY) {
+        vfree(set->node[node]);
+    }
+    kfree(set);
+}
+
+// 撤下已发布的副本，等待读者离开后释放
+static void hips_replica_publish(struct hips_replica_set *set)
+{
+    struct hips_replica_set *old = rcu_dereference_protected(hips_config->replicas, 1);
+
+    rcu_assign_pointer(hips_config->replicas, set);
+    if (old) {
+        synchronize_rcu();
+        hips_replica_free_set(old);
+    }
+}
+
+// 编译并发布一组副本，替换已发布的副本。调用者保证重新编译串行进行（过期工作项）。
+// 返回发布的副本数
+int hips_replica_rebuild(void)
+{
+    struct hips_replica_set *set;
+    u32 capacity;
+    u64 bytes, start, gen;
+    int node, ret;
+
+    start = ktime_get_ns();
+    capacity = hips_replica_capacity(READ_ONCE(hips_config->hash_count));
+    bytes = hips_replica_bytes(capacity);
+
+    set = kzalloc(sizeof(*set) + nr_node_ids * sizeof(set->node[0]), GFP_KERNEL);
+    if (!set) {
+        return HIPS_ERROR_MEMORY;
+    }
+
+    // 每个副本在所属节点上分配（清零在锁外完成）
+    for_each_node_state(node, N_MEMORY) {
+        set->node[node] = vzalloc_node(bytes, node);
+        if (!set->node[node]) {
+            HIPS_WARN("无法在节点 %d 上分配摘要索引副本 (%llu 字节)", node,
+                      (unsigned long long)bytes);
+            hips_replica_free_set(set);
+            return HIPS_ERROR_MEMORY;
+        }
+        if (!set->primary) {
+            set->primary = set->node[node];
+        }
+        set->bytes += bytes;
+        set->nodes++;
+    }
+
+    // 摘要表的每次修改都在锁内递增代数：编译前后在锁内取到的代数相同，
+    // 说明遍历期间没有修改，副本与该代数的摘要表一致
+    spin_lock_bh(&hips_config->config_lock);
+    gen = hips_config->digest_gen;
+    spin_unlock_bh(&hips_config->config_lock);
+
+    ret = hips_replica_compile(set->primary, capacity);
+
+    spin_lock_bh(&hips_config->config_lock);
+    if (ret == HIPS_SUCCESS && hips_config->digest_gen != gen) {
+        ret = HIPS_ERROR_INVALID;
+    }
+    spin_unlock_bh(&hips_config->config_lock);
+    if (ret != HIPS_SUCCESS) {
+        // 分配或编译期间规则有变化，由下个周期按新的规则数重试
+        hips_replica_free_set(set);
+        return ret;
+    }
+    set->gen = gen;
+
+    for_each_node_state(node, N_MEMORY) {
+        if (set->node[node] != set->primary) {
+            memcpy(set->node[node], set->primary, bytes);
+        }
+    }
+
+    hips_replica_publish(set);
+    WRITE_ONCE(hips_replica_rebuilds, hips_replica_rebuilds + 1);
+    WRITE_ONCE(hips_replica_build_ns, ktime_get_ns() - start);
+
+    HIPS_DEBUG("摘要索引副本已更新: %u 条规则, %u 个节点, 共 %llu 字节", set->primary->count,
+               set->nodes, (unsigned long long)set->bytes);
+    return set->nodes;
+}
+
+// 过期工作项每个周期调用一次：未启用或没有哈希规则时撤下副本；
+// 摘要表与已发布的副本不同且上个周期之后没有再变化时重新编译
+void hips_replica_refresh(void)
+{
+    struct hips_replica_set *old;
+    u64 gen;
+
+    if (!hips_config) {
+        return;
+    }
+
+    old = rcu_dereference_protected(hips_config->replicas, 1);
+    if (!READ_ONCE(hips_numa_replicas) || !READ_ONCE(hips_config->hash_count)) {
+        if (old) {
+            hips_replica_publish(NULL);
+        }
+        return;
+    }
+
+    gen = READ_ONCE(hips_config->digest_gen);
+    if (old && old->gen == gen) {
+        return;
+    }
+    if (gen != hips_replica_seen_gen) {
+        hips_replica_seen_gen = gen;
+        return;
+    }
+
+    hips_replica_rebuild();
+}
+
+// 释放副本（清理规则或模块卸载时）
+void hips_replica_drop(void)
+{
+    if (hips_config && rcu_access_pointer(hips_config->replicas)) {
+        hips_replica_publish(NULL);
+    }
+}
+
+// 副本的内存占用和状态
+void hips_replica_get_stats(u32 *nodes, u64 *bytes, u32 *entries, bool *fresh, u64 *rebuilds,
+                            u64 *build_ns)
+{
+    struct hips_replica_set *set;
+
+    *nodes = 0;
+    *bytes = 0;
+    *entries = 0;
+    *fresh = false;
+
+    rcu_read_lock();
+    set = rcu_dereference(hips_config->replicas);
+    if (set) {
+        *nodes = set->nodes;
+        *bytes = set->bytes;
+        *entries = set->primary->count;
+        *fresh = set->gen == READ_ONCE(hips_config->digest_gen);
+    }
+    rcu_read_unlock();
+
+    *rebuilds = READ_ONCE(hips_replica_rebuilds);
+    *build_ns = READ_ONCE(hips_replica_build_ns);
+}
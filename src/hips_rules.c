@@ -0,0 +1,2027 @@
+#include "hips_common.h"
+
+// 规则计数器
+static atomic_t rule_id_counter = ATOMIC_INIT(0);
+
+static uint hips_hash_rule_bits = 16;
+module_param_named(hash_rule_bits, hips_hash_rule_bits, uint, 0444);
+MODULE_PARM_DESC(hash_rule_bits, "哈希规则摘要表的桶数（2 的幂次，8-24），加载百万级 IOC 摘要时建议 20");
+
+// 初始化规则表
+void hips_rules_init(void)
+{
+    int i;
+    
+    xa_init(&hips_config->rule_index);
+    hips_rule_set_init(&hips_config->global_sets[0], 0);
+    hips_rule_set_init(&hips_config->global_sets[1], 0);
+    hips_rule_set_init(&hips_config->global_sets[HIPS_CONFIG_SET], 0);
+    RCU_INIT_POINTER(hips_config->rules, &hips_config->global_sets[0]);
+    RCU_INIT_POINTER(hips_config->shadow, &hips_config->global_sets[1]);
+    INIT_LIST_HEAD(&hips_config->net_rule_sets);
+    hash_init(hips_config->cgroup_rule_sets);
+    hips_config->cgroup_set_count = 0;
+    hips_config->digest_table = NULL;
+    hips_config->hash_count = 0;
+    hips_config->digest_gen = 0;
+    RCU_INIT_POINTER(hips_config->replicas, NULL);
+    hips_config->path_table = NULL;
+    hips_config->rule_seq = 0;
+    
+    for (i = 0; i < HIPS_EXPIRE_WHEEL_SLOTS; i++) {
+        INIT_LIST_HEAD(&hips_config->expire_wheel[i]);
+    }
+    hips_config->expire_clock = 0;
+    hips_config->expire_next = 0;
+    hips_config->expire_count = 0;
+}
+
+// 初始化规则集
+void hips_rule_set_init(struct hips_rule_set *set, u32 netns_ino)
+{
+    INIT_LIST_HEAD(&set->list);
+    INIT_HLIST_NODE(&set->node);
+    INIT_LIST_HEAD(&set->exec_rules);
+    INIT_LIST_HEAD(&set->dns_rules);
+    INIT_LIST_HEAD(&set->network_rules);
+    INIT_LIST_HEAD(&set->hash_rules);
+    INIT_LIST_HEAD(&set->path_rules);
+    INIT_LIST_HEAD(&set->netcls_rules);
+    RCU_INIT_POINTER(set->paths.root, NULL);
+    set->paths.count = 0;
+    hips_netcls_init(&set->netcls);
+    set->netns_ino = netns_ino;
+    set->cgroup_id = 0;
+    set->rule_count = 0;
+    set->network_strings = 0;
+}
+
+// 根据规则类型选择规则集中的列表
+static struct list_head *hips_rule_set_list(struct hips_rule_set *set, u32 rule_type)
+{
+    switch (rule_type) {
+        case HIPS_RULE_EXEC:
+            return &set->exec_rules;
+        case HIPS_RULE_DNS:
+            return &set->dns_rules;
+        case HIPS_RULE_NETWORK:
+            return &set->network_rules;
+        case HIPS_RULE_HASH:
+            return &set->hash_rules;
+        default:
+            return NULL;
+    }
+}
+
+// 生效或影子全局规则集（调用者处于 RCU 读临界区或持有 config_lock）
+static struct hips_rule_set *hips_global_set(bool shadow)
+{
+    if (shadow) {
+        return rcu_dereference_check(hips_config->shadow,
+                                     lockdep_is_held(&hips_config->config_lock));
+    }
+    return rcu_dereference_check(hips_config->rules, lockdep_is_held(&hips_config->config_lock));
+}
+
+// 全局范围的配置文件规则集，不随提升交换，生效和影子匹配都叠加它
+static struct hips_rule_set *hips_config_set(void)
+{
+    return &hips_config->global_sets[HIPS_CONFIG_SET];
+}
+
+// 按 cgroup ID 查找规则集（调用者处于 RCU 读临界区或持有 config_lock），
+// 变空的 cgroup 规则集经 RCU 宽限期后才释放
+static struct hips_rule_set *hips_find_cgroup_rule_set(u64 cgroup_id)
+{
+    struct hips_rule_set *set;
+    
+    hash_for_each_possible_rcu(hips_config->cgroup_rule_sets, set, node, cgroup_id) {
+        if (set->cgroup_id == cgroup_id) {
+            return set;
+        }
+    }
+    
+    return NULL;
+}
+
+// 查找规则所属的规则集，不限范围时为全局规则集，配置文件规则放入配置文件规则集（调用者持有 config_lock）
+static struct hips_rule_set *hips_find_rule_set(const struct hips_rule *rule)
+{
+    struct hips_rule_set *set;
+    
+    if (rule->cgroup_id) {
+        return hips_find_cgroup_rule_set(rule->cgroup_id);
+    }
+    
+    if (rule->netns_ino == 0) {
+        if (rule->flags & HIPS_RULE_F_CONFIG) {
+            return hips_config_set();
+        }
+        return hips_deref_locked(hips_config->rules);
+    }
+    
+    list_for_each_entry(set, &hips_config->net_rule_sets, list) {
+        if (set->netns_ino == rule->netns_ino) {
+            return set;
+        }
+    }
+    
+    return NULL;
+}
+
+// 摘要表的桶数位数，模块参数只读，分配和查找时结果一致
+static u32 hips_digest_table_bits(void)
+{
+    return clamp(hips_hash_rule_bits, 8U, 24U);
+}
+
+// 摘要所在的摘要表桶，SHA-256 分布均匀，直接取前 4 字节。
+// 摘要表安装后直到清空规则表才释放，桶数在安装前写好
+static struct hlist_head *hips_digest_bucket(struct hlist_head *table, const u8 *digest)
+{
+    u32 key;
+    
+    memcpy(&key, digest, sizeof(key));
+    return &table[key & ((1U << hips_config->digest_bits) - 1)];
+}
+
+// 过期时间所在的时间轮格
+static struct list_head *hips_expire_slot(u64 expires_at)
+{
+    return &hips_config->expire_wheel[(expires_at / HIPS_EXPIRE_SLOT_SECS) %
+                                      HIPS_EXPIRE_WHEEL_SLOTS];
+}
+
+// 从过期时间轮上摘除规则（调用者持有 config_lock）
+static void hips_expire_unlink(struct hips_rule_entry *entry)
+{
+    if (!list_empty(&entry->expire_list)) {
+        list_del_init(&entry->expire_list);
+        hips_config->expire_count--;
+    }
+}
+
+static void hips_rule_entry_free_rcu(struct rcu_head *head)
+{
+    struct hips_rule_entry *entry = container_of(head, struct hips_rule_entry, rcu);
+    
+    free_percpu(entry->hits);
+    free_percpu(entry->limits);
+    kfree(entry);
+}
+
+// 无锁读者（ID 索引查询、命中计数、日志限速）可能仍在访问条目，经 RCU 宽限期后连同每 CPU 状态一起释放
+static void hips_rule_entry_free(struct hips_rule_entry *entry)
+{
+    call_rcu(&entry->rcu, hips_rule_entry_free_rcu);
+}
+
+// 从规则集和 ID 索引中移除并释放规则，cgroup 规则集空了之后从哈希表摘除并释放。
+// 匹配路径不持有 config_lock，可能仍在遍历条目和规则集：链表只用 RCU 方式摘除，
+// 条目的 list 成员不再复用，内存经 RCU 宽限期后才释放（调用者持有 config_lock）
+static void hips_unlink_rule(struct hips_rule_set *set, struct hips_rule_entry *entry)
+{
+    xa_erase(&hips_config->rule_index, entry->rule.rule_id);
+    list_del_rcu(&entry->list);
+    hips_expire_unlink(entry);
+    if (entry->tuple) {
+        hips_netcls_remove(&set->netcls, entry);
+        hips_config->netcls_count--;
+    } else if (entry->rule.rule_type == HIPS_RULE_NETWORK) {
+        WRITE_ONCE(set->network_strings, set->network_strings - 1);
+    }
+    if (entry->rule.rule_type == HIPS_RULE_HASH) {
+        hlist_del_init_rcu(&entry->cls_node);
+        WRITE_ONCE(hips_config->hash_count, hips_config->hash_count - 1);
+        hips_config->digest_gen++;
+    }
+    if (entry->path_node) {
+        hips_pathtrie_remove(&set->paths, entry);
+    }
+    WRITE_ONCE(set->rule_count, set->rule_count - 1);
+    hips_rule_entry_free(entry);
+    
+    if (set->cgroup_id && set->rule_count == 0) {
+        hash_del_rcu(&set->node);
+        WRITE_ONCE(hips_config->cgroup_set_count, hips_config->cgroup_set_count - 1);
+        kfree_rcu(set, rcu);
+    }
+}
+
+// 被摘除的 DNS 规则 ID：在 config_lock 内收集，解锁后使其学习到的动态 IP 失效
+struct hips_forget_ids {
+    u32 *ids;
+    int count;
+    int capacity;
+    bool overflow;          // 扩容失败，退回清空整张动态 IP 表
+};
+
+static void hips_forget_init(struct hips_forget_ids *forget, int capacity)
+{
+    forget->ids = capacity > 0 ? kmalloc_array(capacity, sizeof(u32), GFP_KERNEL) : NULL;
+    forget->count = 0;
+    forget->capacity = forget->ids ? capacity : 0;
+    forget->overflow = false;
+}
+
+// 记录即将摘除的规则（调用者持有 config_lock，须在 hips_unlink_rule 之前调用）
+static void hips_forget_push(struct hips_forget_ids *forget, const struct hips_rule_entry *entry)
+{
+    u32 *ids;
+    int capacity;
+
+    if (entry->rule.rule_type != HIPS_RULE_DNS || forget->overflow) {
+        return;
+    }
+
+    if (forget->count == forget->capacity) {
+        capacity = forget->capacity ? forget->capacity * 2 : 16;
+        ids = krealloc(forget->ids, capacity * sizeof(u32), GFP_ATOMIC);
+        if (!ids) {
+            forget->overflow = true;
+            return;
+        }
+        forget->ids = ids;
+        forget->capacity = capacity;
+    }
+    forget->ids[forget->count++] = entry->rule.rule_id;
+}
+
+// 解锁后调用：被删除的规则学习到的地址不能比规则本身活得更久
+static void hips_forget_commit(struct hips_forget_ids *forget)
+{
+    if (forget->overflow) {
+        HIPS_WARN("无法记录被删除的 DNS 规则，清空动态 IP 表");
+        hips_dynip_flush();
+    } else {
+        hips_dynip_forget(forget->ids, forget->count);
+    }
+    kfree(forget->ids);
+}
+
+// 注册命名空间规则集，之后可以向其中添加规则
+void hips_register_rule_set(struct hips_rule_set *set)
+{
+    spin_lock_bh(&hips_config->config_lock);
+    list_add_tail_rcu(&set->list, &hips_config->net_rule_sets);
+    spin_unlock_bh(&hips_config->config_lock);
+    
+    HIPS_DEBUG("注册规则集: netns=%u", set->netns_ino);
+}
+
+// 注销命名空间规则集并释放其中的规则
+void hips_unregister_rule_set(struct hips_rule_set *set)
+{
+    struct hips_rule_entry *entry, *tmp;
+    struct hips_forget_ids forget;
+    u32 type;
+    
+    hips_forget_init(&forget, 0);
+    
+    spin_lock_bh(&hips_config->config_lock);
+    list_del_rcu(&set->list);
+    for (type = HIPS_RULE_EXEC; type <= HIPS_RULE_HASH; type++) {
+        list_for_each_entry_safe(entry, tmp, hips_rule_set_list(set, type), list) {
+            hips_forget_push(&forget, entry);
+            hips_unlink_rule(set, entry);
+        }
+    }
+    list_for_each_entry_safe(entry, tmp, &set->path_rules, list) {
+        hips_unlink_rule(set, entry);
+    }
+    list_for_each_entry_safe(entry, tmp, &set->netcls_rules, list) {
+        hips_unlink_rule(set, entry);
+    }
+    spin_unlock_bh(&hips_config->config_lock);
+    
+    hips_forget_commit(&forget);
+    
+    HIPS_DEBUG("注销规则集: netns=%u", set->netns_ino);
+}
+
+// 添加规则前在锁外完成的准备：校验、分配条目以及可能需要的规则集和分类器元组
+struct hips_rule_prep {
+    struct hips_rule_entry *entry;
+    struct hips_rule_set *new_set;
+    struct hips_netcls_tuple *spare_tuple;
+    struct hlist_head *new_table;   // 摘要表尚未创建时预先分配
+    struct hips_path_node *path_chain;  // 目录规则在路径字典树中需要的节点
+    struct hlist_head *new_path_table;  // 字典树节点哈希表尚未创建时预先分配
+    bool id_reserved;               // 已在 ID 索引中预留规则 ID
+    bool shadow;                    // 加入影子规则集
+};
+
+// 释放准备阶段分配而未被使用的内存
+static void hips_rule_prep_free(struct hips_rule_prep *prep)
+{
+    // 条目未插入时取消其 ID 的预留
+    if (prep->entry && prep->id_reserved) {
+        xa_release(&hips_config->rule_index, prep->entry->rule.rule_id);
+    }
+    kfree(prep->entry);
+    kfree(prep->new_set);
+    hips_netcls_tuple_free(prep->spare_tuple);
+    kvfree(prep->new_table);
+    hips_pathtrie_free_spare(prep->path_chain);
+    kvfree(prep->new_path_table);
+    memset(prep, 0, sizeof(*prep));
+}
+
+// 规则内容哈希，不含规则 ID，字符串只计入有效部分
+static u32 hips_rule_hash(const struct hips_rule *rule)
+{
+    u32 hash;
+    
+    hash = jhash(rule->target, strnlen(rule->target, sizeof(rule->target)), rule->rule_type);
+    hash = jhash(rule->description, strnlen(rule->description, sizeof(rule->description)), hash);
+    hash = jhash_3words(rule->action, rule->priority, rule->flags, hash);
+    hash = jhash_3words(rule->netns_ino, (u32)rule->cgroup_id, (u32)(rule->cgroup_id >> 32), hash);
+    hash = jhash_2words((u32)rule->expires_at, (u32)(rule->expires_at >> 32), hash);
+    hash = jhash_2words(rule->log_sample, rule->log_rate, hash);
+    if (rule->flags & HIPS_RULE_F_STRUCTURED) {
+        hash = jhash(&rule->net, sizeof(rule->net), hash);
+    }
+    
+    return hash;
+}
+
+// 两条规则的内容是否相同（不比较规则 ID）
+static bool hips_rule_same(const struct hips_rule *a, const struct hips_rule *b)
+{
+    return a->rule_type == b->rule_type && a->action == b->action &&
+           a->priority == b->priority && a->flags == b->flags &&
+           a->netns_ino == b->netns_ino && a->cgroup_id == b->cgroup_id &&
+           a->expires_at == b->expires_at &&
+           a->log_sample == b->log_sample && a->log_rate == b->log_rate &&
+           strncmp(a->target, b->target, sizeof(a->target)) == 0 &&
+           strncmp(a->description, b->description, sizeof(a->description)) == 0 &&
+           (!(a->flags & HIPS_RULE_F_STRUCTURED) || memcmp(&a->net, &b->net, sizeof(a->net)) == 0);
+}
+
+// 解析哈希规则的十六进制摘要，并把目标统一写回小写形式
+static int hips_rule_parse_digest(struct hips_rule *rule, u8 *digest)
+{
+    if (strnlen(rule->target, sizeof(rule->target)) != HIPS_SHA256_SIZE * 2 ||
+        hex2bin(digest, rule->target, HIPS_SHA256_SIZE) < 0) {
+        return HIPS_ERROR_INVALID;
+    }
+    bin2hex(rule->target, digest, HIPS_SHA256_SIZE);
+    return HIPS_SUCCESS;
+}
+
+// 校验规则并分配内存，分配规则 ID（规范化后的匹配条件写回 rule）
+static int hips_rule_prepare(struct hips_rule *rule, struct hips_rule_prep *prep)
+{
+    u8 digest[HIPS_SHA256_SIZE];
+    int ret;
+    
+    memset(prep, 0, sizeof(*prep));
+    
+    if (!hips_rule_set_list(&hips_config->global_sets[0], rule->rule_type)) {
+        HIPS_ERROR("无效的规则类型: %u", rule->rule_type);
+        return HIPS_ERROR_INVALID;
+    }
+    
+    // 规则只能有一个作用范围
+    if (rule->netns_ino && rule->cgroup_id) {
+        HIPS_ERROR("规则不能同时限定网络命名空间和 cgroup");
+        return HIPS_ERROR_INVALID;
+    }
+    
+    // 影子规则集只有全局范围，配置文件规则始终生效。
+    // 标志不随规则保存，读取时按规则所在的规则集重新给出，提升后自然随之变化
+    if (rule->flags & HIPS_RULE_F_SHADOW) {
+        if (rule->netns_ino || rule->cgroup_id || (rule->flags & HIPS_RULE_F_CONFIG)) {
+            HIPS_ERROR("影子规则只能是全局范围的非配置文件规则");
+            return HIPS_ERROR_INVALID;
+        }
+        rule->flags &= ~HIPS_RULE_F_SHADOW;
+        prep->shadow = true;
+    }
+    
+    // 结构化网络规则先校验并规范化匹配条件
+    if (rule->flags & HIPS_RULE_F_STRUCTURED) {
+        if (rule->rule_type != HIPS_RULE_NETWORK ||
+            hips_netcls_normalize(&rule->net) != HIPS_SUCCESS) {
+            HIPS_ERROR("无效的结构化网络规则");
+            return HIPS_ERROR_INVALID;
+        }
+    }
+    
+    // 抽样和限速只作用于记录动作，其他动作的事件总是完整记录
+    if ((rule->log_sample > 1 || rule->log_rate) && rule->action != HIPS_ACTION_LOG) {
+        HIPS_ERROR("日志抽样和限速只适用于记录动作的规则");
+        return HIPS_ERROR_INVALID;
+    }
+    
+    // 哈希规则的目标必须是十六进制 SHA-256 摘要，统一写回小写形式
+    if (rule->rule_type == HIPS_RULE_HASH && hips_rule_parse_digest(rule, digest) != HIPS_SUCCESS) {
+        HIPS_ERROR("无效的 SHA-256 摘要: %.64s", rule->target);
+        return HIPS_ERROR_INVALID;
+    }
+    
+    // 分配规则条目
+    prep->entry = kzalloc(sizeof(struct hips_rule_entry), GFP_KERNEL);
+    if (!prep->entry) {
+        HIPS_ERROR("无法分配规则内存");
+        return HIPS_ERROR_MEMORY;
+    }
+    
+    // cgroup 规则集在第一条规则加入时创建，先在锁外分配
+    if (rule->cgroup_id) {
+        prep->new_set = kzalloc(sizeof(struct hips_rule_set), GFP_KERNEL);
+        if (!prep->new_set) {
+            HIPS_ERROR("无法分配规则集内存");
+            hips_rule_prep_free(prep);
+            return HIPS_ERROR_MEMORY;
+        }
+        hips_rule_set_init(prep->new_set, 0);
+        prep->new_set->cgroup_id = rule->cgroup_id;
+    }
+    
+    // 分类器可能需要新元组，同样先在锁外分配
+    if (rule->flags & HIPS_RULE_F_STRUCTURED) {
+        prep->spare_tuple = hips_netcls_tuple_alloc();
+        if (!prep->spare_tuple) {
+            HIPS_ERROR("无法分配分类器内存");
+            hips_rule_prep_free(prep);
+            return HIPS_ERROR_MEMORY;
+        }
+    }
+    
+    // 摘要表在第一条哈希规则加入时创建，同样先在锁外分配
+    if (rule->rule_type == HIPS_RULE_HASH && !READ_ONCE(hips_config->digest_table)) {
+        prep->new_table = kvcalloc(1U << hips_digest_table_bits(), sizeof(struct hlist_head),
+                                   GFP_KERNEL);
+        if (!prep->new_table) {
+            HIPS_ERROR("无法分配摘要表内存");
+            hips_rule_prep_free(prep);
+            return HIPS_ERROR_MEMORY;
+        }
+    }
+    
+    // 可按目录组件匹配的 exec 规则放进路径字典树，节点和节点哈希表同样先在锁外分配
+    if (rule->rule_type == HIPS_RULE_EXEC) {
+        ret = hips_pathtrie_alloc(rule->target, &prep->path_chain);
+        if (ret >= 0 && prep->path_chain && !READ_ONCE(hips_config->path_table)) {
+            prep->new_path_table = kvcalloc(1U << hips_pathtrie_table_bits(),
+                                            sizeof(struct hlist_head), GFP_KERNEL);
+            if (!prep->new_path_table) {
+                ret = HIPS_ERROR_MEMORY;
+            }
+        }
+        if (ret < 0) {
+            HIPS_ERROR("无法分配路径字典树内存");
+            hips_rule_prep_free(prep);
+            return HIPS_ERROR_MEMORY;
+        }
+    }
+    
+    // 在锁外预留 ID 的索引槽位，插入时不再分配内存。预留是排他的：
+    // 指定的 ID 已被使用或预留时失败，自动分配时跳过配置文件等指定占用的 ID
+    if (rule->rule_id) {
+        ret = xa_insert(&hips_config->rule_index, rule->rule_id, NULL, GFP_KERNEL);
+    } else {
+        do {
+            rule->rule_id = atomic_inc_return(&rule_id_counter);
+            ret = rule->rule_id ?
+                  xa_insert(&hips_config->rule_index, rule->rule_id, NULL, GFP_KERNEL) : -EBUSY;
+        } while (ret == -EBUSY);
+    }
+    if (ret < 0) {
+        hips_rule_prep_free(prep);
+        if (ret == -EBUSY) {
+            HIPS_ERROR("规则 ID 已存在: %u", rule->rule_id);
+            return HIPS_ERROR_EXISTS;
+        }
+        HIPS_ERROR("无法分配规则索引内存");
+        return HIPS_ERROR_MEMORY;
+    }
+    prep->id_reserved = true;
+    
+    // 复制规则数据
+    memcpy(&prep->entry->rule, rule, sizeof(struct hips_rule));
+    prep->entry->hash = hips_rule_hash(rule);
+    if (rule->rule_type == HIPS_RULE_HASH) {
+        memcpy(prep->entry->digest, digest, HIPS_SHA256_SIZE);
+    }
+    INIT_LIST_HEAD(&prep->entry->expire_list);
+    INIT_LIST_HEAD(&prep->entry->path_list);
+    
+    return HIPS_SUCCESS;
+}
+
+// 把准备好的规则插入规则表（调用者持有 config_lock），
+// 成功时条目归规则表所有，未用到的规则集和元组仍留在 prep 中由调用者释放
+static int hips_rule_insert(struct hips_rule_prep *prep)
+{
+    struct hips_rule_entry *entry = prep->entry;
+    struct hips_rule *rule = &entry->rule;
+    struct list_head *rule_list, *insert_after, *fwd, *rev;
+    struct hips_rule_set *set;
+    bool path_rule = prep->path_chain != NULL;
+    
+    // 已经过期的规则（例如情报源中的陈旧条目）不再加入
+    if (rule->expires_at && rule->expires_at <= hips_config->expire_clock) {
+        HIPS_WARN("规则已过期: 目标=%s, 过期时间=%llu", rule->target,
+                  (unsigned long long)rule->expires_at);
+        return HIPS_ERROR_INVALID;
+    }
+    
+    // 安装摘要表（准备之后被清空规则表释放时无法再插入）
+    if (rule->rule_type == HIPS_RULE_HASH && !hips_config->digest_table) {
+        if (!prep->new_table) {
+            HIPS_ERROR("摘要表不存在");
+            return HIPS_ERROR_MEMORY;
+        }
+        // 无锁读者先看到桶数再看到表
+        hips_config->digest_bits = hips_digest_table_bits();
+        smp_store_release(&hips_config->digest_table, prep->new_table);
+        prep->new_table = NULL;
+    }
+    
+    // 安装路径字典树节点哈希表，情形同摘要表
+    if (path_rule && !hips_config->path_table) {
+        if (!prep->new_path_table) {
+            HIPS_ERROR("路径字典树节点哈希表不存在");
+            return HIPS_ERROR_MEMORY;
+        }
+        hips_config->path_bits = hips_pathtrie_table_bits();
+        smp_store_release(&hips_config->path_table, prep->new_path_table);
+        prep->new_path_table = NULL;
+    }
+    
+    // 根据作用范围选择规则集
+    set = prep->shadow ? hips_global_set(true) : hips_find_rule_set(rule);
+    if (!set && prep->new_set) {
+        hash_add_rcu(hips_config->cgroup_rule_sets, &prep->new_set->node, prep->new_set->cgroup_id);
+        WRITE_ONCE(hips_config->cgroup_set_count, hips_config->cgroup_set_count + 1);
+        set = prep->new_set;
+        prep->new_set = NULL;
+    }
+    if (!set) {
+        HIPS_ERROR("未找到网络命名空间: %u", rule->netns_ino);
+        return HIPS_ERROR_NOT_FOUND;
+    }
+    entry->set = set;
+    entry->seq = ++hips_config->rule_seq;
+    if (path_rule) {
+        rule_list = &set->path_rules;
+    } else if (rule->flags & HIPS_RULE_F_STRUCTURED) {
+        rule_list = &set->netcls_rules;
+    } else {
+        rule_list = hips_rule_set_list(set, rule->rule_type);
+    }
+    
+    // 分类器的哈希表插入可能因原子分配失败，放在发布到列表和 ID 索引之前，失败时无需回退
+    if (rule->flags & HIPS_RULE_F_STRUCTURED) {
+        if (hips_netcls_insert(&set->netcls, entry, &prep->spare_tuple) != HIPS_SUCCESS) {
+            HIPS_ERROR("网络规则分类器插入失败: %u", rule->rule_id);
+            return HIPS_ERROR_MEMORY;
+        }
+        hips_config->netcls_count++;
+    }
+    
+    // 按优先级降序插入，同优先级保持添加顺序，匹配时第一条命中即为最高优先级。
+    // 从两端同时查找插入位置（最后一条优先级不低于新规则的条目之后），
+    // 开销只与优先级高于、低于新规则的两部分中较小的一部分相关
+    fwd = rule_list->next;
+    rev = rule_list->prev;
+    for (;;) {
+        if (rev == rule_list ||
+            list_entry(rev, struct hips_rule_entry, list)->rule.priority >= rule->priority) {
+            insert_after = rev;
+            break;
+        }
+        if (fwd == rule_list ||
+            list_entry(fwd, struct hips_rule_entry, list)->rule.priority < rule->priority) {
+            insert_after = fwd->prev;
+            break;
+        }
+        fwd = fwd->next;
+        rev = rev->prev;
+    }
+    list_add_rcu(&entry->list, insert_after);
+    WRITE_ONCE(set->rule_count, set->rule_count + 1);
+    
+    // 槽位已在准备阶段排他地预留，这里不会分配内存
+    xa_store(&hips_config->rule_index, rule->rule_id, entry, GFP_ATOMIC);
+    
+    if (rule->expires_at) {
+        list_add_tail(&entry->expire_list, hips_expire_slot(rule->expires_at));
+        hips_config->expire_count++;
+    }
+    
+    if (!(rule->flags & HIPS_RULE_F_STRUCTURED) && rule->rule_type == HIPS_RULE_NETWORK) {
+        WRITE_ONCE(set->network_strings, set->network_strings + 1);
+    }
+    
+    if (rule->rule_type == HIPS_RULE_HASH) {
+        hlist_add_head_rcu(&entry->cls_node,
+                           hips_digest_bucket(hips_config->digest_table, entry->digest));
+        WRITE_ONCE(hips_config->hash_count, hips_config->hash_count + 1);
+        hips_config->digest_gen++;
+    }
+    
+    if (path_rule) {
+        hips_pathtrie_insert(&set->paths, entry, &prep->path_chain);
+    }
+    prep->entry = NULL;
+    
+    HIPS_DEBUG("添加规则成功: ID=%u, 类型=%u, 目标=%s, netns=%u, cgroup=%llu", 
+              rule->rule_id, rule->rule_type, rule->target, rule->netns_ino,
+              (unsigned long long)rule->cgroup_id);
+    
+    return HIPS_SUCCESS;
+}
+
+// 添加规则
+int hips_add_rule(struct hips_rule *rule)
+{
+    struct hips_rule_prep prep;
+    int ret;
+    
+    if (!hips_config || !rule) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    ret = hips_rule_prepare(rule, &prep);
+    if (ret != HIPS_SUCCESS) {
+        return ret;
+    }
+    
+    spin_lock_bh(&hips_config->config_lock);
+    ret = hips_rule_insert(&prep);
+    spin_unlock_bh(&hips_config->config_lock);
+    
+    hips_rule_prep_free(&prep);
+    return ret;
+}
+
+// 批量添加规则：所有条目先在锁外准备好，再在一次加锁内全部插入，不会为每条规则各竞争一次锁。
+// 匹配路径不持有锁，插入过程中可能已经看到本批的一部分规则，每条规则各自生效
+// status[i] 为每条规则的 HIPS_SUCCESS 或错误码，返回成功添加的条数
+int hips_add_rules(struct hips_rule *rules, int count, int *status)
+{
+    struct hips_rule_prep *preps;
+    int added = 0, i;
+    
+    if (!hips_config || !rules || !status || count <= 0) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    preps = kvcalloc(count, sizeof(*preps), GFP_KERNEL);
+    if (!preps) {
+        return HIPS_ERROR_MEMORY;
+    }
+    
+    for (i = 0; i < count; i++) {
+        status[i] = hips_rule_prepare(&rules[i], &preps[i]);
+    }
+    
+    spin_lock_bh(&hips_config->config_lock);
+    for (i = 0; i < count; i++) {
+        if (status[i] == HIPS_SUCCESS) {
+            status[i] = hips_rule_insert(&preps[i]);
+        }
+        if (status[i] == HIPS_SUCCESS) {
+            added++;
+        }
+    }
+    spin_unlock_bh(&hips_config->config_lock);
+    
+    for (i = 0; i < count; i++) {
+        hips_rule_prep_free(&preps[i]);
+    }
+    kvfree(preps);
+    
+    return added;
+}
+
+// 从规则表中摘除并释放规则（调用者持有 config_lock）
+static int hips_rule_remove(u32 rule_id, struct hips_forget_ids *forget)
+{
+    struct hips_rule_entry *entry;
+    
+    entry = xa_load(&hips_config->rule_index, rule_id);
+    if (!entry) {
+        HIPS_WARN("未找到规则: ID=%u", rule_id);
+        return HIPS_ERROR_NOT_FOUND;
+    }
+    
+    hips_forget_push(forget, entry);
+    hips_unlink_rule(entry->set, entry);
+    
+    HIPS_DEBUG("删除规则成功: ID=%u", rule_id);
+    return HIPS_SUCCESS;
+}
+
+// 删除规则
+int hips_del_rule(u32 rule_id)
+{
+    int status;
+    
+    if (!hips_config) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    hips_del_rules(&rule_id, 1, &status);
+    return status;
+}
+
+// 批量删除规则，一次加锁内摘除全部规则，经 RCU 宽限期释放；status 与返回值同 hips_add_rules。
+// 被删除的 DNS 规则学习到的动态 IP 在解锁后一并失效
+int hips_del_rules(const u32 *rule_ids, int count, int *status)
+{
+    struct hips_forget_ids forget;
+    int removed = 0, i;
+    
+    if (!hips_config || !rule_ids || !status || count <= 0) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    hips_forget_init(&forget, count);
+    
+    spin_lock_bh(&hips_config->config_lock);
+    for (i = 0; i < count; i++) {
+        status[i] = hips_rule_remove(rule_ids[i], &forget);
+        if (status[i] == HIPS_SUCCESS) {
+            removed++;
+        }
+    }
+    spin_unlock_bh(&hips_config->config_lock);
+    
+    hips_forget_commit(&forget);
+    
+    return removed;
+}
+
+// 复制规则，影子规则集中的规则带上 HIPS_RULE_F_SHADOW（调用者处于 RCU 读临界区）
+static void hips_copy_rule(struct hips_rule *rule, const struct hips_rule_entry *entry)
+{
+    memcpy(rule, &entry->rule, sizeof(struct hips_rule));
+    if (entry->set == rcu_access_pointer(hips_config->shadow)) {
+        rule->flags |= HIPS_RULE_F_SHADOW;
+    }
+}
+
+// 获取规则：按 ID 索引查找，不持有 config_lock
+int hips_get_rule(u32 rule_id, struct hips_rule *rule)
+{
+    struct hips_rule_entry *entry;
+    
+    if (!hips_config || !rule) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    rcu_read_lock();
+    entry = xa_load(&hips_config->rule_index, rule_id);
+    if (entry) {
+        hips_copy_rule(rule, entry);
+    }
+    rcu_read_unlock();
+    
+    return entry ? HIPS_SUCCESS : HIPS_ERROR_NOT_FOUND;
+}
+
+// 分页导出：按 ID 升序复制 ID 不小于 start_id 的规则，最多 max 条，返回条数。
+// 沿 ID 索引遍历，不持有 config_lock，开销只与本页条数相关；
+// 调用者以最后一条的 ID + 1 作为下一页的起点
+int hips_dump_rules(u32 start_id, struct hips_rule *rules, int max)
+{
+    struct hips_rule_entry *entry;
+    unsigned long index = start_id;
+    int count = 0;
+    
+    if (!hips_config || !rules || max <= 0) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    rcu_read_lock();
+    entry = xa_find(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+    while (entry) {
+        hips_copy_rule(&rules[count], entry);
+        if (++count == max) {
+            break;
+        }
+        entry = xa_find_after(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+    }
+    rcu_read_unlock();
+    
+    return count;
+}
+
+/*
+ * 配置文件增量重载
+ *
+ * 新配置的每条规则按内容哈希放入临时哈希表，再沿 ID 索引遍历现有的配置规则（HIPS_RULE_F_CONFIG）：
+ * 内容相同（指定了 ID 时 ID 也相同）的保留，其余删除；新配置中没有对应现有规则的添加。
+ * 未变化的规则不重新分配、不离开规则表，网络分类器和动态 IP 表不受影响；
+ * 分配、加锁和插入删除的开销只与变化的规则数相关。
+ * 遍历分段进行，每段在 RCU 下按哈希暂定配对，离开 RCU 后再解析规则行核对内容，
+ * 哈希冲突导致的误配对会被撤销。
+ * 先添加与现有规则 ID 不冲突的新规则，再删除，最后添加沿用被删除规则 ID 的新规则，
+ * 修改内容的规则不会出现无规则生效的间隙（指定 ID 的规则除外）。
+ */
+
+#define HIPS_SYNC_SCAN  64      // 每段 RCU 读临界区遍历的规则数
+
+enum {
+    HIPS_SYNC_SKIP,             // 空行、注释或格式错误
+    HIPS_SYNC_NEW,              // 需要添加
+    HIPS_SYNC_DEFERRED,         // 需要添加，但 ID 仍被将要删除的规则占用
+    HIPS_SYNC_KEPT,             // 与现有规则相同
+};
+
+struct hips_sync_node {
+    struct hlist_node node;
+    u32 hash;
+    u32 rule_id;                // 配置中指定的 ID，0 表示自动分配
+    u8 state;
+};
+
+// 现有规则与新规则的暂定配对，node 为 -1 表示删除
+struct hips_sync_pair {
+    u32 rule_id;
+    s32 node;
+};
+
+// 解析配置行并做与 hips_rule_prepare 相同的规范化，内容哈希和比较才能与已生效的副本一致
+// （例如大写的摘要在生效的规则中已写回小写形式）
+static int hips_sync_parse(const char *line, struct hips_rule *rule)
+{
+    u8 digest[HIPS_SHA256_SIZE];
+    int ret = hips_parse_rule(line, rule);
+    
+    if (ret == 0) {
+        rule->flags |= HIPS_RULE_F_CONFIG;
+        // 无效的摘要保持原样，添加时由 hips_rule_prepare 报错
+        if (rule->rule_type == HIPS_RULE_HASH) {
+            hips_rule_parse_digest(rule, digest);
+        }
+    }
+    return ret;
+}
+
+// 在哈希表中为现有规则找一条内容哈希相同、尚未配对的新规则
+static s32 hips_sync_lookup(struct hlist_head *table, u32 mask, struct hips_sync_node *nodes,
+                            const struct hips_rule_entry *entry)
+{
+    struct hips_sync_node *node;
+    
+    hlist_for_each_entry(node, &table[entry->hash & mask], node) {
+        if (node->hash == entry->hash && node->state == HIPS_SYNC_NEW &&
+            (node->rule_id == 0 || node->rule_id == entry->rule.rule_id)) {
+            return node - nodes;
+        }
+    }
+    
+    return -1;
+}
+
+// 追加待删除的规则 ID，按需扩容
+static int hips_sync_push(u32 **ids, u32 *count, u32 *capacity, u32 rule_id)
+{
+    u32 *grown;
+    
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 256;
+        grown = kvmalloc_array(*capacity, sizeof(u32), GFP_KERNEL);
+        if (!grown) {
+            return HIPS_ERROR_MEMORY;
+        }
+        if (*count) {
+            memcpy(grown, *ids, *count * sizeof(u32));
+        }
+        kvfree(*ids);
+        *ids = grown;
+    }
+    (*ids)[(*count)++] = rule_id;
+    
+    return HIPS_SUCCESS;
+}
+
+// 分批添加处于 state 状态的新规则，每批一次加锁
+static void hips_sync_add(const char *const *lines, struct hips_sync_node *nodes, int count,
+                          u8 state, struct hips_rule *chunk, int *status,
+                          struct hips_rule_delta *delta)
+{
+    int i = 0, n, j;
+    
+    while (i < count) {
+        for (n = 0; i < count && n < HIPS_BATCH_MAX; i++) {
+            if (nodes[i].state == state && hips_sync_parse(lines[i], &chunk[n]) == 0) {
+                n++;
+            }
+        }
+        if (n == 0) {
+            break;
+        }
+        
+        hips_add_rules(chunk, n, status);
+        for (j = 0; j < n; j++) {
+            if (status[j] == HIPS_SUCCESS) {
+                delta->added++;
+            } else {
+                HIPS_WARN("重新加载: 添加规则失败: 目标=%s (%d)", chunk[j].target, status[j]);
+                delta->failed++;
+            }
+        }
+    }
+}
+
+// 用配置文件中的规则行增量替换现有的配置规则；delta->removed_ids 由调用者 kvfree
+int hips_sync_config_rules(const char *const *lines, int count, struct hips_rule_delta *delta)
+{
+    struct hips_sync_node *nodes = NULL;
+    struct hlist_head *table = NULL;
+    struct hips_sync_pair pairs[HIPS_SYNC_SCAN];
+    struct hips_rule_entry *entry;
+    struct hips_rule *chunk = NULL, *rule;
+    unsigned long index = 0;
+    u32 del_count = 0, del_capacity = 0, mask, bits;
+    u32 *del_ids = NULL;
+    int *status = NULL;
+    int ret = HIPS_ERROR_MEMORY;
+    int i, n, scanned, done, removed;
+    
+    memset(delta, 0, sizeof(*delta));
+    if (!hips_config || count < 0 || (count && !lines)) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    // 哈希表大小取不小于规则行数的 2 的幂，最多 2^20 个桶
+    bits = 4;
+    while (bits < 20 && (1U << bits) < (u32)count) {
+        bits++;
+    }
+    mask = (1U << bits) - 1;
+    
+    nodes = kvcalloc(max(count, 1), sizeof(*nodes), GFP_KERNEL);
+    table = kvcalloc(mask + 1, sizeof(*table), GFP_KERNEL);
+    chunk = kvcalloc(HIPS_BATCH_MAX, sizeof(*chunk), GFP_KERNEL);
+    status = kvcalloc(HIPS_BATCH_MAX, sizeof(*status), GFP_KERNEL);
+    if (!nodes || !table || !chunk || !status) {
+        goto out;
+    }
+    rule = &chunk[0];
+    
+    // 解析新配置，格式错误的行跳过
+    for (i = 0; i < count; i++) {
+        ret = hips_sync_parse(lines[i], rule);
+        if (ret != 0) {
+            if (ret < 0) {
+                HIPS_WARN("重新加载: 无法解析规则行: %s", lines[i]);
+                delta->failed++;
+            }
+            nodes[i].state = HIPS_SYNC_SKIP;
+            continue;
+        }
+        nodes[i].hash = hips_rule_hash(rule);
+        nodes[i].rule_id = rule->rule_id;
+        nodes[i].state = HIPS_SYNC_NEW;
+        hlist_add_head(&nodes[i].node, &table[nodes[i].hash & mask]);
+    }
+    
+    // 分段遍历现有规则：RCU 下按哈希暂定配对，离开 RCU 后核对内容
+    done = 0;
+    while (!done) {
+        n = 0;
+        scanned = 0;
+        rcu_read_lock();
+        entry = xa_find(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+        while (entry && n < HIPS_SYNC_SCAN && scanned++ < HIPS_SYNC_SCAN * 16) {
+            if (entry->rule.flags & HIPS_RULE_F_CONFIG) {
+                pairs[n].rule_id = entry->rule.rule_id;
+                pairs[n].node = hips_sync_lookup(table, mask, nodes, entry);
+                if (pairs[n].node >= 0) {
+                    nodes[pairs[n].node].state = HIPS_SYNC_KEPT;
+                }
+                n++;
+            }
+            entry = xa_find_after(&hips_config->rule_index, &index, U32_MAX, XA_PRESENT);
+        }
+        rcu_read_unlock();
+        done = !entry;
+        
+        for (i = 0; i < n; i++) {
+            s32 node = pairs[i].node;
+            struct hips_rule *live = &chunk[1];
+            
+            if (node >= 0) {
+                if (hips_get_rule(pairs[i].rule_id, live) != HIPS_SUCCESS) {
+                    // 期间已被删除或过期，新规则仍需添加
+                    nodes[node].state = HIPS_SYNC_NEW;
+                    continue;
+                }
+                if (hips_sync_parse(lines[node], rule) == 0 && hips_rule_same(rule, live)) {
+                    delta->kept++;
+                    continue;
+                }
+                nodes[node].state = HIPS_SYNC_NEW;
+            }
+            ret = hips_sync_push(&del_ids, &del_count, &del_capacity, pairs[i].rule_id);
+            if (ret != HIPS_SUCCESS) {
+                goto out;
+            }
+        }
+        cond_resched();
+    }
+    
+    // 指定了 ID 且该 ID 仍被（将要删除的）现有规则占用的新规则推迟到删除之后添加
+    for (i = 0; i < count; i++) {
+        if (nodes[i].state == HIPS_SYNC_NEW && nodes[i].rule_id &&
+            hips_get_rule(nodes[i].rule_id, rule) == HIPS_SUCCESS) {
+            nodes[i].state = HIPS_SYNC_DEFERRED;
+        }
+    }
+    
+    hips_sync_add(lines, nodes, count, HIPS_SYNC_NEW, chunk, status, delta);
+    
+    // 分批删除（动态 IP 由 hips_del_rules 使之失效），只保留确实删除了的 ID
+    removed = 0;
+    for (i = 0; i < del_count; i += HIPS_BATCH_MAX) {
+        int batch = min_t(int, del_count - i, HIPS_BATCH_MAX);
+        int j;
+        
+        hips_del_rules(&del_ids[i], batch, status);
+        for (j = 0; j < batch; j++) {
+            if (status[j] == HIPS_SUCCESS) {
+                del_ids[removed++] = del_ids[i + j];
+            }
+        }
+    }
+    delta->removed = removed;
+    
+    hips_sync_add(lines, nodes, count, HIPS_SYNC_DEFERRED, chunk, status, delta);
+    
+    delta->removed_ids = del_ids;
+    del_ids = NULL;
+    ret = HIPS_SUCCESS;
+    
+out:
+    kvfree(del_ids);
+    kvfree(status);
+    kvfree(chunk);
+    kvfree(table);
+    kvfree(nodes);
+    return ret;
+}
+
+// 在单个列表中查找第一条命中的规则，跳过已过期但尚未回收的规则（调用者处于 RCU 读临界区）
+static struct hips_rule_entry *hips_match_list(struct list_head *rule_list, u32 rule_type,
+                                               const char *target, u64 clock)
+{
+    struct hips_rule_entry *entry;
+    
+    list_for_each_entry_rcu(entry, rule_list, list) {
+        if (entry->rule.expires_at && entry->rule.expires_at <= clock) {
+            continue;
+        }
+        if (entry->rule.rule_type == rule_type &&
+            hips_match_pattern(entry->rule.target, target)) {
+            return entry;
+        }
+    }
+    
+    return NULL;
+}
+
+// 在单个规则集中匹配：exec 规则先走路径字典树，再逐条匹配字典树之外的规则，
+// 两部分按优先级和加入顺序合并。字典树查找不完整时连同目录规则一起逐条匹配（调用者处于 RCU 读临界区）
+static struct hips_rule_entry *hips_match_set(struct hips_rule_set *set, u32 rule_type,
+                                              const char *target, u64 clock)
+{
+    struct hips_rule_entry *entry = NULL, *listed;
+    
+    if (rule_type == HIPS_RULE_EXEC && READ_ONCE(set->paths.count) &&
+        !hips_pathtrie_lookup(&set->paths, target, clock, &entry)) {
+        entry = hips_match_list(&set->path_rules, rule_type, target, clock);
+    }
+    
+    listed = hips_match_list(hips_rule_set_list(set, rule_type), rule_type, target, clock);
+    if (listed && (!entry || hips_rule_precedes(listed, entry))) {
+        entry = listed;
+    }
+    
+    return entry;
+}
+
+// 按匹配结果合并：取优先级最高者，同优先级时先传入的（范围更小的）规则优先
+static struct hips_rule_entry *hips_match_better(struct hips_rule_entry *best,
+                                                 struct hips_rule_entry *entry)
+{
+    if (entry && (!best || entry->rule.priority > best->rule.priority)) {
+        return entry;
+    }
+    return best;
+}
+
+static int hips_match_digest_in(struct hips_rule_set *net_set, u64 cgroup_id, const u8 *digest,
+                                struct hips_rule *matched_rule, bool shadow);
+
+// 匹配规则：cgroup 和网络命名空间规则集叠加在全局规则集之上，取优先级最高的命中。
+// shadow 为真时全局规则集取影子规则集（影子规则只有全局范围，net_set 为 NULL、cgroup_id 为 0）。
+// 配置文件规则集排在全局规则集之后，同优先级时全局规则优先
+static int hips_match_rule_in(struct hips_rule_set *net_set, u64 cgroup_id, u32 rule_type,
+                              const char *target, struct hips_rule *matched_rule, bool shadow)
+{
+    struct hips_rule_entry *entry = NULL;
+    struct hips_rule_set *cgroup_set;
+    char path[256];
+    size_t len;
+    u64 clock;
+    
+    if (!hips_config || !target || !matched_rule) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    if (!hips_rule_set_list(&hips_config->global_sets[0], rule_type)) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    // 哈希规则按摘要查表，target 为十六进制摘要
+    if (rule_type == HIPS_RULE_HASH) {
+        u8 digest[HIPS_SHA256_SIZE];
+        
+        if (hex2bin(digest, target, HIPS_SHA256_SIZE) < 0) {
+            return HIPS_ERROR_INVALID;
+        }
+        return hips_match_digest_in(net_set, cgroup_id, digest, matched_rule, shadow);
+    }
+    
+    // exec 路径先做词法规范化，"."、".." 和重复的 '/' 无法绕过目录规则。
+    // exec 钩子传入的已是规范路径，这里只在可能需要时复制
+    if (rule_type == HIPS_RULE_EXEC) {
+        len = strlen(target);
+        if ((target[0] == '.' || strstr(target, "//") || strstr(target, "/.") ||
+             (len > 1 && target[len - 1] == '/')) &&
+            hips_path_canonicalize(target, path, sizeof(path)) == 0) {
+            target = path;
+        }
+    }
+    
+    // 匹配路径只是读者：规则表的链表、字典树和 cgroup 规则集哈希表都按 RCU 方式读取，
+    // config_lock 只由修改者获取，exec 和 DNS 钩子之间、钩子与规则更新之间互不阻塞
+    rcu_read_lock();
+    clock = READ_ONCE(hips_config->expire_clock);
+    
+    // cgroup 规则集按 ID 哈希查找，只遍历该 cgroup 自己的规则
+    if (cgroup_id && READ_ONCE(hips_config->cgroup_set_count)) {
+        cgroup_set = hips_find_cgroup_rule_set(cgroup_id);
+        if (cgroup_set) {
+            entry = hips_match_set(cgroup_set, rule_type, target, clock);
+        }
+    }
+    
+    // 命名空间规则集为空时不遍历，开销只与该命名空间自己的规则数相关
+    if (net_set && net_set != hips_global_set(false) && READ_ONCE(net_set->rule_count)) {
+        entry = hips_match_better(entry, hips_match_set(net_set, rule_type, target, clock));
+    }
+    
+    entry = hips_match_better(entry, hips_match_set(hips_global_set(shadow), rule_type, target,
+                                                    clock));
+    if (READ_ONCE(hips_config_set()->rule_count)) {
+        entry = hips_match_better(entry, hips_match_set(hips_config_set(), rule_type, target,
+                                                        clock));
+    }
+    
+    if (entry) {
+        // 条目经 RCU 宽限期后才释放，在读临界区内复制，无需持有引用
+        memcpy(matched_rule, &entry->rule, sizeof(struct hips_rule));
+    }
+    
+    rcu_read_unlock();
+    return entry ? HIPS_SUCCESS : HIPS_ERROR_NOT_FOUND;
+}
+
+// 匹配规则，net_set 为 NULL、cgroup_id 为 0 时只匹配全局规则集
+int hips_match_rule_scoped(struct hips_rule_set *net_set, u64 cgroup_id, u32 rule_type,
+                           const char *target, struct hips_rule *matched_rule)
+{
+    return hips_match_rule_in(net_set, cgroup_id, rule_type, target, matched_rule, false);
+}
+
+// 匹配网络规则：字符串规则（target 非空时）和结构化规则一起参与优先级比较，
+// 作用范围的叠加方式与 hips_match_rule_in 相同
+static int hips_match_network_in(struct hips_rule_set *net_set, u64 cgroup_id,
+                                 const struct hips_net_key *key, const char *target,
+                                 struct hips_rule *matched_rule, bool shadow)
+{
+    struct hips_rule_entry *entry = NULL;
+    struct hips_rule_set *sets[4], *global;
+    int i, count = 0;
+    u64 clock;
+    
+    if (!hips_config || !key || !matched_rule) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    // 网络钩子（包括 ingress 上的每个报文）只在 RCU 读临界区内查找，不获取 config_lock
+    rcu_read_lock();
+    clock = READ_ONCE(hips_config->expire_clock);
+    global = hips_global_set(shadow);
+    
+    // 按范围从小到大排列，同优先级时先出现的规则优先
+    if (cgroup_id && READ_ONCE(hips_config->cgroup_set_count)) {
+        sets[count] = hips_find_cgroup_rule_set(cgroup_id);
+        if (sets[count]) {
+            count++;
+        }
+    }
+    if (net_set && net_set != global && READ_ONCE(net_set->rule_count)) {
+        sets[count++] = net_set;
+    }
+    sets[count++] = global;
+    if (READ_ONCE(hips_config_set()->rule_count)) {
+        sets[count++] = hips_config_set();
+    }
+    
+    for (i = 0; i < count; i++) {
+        if (target && READ_ONCE(sets[i]->network_strings)) {
+            entry = hips_match_better(entry, hips_match_list(&sets[i]->network_rules,
+                                                             HIPS_RULE_NETWORK, target, clock));
+        }
+        entry = hips_netcls_lookup(&sets[i]->netcls, key, clock, entry);
+    }
+    
+    // 条目经 RCU 宽限期后才释放，在读临界区内复制即可
+    if (entry) {
+        memcpy(matched_rule, &entry->rule, sizeof(struct hips_rule));
+    }
+    
+    rcu_read_unlock();
+    return entry ? HIPS_SUCCESS : HIPS_ERROR_NOT_FOUND;
+}
+
+int hips_match_network(struct hips_rule_set *net_set, u64 cgroup_id, const struct hips_net_key *key,
+                       const char *target, struct hips_rule *matched_rule)
+{
+    return hips_match_network_in(net_set, cgroup_id, key, target, matched_rule, false);
+}
+
+// 调用者所在范围（以及 shadow 为 true 时的影子规则集）是否有字符串网络规则。
+// 没有时网络钩子不必把地址格式化成字符串，直接以 target 为 NULL 匹配
+bool hips_network_strings(struct hips_rule_set *net_set, u64 cgroup_id, bool shadow)
+{
+    struct hips_rule_set *cgroup_set;
+    bool found = false;
+    
+    if (!hips_config) {
+        return false;
+    }
+    
+    rcu_read_lock();
+    if (READ_ONCE(hips_global_set(false)->network_strings) ||
+        READ_ONCE(hips_config_set()->network_strings) ||
+        (shadow && READ_ONCE(hips_global_set(true)->network_strings)) ||
+        (net_set && READ_ONCE(net_set->network_strings))) {
+        found = true;
+    } else if (cgroup_id && READ_ONCE(hips_config->cgroup_set_count)) {
+        cgroup_set = hips_find_cgroup_rule_set(cgroup_id);
+        found = cgroup_set && READ_ONCE(cgroup_set->network_strings);
+    }
+    rcu_read_unlock();
+    
+    return found;
+}
+
+// 按文件摘要匹配哈希规则：摘要表覆盖所有规则集，只有调用者所在范围的规则参与比较，
+// 开销是一次哈希定位加桶内比较，与哈希规则总数无关。优先级规则与 hips_match_rule_in 相同
+static int hips_match_digest_in(struct hips_rule_set *net_set, u64 cgroup_id, const u8 *digest,
+                                struct hips_rule *matched_rule, bool shadow)
+{
+    struct hips_rule_entry *entry, *best = NULL;
+    struct hips_rule_set *sets[4], *global;
+    struct hlist_head *table;
+    int i, count = 0, best_scope = 0;
+    u64 clock;
+    
+    if (!hips_config || !digest || !matched_rule) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    // 摘要表桶是 RCU 链表，与 hips_match_rule_in 一样只在 RCU 读临界区内查找
+    table = smp_load_acquire(&hips_config->digest_table);
+    if (!table || !READ_ONCE(hips_config->hash_count)) {
+        return HIPS_ERROR_NOT_FOUND;
+    }
+    
+    rcu_read_lock();
+    clock = READ_ONCE(hips_config->expire_clock);
+    global = hips_global_set(shadow);
+    
+    // 按范围从小到大排列，同优先级时范围小的规则优先
+    if (cgroup_id && READ_ONCE(hips_config->cgroup_set_count)) {
+        sets[count] = hips_find_cgroup_rule_set(cgroup_id);
+        if (sets[count]) {
+            count++;
+        }
+    }
+    if (net_set && net_set != global && READ_ONCE(net_set->rule_count)) {
+        sets[count++] = net_set;
+    }
+    sets[count++] = global;
+    sets[count++] = hips_config_set();
+    
+    hlist_for_each_entry_rcu(entry, hips_digest_bucket(table, digest), cls_node) {
+        if (memcmp(entry->digest, digest, HIPS_SHA256_SIZE) != 0) {
+            continue;
+        }
+        if (entry->rule.expires_at && entry->rule.expires_at <= clock) {
+            continue;
+        }
+        for (i = 0; i < count && sets[i] != entry->set; i++) {
+        }
+        if (i == count) {
+            continue;
+        }
+        if (!best || entry->rule.priority > best->rule.priority ||
+            (entry->rule.priority == best->rule.priority && i < best_scope)) {
+            best = entry;
+            best_scope = i;
+        }
+    }
+    
+    if (best) {
+        memcpy(matched_rule, &best->rule, sizeof(struct hips_rule));
+    }
+    
+    rcu_read_unlock();
+    return best ? HIPS_SUCCESS : HIPS_ERROR_NOT_FOUND;
+}
+
+// 启用 NUMA 副本时先查本节点的副本，副本未发布或已过时再查摘要表
+int hips_match_digest(struct hips_rule_set *net_set, u64 cgroup_id, const u8 *digest,
+                      struct hips_rule *matched_rule)
+{
+    int ret;
+    
+    if (!hips_config || !digest || !matched_rule) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    ret = hips_replica_match(net_set, cgroup_id, digest, matched_rule);
+    if (ret != HIPS_ERROR_INVALID) {
+        return ret;
+    }
+    
+    return hips_match_digest_in(net_set, cgroup_id, digest, matched_rule, false);
+}
+
+// 匹配全局规则
+int hips_match_rule(u32 rule_type, const char *target, struct hips_rule *matched_rule)
+{
+    return hips_match_rule_scoped(NULL, 0, rule_type, target, matched_rule);
+}
+
+/*
+ * 影子规则集
+ *
+ * 新情报源先以影子规则加入（HIPS_RULE_F_SHADOW），与生效规则集共用 ID 索引、摘要表和字典树节点表，
+ * 但匹配函数只在调用者抽样的事件上单独查询，结果只用于比较，不执行。
+ * 提升时在锁内交换生效和影子两个全局规则集指针，条目不移动；原生效规则集成为影子规则集，
+ * 再提升一次即可回退。配置文件规则在单独的规则集中，生效和影子匹配都叠加它，提升不交换也不重新加载；
+ * 命名空间和 cgroup 规则集同样不交换，影子匹配与生效匹配一样叠加调用者所在范围的规则集。
+ */
+
+// 以影子规则集代替生效的全局规则集匹配，调用者所在的命名空间、cgroup 规则集和配置文件规则照常叠加，
+// 作用范围内的规则不会被误报为分歧
+int hips_shadow_match_rule(struct hips_rule_set *net_set, u64 cgroup_id, u32 rule_type,
+                           const char *target, struct hips_rule *matched_rule)
+{
+    return hips_match_rule_in(net_set, cgroup_id, rule_type, target, matched_rule, true);
+}
+
+int hips_shadow_match_network(struct hips_rule_set *net_set, u64 cgroup_id,
+                              const struct hips_net_key *key, const char *target,
+                              struct hips_rule *matched_rule)
+{
+    return hips_match_network_in(net_set, cgroup_id, key, target, matched_rule, true);
+}
+
+int hips_shadow_match_digest(struct hips_rule_set *net_set, u64 cgroup_id, const u8 *digest,
+                             struct hips_rule *matched_rule)
+{
+    return hips_match_digest_in(net_set, cgroup_id, digest, matched_rule, true);
+}
+
+// 影子规则集中的规则数，抽样前判断是否需要评估
+u32 hips_shadow_rule_count(void)
+{
+    u32 count;
+    
+    if (!hips_config) {
+        return 0;
+    }
+    
+    rcu_read_lock();
+    count = READ_ONCE(rcu_dereference(hips_config->shadow)->rule_count);
+    rcu_read_unlock();
+    
+    return count;
+}
+
+// 提升影子规则集：交换两个全局规则集，返回提升的规则数。影子规则集为空时拒绝，
+// 避免误操作清空生效规则。离开生效规则集的 DNS 规则学到的动态 IP 随之遗忘
+int hips_shadow_promote(void)
+{
+    struct hips_rule_set *live, *shadow;
+    struct hips_rule_entry *entry;
+    struct hips_forget_ids forget;
+    int count;
+    
+    if (!hips_config) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    hips_forget_init(&forget, 0);
+    
+    spin_lock_bh(&hips_config->config_lock);
+    live = hips_global_set(false);
+    shadow = hips_global_set(true);
+    count = shadow->rule_count;
+    if (count == 0) {
+        spin_unlock_bh(&hips_config->config_lock);
+        return HIPS_ERROR_NOT_FOUND;
+    }
+    list_for_each_entry(entry, &live->dns_rules, list) {
+        hips_forget_push(&forget, entry);
+    }
+    rcu_assign_pointer(hips_config->rules, shadow);
+    rcu_assign_pointer(hips_config->shadow, live);
+    spin_unlock_bh(&hips_config->config_lock);
+    
+    hips_forget_commit(&forget);
+    
+    HIPS_INFO("影子规则集已提升为生效规则集: %d 条规则", count);
+    return count;
+}
+
+// 清空影子规则集，返回删除的规则数
+int hips_shadow_clear(void)
+{
+    struct hips_rule_entry *entry, *tmp;
+    struct hips_forget_ids forget;
+    struct hips_rule_set *set;
+    u32 type;
+    int count = 0;
+    
+    if (!hips_config) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    hips_forget_init(&forget, 0);
+    
+    // 全局规则集不会变空释放，只释放条目
+    spin_lock_bh(&hips_config->config_lock);
+    set = hips_global_set(true);
+    for (type = HIPS_RULE_EXEC; type <= HIPS_RULE_HASH; type++) {
+        list_for_each_entry_safe(entry, tmp, hips_rule_set_list(set, type), list) {
+            hips_forget_push(&forget, entry);
+            hips_unlink_rule(set, entry);
+            count++;
+        }
+    }
+    list_for_each_entry_safe(entry, tmp, &set->path_rules, list) {
+        hips_unlink_rule(set, entry);
+        count++;
+    }
+    list_for_each_entry_safe(entry, tmp, &set->netcls_rules, list) {
+        hips_unlink_rule(set, entry);
+        count++;
+    }
+    spin_unlock_bh(&hips_config->config_lock);
+    
+    hips_forget_commit(&forget);
+    
+    HIPS_DEBUG("清空影子规则集: %d 条规则", count);
+    return count;
+}
+
+// 规则过期处理：先推进过期水位，所有到期规则在同一时刻退出匹配，
+// 再扫描时间轮上已经走过的格，一次加锁批量摘除。返回回收的规则数
+int hips_expire_rules(u64 now)
+{
+    struct hips_rule_entry *entry, *tmp;
+    struct hips_forget_ids forget;
+    u64 slot, last;
+    int count = 0;
+    
+    if (!hips_config) {
+        return 0;
+    }
+    
+    hips_forget_init(&forget, 0);
+    
+    spin_lock_bh(&hips_config->config_lock);
+    
+    if (now <= hips_config->expire_clock) {
+        spin_unlock_bh(&hips_config->config_lock);
+        return 0;
+    }
+    WRITE_ONCE(hips_config->expire_clock, now);
+    
+    if (hips_config->expire_count == 0) {
+        hips_config->expire_next = now;
+        spin_unlock_bh(&hips_config->config_lock);
+        return 0;
+    }
+    
+    // 从上次回收的格走到当前格，落后超过一圈时每格只需走一次
+    slot = hips_config->expire_next / HIPS_EXPIRE_SLOT_SECS;
+    last = now / HIPS_EXPIRE_SLOT_SECS;
+    if (last - slot >= HIPS_EXPIRE_WHEEL_SLOTS) {
+        slot = last - HIPS_EXPIRE_WHEEL_SLOTS + 1;
+    }
+    
+    for (; slot <= last; slot++) {
+        list_for_each_entry_safe(entry, tmp,
+                                 &hips_config->expire_wheel[slot % HIPS_EXPIRE_WHEEL_SLOTS],
+                                 expire_list) {
+            // 当前格中尚未到期的规则以及一圈之后才到期的规则留在原处
+            if (entry->rule.expires_at > now) {
+                continue;
+            }
+            hips_forget_push(&forget, entry);
+            hips_unlink_rule(entry->set, entry);
+            count++;
+        }
+    }
+    
+    // 当前格可能还有稍后到期的规则，下次从这一格重新开始
+    hips_config->expire_next = now;
+    
+    spin_unlock_bh(&hips_config->config_lock);
+    
+    hips_forget_commit(&forget);
+    
+    if (count) {
+        HIPS_DEBUG("回收过期规则: %d 条", count);
+    }
+    
+    return count;
+}
+
+// 通配符匹配：'*' 匹配任意长度字符串，'?' 匹配单个字符
+static int hips_glob_match(const char *pattern, const char *string)
+{
+    const char *star = NULL;
+    const char *retry = NULL;
+    
+    while (*string) {
+        if (*pattern == '*') {
+            star = pattern++;
+            retry = string;
+        } else if (*pattern == '?' || *pattern == *string) {
+            pattern++;
+            string++;
+        } else if (star) {
+            pattern = star + 1;
+            string = ++retry;
+        } else {
+            return 0;
+        }
+    }
+    
+    while (*pattern == '*') {
+        pattern++;
+    }
+    
+    return *pattern == '\0';
+}
+
+// 模式匹配（支持通配符）
+int hips_match_pattern(const char *pattern, const char *string)
+{
+    size_t len;
+    
+    if (!pattern || !string) {
+        return 0;
+    }
+    
+    // 精确匹配
+    if (strcmp(pattern, string) == 0) {
+        return 1;
+    }
+    
+    len = strlen(pattern);
+    if (len == 0) {
+        return 0;
+    }
+    
+    // 前缀匹配（仅末尾一个 '*' 的常见情况）
+    if (strchr(pattern, '*') == &pattern[len - 1] && !strchr(pattern, '?')) {
+        char prefix[256];
+        // 复制时去掉末尾的 '*'
+        strscpy(prefix, pattern, min_t(size_t, len, sizeof(prefix)));
+        if (strncmp(string, prefix, strlen(prefix)) == 0) {
+            return 1;
+        }
+        return 0;
+    }
+    
+    // 通配符匹配
+    if (strpbrk(pattern, "*?")) {
+        return hips_glob_match(pattern, string);
+    }
+    
+    return 0;
+}
+
+// 解析 IP 地址，支持 "1.2.3.4"、"1.2.3.4:22"、"2001:db8::1" 和 "[2001:db8::1]:22"
+int hips_parse_ip(const char *ip_str, struct hips_network_addr *addr)
+{
+    const char *end;
+    u32 port = 0;
+    
+    if (!ip_str || !addr) {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    memset(addr, 0, sizeof(*addr));
+    
+    if (ip_str[0] == '[') {
+        if (!in6_pton(ip_str + 1, -1, addr->addr.ipv6, ']', &end) || *end != ']') {
+            return HIPS_ERROR_INVALID;
+        }
+        addr->family = AF_INET6;
+        end++;
+    } else if (in4_pton(ip_str, -1, (u8 *)&addr->addr.ipv4, ':', &end)) {
+        addr->family = AF_INET;
+    } else if (in6_pton(ip_str, -1, addr->addr.ipv6, -1, &end)) {
+        addr->family = AF_INET6;
+    } else {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    // 可选端口
+    if (*end == ':') {
+        if (kstrtou32(end + 1, 10, &port) != 0 || port > 65535) {
+            return HIPS_ERROR_INVALID;
+        }
+    } else if (*end != '\0') {
+        return HIPS_ERROR_INVALID;
+    }
+    
+    addr->port = port;
+    return HIPS_SUCCESS;
+}
+
+// 比较网络地址，端口为 0 表示任意端口
+int hips_match_ip(const struct hips_network_addr *addr1, const struct hips_network_addr *addr2)
+{
+    if (!addr1 || !addr2 || addr1->family != addr2->family) {
+        return 0;
+    }
+    
+    if (addr1->port && addr2->port && addr1->port != addr2->port) {
+        return 0;
+    }
+    
+    if (addr1->family == AF_INET) {
+        return addr1->addr.ipv4 == addr2->addr.ipv4;
+    }
+    
+    return memcmp(addr1->addr.ipv6, addr2->addr.ipv6, sizeof(addr1->addr.ipv6)) == 0;
+}
+
+// 释放规则集中不在按类型划分的列表上的规则：目录规则及其字典树节点、结构化网络规则
+// （分类器元组空了之后随之摘下，调用者持有 config_lock）
+static void hips_flush_indexed_rules(struct hips_rule_set *set)
+{
+    struct hips_rule_entry *entry, *tmp;
+    
+    list_for_each_entry_safe(entry, tmp, &set->path_rules, list) {
+        hips_pathtrie_remove(&set->paths, entry);
+        list_del_rcu(&entry->list);
+        hips_rule_entry_free(entry);
+    }
+    // 条目先从元组的哈希表摘除，哈希表的后台扩缩不会再访问已释放的条目
+    list_for_each_entry_safe(entry, tmp, &set->netcls_rules, list) {
+        hips_netcls_remove(&set->netcls, entry);
+        list_del_rcu(&entry->list);
+        hips_rule_entry_free(entry);
+    }
+}
+
+// 清理规则列表（包括各命名空间和 cgroup 规则集中的规则，命名空间规则集本身保持注册）
+void hips_cleanup_rules(void)
+{
+    struct hips_rule_entry *entry, *tmp;
+    struct hlist_head *digest_table, *path_table;
+    struct hips_rule_set *set;
+    struct hlist_node *node_tmp;
+    u32 type;
+    int bkt, i;
+    
+    if (!hips_config) {
+        return;
+    }
+    
+    spin_lock_bh(&hips_config->config_lock);
+    
+    // 目录规则先从字典树摘除，节点随之释放；结构化网络规则一并释放
+    for (i = 0; i < ARRAY_SIZE(hips_config->global_sets); i++) {
+        hips_flush_indexed_rules(&hips_config->global_sets[i]);
+    }
+    list_for_each_entry(set, &hips_config->net_rule_sets, list) {
+        hips_flush_indexed_rules(set);
+    }
+    
+    for (type = HIPS_RULE_EXEC; type <= HIPS_RULE_HASH; type++) {
+        for (i = 0; i < ARRAY_SIZE(hips_config->global_sets); i++) {
+            set = &hips_config->global_sets[i];
+            list_for_each_entry_safe(entry, tmp, hips_rule_set_list(set, type), list) {
+                list_del_rcu(&entry->list);
+                hips_rule_entry_free(entry);
+            }
+        }
+        list_for_each_entry(set, &hips_config->net_rule_sets, list) {
+            list_for_each_entry_safe(entry, tmp, hips_rule_set_list(set, type), list) {
+                list_del_rcu(&entry->list);
+                hips_rule_entry_free(entry);
+            }
+        }
+    }
+    
+    for (i = 0; i < ARRAY_SIZE(hips_config->global_sets); i++) {
+        hips_config->global_sets[i].rule_count = 0;
+        hips_config->global_sets[i].network_strings = 0;
+    }
+    list_for_each_entry(set, &hips_config->net_rule_sets, list) {
+        set->rule_count = 0;
+        set->network_strings = 0;
+    }
+    
+    // cgroup 规则集随规则一起释放
+    hash_for_each_safe(hips_config->cgroup_rule_sets, bkt, node_tmp, set, node) {
+        hips_flush_indexed_rules(set);
+        for (type = HIPS_RULE_EXEC; type <= HIPS_RULE_HASH; type++) {
+            list_for_each_entry_safe(entry, tmp, hips_rule_set_list(set, type), list) {
+                list_del_rcu(&entry->list);
+                hips_rule_entry_free(entry);
+            }
+        }
+        hips_netcls_flush(&set->netcls);
+        hash_del_rcu(&set->node);
+        kfree_rcu(set, rcu);
+    }
+    hips_config->cgroup_set_count = 0;
+    
+    // 分类器元组随规则一起释放
+    for (i = 0; i < ARRAY_SIZE(hips_config->global_sets); i++) {
+        hips_netcls_flush(&hips_config->global_sets[i].netcls);
+    }
+    list_for_each_entry(set, &hips_config->net_rule_sets, list) {
+        hips_netcls_flush(&set->netcls);
+    }
+    hips_config->netcls_count = 0;
+    
+    // 摘要表随规则一起释放，下一条哈希规则加入时重新分配
+    digest_table = hips_config->digest_table;
+    WRITE_ONCE(hips_config->digest_table, NULL);
+    WRITE_ONCE(hips_config->hash_count, 0);
+    hips_config->digest_gen++;
+    
+    // 字典树节点已全部释放，节点哈希表同样在下一条目录规则加入时重新分配
+    path_table = hips_config->path_table;
+    WRITE_ONCE(hips_config->path_table, NULL);
+    
+    // 规则已全部释放，直接清空时间轮
+    for (bkt = 0; bkt < HIPS_EXPIRE_WHEEL_SLOTS; bkt++) {
+        INIT_LIST_HEAD(&hips_config->expire_wheel[bkt]);
+    }
+    hips_config->expire_count = 0;
+    
+    // 条目已全部释放，清空 ID 索引
+    xa_destroy(&hips_config->rule_index);
+    
+    spin_unlock_bh(&hips_config->config_lock);
+    
+    // 匹配路径不持有 config_lock，等已经开始的查找离开两张表之后再释放
+    synchronize_rcu();
+    kvfree(digest_table);
+    kvfree(path_table);
+    hips_replica_drop();
+    hips_netcls_drain();
+    
+    HIPS_INFO("规则列表清理完成");
+}
+
+// 解析规则命令
+int hips_parse_rules_command(const char *data, size_t size)
+{
+    char *line, *cursor;
+    char *data_copy;
+    int ret = 0;
+    
+    data_copy = kmalloc(size + 1, GFP_KERNEL);
+    if (!data_copy) {
+        return -ENOMEM;
+    }
+    
+    memcpy(data_copy, data, size);
+    data_copy[size] = '\0';
+    
+    // 逐行解析
+    cursor = data_copy;
+    while ((line = strsep(&cursor, "\n")) != NULL) {
+        ret = hips_parse_rule_line(line);
+        if (ret < 0) {
+            HIPS_ERROR("解析规则行失败: %s", line);
+            break;
+        }
+    }
+    
+    kfree(data_copy);
+    return ret;
+}
+
+// 解析并添加一条规则行
+int hips_parse_rule_line(const char *line)
+{
+    struct hips_rule rule;
+    int ret;
+    
+    ret = hips_parse_rule(line, &rule);
+    if (ret != 0) {
+        return ret < 0 ? ret : 0;
+    }
+    
+    return hips_add_rule(&rule);
+}
+
+// 把规则格式化为规则行（hips_parse_rule 的逆过程，含规则 ID），返回长度，放不下时返回 -ENOSPC
+int hips_format_rule_line(const struct hips_rule *rule, char *buf, size_t size)
+{
+    static const char *const types[] = {"", "exec", "dns", "network", "hash"};
+    static const char *const actions[] = {"block", "allow", "log"};
+    int len;
+    
+    if (rule->rule_type < HIPS_RULE_EXEC || rule->rule_type > HIPS_RULE_HASH ||
+        rule->action > HIPS_ACTION_LOG) {
+        return -EINVAL;
+    }
+    
+    len = snprintf(buf, size, "%s|%s|%u|%s|%s|%u|%llu|%llu|%u",
+                   types[rule->rule_type], actions[rule->action], rule->priority,
+                   rule->target, rule->description, rule->netns_ino,
+                   (unsigned long long)rule->cgroup_id,
+                   (unsigned long long)rule->expires_at, rule->rule_id);
+    
+    // 日志抽样和限速只在设置时写出，保持普通规则行的格式不变
+    if (len >= 0 && len < (int)size) {
+        if (rule->log_sample > 1 || rule->log_rate) {
+            len += snprintf(buf + len, size - len, "|%u|%u\n", rule->log_sample, rule->log_rate);
+        } else {
+            len += snprintf(buf + len, size - len, "\n");
+        }
+    }
+    
+    return len < (int)size ? len : -ENOSPC;
+}
+
+// 解析规则行，成功返回 0，空行和注释行返回 1，格式错误返回负的 errno
+int hips_parse_rule(const char *line, struct hips_rule *rule)
+{
+    char *token, *cursor;
+    char *line_copy;
+    int ret = 0;
+    
+    memset(rule, 0, sizeof(*rule));
+    
+    line_copy = kstrdup(line, GFP_KERNEL);
+    if (!line_copy) {
+        return -ENOMEM;
+    }
+    
+    // 跳过空白字符（保留 line_copy 原指针用于释放）
+    cursor = line_copy;
+    while (*cursor == ' ' || *cursor == '\t') {
+        cursor++;
+    }
+    
+    // 跳过注释行
+    if (*cursor == '#' || *cursor == '\0') {
+        kfree(line_copy);
+        return 1;
+    }
+    
+    // 解析规则格式: 类型|动作|优先级|目标|描述[|网络命名空间 inode[|cgroup ID[|过期时间[|规则 ID
+    //               [|日志抽样[|每秒日志上限]]]]]]
+    token = strsep(&cursor, "|");
+    if (!token) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    // 解析规则类型
+    if (strcmp(token, "exec") == 0) {
+        rule->rule_type = HIPS_RULE_EXEC;
+    } else if (strcmp(token, "dns") == 0) {
+        rule->rule_type = HIPS_RULE_DNS;
+    } else if (strcmp(token, "network") == 0) {
+        rule->rule_type = HIPS_RULE_NETWORK;
+    } else if (strcmp(token, "hash") == 0) {
+        rule->rule_type = HIPS_RULE_HASH;
+    } else {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    // 解析动作
+    token = strsep(&cursor, "|");
+    if (!token) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    if (strcmp(token, "block") == 0) {
+        rule->action = HIPS_ACTION_BLOCK;
+    } else if (strcmp(token, "allow") == 0) {
+        rule->action = HIPS_ACTION_ALLOW;
+    } else if (strcmp(token, "log") == 0) {
+        rule->action = HIPS_ACTION_LOG;
+    } else {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    // 解析优先级
+    token = strsep(&cursor, "|");
+    if (!token) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    if (kstrtou32(token, 10, &rule->priority) != 0) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    // 解析目标
+    token = strsep(&cursor, "|");
+    if (!token) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    strncpy(rule->target, token, sizeof(rule->target) - 1);
+    rule->target[sizeof(rule->target) - 1] = '\0';
+    
+    // 解析描述
+    token = strsep(&cursor, "|");
+    if (token) {
+        strncpy(rule->description, token, sizeof(rule->description) - 1);
+        rule->description[sizeof(rule->description) - 1] = '\0';
+    } else {
+        strcpy(rule->description, "");
+    }
+    
+    // 解析网络命名空间（可选，缺省为全局规则）
+    token = strsep(&cursor, "|");
+    if (token && *token && kstrtou32(token, 10, &rule->netns_ino) != 0) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    // 解析 cgroup ID（可选，缺省为全局规则）
+    token = strsep(&cursor, "|");
+    if (token && *token && kstrtou64(token, 10, &rule->cgroup_id) != 0) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    // 解析过期时间（可选，Unix 秒，缺省为永不过期）
+    token = strsep(&cursor, "|");
+    if (token && *token && kstrtou64(token, 10, &rule->expires_at) != 0) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    // 解析规则 ID（可选，缺省为自动分配；重新加载配置时用于按 ID 比对）
+    token = strsep(&cursor, "|");
+    if (token && *token && kstrtou32(token, 10, &rule->rule_id) != 0) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    // 解析日志抽样（可选，每 N 个事件记录一个，缺省为全部记录）
+    token = strsep(&cursor, "|");
+    if (token && *token && kstrtou32(token, 10, &rule->log_sample) != 0) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+    // 解析每秒日志上限（可选，每 CPU 计算，缺省为不限）
+    token = strsep(&cursor, "|");
+    if (token && *token && kstrtou32(token, 10, &rule->log_rate) != 0) {
+        ret = -EINVAL;
+        goto out;
+    }
+    
+out:
+    kfree(line_copy);
+    return ret;
+}
@@ -0,0 +1,187 @@
+#include <linux/percpu.h>
+
+#include "hips_common.h"
+
+/*
+ * 影子规则集抽样评估
+ *
+ * 每 shadow_sample 个事件（每 CPU 计数）在生效规则集之外再匹配一次影子规则集，
+ * 两者结论（是否阻止）不同时记录一条动作为 HIPS_ACTION_LOG 的分歧事件，结论本身不执行。
+ * 抽样事件上分别累计两个规则集的匹配耗时，用来估计影子规则集提升后的开销；
+ * 影子规则集为空或关闭抽样时钩子只多一次读取。
+ * 入口早期丢弃只处理入站洪泛，不参与抽样；DNS 动态 IP 命中只来自生效规则集，同样不比较。
+ */
+
+static uint hips_shadow_sample = 100;
+module_param_named(shadow_sample, hips_shadow_sample, uint, 0644);
+MODULE_PARM_DESC(shadow_sample, "每 N 个事件评估一次影子规则集（每 CPU 计数），0 表示关闭");
+
+static DEFINE_PER_CPU(u32, hips_shadow_tick);
+
+static atomic64_t hips_shadow_samples = ATOMIC64_INIT(0);
+static atomic64_t hips_shadow_would_block = ATOMIC64_INIT(0);
+static atomic64_t hips_shadow_would_allow = ATOMIC64_INIT(0);
+static atomic64_t hips_shadow_live_ns = ATOMIC64_INIT(0);
+static atomic64_t hips_shadow_ns = ATOMIC64_INIT(0);
+static atomic64_t hips_shadow_max_ns = ATOMIC64_INIT(0);
+
+// 本次事件是否评估影子规则集
+bool hips_shadow_sampled(void)
+{
+    u32 rate = READ_ONCE(hips_shadow_sample);
+
+    if (!rate || !hips_shadow_rule_count()) {
+        return false;
+    }
+
+    return this_cpu_inc_return(hips_shadow_tick) % rate == 0;
+}
+
+// 累计一次抽样的耗时
+static void hips_shadow_account(u64 live_ns, u64 shadow_ns)
+{
+    u64 max = atomic64_read(&hips_shadow_max_ns);
+
+    atomic64_inc(&hips_shadow_samples);
+    atomic64_add(live_ns, &hips_shadow_live_ns);
+    atomic64_add(shadow_ns, &hips_shadow_ns);
+
+    while (shadow_ns > max) {
+        u64 old = atomic64_cmpxchg(&hips_shadow_max_ns, max, shadow_ns);
+
+        if (old == max) {
+            break;
+        }
+        max = old;
+    }
+}
+
+// 比较两个规则集的结论，不同时返回分歧事件的标志和规则 ID（将阻止时取影子规则，将放行时取生效规则）
+static u32 hips_shadow_diverge(const struct hips_shadow_live *live, bool blocked, u32 rule_id,
+                               u32 *event_rule_id)
+{
+    if (blocked == live->blocked) {
+        return 0;
+    }
+
+    if (blocked) {
+        atomic64_inc(&hips_shadow_would_block);
+        *event_rule_id = rule_id;
+        return HIPS_EVENT_F_SHADOW_BLOCK;
+    }
+
+    atomic64_inc(&hips_shadow_would_allow);
+    *event_rule_id = live->rule_id;
+    return HIPS_EVENT_F_SHADOW_ALLOW;
+}
+
+// exec：路径规则和哈希规则的合并方式与 exec 钩子相同，摘要取自按 inode 的缓存。
+// 各 check 函数与生效匹配叠加同样的命名空间和 cgroup 规则集，只有全局规则集换成影子规则集
+void hips_shadow_check_exec(struct file *file, const char *path, struct hips_rule_set *net_set,
+                            u64 cgroup_id, const struct hips_shadow_live *live)
+{
+    struct hips_rule rule;
+    struct hips_owner owner;
+    u8 digest[HIPS_SHA256_SIZE];
+    u32 rule_id = 0, rule_type = HIPS_RULE_EXEC, priority = 0, event_rule_id, flags;
+    bool matched = false, blocked;
+    u64 start, end;
+
+    start = ktime_get_ns();
+    if (hips_shadow_match_rule(net_set, cgroup_id, HIPS_RULE_EXEC, path, &rule) == HIPS_SUCCESS) {
+        matched = true;
+        rule_id = rule.rule_id;
+        priority = rule.priority;
+    }
+    blocked = matched && rule.action == HIPS_ACTION_BLOCK;
+    if (!blocked && READ_ONCE(hips_config->hash_count) &&
+        hips_digest_file(file, digest) == HIPS_SUCCESS &&
+        hips_shadow_match_digest(net_set, cgroup_id, digest, &rule) == HIPS_SUCCESS &&
+        (!matched || rule.priority > priority)) {
+        rule_id = rule.rule_id;
+        rule_type = HIPS_RULE_HASH;
+        blocked = rule.action == HIPS_ACTION_BLOCK;
+    }
+    end = ktime_get_ns();
+    hips_shadow_account(start - live->start, end - start);
+
+    flags = hips_shadow_diverge(live, blocked, rule_id, &event_rule_id);
+    if (flags) {
+        hips_current_owner(&owner, cgroup_id);
+        hips_log_exec_event(event_rule_id, blocked ? rule_type : live->rule_type, HIPS_ACTION_LOG,
+                            &owner, file, NULL, flags);
+    }
+}
+
+void hips_shadow_check_dns(struct sk_buff *skb, struct hips_rule_set *net_set, u64 cgroup_id,
+                           const char *domain, const struct hips_shadow_live *live)
+{
+    struct hips_rule rule;
+    struct hips_owner owner;
+    u32 rule_id = 0, event_rule_id, flags;
+    bool blocked = false;
+    u64 start, end;
+
+    start = ktime_get_ns();
+    if (hips_shadow_match_rule(net_set, cgroup_id, HIPS_RULE_DNS, domain, &rule) == HIPS_SUCCESS) {
+        rule_id = rule.rule_id;
+        blocked = rule.action == HIPS_ACTION_BLOCK;
+    }
+    end = ktime_get_ns();
+    hips_shadow_account(start - live->start, end - start);
+
+    flags = hips_shadow_diverge(live, blocked, rule_id, &event_rule_id);
+    if (flags) {
+        hips_skb_owner(skb, cgroup_id, &owner);
+        hips_log_event(event_rule_id, HIPS_RULE_DNS, HIPS_ACTION_LOG, &owner, domain, flags);
+    }
+}
+
+void hips_shadow_check_network(struct sk_buff *skb, struct hips_rule_set *net_set, u64 cgroup_id,
+                               const struct hips_net_key *key, const struct hips_network_addr *addr,
+                               const char *addr_str, u32 event_flags,
+                               const struct hips_shadow_live *live)
+{
+    struct hips_rule rule;
+    struct hips_owner owner;
+    u32 rule_id = 0, event_rule_id, flags;
+    bool blocked = false;
+    u64 start, end;
+
+    start = ktime_get_ns();
+    if (hips_shadow_match_network(net_set, cgroup_id, key, addr_str, &rule) == HIPS_SUCCESS) {
+        rule_id = rule.rule_id;
+        blocked = rule.action == HIPS_ACTION_BLOCK;
+    }
+    end = ktime_get_ns();
+    hips_shadow_account(start - live->start, end - start);
+
+    flags = hips_shadow_diverge(live, blocked, rule_id, &event_rule_id);
+    if (flags) {
+        hips_skb_owner(skb, cgroup_id, &owner);
+        hips_log_net_event(event_rule_id, HIPS_ACTION_LOG, &owner, addr, event_flags | flags);
+    }
+}
+
+// 填入统计信息中的影子规则集部分
+void hips_shadow_get_stats(struct hips_stats *stats)
+{
+    stats->shadow_rules = hips_shadow_rule_count();
+    stats->shadow_samples = atomic64_read(&hips_shadow_samples);
+    stats->shadow_would_block = atomic64_read(&hips_shadow_would_block);
+    stats->shadow_would_allow = atomic64_read(&hips_shadow_would_allow);
+    stats->shadow_live_ns = atomic64_read(&hips_shadow_live_ns);
+    stats->shadow_ns = atomic64_read(&hips_shadow_ns);
+    stats->shadow_max_ns = atomic64_read(&hips_shadow_max_ns);
+}
+
+// 影子规则集提升或清空后，之前的比较结果不再对应当前的规则集
+void hips_shadow_reset_stats(void)
+{
+    atomic64_set(&hips_shadow_samples, 0);
+    atomic64_set(&hips_shadow_would_block, 0);
+    atomic64_set(&hips_shadow_would_allow, 0);
+    atomic64_set(&hips_shadow_live_ns, 0);
+    atomic64_set(&hips_shadow_ns, 0);
+    atomic64_set(&hips_shadow_max_ns, 0);
+}
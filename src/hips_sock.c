@@ -0,0 +1,210 @@
+#include <linux/hashtable.h>
+#include <linux/rcupdate.h>
+#include <linux/file.h>
+#include <linux/sched/mm.h>
+#include <net/sock.h>
+#include <net/inet_sock.h>
+
+#include "hips_common.h"
+
+/*
+ * 套接字归属缓存
+ *
+ * 在 PRE_ROUTING 和软中断中 current 只是碰巧在运行的进程，不能用来归属网络事件。
+ * 这里在套接字创建时（进程上下文）记录创建者的 pid、uid、comm、可执行文件 inode 和 cgroup，
+ * 以套接字指针为键放入哈希表，报文路径只需一次 RCU 查找，不必逐包获取进程信息。
+ * 模块加载前已存在的套接字在其第一次于进程上下文中发包时补录。
+ */
+
+#define HIPS_SOCK_HASH_BITS  12
+#define HIPS_SOCK_LOCK_BITS  8       // 桶锁按桶号散列，每把锁覆盖 16 个桶
+
+// 缓存条目
+struct hips_sock_entry {
+    struct hlist_node node;
+    struct rcu_head rcu;
+    const struct sock *sk;
+    struct hips_owner owner;
+};
+
+static DEFINE_HASHTABLE(hips_sock_table, HIPS_SOCK_HASH_BITS);
+
+// 每次套接字创建和释放都要修改哈希表，写者按桶分散到多把锁上，互不相关的套接字不争用
+static spinlock_t hips_sock_locks[1 << HIPS_SOCK_LOCK_BITS] = {
+    [0 ... (1 << HIPS_SOCK_LOCK_BITS) - 1] = __SPIN_LOCK_UNLOCKED(hips_sock_locks),
+};
+
+static inline spinlock_t *hips_sock_bucket_lock(u32 bkt)
+{
+    return &hips_sock_locks[bkt & ((1 << HIPS_SOCK_LOCK_BITS) - 1)];
+}
+
+// 与 hash_add_rcu 使用同样的桶号
+static inline spinlock_t *hips_sock_lock(const struct sock *sk)
+{
+    return hips_sock_bucket_lock(hash_min((unsigned long)sk, HIPS_SOCK_HASH_BITS));
+}
+
+// 查找缓存条目（调用者持有 RCU 读锁或该套接字所在桶的锁）
+static struct hips_sock_entry *hips_sock_find(const struct sock *sk)
+{
+    struct hips_sock_entry *entry;
+
+    hash_for_each_possible_rcu(hips_sock_table, entry, node, (unsigned long)sk) {
+        if (entry->sk == sk) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+// 从当前进程填充归属信息，只能在进程上下文调用。
+// 可执行文件只记录 inode，路径由日志工作项解析，这里不分配内存
+void hips_current_owner(struct hips_owner *owner, u64 cgroup_id)
+{
+    struct file *exe_file;
+
+    memset(owner, 0, sizeof(*owner));
+    owner->pid = task_tgid_nr(current);
+    owner->uid = from_kuid_munged(&init_user_ns, current_uid());
+    owner->cgroup_id = cgroup_id;
+    get_task_comm(owner->comm, current);
+
+    exe_file = get_task_exe_file(current);
+    if (!exe_file) {
+        return;
+    }
+
+    owner->exe_ino = file_inode(exe_file)->i_ino;
+    owner->exe_dev = file_inode(exe_file)->i_sb->s_dev;
+    fput(exe_file);
+}
+
+// 进程名（task->comm），仅用于调试输出
+char *hips_get_process_name(struct task_struct *task)
+{
+    return task->comm;
+}
+
+// 记录套接字的创建者，重复调用时保留第一次的记录。套接字创建钩子在进程上下文中
+// 使用 GFP_KERNEL；报文路径上的补录处于 RCU 读临界区，只能使用 GFP_ATOMIC
+void hips_sock_owner_capture(struct sock *sk, u64 cgroup_id, gfp_t gfp)
+{
+    struct hips_sock_entry *entry;
+    spinlock_t *lock;
+
+    if (!sk || !in_task()) {
+        return;
+    }
+
+    entry = kmalloc(sizeof(*entry), gfp);
+    if (!entry) {
+        return;
+    }
+
+    entry->sk = sk;
+    hips_current_owner(&entry->owner, cgroup_id);
+
+    lock = hips_sock_lock(sk);
+    spin_lock_bh(lock);
+    if (hips_sock_find(sk)) {
+        spin_unlock_bh(lock);
+        kfree(entry);
+        return;
+    }
+    hash_add_rcu(hips_sock_table, &entry->node, (unsigned long)sk);
+    spin_unlock_bh(lock);
+}
+
+// 套接字释放时删除缓存条目。释放时不会再有人为它补录，未缓存的套接字
+// （unix、netlink 和内核套接字）先无锁确认后直接返回
+void hips_sock_owner_release(struct sock *sk)
+{
+    struct hips_sock_entry *entry;
+    spinlock_t *lock = hips_sock_lock(sk);
+
+    rcu_read_lock();
+    entry = hips_sock_find(sk);
+    rcu_read_unlock();
+    if (!entry) {
+        return;
+    }
+
+    spin_lock_bh(lock);
+    entry = hips_sock_find(sk);
+    if (entry) {
+        hash_del_rcu(&entry->node);
+    }
+    spin_unlock_bh(lock);
+
+    if (entry) {
+        kfree_rcu(entry, rcu);
+    }
+}
+
+// 查询套接字归属，未缓存时返回 HIPS_ERROR_NOT_FOUND
+int hips_sock_owner_get(const struct sock *sk, struct hips_owner *owner)
+{
+    struct hips_sock_entry *entry;
+    int ret = HIPS_ERROR_NOT_FOUND;
+
+    rcu_read_lock();
+    entry = hips_sock_find(sk);
+    if (entry) {
+        memcpy(owner, &entry->owner, sizeof(*owner));
+        ret = HIPS_SUCCESS;
+    }
+    rcu_read_unlock();
+
+    return ret;
+}
+
+// 取报文的归属进程：优先使用套接字缓存，缓存缺失时在进程上下文中补录，
+// 软中断中无法确定时只填 uid，pid 为 0
+void hips_skb_owner(struct sk_buff *skb, u64 cgroup_id, struct hips_owner *owner)
+{
+    struct sock *sk = skb_to_full_sk(skb);
+
+    if (!sk || !sk_fullsock(sk)) {
+        memset(owner, 0, sizeof(*owner));
+        owner->cgroup_id = cgroup_id;
+        strscpy(owner->comm, "-", sizeof(owner->comm));
+        return;
+    }
+
+    if (hips_sock_owner_get(sk, owner) == HIPS_SUCCESS) {
+        return;
+    }
+
+    if (in_task()) {
+        hips_sock_owner_capture(sk, cgroup_id, GFP_ATOMIC);
+        if (hips_sock_owner_get(sk, owner) == HIPS_SUCCESS) {
+            return;
+        }
+    }
+
+    memset(owner, 0, sizeof(*owner));
+    owner->uid = from_kuid_munged(&init_user_ns, sock_i_uid(sk));
+    owner->cgroup_id = cgroup_id;
+    strscpy(owner->comm, "-", sizeof(owner->comm));
+}
+
+// 清空缓存（模块卸载时，钩子已注销）
+void hips_sock_owner_cleanup(void)
+{
+    struct hips_sock_entry *entry;
+    struct hlist_node *tmp;
+    u32 bkt;
+
+    for (bkt = 0; bkt < HASH_SIZE(hips_sock_table); bkt++) {
+        spin_lock_bh(hips_sock_bucket_lock(bkt));
+        hlist_for_each_entry_safe(entry, tmp, &hips_sock_table[bkt], node) {
+            hash_del_rcu(&entry->node);
+            kfree_rcu(entry, rcu);
+        }
+        spin_unlock_bh(hips_sock_bucket_lock(bkt));
+    }
+
+    HIPS_INFO("套接字归属缓存清理完成");
+}
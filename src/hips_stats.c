@@ -0,0 +1,89 @@
+#include "hips_common.h"
+
+// 统计信息锁，钩子可能在软中断中更新统计
+static DEFINE_SPINLOCK(hips_stats_lock);
+
+// 更新统计
+void hips_update_stats(u32 rule_type, u32 action)
+{
+    unsigned long flags;
+
+    if (!hips_config) {
+        return;
+    }
+
+    spin_lock_irqsave(&hips_stats_lock, flags);
+
+    if (action == HIPS_ACTION_BLOCK) {
+        switch (rule_type) {
+            case HIPS_RULE_EXEC:
+            case HIPS_RULE_HASH:
+                hips_config->stats.exec_blocks++;
+                break;
+            case HIPS_RULE_DNS:
+                hips_config->stats.dns_blocks++;
+                break;
+            case HIPS_RULE_NETWORK:
+                hips_config->stats.network_blocks++;
+                break;
+        }
+    }
+
+    hips_config->stats.total_events++;
+    hips_config->stats.last_event_time = ktime_get_ns();
+
+    spin_unlock_irqrestore(&hips_stats_lock, flags);
+}
+
+// 更新被阻止 DNS 查询的处理统计
+void hips_update_dns_stats(int response)
+{
+    unsigned long flags;
+
+    if (!hips_config) {
+        return;
+    }
+
+    spin_lock_irqsave(&hips_stats_lock, flags);
+
+    switch (response) {
+        case HIPS_DNS_RESPONSE_NXDOMAIN:
+            hips_config->stats.dns_nxdomain++;
+            break;
+        case HIPS_DNS_RESPONSE_SINKHOLE:
+            hips_config->stats.dns_sinkhole++;
+            break;
+        default:
+            hips_config->stats.dns_dropped++;
+            break;
+    }
+
+    spin_unlock_irqrestore(&hips_stats_lock, flags);
+}
+
+// 获取统计信息
+int hips_get_stats(struct hips_stats *stats)
+{
+    u64 rebuilds, build_ns;
+    u32 nodes, entries;
+    unsigned long flags;
+    bool fresh;
+
+    if (!hips_config || !stats) {
+        return HIPS_ERROR_INVALID;
+    }
+
+    spin_lock_irqsave(&hips_stats_lock, flags);
+    memcpy(stats, &hips_config->stats, sizeof(struct hips_stats));
+    spin_unlock_irqrestore(&hips_stats_lock, flags);
+    
+    // 入口丢弃和日志丢弃使用每 CPU 计数器，影子规则集使用原子计数，都不经过统计锁
+    stats->ingress_drops = hips_ingress_get_drops();
+    stats->log_dropped = hips_log_get_dropped();
+    stats->log_suppressed = hips_log_get_suppressed();
+    hips_shadow_get_stats(stats);
+    hips_replica_get_stats(&nodes, &stats->replica_bytes, &entries, &fresh, &rebuilds, &build_ns);
+    stats->replica_nodes = nodes;
+
+    return HIPS_SUCCESS;
+}
@@ -0,0 +1,1565 @@
+#include <kunit/test.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/delay.h>
+
+#include "hips_common.h"
+
+/*
+ * HIPS 匹配路径 KUnit 测试
+ *
+ * 以独立模块 hips_kunit.ko 构建（make kunit），只链接规则引擎、动态 IP 表和事件日志，
+ * 不注册任何钩子，可以在 UML 或 QEMU 中无网络运行。
+ * 加载时指定 hips_bench=1 会额外运行 hips_match_rule 基准，
+ * 结果以 "HIPS_BENCH {json}" 行输出，便于脚本提取和跟踪回归。
+ */
+
+// 测试模块自己的全局配置（hips.ko 中由 hips_main.c 定义）
+struct hips_global_config *hips_config = NULL;
+
+// 事件日志的工作项用到的钩子和 netlink 函数：测试模块不启动日志工作项，也不注册 netlink 族
+void hips_format_network_addr(struct hips_network_addr *addr, char *str, size_t size)
+{
+    snprintf(str, size, "unknown");
+}
+
+void hips_genl_notify_event(const struct hips_log_entry *entry)
+{
+}
+
+static bool hips_bench;
+module_param(hips_bench, bool, 0444);
+MODULE_PARM_DESC(hips_bench, "运行 hips_match_rule 基准测试 (默认关闭)");
+
+static char *hips_bench_sizes = "1000,10000,100000";
+module_param(hips_bench_sizes, charp, 0444);
+MODULE_PARM_DESC(hips_bench_sizes, "基准规则规模列表");
+
+static char *hips_bench_threads = "1,2,4";
+module_param(hips_bench_threads, charp, 0444);
+MODULE_PARM_DESC(hips_bench_threads, "基准线程数列表");
+
+static uint hips_bench_ops = 20000;
+module_param(hips_bench_ops, uint, 0444);
+MODULE_PARM_DESC(hips_bench_ops, "基准每线程匹配次数");
+
+#define HIPS_TEST_QUERY_COUNT  1024
+#define HIPS_TEST_QUERY_LEN    64
+#define HIPS_TEST_MAX_LIST     8
+#define HIPS_TEST_MAX_THREADS  64
+
+static int hips_test_init(struct kunit *test)
+{
+    hips_config = kzalloc(sizeof(struct hips_global_config), GFP_KERNEL);
+    if (!hips_config) {
+        return -ENOMEM;
+    }
+
+    spin_lock_init(&hips_config->config_lock);
+    hips_rules_init();
+    hips_config->config.enabled = 1;
+    hips_config->config.max_rules = hips_max_rules;
+
+    return 0;
+}
+
+static void hips_test_exit(struct kunit *test)
+{
+    hips_cleanup_rules();
+    rcu_barrier();
+    kfree(hips_config);
+    hips_config = NULL;
+}
+
+static u32 hips_test_add(struct kunit *test, u32 type, u32 action, u32 priority,
+                         const char *target)
+{
+    struct hips_rule rule;
+
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = type;
+    rule.action = action;
+    rule.priority = priority;
+    strscpy(rule.target, target, sizeof(rule.target));
+
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    KUNIT_ASSERT_NE(test, rule.rule_id, 0U);
+
+    return rule.rule_id;
+}
+
+// 规则添加、查询、匹配与删除
+static void hips_test_add_del_match(struct kunit *test)
+{
+    struct hips_rule rule, matched;
+    u32 id;
+
+    id = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_BLOCK, 100, "/usr/bin/malware.exe");
+
+    KUNIT_EXPECT_EQ(test, hips_get_rule(id, &rule), HIPS_SUCCESS);
+    KUNIT_EXPECT_STREQ(test, rule.target, "/usr/bin/malware.exe");
+
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_EXEC, "/usr/bin/malware.exe", &matched),
+                    HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, id);
+    KUNIT_EXPECT_EQ(test, matched.action, (u32)HIPS_ACTION_BLOCK);
+
+    // 规则类型互不干扰
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "/usr/bin/malware.exe", &matched),
+                    HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_EXEC, "/usr/bin/true", &matched),
+                    HIPS_ERROR_NOT_FOUND);
+
+    // 匹配之后删除不能阻塞
+    KUNIT_EXPECT_EQ(test, hips_del_rule(id), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_EXEC, "/usr/bin/malware.exe", &matched),
+                    HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, hips_del_rule(id), HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, hips_get_rule(id, &rule), HIPS_ERROR_NOT_FOUND);
+
+    // 无效规则类型
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = 99;
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_INVALID);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(99, "x", &matched), HIPS_ERROR_INVALID);
+}
+
+// 分页导出按 ID 升序，跨类型、跨规则集，页间删除的规则不再出现
+static void hips_test_dump_rules(struct kunit *test)
+{
+    struct hips_rule *page;
+    u32 ids[10], next;
+    int i, n, seen = 0;
+
+    page = kunit_kcalloc(test, 4, sizeof(*page), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, page);
+
+    for (i = 0; i < ARRAY_SIZE(ids); i++) {
+        ids[i] = hips_test_add(test, i % 2 ? HIPS_RULE_DNS : HIPS_RULE_EXEC,
+                               HIPS_ACTION_BLOCK, i, i % 2 ? "evil.com" : "/bin/evil");
+    }
+
+    n = hips_dump_rules(0, page, 4);
+    KUNIT_ASSERT_EQ(test, n, 4);
+    for (i = 0; i < n; i++) {
+        KUNIT_EXPECT_EQ(test, page[i].rule_id, ids[i]);
+    }
+
+    // 第二页开始前删除一条尚未导出的规则
+    KUNIT_EXPECT_EQ(test, hips_del_rule(ids[5]), HIPS_SUCCESS);
+    seen = n;
+    next = page[n - 1].rule_id + 1;
+    while ((n = hips_dump_rules(next, page, 4)) > 0) {
+        for (i = 0; i < n; i++) {
+            KUNIT_EXPECT_NE(test, page[i].rule_id, ids[5]);
+            KUNIT_EXPECT_GT(test, page[i].rule_id, next - 1);
+        }
+        seen += n;
+        next = page[n - 1].rule_id + 1;
+    }
+    KUNIT_EXPECT_EQ(test, n, 0);
+    KUNIT_EXPECT_EQ(test, seen, (int)ARRAY_SIZE(ids) - 1);
+
+    KUNIT_EXPECT_EQ(test, hips_dump_rules(0, page, 0), HIPS_ERROR_INVALID);
+}
+
+// 批量添加和删除逐项返回结果，无效条目不影响其余各项
+static void hips_test_batch(struct kunit *test)
+{
+    struct hips_rule *rules, matched;
+    int status[4];
+    u32 ids[4];
+    int i;
+
+    rules = kunit_kcalloc(test, 4, sizeof(*rules), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, rules);
+
+    for (i = 0; i < 4; i++) {
+        rules[i].rule_type = HIPS_RULE_DNS;
+        rules[i].priority = i;
+        snprintf(rules[i].target, sizeof(rules[i].target), "batch%d.example", i);
+    }
+    rules[2].rule_type = 99;
+    rules[3].netns_ino = 4026532999U;
+
+    KUNIT_EXPECT_EQ(test, hips_add_rules(rules, 4, status), 2);
+    KUNIT_EXPECT_EQ(test, status[0], HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, status[1], HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, status[2], HIPS_ERROR_INVALID);
+    KUNIT_EXPECT_EQ(test, status[3], HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "batch1.example", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, rules[1].rule_id);
+
+    ids[0] = rules[0].rule_id;
+    ids[1] = rules[1].rule_id;
+    ids[2] = rules[0].rule_id;
+    ids[3] = 0;
+    KUNIT_EXPECT_EQ(test, hips_del_rules(ids, 4, status), 2);
+    KUNIT_EXPECT_EQ(test, status[0], HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, status[1], HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, status[2], HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, status[3], HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, rcu_access_pointer(hips_config->rules)->rule_count, 0U);
+
+    KUNIT_EXPECT_EQ(test, hips_add_rules(rules, 0, status), HIPS_ERROR_INVALID);
+}
+
+// 规则 ID 索引：显式 ID 不可重复，删除后 ID 可重新使用
+static void hips_test_rule_index(struct kunit *test)
+{
+    struct hips_rule rule, got;
+    u32 id;
+
+    id = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_BLOCK, 10, "/usr/bin/nc");
+    KUNIT_EXPECT_EQ(test, hips_get_rule(id, &got), HIPS_SUCCESS);
+    KUNIT_EXPECT_STREQ(test, got.target, "/usr/bin/nc");
+
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_id = id;
+    rule.rule_type = HIPS_RULE_DNS;
+    strscpy(rule.target, "dup.example", sizeof(rule.target));
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_EXISTS);
+    KUNIT_EXPECT_EQ(test, rcu_access_pointer(hips_config->rules)->rule_count, 1U);
+
+    KUNIT_EXPECT_EQ(test, hips_del_rule(id), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_get_rule(id, &got), HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, hips_del_rule(id), HIPS_ERROR_NOT_FOUND);
+
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_get_rule(id, &got), HIPS_SUCCESS);
+    KUNIT_EXPECT_STREQ(test, got.target, "dup.example");
+}
+
+// 配置增量重载：未变的规则保留原 ID，只添加和删除有变化的规则，其他来源的规则不受影响
+static void hips_test_sync_config(struct kunit *test)
+{
+    static const char *const before[] = {
+        "dns|block|50|a.example|情报",
+        "dns|block|50|b.example|情报",
+        "exec|block|10|/tmp/x|固定 ID|0|0|0|90000",
+        // 大写摘要在生效的规则中写回小写，重新加载时仍应与之配对
+        "hash|block|50|E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855|空文件",
+    };
+    static const char *const after[] = {
+        "dns|block|50|a.example|情报",
+        "dns|block|60|b.example|情报",
+        "exec|block|10|/tmp/y|固定 ID|0|0|0|90000",
+        "格式错误",
+        "dns|log|1|c.example",
+    };
+    struct hips_rule_delta delta;
+    struct hips_rule matched;
+    u32 runtime, a_id;
+
+    runtime = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_LOG, 1, "runtime.example");
+
+    KUNIT_ASSERT_EQ(test, hips_sync_config_rules(before, ARRAY_SIZE(before), &delta), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, delta.added, 4U);
+    kvfree(delta.removed_ids);
+    KUNIT_ASSERT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "a.example", &matched), HIPS_SUCCESS);
+    a_id = matched.rule_id;
+    KUNIT_EXPECT_TRUE(test, matched.flags & HIPS_RULE_F_CONFIG);
+
+    KUNIT_ASSERT_EQ(test, hips_sync_config_rules(before, ARRAY_SIZE(before), &delta), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, delta.kept, 4U);
+    KUNIT_EXPECT_EQ(test, delta.added + delta.removed, 0U);
+    kvfree(delta.removed_ids);
+
+    KUNIT_ASSERT_EQ(test, hips_sync_config_rules(after, ARRAY_SIZE(after), &delta), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, delta.kept, 1U);
+    KUNIT_EXPECT_EQ(test, delta.added, 3U);
+    KUNIT_EXPECT_EQ(test, delta.removed, 3U);
+    KUNIT_EXPECT_EQ(test, delta.failed, 1U);
+    kvfree(delta.removed_ids);
+
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "a.example", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, a_id);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "b.example", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.priority, 60U);
+    KUNIT_EXPECT_EQ(test, hips_get_rule(90000, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_STREQ(test, matched.target, "/tmp/y");
+    KUNIT_EXPECT_EQ(test, hips_get_rule(runtime, &matched), HIPS_SUCCESS);
+
+    KUNIT_ASSERT_EQ(test, hips_sync_config_rules(NULL, 0, &delta), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, delta.removed, 4U);
+    kvfree(delta.removed_ids);
+    KUNIT_EXPECT_EQ(test, rcu_access_pointer(hips_config->rules)->rule_count, 1U);
+}
+
+// 多条规则同时命中时高优先级生效，同优先级先添加者生效
+static void hips_test_priority(struct kunit *test)
+{
+    struct hips_rule matched;
+    u32 low, high, first, second;
+
+    low = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_LOG, 10, "/usr/bin/*");
+    high = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_BLOCK, 500, "/usr/bin/nc");
+
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_EXEC, "/usr/bin/nc", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, high);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_EXEC, "/usr/bin/ls", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, low);
+
+    first = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_LOG, 50, "*.example.com");
+    second = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_BLOCK, 50, "www.example.com");
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "www.example.com", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, first);
+
+    KUNIT_EXPECT_EQ(test, hips_del_rule(first), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "www.example.com", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, second);
+}
+
+// 网络命名空间规则集叠加在全局规则集之上，互不可见
+static void hips_test_net_rule_set(struct kunit *test)
+{
+    struct hips_rule_set *net_a, *net_b;
+    struct hips_rule rule, matched;
+    u32 global, scoped;
+
+    net_a = kunit_kzalloc(test, sizeof(*net_a), GFP_KERNEL);
+    net_b = kunit_kzalloc(test, sizeof(*net_b), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, net_a);
+    KUNIT_ASSERT_NOT_NULL(test, net_b);
+    hips_rule_set_init(net_a, 4026532001U);
+    hips_rule_set_init(net_b, 4026532002U);
+
+    // 命名空间未注册时不能添加规则
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_NETWORK;
+    rule.priority = 100;
+    rule.netns_ino = net_a->netns_ino;
+    strscpy(rule.target, "10.0.0.8:*", sizeof(rule.target));
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_NOT_FOUND);
+
+    hips_register_rule_set(net_a);
+    hips_register_rule_set(net_b);
+
+    rule.rule_id = 0;
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    scoped = rule.rule_id;
+    global = hips_test_add(test, HIPS_RULE_NETWORK, HIPS_ACTION_LOG, 10, "10.0.0.*");
+
+    // 命名空间 A 命中自己的规则，B 和全局匹配只看到全局规则
+    KUNIT_EXPECT_EQ(test, hips_match_rule_scoped(net_a, 0, HIPS_RULE_NETWORK, "10.0.0.8:443",
+                                                 &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, scoped);
+    KUNIT_EXPECT_EQ(test, hips_match_rule_scoped(net_b, 0, HIPS_RULE_NETWORK, "10.0.0.8:443",
+                                                 &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, global);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_NETWORK, "10.0.0.8:443", &matched),
+                    HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, global);
+
+    // 全局规则优先级更高时仍然生效
+    KUNIT_EXPECT_EQ(test, hips_del_rule(global), HIPS_SUCCESS);
+    global = hips_test_add(test, HIPS_RULE_NETWORK, HIPS_ACTION_BLOCK, 900, "10.0.0.*");
+    KUNIT_EXPECT_EQ(test, hips_match_rule_scoped(net_a, 0, HIPS_RULE_NETWORK, "10.0.0.8:443",
+                                                 &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, global);
+
+    // 按 ID 查询和删除覆盖命名空间规则集
+    KUNIT_EXPECT_EQ(test, hips_get_rule(scoped, &rule), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, rule.netns_ino, net_a->netns_ino);
+    KUNIT_EXPECT_EQ(test, hips_del_rule(scoped), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, net_a->rule_count, 0U);
+
+    // 注销命名空间时释放其中的规则
+    hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_BLOCK, 1, "/bin/true");
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_EXEC;
+    rule.netns_ino = net_b->netns_ino;
+    strscpy(rule.target, "/bin/false", sizeof(rule.target));
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    hips_unregister_rule_set(net_b);
+    KUNIT_EXPECT_EQ(test, hips_get_rule(rule.rule_id, &matched), HIPS_ERROR_NOT_FOUND);
+    hips_unregister_rule_set(net_a);
+}
+
+// cgroup 规则集按 ID 查找，只对该 cgroup 生效，最后一条规则删除后释放
+static void hips_test_cgroup_rule_set(struct kunit *test)
+{
+    struct hips_rule rule, matched;
+    u32 tenant_a, tenant_b, global;
+
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_EXEC;
+    rule.priority = 100;
+    rule.cgroup_id = 1001;
+    strscpy(rule.target, "/usr/bin/curl", sizeof(rule.target));
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    tenant_a = rule.rule_id;
+
+    rule.rule_id = 0;
+    rule.cgroup_id = 1002;
+    rule.action = HIPS_ACTION_LOG;
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    tenant_b = rule.rule_id;
+    KUNIT_EXPECT_EQ(test, hips_config->cgroup_set_count, 2U);
+
+    global = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_LOG, 1, "/usr/bin/*");
+
+    KUNIT_EXPECT_EQ(test, hips_match_rule_scoped(NULL, 1001, HIPS_RULE_EXEC, "/usr/bin/curl",
+                                                 &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, tenant_a);
+    KUNIT_EXPECT_EQ(test, hips_match_rule_scoped(NULL, 1002, HIPS_RULE_EXEC, "/usr/bin/curl",
+                                                 &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, tenant_b);
+    KUNIT_EXPECT_EQ(test, hips_match_rule_scoped(NULL, 1003, HIPS_RULE_EXEC, "/usr/bin/curl",
+                                                 &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, global);
+
+    // 不能同时限定命名空间和 cgroup
+    rule.rule_id = 0;
+    rule.netns_ino = 4026532001U;
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_INVALID);
+
+    KUNIT_EXPECT_EQ(test, hips_get_rule(tenant_a, &rule), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, rule.cgroup_id, 1001ULL);
+    KUNIT_EXPECT_EQ(test, hips_del_rule(tenant_a), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_config->cgroup_set_count, 1U);
+    KUNIT_EXPECT_EQ(test, hips_match_rule_scoped(NULL, 1001, HIPS_RULE_EXEC, "/usr/bin/curl",
+                                                 &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, global);
+
+    // 规则行的第 7 个字段为 cgroup ID
+    KUNIT_EXPECT_EQ(test, hips_parse_rule_line("dns|block|5|evil.com|租户|0|1004"), 0);
+    KUNIT_EXPECT_EQ(test, hips_match_rule_scoped(NULL, 1004, HIPS_RULE_DNS, "evil.com", &matched),
+                    HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "evil.com", &matched),
+                    HIPS_ERROR_NOT_FOUND);
+}
+
+// 哈希规则按摘要查表：大小写统一、格式校验、范围叠加，删除和清空后不再命中
+static void hips_test_hash_rules(struct kunit *test)
+{
+    static const char sha[] = "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08";
+    static const char sha_upper[] = "9F86D081884C7D659A2FEAA0C55AD015A3BF4F1B2B0B822CD15D6C15B0F00A08";
+    struct hips_rule rule, matched;
+    u8 digest[HIPS_SHA256_SIZE];
+    u32 global, tenant;
+
+    global = hips_test_add(test, HIPS_RULE_HASH, HIPS_ACTION_LOG, 10, sha_upper);
+    KUNIT_EXPECT_EQ(test, hips_get_rule(global, &rule), HIPS_SUCCESS);
+    KUNIT_EXPECT_STREQ(test, rule.target, sha);
+    KUNIT_EXPECT_EQ(test, hips_config->hash_count, 1U);
+
+    KUNIT_ASSERT_EQ(test, hex2bin(digest, sha, HIPS_SHA256_SIZE), 0);
+    KUNIT_EXPECT_EQ(test, hips_match_digest(NULL, 0, digest, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, global);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_HASH, sha, &matched), HIPS_SUCCESS);
+    digest[HIPS_SHA256_SIZE - 1] ^= 1;
+    KUNIT_EXPECT_EQ(test, hips_match_digest(NULL, 0, digest, &matched), HIPS_ERROR_NOT_FOUND);
+    digest[HIPS_SHA256_SIZE - 1] ^= 1;
+
+    // 长度不对或含非十六进制字符的目标被拒绝
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_HASH;
+    strscpy(rule.target, "9f86d081", sizeof(rule.target));
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_INVALID);
+    strscpy(rule.target, sha, sizeof(rule.target));
+    rule.target[0] = 'x';
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_INVALID);
+
+    // cgroup 规则只对该 cgroup 生效，优先级更高时覆盖全局规则
+    strscpy(rule.target, sha, sizeof(rule.target));
+    rule.priority = 100;
+    rule.cgroup_id = 1001;
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    tenant = rule.rule_id;
+    KUNIT_EXPECT_EQ(test, hips_match_digest(NULL, 1001, digest, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, tenant);
+    KUNIT_EXPECT_EQ(test, hips_match_digest(NULL, 1002, digest, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, global);
+
+    KUNIT_EXPECT_EQ(test, hips_del_rule(tenant), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_match_digest(NULL, 1001, digest, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, global);
+
+    // 规则行的类型为 hash，清空规则表后摘要表一起释放
+    KUNIT_EXPECT_EQ(test, hips_parse_rule_line("hash|block|5|"
+                    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855|空文件"), 0);
+    KUNIT_EXPECT_EQ(test, hips_config->hash_count, 2U);
+    hips_cleanup_rules();
+    KUNIT_EXPECT_EQ(test, hips_config->hash_count, 0U);
+    KUNIT_EXPECT_EQ(test, hips_match_digest(NULL, 0, digest, &matched), HIPS_ERROR_NOT_FOUND);
+    global = hips_test_add(test, HIPS_RULE_HASH, HIPS_ACTION_BLOCK, 1, sha);
+    KUNIT_EXPECT_EQ(test, hips_match_digest(NULL, 0, digest, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, global);
+}
+
+// NUMA 副本与摘要表查找结果一致：范围和优先级、过期跳过，摘要表变化后副本过时并退回摘要表查找
+static void hips_test_numa_replica(struct kunit *test)
+{
+    static const char sha[] = "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08";
+    struct hips_replica_set *set;
+    struct hips_rule rule, matched;
+    u8 digest[HIPS_SHA256_SIZE];
+    u32 global, tenant, feed, other;
+
+    KUNIT_ASSERT_EQ(test, hex2bin(digest, sha, HIPS_SHA256_SIZE), 0);
+    KUNIT_ASSERT_EQ(test, hips_expire_rules(1000), 0);
+    KUNIT_EXPECT_EQ(test, hips_replica_match(NULL, 0, digest, &matched), HIPS_ERROR_INVALID);
+
+    global = hips_test_add(test, HIPS_RULE_HASH, HIPS_ACTION_LOG, 10, sha);
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_HASH;
+    rule.action = HIPS_ACTION_BLOCK;
+    rule.priority = 10;
+    rule.cgroup_id = 1001;
+    strscpy(rule.target, sha, sizeof(rule.target));
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    tenant = rule.rule_id;
+    rule.rule_id = 0;
+    rule.cgroup_id = 0;
+    rule.priority = 50;
+    rule.expires_at = 1100;
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    feed = rule.rule_id;
+
+    KUNIT_ASSERT_GT(test, hips_replica_rebuild(), 0);
+    set = rcu_dereference_protected(hips_config->replicas, 1);
+    KUNIT_ASSERT_NOT_NULL(test, set);
+    KUNIT_EXPECT_EQ(test, set->primary->count, 3U);
+
+    // 同优先级时 cgroup 规则优先，高优先级的限时规则覆盖两者，过期后退出匹配
+    KUNIT_EXPECT_EQ(test, hips_replica_match(NULL, 1001, digest, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, feed);
+    KUNIT_EXPECT_EQ(test, hips_replica_lookup(set->primary, rcu_access_pointer(hips_config->rules),
+                                              NULL, 1001, 1100, digest), tenant);
+    KUNIT_EXPECT_EQ(test, hips_replica_lookup(set->primary, rcu_access_pointer(hips_config->rules),
+                                              NULL, 1002, 1100, digest), global);
+    digest[0] ^= 1;
+    KUNIT_EXPECT_EQ(test, hips_replica_match(NULL, 0, digest, &matched), HIPS_ERROR_NOT_FOUND);
+    digest[0] ^= 1;
+
+    // 新加入的哈希规则使副本过时，匹配退回摘要表查找
+    other = hips_test_add(test, HIPS_RULE_HASH, HIPS_ACTION_BLOCK, 100, sha);
+    KUNIT_EXPECT_EQ(test, hips_replica_match(NULL, 0, digest, &matched), HIPS_ERROR_INVALID);
+    KUNIT_EXPECT_EQ(test, hips_match_digest(NULL, 0, digest, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, other);
+
+    KUNIT_ASSERT_GT(test, hips_replica_rebuild(), 0);
+    KUNIT_EXPECT_EQ(test, hips_replica_match(NULL, 0, digest, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, other);
+
+    // 清空规则表时副本一起释放
+    hips_cleanup_rules();
+    KUNIT_EXPECT_NULL(test, rcu_access_pointer(hips_config->replicas));
+    KUNIT_EXPECT_EQ(test, hips_match_digest(NULL, 0, digest, &matched), HIPS_ERROR_NOT_FOUND);
+}
+
+// 钩子耗时按 2 的幂分桶，规则命中按 CPU 累计：未命中的规则不分配计数器，不存在的规则忽略
+static void hips_test_metrics(struct kunit *test)
+{
+    struct hips_hook_stats before[HIPS_HOOK_MAX], after[HIPS_HOOK_MAX];
+    struct hips_rule_entry *entry;
+    u32 hot, cold;
+    int i;
+
+    KUNIT_EXPECT_EQ(test, hips_metrics_bucket(0), 0U);
+    KUNIT_EXPECT_EQ(test, hips_metrics_bucket(256), 0U);
+    KUNIT_EXPECT_EQ(test, hips_metrics_bucket(257), 1U);
+    KUNIT_EXPECT_EQ(test, hips_metrics_bucket(512), 1U);
+    KUNIT_EXPECT_EQ(test, hips_metrics_bucket(1ULL << 22), HIPS_LAT_BUCKETS - 2);
+    KUNIT_EXPECT_EQ(test, hips_metrics_bucket((1ULL << 22) + 1), HIPS_LAT_BUCKETS - 1);
+    KUNIT_EXPECT_EQ(test, hips_metrics_bucket(U64_MAX), HIPS_LAT_BUCKETS - 1);
+
+    hot = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_LOG, 1, "hot.example.com");
+    cold = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_LOG, 1, "cold.example.com");
+
+    hips_metrics_get_hooks(before);
+    for (i = 0; i < 4; i++) {
+        hips_metrics_rule_hit(hot);
+    }
+    hips_metrics_eval(HIPS_HOOK_DNS, hips_metrics_begin(), hot, true);
+    hips_metrics_eval(HIPS_HOOK_DNS, hips_metrics_begin(), 0, false);
+    hips_metrics_rule_hit(cold + 1000);
+    hips_metrics_get_hooks(after);
+
+    KUNIT_EXPECT_EQ(test, after[HIPS_HOOK_DNS].evals - before[HIPS_HOOK_DNS].evals, 2ULL);
+    KUNIT_EXPECT_EQ(test, after[HIPS_HOOK_DNS].matches - before[HIPS_HOOK_DNS].matches, 1ULL);
+    KUNIT_EXPECT_EQ(test, after[HIPS_HOOK_DNS].blocks - before[HIPS_HOOK_DNS].blocks, 1ULL);
+    KUNIT_EXPECT_EQ(test, after[HIPS_HOOK_EXEC].evals, before[HIPS_HOOK_EXEC].evals);
+
+    rcu_read_lock();
+    entry = xa_load(&hips_config->rule_index, hot);
+    KUNIT_EXPECT_EQ(test, hips_metrics_rule_hits(entry), 5ULL);
+    entry = xa_load(&hips_config->rule_index, cold);
+    KUNIT_EXPECT_EQ(test, hips_metrics_rule_hits(entry), 0ULL);
+    KUNIT_EXPECT_NULL(test, entry->hits);
+    rcu_read_unlock();
+
+    // 计数器随条目在宽限期后释放，删除之后的命中忽略
+    KUNIT_EXPECT_EQ(test, hips_del_rule(hot), HIPS_SUCCESS);
+    hips_metrics_rule_hit(hot);
+}
+
+// 命中计数按 ID 升序分页导出，只包含命中过的规则
+static void hips_test_metrics_dump(struct kunit *test)
+{
+    struct hips_rule_hits hits[4];
+    u32 first, idle, last;
+    int i;
+
+    first = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_LOG, 10, "/usr/bin/first");
+    idle = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_LOG, 10, "/usr/bin/idle");
+    last = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_BLOCK, 20, "last.example.com");
+    KUNIT_ASSERT_GT(test, last, idle);
+
+    for (i = 0; i < 3; i++) {
+        hips_metrics_rule_hit(first);
+    }
+    hips_metrics_rule_hit(last);
+
+    KUNIT_ASSERT_EQ(test, hips_metrics_dump_hits(0, hits, 1), 1);
+    KUNIT_EXPECT_EQ(test, hits[0].rule_id, first);
+    KUNIT_EXPECT_EQ(test, hits[0].hits, 3ULL);
+    KUNIT_EXPECT_STREQ(test, hits[0].target, "/usr/bin/first");
+
+    KUNIT_ASSERT_EQ(test, hips_metrics_dump_hits(first + 1, hits, ARRAY_SIZE(hits)), 1);
+    KUNIT_EXPECT_EQ(test, hits[0].rule_id, last);
+    KUNIT_EXPECT_EQ(test, hits[0].rule_type, (u32)HIPS_RULE_DNS);
+    KUNIT_EXPECT_EQ(test, hits[0].action, (u32)HIPS_ACTION_BLOCK);
+    KUNIT_EXPECT_EQ(test, hits[0].priority, 20U);
+    KUNIT_EXPECT_EQ(test, hits[0].hits, 1ULL);
+
+    KUNIT_EXPECT_EQ(test, hips_metrics_dump_hits(last + 1, hits, ARRAY_SIZE(hits)), 0);
+    KUNIT_EXPECT_EQ(test, hips_metrics_dump_hits(0, hits, 0), HIPS_ERROR_INVALID);
+}
+
+// 过期规则在水位推进时一起退出匹配，回收时批量摘除，cgroup 规则集随之释放
+static void hips_test_rule_expiry(struct kunit *test)
+{
+    struct hips_rule rule, matched;
+    u32 permanent, feed;
+    int i;
+
+    KUNIT_ASSERT_EQ(test, hips_expire_rules(1000), 0);
+
+    permanent = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_LOG, 1, "*.example.net");
+
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_DNS;
+    rule.priority = 50;
+    rule.expires_at = 1100;
+    strscpy(rule.target, "c2.example.net", sizeof(rule.target));
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    feed = rule.rule_id;
+
+    // 同一批情报条目，其中一条要一圈之后才到期
+    for (i = 0; i < 16; i++) {
+        rule.rule_id = 0;
+        rule.expires_at = 1100 + i;
+        snprintf(rule.target, sizeof(rule.target), "ioc%d.example.org", i);
+        KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    }
+    rule.rule_id = 0;
+    rule.expires_at = 1100 + HIPS_EXPIRE_SLOT_SECS * HIPS_EXPIRE_WHEEL_SLOTS;
+    strscpy(rule.target, "late.example.org", sizeof(rule.target));
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+
+    rule.rule_id = 0;
+    rule.expires_at = 1100;
+    rule.cgroup_id = 1001;
+    strscpy(rule.target, "tenant.example.org", sizeof(rule.target));
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_config->expire_count, 19U);
+
+    // 已经过期的规则不能加入
+    rule.rule_id = 0;
+    rule.cgroup_id = 0;
+    rule.expires_at = 999;
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_INVALID);
+
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "c2.example.net", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, feed);
+
+    KUNIT_EXPECT_EQ(test, hips_expire_rules(1107), 10);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "c2.example.net", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, permanent);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "ioc8.example.org", &matched),
+                    HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_get_rule(feed, &rule), HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, hips_config->cgroup_set_count, 0U);
+
+    // 跳过很长一段时间后一次回收完，一圈之后才到期的规则仍然保留
+    KUNIT_EXPECT_EQ(test, hips_expire_rules(1100 + HIPS_EXPIRE_SLOT_SECS * 10), 8);
+    KUNIT_EXPECT_EQ(test, hips_config->expire_count, 1U);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "late.example.org", &matched),
+                    HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_expire_rules(1100 + HIPS_EXPIRE_SLOT_SECS * HIPS_EXPIRE_WHEEL_SLOTS),
+                    1);
+    KUNIT_EXPECT_EQ(test, hips_config->expire_count, 0U);
+
+    // 规则行的第 8 个字段为过期时间
+    KUNIT_EXPECT_EQ(test, hips_parse_rule_line("dns|block|5|evil.com|情报||||"), 0);
+    KUNIT_EXPECT_NE(test, hips_parse_rule_line("dns|block|5|old.com|情报|0|0|1000"), 0);
+}
+
+// 删除、过期和清空影子规则集时，DNS 规则学习到的动态 IP（包括尚在暂存区中的）随之失效
+static void hips_test_dynip_forget(struct kunit *test)
+{
+    struct hips_network_addr addr = { .family = AF_INET };
+    struct hips_rule rule, matched;
+    u8 deleted_ip[4] = { 192, 0, 2, 1 };
+    u8 expired_ip[4] = { 192, 0, 2, 2 };
+    u8 shadow_ip[4] = { 192, 0, 2, 3 };
+    u8 kept_ip[4] = { 192, 0, 2, 4 };
+    u32 deleted, expiring, kept;
+
+    KUNIT_ASSERT_EQ(test, hips_dynip_init(), 0);
+    KUNIT_ASSERT_EQ(test, hips_expire_rules(1000), 0);
+
+    deleted = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_LOG, 10, "deleted.example");
+    kept = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_LOG, 10, "kept.example");
+
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_DNS;
+    rule.action = HIPS_ACTION_LOG;
+    rule.expires_at = 1100;
+    strscpy(rule.target, "expiring.example", sizeof(rule.target));
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    expiring = rule.rule_id;
+
+    rule.rule_id = 0;
+    rule.expires_at = 0;
+    rule.flags = HIPS_RULE_F_SHADOW;
+    strscpy(rule.target, "shadow.example", sizeof(rule.target));
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+
+    KUNIT_ASSERT_EQ(test, hips_get_rule(deleted, &matched), HIPS_SUCCESS);
+    KUNIT_ASSERT_EQ(test, hips_dynip_add(AF_INET, deleted_ip, 300, &matched), HIPS_SUCCESS);
+    KUNIT_ASSERT_EQ(test, hips_get_rule(expiring, &matched), HIPS_SUCCESS);
+    KUNIT_ASSERT_EQ(test, hips_dynip_add(AF_INET, expired_ip, 300, &matched), HIPS_SUCCESS);
+    KUNIT_ASSERT_EQ(test, hips_get_rule(rule.rule_id, &matched), HIPS_SUCCESS);
+    KUNIT_ASSERT_EQ(test, hips_dynip_add(AF_INET, shadow_ip, 300, &matched), HIPS_SUCCESS);
+    KUNIT_ASSERT_EQ(test, hips_get_rule(kept, &matched), HIPS_SUCCESS);
+    KUNIT_ASSERT_EQ(test, hips_dynip_add(AF_INET, kept_ip, 300, &matched), HIPS_SUCCESS);
+
+    KUNIT_EXPECT_EQ(test, hips_del_rule(deleted), HIPS_SUCCESS);
+    memcpy(&addr.addr.ipv4, deleted_ip, 4);
+    KUNIT_EXPECT_EQ(test, hips_dynip_lookup(&addr, 0, &matched), HIPS_ERROR_NOT_FOUND);
+
+    KUNIT_EXPECT_EQ(test, hips_expire_rules(1200), 1);
+    memcpy(&addr.addr.ipv4, expired_ip, 4);
+    KUNIT_EXPECT_EQ(test, hips_dynip_lookup(&addr, 0, &matched), HIPS_ERROR_NOT_FOUND);
+
+    KUNIT_EXPECT_EQ(test, hips_shadow_clear(), 1);
+    memcpy(&addr.addr.ipv4, shadow_ip, 4);
+    KUNIT_EXPECT_EQ(test, hips_dynip_lookup(&addr, 0, &matched), HIPS_ERROR_NOT_FOUND);
+
+    memcpy(&addr.addr.ipv4, kept_ip, 4);
+    KUNIT_EXPECT_EQ(test, hips_dynip_lookup(&addr, 0, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, kept);
+
+    hips_dynip_exit();
+}
+
+// 结构化网络规则
+static u32 hips_test_add_net(struct kunit *test, u32 action, u32 priority, const char *addr,
+                             u8 prefix_len, u8 protocol, u16 port_min, u16 port_max, u8 direction)
+{
+    struct hips_rule rule;
+
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_NETWORK;
+    rule.action = action;
+    rule.priority = priority;
+    rule.flags = HIPS_RULE_F_STRUCTURED;
+    rule.net.family = strchr(addr, ':') ? AF_INET6 : AF_INET;
+    if (rule.net.family == AF_INET) {
+        KUNIT_ASSERT_EQ(test, in4_pton(addr, -1, rule.net.addr, -1, NULL), 1);
+    } else {
+        KUNIT_ASSERT_EQ(test, in6_pton(addr, -1, rule.net.addr, -1, NULL), 1);
+    }
+    rule.net.prefix_len = prefix_len;
+    rule.net.protocol = protocol;
+    rule.net.port_min = port_min;
+    rule.net.port_max = port_max;
+    rule.net.direction = direction;
+    strscpy(rule.target, addr, sizeof(rule.target));
+
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    return rule.rule_id;
+}
+
+static int hips_test_match_net(const char *addr, u8 protocol, u16 port, u8 direction,
+                               const char *target, struct hips_rule *matched)
+{
+    struct hips_net_key key;
+
+    memset(&key, 0, sizeof(key));
+    key.family = strchr(addr, ':') ? AF_INET6 : AF_INET;
+    if (key.family == AF_INET) {
+        in4_pton(addr, -1, key.addr, -1, NULL);
+    } else {
+        in6_pton(addr, -1, key.addr, -1, NULL);
+    }
+    key.protocol = protocol;
+    key.port = port;
+    key.direction = direction;
+
+    return hips_match_network(NULL, 0, &key, target, matched);
+}
+
+static void hips_test_structured_network(struct kunit *test)
+{
+    struct hips_rule rule, matched;
+    u32 lowports, subnet, v6;
+
+    // 地址按前缀掩码后存储
+    lowports = hips_test_add_net(test, HIPS_ACTION_BLOCK, 50, "10.1.2.3", 8,
+                                 IPPROTO_TCP, 1, 1024, HIPS_DIR_OUT);
+    KUNIT_ASSERT_EQ(test, hips_get_rule(lowports, &rule), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, rule.net.addr[1], 0);
+
+    KUNIT_EXPECT_EQ(test, hips_test_match_net("10.200.0.1", IPPROTO_TCP, 22, HIPS_DIR_OUT,
+                                              NULL, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, lowports);
+    KUNIT_EXPECT_NE(test, hips_test_match_net("10.200.0.1", IPPROTO_UDP, 22, HIPS_DIR_OUT,
+                                              NULL, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_NE(test, hips_test_match_net("10.200.0.1", IPPROTO_TCP, 2000, HIPS_DIR_OUT,
+                                              NULL, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_NE(test, hips_test_match_net("10.200.0.1", IPPROTO_TCP, 22, HIPS_DIR_IN,
+                                              NULL, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_NE(test, hips_test_match_net("11.0.0.1", IPPROTO_TCP, 22, HIPS_DIR_OUT,
+                                              NULL, &matched), HIPS_SUCCESS);
+
+    // 端口 0-0 表示任意端口，优先级高的元组先命中
+    subnet = hips_test_add_net(test, HIPS_ACTION_LOG, 60, "10.200.0.0", 16, 0, 0, 0, HIPS_DIR_ANY);
+    KUNIT_EXPECT_EQ(test, hips_test_match_net("10.200.0.1", IPPROTO_TCP, 22, HIPS_DIR_OUT,
+                                              NULL, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, subnet);
+    KUNIT_EXPECT_EQ(test, hips_test_match_net("10.200.0.1", IPPROTO_UDP, 9999, HIPS_DIR_IN,
+                                              NULL, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, subnet);
+
+    v6 = hips_test_add_net(test, HIPS_ACTION_BLOCK, 10, "2001:db8::", 32,
+                           IPPROTO_UDP, 53, 53, HIPS_DIR_ANY);
+    KUNIT_EXPECT_EQ(test, hips_test_match_net("2001:db8:1::5", IPPROTO_UDP, 53, HIPS_DIR_OUT,
+                                              NULL, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, v6);
+    KUNIT_EXPECT_NE(test, hips_test_match_net("2001:db9::5", IPPROTO_UDP, 53, HIPS_DIR_OUT,
+                                              NULL, &matched), HIPS_SUCCESS);
+
+    // 只有结构化规则时网络钩子不格式化地址
+    KUNIT_EXPECT_FALSE(test, hips_network_strings(NULL, 0, false));
+
+    // 字符串规则与结构化规则按优先级合并，字符串匹配看不到结构化规则
+    hips_test_add(test, HIPS_RULE_NETWORK, HIPS_ACTION_ALLOW, 70, "10.200.0.1:22");
+    KUNIT_EXPECT_TRUE(test, hips_network_strings(NULL, 0, false));
+    KUNIT_EXPECT_EQ(test, hips_test_match_net("10.200.0.1", IPPROTO_TCP, 22, HIPS_DIR_OUT,
+                                              "10.200.0.1:22", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.action, (u32)HIPS_ACTION_ALLOW);
+    KUNIT_EXPECT_NE(test, hips_match_rule(HIPS_RULE_NETWORK, "10.1.2.3", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, rcu_access_pointer(hips_config->rules)->network_strings, 1U);
+
+    // 无效的前缀和端口范围
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_NETWORK;
+    rule.flags = HIPS_RULE_F_STRUCTURED;
+    rule.net.family = AF_INET;
+    rule.net.prefix_len = 33;
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_INVALID);
+    rule.net.prefix_len = 8;
+    rule.net.port_min = 9;
+    rule.net.port_max = 1;
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_INVALID);
+
+    // 删除后回退到低优先级的规则，空元组被释放
+    KUNIT_EXPECT_EQ(test, hips_del_rule(subnet), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_test_match_net("10.200.0.1", IPPROTO_TCP, 22, HIPS_DIR_OUT,
+                                              NULL, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, lowports);
+    KUNIT_EXPECT_EQ(test, hips_config->netcls_count, 2U);
+    KUNIT_EXPECT_EQ(test, rcu_access_pointer(hips_config->rules)->netcls.count, 2U);
+}
+
+// 通配符模式
+static void hips_test_wildcard(struct kunit *test)
+{
+    static const struct {
+        const char *pattern;
+        const char *string;
+        int match;
+    } cases[] = {
+        { "evil.com",      "evil.com",           1 },
+        { "evil.com",      "notevil.com",        0 },
+        { "*.malware.com", "a.malware.com",      1 },
+        { "*.malware.com", "a.b.malware.com",    1 },
+        { "*.malware.com", "malware.com",        0 },
+        { "/tmp/*",        "/tmp/x",             1 },
+        { "/tmp/*",        "/tmp/a/b/c",         1 },
+        { "/tmp/*",        "/tmpx",              0 },
+        { "/tmp/*.exe",    "/tmp/dropper.exe",   1 },
+        { "/tmp/*.exe",    "/tmp/dropper.sh",    0 },
+        { "/home/*/Downloads/*", "/home/u/Downloads/a", 1 },
+        { "/bin/?s",       "/bin/ls",            1 },
+        { "/bin/?s",       "/bin/lss",           0 },
+        { "*",             "anything",           1 },
+        { "",              "anything",           0 },
+    };
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(cases); i++) {
+        KUNIT_EXPECT_EQ_MSG(test, hips_match_pattern(cases[i].pattern, cases[i].string),
+                            cases[i].match, "pattern=%s string=%s",
+                            cases[i].pattern, cases[i].string);
+    }
+}
+
+// 目录规则走路径字典树：结果与逐条通配符匹配一致，路径先规范化，与逐条匹配的规则按优先级合并
+static void hips_test_path_trie(struct kunit *test)
+{
+    static const struct {
+        const char *path;
+        const char *target;     // 期望命中的规则，NULL 表示不命中
+    } cases[] = {
+        { "/tmp/x",                     "/tmp/*" },
+        { "/tmp/a/b/c",                 "/tmp/*" },
+        { "/tmpx",                      NULL },
+        { "/tmp",                       NULL },
+        { "/home/u/Downloads/a",        "/home/*/Downloads/*" },
+        { "/home/u/v/Downloads/a",      "/home/*/Downloads/*" },
+        { "/home/Downloads/a",          NULL },
+        { "/usr/bin/ls",                "/usr/bin/ls" },
+        { "/usr/bin/lsx",               NULL },
+        { "/tmp/dropper.exe",           "/tmp/*.exe" },
+        { "/var/tmp/../../tmp/x",       "/tmp/*" },
+        { "//tmp/./x",                  "/tmp/*" },
+        { "/usr/bin/../bin/ls",         "/usr/bin/ls" },
+    };
+    struct hips_rule matched;
+    char buf[64];
+    u32 ids[4];
+    int i;
+
+    ids[0] = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_BLOCK, 10, "/tmp/*");
+    ids[1] = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_BLOCK, 10, "/home/*/Downloads/*");
+    ids[2] = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_LOG, 10, "/usr/bin/ls");
+    // 组件内的通配符不能放进字典树，优先级更高时仍然胜出
+    ids[3] = hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_LOG, 20, "/tmp/*.exe");
+    KUNIT_EXPECT_EQ(test, rcu_access_pointer(hips_config->rules)->paths.count, 3U);
+
+    for (i = 0; i < ARRAY_SIZE(cases); i++) {
+        if (!cases[i].target) {
+            KUNIT_EXPECT_EQ_MSG(test, hips_match_rule(HIPS_RULE_EXEC, cases[i].path, &matched),
+                                HIPS_ERROR_NOT_FOUND, "path=%s", cases[i].path);
+            continue;
+        }
+        KUNIT_EXPECT_EQ_MSG(test, hips_match_rule(HIPS_RULE_EXEC, cases[i].path, &matched),
+                            HIPS_SUCCESS, "path=%s", cases[i].path);
+        KUNIT_EXPECT_STREQ_MSG(test, matched.target, cases[i].target, "path=%s", cases[i].path);
+    }
+
+    // 同优先级时先加入的规则优先，无论它在字典树内还是外
+    hips_test_add(test, HIPS_RULE_EXEC, HIPS_ACTION_ALLOW, 10, "/usr/bin/l?");
+    KUNIT_ASSERT_EQ(test, hips_match_rule(HIPS_RULE_EXEC, "/usr/bin/ls", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, ids[2]);
+
+    KUNIT_ASSERT_EQ(test, hips_path_canonicalize("/a/./b/../../c//", buf, sizeof(buf)), 0);
+    KUNIT_EXPECT_STREQ(test, buf, "/c");
+    KUNIT_ASSERT_EQ(test, hips_path_canonicalize("/..", buf, sizeof(buf)), 0);
+    KUNIT_EXPECT_STREQ(test, buf, "/");
+
+    // 删除最后一条目录规则后字典树节点全部释放
+    for (i = 0; i < 3; i++) {
+        KUNIT_EXPECT_EQ(test, hips_del_rule(ids[i]), HIPS_SUCCESS);
+    }
+    KUNIT_EXPECT_EQ(test, rcu_access_pointer(hips_config->rules)->paths.count, 0U);
+    KUNIT_EXPECT_PTR_EQ(test, rcu_access_pointer(rcu_access_pointer(hips_config->rules)->paths.root),
+                        NULL);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_EXEC, "/tmp/x", &matched), HIPS_ERROR_NOT_FOUND);
+}
+
+// 影子规则集：只由影子匹配函数查询，不影响生效规则集；提升时交换两个规则集，再提升一次即回退。
+// 配置文件规则不参与交换，提升和回退后仍只有一份且一直生效
+static void hips_test_shadow(struct kunit *test)
+{
+    static const char *const config[] = {
+        "dns|block|5|cfg.example",
+    };
+    struct hips_rule_delta delta;
+    struct hips_rule rule, matched;
+    u32 live_id, shadow_id, config_id;
+    int status;
+
+    live_id = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_LOG, 10, "evil.com");
+    KUNIT_ASSERT_EQ(test, hips_sync_config_rules(config, ARRAY_SIZE(config), &delta), HIPS_SUCCESS);
+    kvfree(delta.removed_ids);
+    KUNIT_ASSERT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "cfg.example", &matched), HIPS_SUCCESS);
+    config_id = matched.rule_id;
+    KUNIT_EXPECT_EQ(test, rcu_access_pointer(hips_config->rules)->rule_count, 1U);
+
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_DNS;
+    rule.action = HIPS_ACTION_BLOCK;
+    rule.priority = 20;
+    rule.flags = HIPS_RULE_F_SHADOW;
+    strscpy(rule.target, "*.evil.com", sizeof(rule.target));
+    KUNIT_ASSERT_EQ(test, hips_add_rules(&rule, 1, &status), 1);
+    shadow_id = rule.rule_id;
+    KUNIT_EXPECT_EQ(test, hips_shadow_rule_count(), 1U);
+
+    // 生效规则集看不到影子规则，反之亦然
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "a.evil.com", &matched),
+                    HIPS_ERROR_NOT_FOUND);
+    KUNIT_ASSERT_EQ(test, hips_shadow_match_rule(NULL, 0, HIPS_RULE_DNS, "a.evil.com", &matched),
+                    HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, shadow_id);
+    KUNIT_EXPECT_EQ(test, hips_shadow_match_rule(NULL, 0, HIPS_RULE_DNS, "evil.com", &matched),
+                    HIPS_ERROR_NOT_FOUND);
+
+    // 标志按所在规则集给出
+    KUNIT_ASSERT_EQ(test, hips_get_rule(shadow_id, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_TRUE(test, matched.flags & HIPS_RULE_F_SHADOW);
+    KUNIT_ASSERT_EQ(test, hips_get_rule(live_id, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_FALSE(test, matched.flags & HIPS_RULE_F_SHADOW);
+
+    // 影子规则只能是全局范围
+    rule.rule_id = 0;
+    rule.cgroup_id = 42;
+    rule.flags = HIPS_RULE_F_SHADOW;
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_INVALID);
+
+    // 影子评估叠加调用者所在范围的规则集，作用范围内的阻止不会被当作分歧
+    rule.flags = 0;
+    strscpy(rule.target, "scoped.example", sizeof(rule.target));
+    KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    KUNIT_ASSERT_EQ(test, hips_shadow_match_rule(NULL, 42, HIPS_RULE_DNS, "scoped.example",
+                                                 &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, rule.rule_id);
+    KUNIT_EXPECT_EQ(test, hips_shadow_match_rule(NULL, 0, HIPS_RULE_DNS, "scoped.example",
+                                                 &matched), HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, hips_del_rule(rule.rule_id), HIPS_SUCCESS);
+
+    // 影子评估同样叠加配置文件规则
+    KUNIT_ASSERT_EQ(test, hips_shadow_match_rule(NULL, 0, HIPS_RULE_DNS, "cfg.example", &matched),
+                    HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, config_id);
+
+    KUNIT_EXPECT_EQ(test, hips_shadow_promote(), 1);
+    KUNIT_ASSERT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "a.evil.com", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, shadow_id);
+    KUNIT_ASSERT_EQ(test, hips_get_rule(live_id, &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_TRUE(test, matched.flags & HIPS_RULE_F_SHADOW);
+    KUNIT_ASSERT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "cfg.example", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, config_id);
+    KUNIT_EXPECT_FALSE(test, matched.flags & HIPS_RULE_F_SHADOW);
+
+    KUNIT_EXPECT_EQ(test, hips_shadow_promote(), 1);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "a.evil.com", &matched),
+                    HIPS_ERROR_NOT_FOUND);
+    KUNIT_ASSERT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "cfg.example", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.rule_id, config_id);
+
+    // 回退后重新加载配置，规则原样保留，不重复也不丢失
+    KUNIT_ASSERT_EQ(test, hips_sync_config_rules(config, ARRAY_SIZE(config), &delta), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, delta.kept, 1U);
+    KUNIT_EXPECT_EQ(test, delta.added + delta.removed, 0U);
+    kvfree(delta.removed_ids);
+    KUNIT_EXPECT_EQ(test, hips_config->global_sets[HIPS_CONFIG_SET].rule_count, 1U);
+
+    // 清空后影子规则从索引中删除，空的影子规则集不能提升
+    KUNIT_EXPECT_EQ(test, hips_shadow_clear(), 1);
+    KUNIT_EXPECT_EQ(test, hips_get_rule(shadow_id, &matched), HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, hips_shadow_promote(), HIPS_ERROR_NOT_FOUND);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "evil.com", &matched), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_get_rule(config_id, &matched), HIPS_SUCCESS);
+}
+
+// IPv4 地址解析
+static void hips_test_parse_ipv4(struct kunit *test)
+{
+    struct hips_network_addr addr, other;
+
+    KUNIT_ASSERT_EQ(test, hips_parse_ip("192.168.1.100", &addr), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, addr.family, (u32)AF_INET);
+    KUNIT_EXPECT_EQ(test, addr.addr.ipv4, (u32)htonl(0xc0a80164));
+    KUNIT_EXPECT_EQ(test, addr.port, (u16)0);
+
+    KUNIT_ASSERT_EQ(test, hips_parse_ip("192.168.1.100:22", &other), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, other.port, (u16)22);
+    KUNIT_EXPECT_TRUE(test, hips_match_ip(&addr, &other));
+
+    KUNIT_ASSERT_EQ(test, hips_parse_ip("192.168.1.101:22", &other), HIPS_SUCCESS);
+    KUNIT_EXPECT_FALSE(test, hips_match_ip(&addr, &other));
+
+    KUNIT_EXPECT_EQ(test, hips_parse_ip("192.168.1", &addr), HIPS_ERROR_INVALID);
+    KUNIT_EXPECT_EQ(test, hips_parse_ip("256.1.1.1", &addr), HIPS_ERROR_INVALID);
+    KUNIT_EXPECT_EQ(test, hips_parse_ip("1.2.3.4:70000", &addr), HIPS_ERROR_INVALID);
+    KUNIT_EXPECT_EQ(test, hips_parse_ip("1.2.3.4x", &addr), HIPS_ERROR_INVALID);
+    KUNIT_EXPECT_EQ(test, hips_parse_ip("", &addr), HIPS_ERROR_INVALID);
+}
+
+// IPv6 地址解析
+static void hips_test_parse_ipv6(struct kunit *test)
+{
+    static const u8 expected[16] = {
+        0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01
+    };
+    struct hips_network_addr addr, other;
+
+    KUNIT_ASSERT_EQ(test, hips_parse_ip("2001:db8::1", &addr), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, addr.family, (u32)AF_INET6);
+    KUNIT_EXPECT_EQ(test, memcmp(addr.addr.ipv6, expected, sizeof(expected)), 0);
+    KUNIT_EXPECT_EQ(test, addr.port, (u16)0);
+
+    KUNIT_ASSERT_EQ(test, hips_parse_ip("[2001:db8::1]:443", &other), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, other.port, (u16)443);
+    KUNIT_EXPECT_TRUE(test, hips_match_ip(&addr, &other));
+
+    KUNIT_ASSERT_EQ(test, hips_parse_ip("::1", &other), HIPS_SUCCESS);
+    KUNIT_EXPECT_FALSE(test, hips_match_ip(&addr, &other));
+
+    // 不同地址族不匹配
+    KUNIT_ASSERT_EQ(test, hips_parse_ip("127.0.0.1", &other), HIPS_SUCCESS);
+    KUNIT_EXPECT_FALSE(test, hips_match_ip(&addr, &other));
+
+    KUNIT_EXPECT_EQ(test, hips_parse_ip("2001:db8::zz", &addr), HIPS_ERROR_INVALID);
+    KUNIT_EXPECT_EQ(test, hips_parse_ip("[2001:db8::1", &addr), HIPS_ERROR_INVALID);
+}
+
+// /proc/hips/rules 规则行解析
+static void hips_test_parse_rule_line(struct kunit *test)
+{
+    static const char commands[] = "exec|log|1|/a\n\nexec|log|1|/b\n";
+    struct hips_rule matched;
+
+    KUNIT_EXPECT_EQ(test, hips_parse_rule_line("  exec|block|100|/usr/bin/malware.exe|恶意软件"), 0);
+    KUNIT_EXPECT_EQ(test, hips_parse_rule_line("# 注释行"), 0);
+    KUNIT_EXPECT_EQ(test, hips_parse_rule_line(""), 0);
+    KUNIT_EXPECT_EQ(test, hips_parse_rule_line("dns|log|30|*.suspicious.com"), 0);
+
+    KUNIT_EXPECT_LT(test, hips_parse_rule_line("exec|block"), 0);
+    KUNIT_EXPECT_LT(test, hips_parse_rule_line("file|block|1|/x"), 0);
+    KUNIT_EXPECT_LT(test, hips_parse_rule_line("exec|deny|1|/x"), 0);
+    KUNIT_EXPECT_LT(test, hips_parse_rule_line("exec|block|high|/x"), 0);
+
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_EXEC, "/usr/bin/malware.exe", &matched),
+                    HIPS_SUCCESS);
+    KUNIT_EXPECT_STREQ(test, matched.description, "恶意软件");
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "x.suspicious.com", &matched),
+                    HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, matched.action, (u32)HIPS_ACTION_LOG);
+
+    KUNIT_EXPECT_EQ(test, hips_parse_rules_command(commands, strlen(commands)), 0);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_EXEC, "/b", &matched), HIPS_SUCCESS);
+}
+
+// 记录规则的日志抽样和每秒上限：规则行往返，非记录动作拒绝
+static void hips_test_log_limits(struct kunit *test)
+{
+    struct hips_rule rule, parsed;
+    char line[256];
+    int len;
+
+    KUNIT_ASSERT_EQ(test, hips_parse_rule("dns|log|30|*.suspicious.com|可疑|||0|6|10|50", &rule), 0);
+    KUNIT_EXPECT_EQ(test, rule.log_sample, 10U);
+    KUNIT_EXPECT_EQ(test, rule.log_rate, 50U);
+
+    len = hips_format_rule_line(&rule, line, sizeof(line));
+    KUNIT_ASSERT_GT(test, len, 0);
+    KUNIT_EXPECT_STREQ(test, line, "dns|log|30|*.suspicious.com|可疑|0|0|0|6|10|50\n");
+    KUNIT_ASSERT_EQ(test, hips_parse_rule(line, &parsed), 0);
+    KUNIT_EXPECT_EQ(test, parsed.log_sample, 10U);
+    KUNIT_EXPECT_EQ(test, parsed.log_rate, 50U);
+
+    // 未设置时规则行格式不变
+    KUNIT_ASSERT_EQ(test, hips_parse_rule("exec|log|50|/usr/bin/sudo|sudo|||0|3", &rule), 0);
+    KUNIT_EXPECT_EQ(test, hips_format_rule_line(&rule, line, sizeof(line)), (int)strlen(line));
+    KUNIT_EXPECT_STREQ(test, line, "exec|log|50|/usr/bin/sudo|sudo|0|0|0|3\n");
+
+    KUNIT_EXPECT_LT(test, hips_parse_rule_line("exec|log|50|/usr/bin/su|su|||0||x"), 0);
+    KUNIT_EXPECT_EQ(test, hips_parse_rule_line("exec|log|50|/usr/bin/su|su|||0||4|20"), 0);
+    KUNIT_EXPECT_LT(test, hips_parse_rule_line("exec|block|50|/usr/bin/su|su|||0||4|20"), 0);
+
+    memset(&rule, 0, sizeof(rule));
+    rule.rule_type = HIPS_RULE_DNS;
+    rule.action = HIPS_ACTION_BLOCK;
+    rule.log_rate = 100;
+    strscpy(rule.target, "limited.example.com", sizeof(rule.target));
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_ERROR_INVALID);
+    rule.action = HIPS_ACTION_LOG;
+    KUNIT_EXPECT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, hips_match_rule(HIPS_RULE_DNS, "limited.example.com", &parsed),
+                    HIPS_SUCCESS);
+    KUNIT_EXPECT_EQ(test, parsed.log_rate, 100U);
+}
+
+// 记录事件的准入判定：令牌桶允许达到每秒上限的突发，时间推进后按比例补充；
+// 加入一条带抽样和每秒上限、指定 ID 的 DNS 记录规则
+static void hips_test_add_limited(struct kunit *test, u32 rule_id, u32 sample, u32 rate)
+{
+    char line[128];
+
+    snprintf(line, sizeof(line), "dns|log|10|limited-%u.example|限速|||0|%u|%u|%u",
+             rule_id, rule_id, sample, rate);
+    KUNIT_ASSERT_EQ(test, hips_parse_rule_line(line), 0);
+}
+
+// 抽样每 N 个事件记录第一个，抽中的事件再受上限约束。限速状态按规则、按 CPU 保存，测试期间不迁移
+static void hips_test_log_admit(struct kunit *test)
+{
+    u32 other = 2001;
+    u64 start, earned;
+    int i, admitted, admitted_other;
+
+    hips_test_add_limited(test, 1001, 0, 100);
+    hips_test_add_limited(test, 1002, 4, 0);
+    hips_test_add_limited(test, 1003, 2, 100);
+
+    // 与 2000 落在旧的直接映射槽位上的另一个 ID
+    while (hash_32(other, 6) != hash_32(2000, 6)) {
+        other++;
+    }
+    hips_test_add_limited(test, 2000, 0, 10);
+    hips_test_add_limited(test, other, 0, 10);
+
+    migrate_disable();
+
+    // 每秒上限 100：突发 100 个后拒绝
+    start = ktime_get_ns();
+    for (i = 0, admitted = 0; i < 200; i++) {
+        admitted += hips_log_admit(1001, 0, 100);
+    }
+    KUNIT_EXPECT_EQ(test, admitted, 100);
+    KUNIT_EXPECT_FALSE(test, hips_log_admit(1001, 0, 100));
+
+    // 每 10 毫秒补充一个：睡眠至少 50 毫秒后至少放行 5 个，且不超过开始以来挣得的数量
+    msleep(50);
+    for (i = 0, admitted = 0; i < 200; i++) {
+        admitted += hips_log_admit(1001, 0, 100);
+    }
+    earned = div64_u64(ktime_get_ns() - start, NSEC_PER_SEC / 100);
+    KUNIT_EXPECT_GE(test, admitted, 5);
+    KUNIT_EXPECT_LE(test, (u64)admitted, min_t(u64, earned, 100));
+
+    // 每 4 个记录一个，记录的是每组的第一个
+    for (i = 0; i < 12; i++) {
+        KUNIT_EXPECT_EQ(test, hips_log_admit(1002, 4, 0), (bool)(i % 4 == 0));
+    }
+
+    // 抽样后再限速：400 个事件抽中 200 个，其中 100 个在上限之内
+    for (i = 0, admitted = 0; i < 400; i++) {
+        admitted += hips_log_admit(1003, 2, 100);
+    }
+    KUNIT_EXPECT_EQ(test, admitted, 100);
+
+    // 交替命中的两条规则各自限速，不会互相重置对方的状态
+    for (i = 0, admitted = 0, admitted_other = 0; i < 40; i++) {
+        admitted += hips_log_admit(2000, 0, 10);
+        admitted_other += hips_log_admit(other, 0, 10);
+    }
+    KUNIT_EXPECT_EQ(test, admitted, 10);
+    KUNIT_EXPECT_EQ(test, admitted_other, 10);
+
+    // 不抽样也不限速时总是记录
+    for (i = 0; i < 8; i++) {
+        KUNIT_EXPECT_TRUE(test, hips_log_admit(1004, 1, 0));
+    }
+
+    migrate_enable();
+}
+
+struct hips_test_matcher {
+    struct task_struct *task;
+    unsigned long ops;
+    unsigned long failures;
+};
+
+static int hips_test_matcher_thread(void *data)
+{
+    struct hips_test_matcher *matcher = data;
+    struct hips_rule matched;
+
+    while (!kthread_should_stop()) {
+        if (hips_match_rule(HIPS_RULE_DNS, "stable.example.com", &matched) != HIPS_SUCCESS) {
+            matcher->failures++;
+        }
+        hips_match_rule(HIPS_RULE_DNS, "churn.example.com", &matched);
+        matcher->ops++;
+        cond_resched();
+    }
+
+    return 0;
+}
+
+// 匹配过程中并发添加/删除规则
+static void hips_test_concurrent(struct kunit *test)
+{
+    struct hips_test_matcher matchers[2];
+    u32 id;
+    int i;
+
+    hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_BLOCK, 10, "stable.example.com");
+
+    memset(matchers, 0, sizeof(matchers));
+    for (i = 0; i < ARRAY_SIZE(matchers); i++) {
+        matchers[i].task = kthread_run(hips_test_matcher_thread, &matchers[i],
+                                       "hips_test_match/%d", i);
+        KUNIT_ASSERT_FALSE(test, IS_ERR(matchers[i].task));
+    }
+
+    for (i = 0; i < 5000; i++) {
+        id = hips_test_add(test, HIPS_RULE_DNS, HIPS_ACTION_BLOCK, i % 20, "churn.example.com");
+        KUNIT_EXPECT_EQ(test, hips_del_rule(id), HIPS_SUCCESS);
+        if ((i & 63) == 0) {
+            cond_resched();
+        }
+    }
+
+    for (i = 0; i < ARRAY_SIZE(matchers); i++) {
+        kthread_stop(matchers[i].task);
+        KUNIT_EXPECT_EQ(test, matchers[i].failures, 0UL);
+        KUNIT_EXPECT_GT(test, matchers[i].ops, 0UL);
+    }
+}
+
+static struct kunit_case hips_rules_test_cases[] = {
+    KUNIT_CASE(hips_test_add_del_match),
+    KUNIT_CASE(hips_test_dump_rules),
+    KUNIT_CASE(hips_test_batch),
+    KUNIT_CASE(hips_test_rule_index),
+    KUNIT_CASE(hips_test_sync_config),
+    KUNIT_CASE(hips_test_priority),
+    KUNIT_CASE(hips_test_net_rule_set),
+    KUNIT_CASE(hips_test_cgroup_rule_set),
+    KUNIT_CASE(hips_test_hash_rules),
+    KUNIT_CASE(hips_test_numa_replica),
+    KUNIT_CASE(hips_test_metrics),
+    KUNIT_CASE(hips_test_metrics_dump),
+    KUNIT_CASE(hips_test_rule_expiry),
+    KUNIT_CASE(hips_test_dynip_forget),
+    KUNIT_CASE(hips_test_structured_network),
+    KUNIT_CASE(hips_test_wildcard),
+    KUNIT_CASE(hips_test_path_trie),
+    KUNIT_CASE(hips_test_shadow),
+    KUNIT_CASE(hips_test_parse_ipv4),
+    KUNIT_CASE(hips_test_parse_ipv6),
+    KUNIT_CASE(hips_test_parse_rule_line),
+    KUNIT_CASE(hips_test_log_limits),
+    KUNIT_CASE(hips_test_log_admit),
+    KUNIT_CASE(hips_test_concurrent),
+    {}
+};
+
+static struct kunit_suite hips_rules_test_suite = {
+    .name = "hips_rules",
+    .init = hips_test_init,
+    .exit = hips_test_exit,
+    .test_cases = hips_rules_test_cases,
+};
+
+// ---------------------------------------------------------------------------
+// 基准模式
+// ---------------------------------------------------------------------------
+
+struct hips_bench_ctx {
+    u32 rule_type;
+    char (*queries)[HIPS_TEST_QUERY_LEN];
+    struct completion start;
+};
+
+struct hips_bench_worker {
+    struct hips_bench_ctx *ctx;
+    struct completion done;
+    unsigned int seed;
+    u64 elapsed_ns;
+    unsigned long hits;
+};
+
+static const char *hips_bench_type_name(u32 type)
+{
+    switch (type) {
+        case HIPS_RULE_EXEC:
+            return "exec";
+        case HIPS_RULE_DNS:
+            return "dns";
+        default:
+            return "network";
+    }
+}
+
+static void hips_bench_format(u32 type, unsigned long i, int miss, char *buf, size_t size)
+{
+    switch (type) {
+        case HIPS_RULE_EXEC:
+            snprintf(buf, size, "/opt/hips-bench/bin/%s-%lu", miss ? "miss" : "tool", i);
+            break;
+        case HIPS_RULE_DNS:
+            snprintf(buf, size, "%s-%lu.bench.example", miss ? "miss" : "host", i);
+            break;
+        default:
+            snprintf(buf, size, "%s.%lu.%lu.%lu:443", miss ? "172" : "10",
+                     (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+            break;
+    }
+}
+
+static int hips_bench_parse_list(const char *arg, unsigned long *out, int max)
+{
+    char *copy, *cursor, *token;
+    int count = 0;
+
+    copy = kstrdup(arg, GFP_KERNEL);
+    if (!copy) {
+        return 0;
+    }
+
+    cursor = copy;
+    while ((token = strsep(&cursor, ",")) != NULL && count < max) {
+        if (kstrtoul(token, 10, &out[count]) == 0 && out[count] > 0) {
+            count++;
+        }
+    }
+
+    kfree(copy);
+    return count;
+}
+
+static int hips_bench_thread(void *data)
+{
+    struct hips_bench_worker *worker = data;
+    struct hips_bench_ctx *ctx = worker->ctx;
+    struct hips_rule matched;
+    unsigned int i;
+    u64 start;
+
+    wait_for_completion(&ctx->start);
+
+    start = ktime_get_ns();
+    for (i = 0; i < hips_bench_ops; i++) {
+        worker->seed = worker->seed * 1103515245 + 12345;
+        if (hips_match_rule(ctx->rule_type,
+                            ctx->queries[(worker->seed >> 8) % HIPS_TEST_QUERY_COUNT],
+                            &matched) == HIPS_SUCCESS) {
+            worker->hits++;
+        }
+        if ((i & 255) == 0) {
+            cond_resched();
+        }
+    }
+    worker->elapsed_ns = ktime_get_ns() - start;
+
+    complete(&worker->done);
+    return 0;
+}
+
+static void hips_bench_run(struct kunit *test, struct hips_bench_ctx *ctx,
+                           unsigned long rules, unsigned long threads)
+{
+    struct hips_bench_worker *workers;
+    struct task_struct *task;
+    u64 wall_start, wall_ns, thread_ns = 0;
+    unsigned long hits = 0, ops;
+    unsigned long i;
+
+    workers = kcalloc(threads, sizeof(*workers), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, workers);
+
+    reinit_completion(&ctx->start);
+    for (i = 0; i < threads; i++) {
+        workers[i].ctx = ctx;
+        workers[i].seed = i * 7919 + 1;
+        init_completion(&workers[i].done);
+        task = kthread_run(hips_bench_thread, &workers[i], "hips_bench/%lu", i);
+        if (IS_ERR(task)) {
+            complete(&workers[i].done);
+        }
+    }
+
+    wall_start = ktime_get_ns();
+    complete_all(&ctx->start);
+    for (i = 0; i < threads; i++) {
+        wait_for_completion(&workers[i].done);
+        thread_ns += workers[i].elapsed_ns;
+        hits += workers[i].hits;
+    }
+    wall_ns = ktime_get_ns() - wall_start;
+
+    ops = threads * hips_bench_ops;
+    kunit_info(test, "HIPS_BENCH {\"type\":\"%s\",\"rules\":%lu,\"threads\":%lu,"
+               "\"ops\":%lu,\"hits\":%lu,\"ns_per_op\":%llu,\"ops_per_sec\":%llu}\n",
+               hips_bench_type_name(ctx->rule_type), rules, threads, ops, hits,
+               div64_u64(thread_ns, ops), div64_u64((u64)ops * NSEC_PER_SEC, wall_ns ?: 1));
+
+    kfree(workers);
+}
+
+// hips_match_rule 随规则规模和线程数的耗时
+static void hips_bench_match(struct kunit *test)
+{
+    static const u32 types[] = { HIPS_RULE_EXEC, HIPS_RULE_DNS, HIPS_RULE_NETWORK };
+    unsigned long sizes[HIPS_TEST_MAX_LIST], threads[HIPS_TEST_MAX_LIST];
+    struct hips_bench_ctx ctx;
+    struct hips_rule rule;
+    int size_count, thread_count;
+    int t, s, n;
+    unsigned long i;
+
+    if (!hips_bench) {
+        kunit_skip(test, "基准未启用，加载时指定 hips_bench=1");
+    }
+
+    size_count = hips_bench_parse_list(hips_bench_sizes, sizes, ARRAY_SIZE(sizes));
+    thread_count = hips_bench_parse_list(hips_bench_threads, threads, ARRAY_SIZE(threads));
+
+    ctx.queries = kvmalloc_array(HIPS_TEST_QUERY_COUNT, HIPS_TEST_QUERY_LEN, GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, ctx.queries);
+    init_completion(&ctx.start);
+
+    for (t = 0; t < ARRAY_SIZE(types); t++) {
+        ctx.rule_type = types[t];
+
+        for (s = 0; s < size_count; s++) {
+            // 加载规则
+            for (i = 0; i < sizes[s]; i++) {
+                memset(&rule, 0, sizeof(rule));
+                rule.rule_type = types[t];
+                rule.action = HIPS_ACTION_BLOCK;
+                rule.priority = 100;
+                hips_bench_format(types[t], i, 0, rule.target, sizeof(rule.target));
+                KUNIT_ASSERT_EQ(test, hips_add_rule(&rule), HIPS_SUCCESS);
+                if ((i & 1023) == 0) {
+                    cond_resched();
+                }
+            }
+
+            // 一半命中、一半未命中
+            for (i = 0; i < HIPS_TEST_QUERY_COUNT; i++) {
+                hips_bench_format(types[t], (i * 2654435761UL) % sizes[s], i & 1,
+                                  ctx.queries[i], HIPS_TEST_QUERY_LEN);
+            }
+
+            for (n = 0; n < thread_count; n++) {
+                hips_bench_run(test, &ctx, sizes[s],
+                               min_t(unsigned long, threads[n], HIPS_TEST_MAX_THREADS));
+            }
+
+            hips_cleanup_rules();
+        }
+    }
+
+    kvfree(ctx.queries);
+}
+
+static struct kunit_case hips_bench_test_cases[] = {
+    KUNIT_CASE(hips_bench_match),
+    {}
+};
+
+static struct kunit_suite hips_bench_test_suite = {
+    .name = "hips_match_bench",
+    .init = hips_test_init,
+    .exit = hips_test_exit,
+    .test_cases = hips_bench_test_cases,
+};
+
+kunit_test_suites(&hips_rules_test_suite, &hips_bench_test_suite);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("HIPS match path KUnit tests");
@@ -0,0 +1,540 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../include/hips.h"
+
+/*
+ * HIPS exec 压测工具
+ *
+ * 由 N 个并行 worker 反复 execve 指定程序，记录每次 exec 的延迟分位数，
+ * 用于衡量 bprm_check 钩子 (hips_exec_hook) 的开销。可以通过 ioctl
+ * 临时加载 1k/100k/1M 条不会命中的 exec 规则，对比模块未加载、
+ * 已加载但禁用以及不同规则规模下的延迟。
+ *
+ * --hash 改为加载哈希规则，每个 worker 执行程序的一份私有副本；
+ * 加上 --cold 时每次 exec 前向副本末尾追加一个字节，使文件摘要缓存失效，
+ * 两者对比即为摘要计算（冷）与缓存命中（热）的 exec 延迟。
+ */
+
+#define HIPS_DEVICE         "/dev/hips"
+#define BENCH_MAX_WORKERS   256
+
+extern char **environ;
+
+struct bench_options {
+    const char *device;
+    char **argv;            // 被执行的程序及参数
+    int workers;
+    unsigned long execs;    // 每个 worker 的 exec 次数
+    unsigned long rules;    // 通过 ioctl 加载的规则数
+    int matrix;
+    int csv;
+    int hash;               // 加载哈希规则，执行程序副本
+    int cold;               // 每次 exec 前修改程序副本
+};
+
+struct bench_worker {
+    pthread_t thread;
+    const struct bench_options *opts;
+    char **argv;
+    char path[64];          // 程序副本（--hash）
+    unsigned long long *latencies;
+    unsigned long count;
+    unsigned long failures;
+};
+
+struct bench_result {
+    const char *label;
+    unsigned long rules;
+    unsigned long execs;
+    unsigned long failures;
+    double wall_s;
+    unsigned long long p50;
+    unsigned long long p90;
+    unsigned long long p99;
+    unsigned long long p999;
+    unsigned long long max;
+};
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// 为 worker 复制一份被执行的程序，各 worker 的摘要缓存条目互不影响
+static int bench_copy_program(const char *src, char *path, size_t size)
+{
+    char buf[65536];
+    ssize_t len;
+    int in, out;
+
+    snprintf(path, size, "/tmp/hips-bench-XXXXXX");
+    out = mkstemp(path);
+    if (out < 0) {
+        return -1;
+    }
+
+    in = open(src, O_RDONLY);
+    if (in < 0) {
+        close(out);
+        unlink(path);
+        return -1;
+    }
+    while ((len = read(in, buf, sizeof(buf))) > 0) {
+        if (write(out, buf, len) != len) {
+            len = -1;
+            break;
+        }
+    }
+    close(in);
+
+    // 写入的文件描述符关闭之后才能执行，否则 ETXTBSY
+    if (len < 0 || fchmod(out, 0755) != 0) {
+        close(out);
+        unlink(path);
+        return -1;
+    }
+    close(out);
+
+    return 0;
+}
+
+// 向程序副本末尾追加一个字节：大小和 i_version 都会变化，下一次 exec 必须重新计算摘要
+static int bench_touch_program(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_APPEND);
+    int ret;
+
+    if (fd < 0) {
+        return -1;
+    }
+    ret = write(fd, "", 1) == 1 ? 0 : -1;
+    close(fd);
+
+    return ret;
+}
+
+static void *bench_worker_main(void *arg)
+{
+    struct bench_worker *worker = arg;
+    const struct bench_options *opts = worker->opts;
+    unsigned long i;
+
+    for (i = 0; i < opts->execs; i++) {
+        unsigned long long start;
+        pid_t pid;
+        int status;
+
+        if (opts->cold && bench_touch_program(worker->path) < 0) {
+            worker->failures++;
+            continue;
+        }
+
+        start = now_ns();
+        if (posix_spawn(&pid, worker->argv[0], NULL, NULL, worker->argv, environ) != 0) {
+            worker->failures++;
+            continue;
+        }
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+            worker->failures++;
+            continue;
+        }
+
+        worker->latencies[worker->count++] = now_ns() - start;
+    }
+
+    return NULL;
+}
+
+// 复制参数数组，argv[0] 换成 worker 的程序副本
+static char **bench_worker_argv(char **argv, char *path)
+{
+    char **copy;
+    int argc = 0;
+
+    while (argv[argc]) {
+        argc++;
+    }
+    copy = calloc(argc + 1, sizeof(char *));
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, argv, argc * sizeof(char *));
+    copy[0] = path;
+
+    return copy;
+}
+
+// 运行一轮压测
+static int bench_run(const struct bench_options *opts, const char *label, unsigned long rules,
+                     struct bench_result *result)
+{
+    struct bench_worker workers[BENCH_MAX_WORKERS];
+    unsigned long long *all, start;
+    unsigned long total = 0;
+    int i;
+
+    memset(workers, 0, sizeof(workers));
+    memset(result, 0, sizeof(*result));
+
+    for (i = 0; i < opts->workers; i++) {
+        workers[i].opts = opts;
+        workers[i].argv = opts->argv;
+        workers[i].latencies = calloc(opts->execs, sizeof(unsigned long long));
+        if (!workers[i].latencies) {
+            fprintf(stderr, "错误: 内存不足\n");
+            return -1;
+        }
+        if (opts->hash) {
+            if (bench_copy_program(opts->argv[0], workers[i].path, sizeof(workers[i].path)) < 0) {
+                fprintf(stderr, "错误: 无法复制 %s: %s\n", opts->argv[0], strerror(errno));
+                return -1;
+            }
+            workers[i].argv = bench_worker_argv(opts->argv, workers[i].path);
+            if (!workers[i].argv) {
+                fprintf(stderr, "错误: 内存不足\n");
+                return -1;
+            }
+        }
+    }
+
+    start = now_ns();
+    for (i = 0; i < opts->workers; i++) {
+        pthread_create(&workers[i].thread, NULL, bench_worker_main, &workers[i]);
+    }
+    for (i = 0; i < opts->workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+        total += workers[i].count;
+        result->failures += workers[i].failures;
+    }
+    result->wall_s = (now_ns() - start) / 1e9;
+
+    all = calloc(total ? total : 1, sizeof(unsigned long long));
+    if (!all) {
+        fprintf(stderr, "错误: 内存不足\n");
+        return -1;
+    }
+
+    total = 0;
+    for (i = 0; i < opts->workers; i++) {
+        memcpy(all + total, workers[i].latencies, workers[i].count * sizeof(unsigned long long));
+        total += workers[i].count;
+        free(workers[i].latencies);
+        if (opts->hash) {
+            unlink(workers[i].path);
+            free(workers[i].argv);
+        }
+    }
+
+    result->label = label;
+    result->rules = rules;
+    result->execs = total;
+    if (total > 0) {
+        qsort(all, total, sizeof(unsigned long long), cmp_u64);
+        result->p50 = all[total * 50 / 100];
+        result->p90 = all[total * 90 / 100];
+        result->p99 = all[total * 99 / 100];
+        result->p999 = all[total * 999 / 1000];
+        result->max = all[total - 1];
+    }
+
+    free(all);
+    return 0;
+}
+
+static void print_header(const struct bench_options *opts)
+{
+    if (opts->csv) {
+        printf("mode,rules,execs,failures,execs_per_sec,p50_us,p90_us,p99_us,p999_us,max_us\n");
+    } else {
+        printf("%-10s %9s %9s %6s %10s %9s %9s %9s %9s %9s\n",
+               "mode", "rules", "execs", "fail", "execs/s",
+               "p50_us", "p90_us", "p99_us", "p999_us", "max_us");
+    }
+}
+
+static void print_result(const struct bench_options *opts, const struct bench_result *r)
+{
+    double rate = r->wall_s > 0 ? r->execs / r->wall_s : 0;
+
+    if (opts->csv) {
+        printf("%s,%lu,%lu,%lu,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+               r->label, r->rules, r->execs, r->failures, rate,
+               r->p50 / 1e3, r->p90 / 1e3, r->p99 / 1e3, r->p999 / 1e3, r->max / 1e3);
+    } else {
+        printf("%-10s %9lu %9lu %6lu %10.0f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+               r->label, r->rules, r->execs, r->failures, rate,
+               r->p50 / 1e3, r->p90 / 1e3, r->p99 / 1e3, r->p999 / 1e3, r->max / 1e3);
+    }
+    fflush(stdout);
+}
+
+// 通过 ioctl 加载 count 条不会命中的 exec 规则（--hash 时为哈希规则），返回规则ID数组
+static __u32 *load_rules(int fd, unsigned long count, int hash)
+{
+    struct hips_rule rule;
+    __u32 *ids;
+    unsigned long i;
+
+    ids = calloc(count ? count : 1, sizeof(__u32));
+    if (!ids) {
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++) {
+        memset(&rule, 0, sizeof(rule));
+        rule.rule_type = hash ? HIPS_RULE_HASH : HIPS_RULE_EXEC;
+        rule.action = HIPS_ACTION_BLOCK;
+        rule.priority = 0;
+        if (hash) {
+            snprintf(rule.target, sizeof(rule.target), "%064lx", i);
+        } else {
+            snprintf(rule.target, sizeof(rule.target), "/opt/hips-bench/never-%lu", i);
+        }
+        snprintf(rule.description, sizeof(rule.description), "hips-bench");
+
+        if (ioctl(fd, HIPS_IOCTL_ADD_RULE, &rule) != 0) {
+            fprintf(stderr, "错误: 添加第 %lu 条规则失败: %s\n", i, strerror(errno));
+            free(ids);
+            return NULL;
+        }
+        ids[i] = rule.rule_id;
+    }
+
+    return ids;
+}
+
+static void unload_rules(int fd, __u32 *ids, unsigned long count)
+{
+    unsigned long i;
+
+    for (i = 0; i < count; i++) {
+        ioctl(fd, HIPS_IOCTL_DEL_RULE, ids[i]);
+    }
+    free(ids);
+}
+
+// 在已加载的规则基础上运行一轮，可选临时加载 rules 条规则
+static int run_with_rules(const struct bench_options *opts, int fd, const char *label,
+                          unsigned long rules)
+{
+    struct bench_result result;
+    __u32 *ids = NULL;
+    int ret;
+
+    if (rules > 0) {
+        fprintf(stderr, "加载 %lu 条%s规则...\n", rules, opts->hash ? "哈希" : " exec ");
+        ids = load_rules(fd, rules, opts->hash);
+        if (!ids) {
+            return -1;
+        }
+    }
+
+    ret = bench_run(opts, label, rules, &result);
+    if (ret == 0) {
+        print_result(opts, &result);
+    }
+
+    if (ids) {
+        unload_rules(fd, ids, rules);
+    }
+
+    return ret;
+}
+
+// 矩阵模式：禁用、启用且无额外规则、1k/100k/1M 规则
+static int run_matrix(const struct bench_options *opts, int fd)
+{
+    static const struct {
+        const char *label;
+        unsigned long rules;
+    } steps[] = {
+        { "enabled", 0 },
+        { "1k", 1000 },
+        { "100k", 100000 },
+        { "1m", 1000000 },
+    };
+    struct hips_config config;
+    int i, ret;
+
+    if (ioctl(fd, HIPS_IOCTL_GET_CONFIG, &config) != 0) {
+        fprintf(stderr, "错误: 无法获取配置信息\n");
+        return -1;
+    }
+
+    if (ioctl(fd, HIPS_IOCTL_DISABLE) != 0) {
+        fprintf(stderr, "错误: 无法禁用模块\n");
+        return -1;
+    }
+    ret = run_with_rules(opts, fd, "disabled", 0);
+
+    ioctl(fd, HIPS_IOCTL_ENABLE);
+    for (i = 0; i < (int)(sizeof(steps) / sizeof(steps[0])) && ret == 0; i++) {
+        ret = run_with_rules(opts, fd, steps[i].label, steps[i].rules);
+    }
+
+    // 恢复原来的启用状态
+    if (!config.enabled) {
+        ioctl(fd, HIPS_IOCTL_DISABLE);
+    }
+
+    return ret;
+}
+
+static void print_help(void)
+{
+    printf("HIPS exec 压测工具 - 版本 %s\n", HIPS_MODULE_VERSION);
+    printf("\n用法: hips-bench [选项] [-- 程序 [参数...]]\n");
+    printf("\n选项:\n");
+    printf("  -w, --workers <N>   并行 worker 数 (默认: 4)\n");
+    printf("  -n, --execs <N>     每个 worker 的 exec 次数 (默认: 2000)\n");
+    printf("  -r, --rules <N>     通过 ioctl 临时加载 N 条不命中的 exec 规则\n");
+    printf("  -m, --matrix        依次测量 禁用/启用/1k/100k/1M 规则\n");
+    printf("  -H, --hash          加载哈希规则，执行程序的私有副本（测量文件摘要缓存命中）\n");
+    printf("      --cold          与 --hash 一起使用，每次 exec 前修改副本，测量摘要计算\n");
+    printf("  -c, --csv           以 CSV 格式输出\n");
+    printf("  -d, --device        指定设备文件 (默认: %s)\n", HIPS_DEVICE);
+    printf("  -h, --help          显示此帮助信息\n");
+    printf("\n默认执行 /bin/true。模块未加载时只运行一轮并标记为 unloaded。\n");
+    printf("\n示例:\n");
+    printf("  hips-bench -w 8 -n 5000\n");
+    printf("  hips-bench --matrix -w 16 -- /usr/bin/env true\n");
+    printf("  hips-bench -H -r 1 -- /usr/bin/python3 -c pass\n");
+    printf("  hips-bench -H --cold -r 1 -- /usr/bin/python3 -c pass\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static char *default_argv[] = { "/bin/true", NULL };
+    struct bench_options opts = {
+        .device = HIPS_DEVICE,
+        .argv = default_argv,
+        .workers = 4,
+        .execs = 2000,
+    };
+    struct bench_result result;
+    struct stat st;
+    int fd, opt, ret;
+
+    static struct option long_options[] = {
+        {"workers", required_argument, 0, 'w'},
+        {"execs", required_argument, 0, 'n'},
+        {"rules", required_argument, 0, 'r'},
+        {"matrix", no_argument, 0, 'm'},
+        {"hash", no_argument, 0, 'H'},
+        {"cold", no_argument, 0, 'C'},
+        {"csv", no_argument, 0, 'c'},
+        {"device", required_argument, 0, 'd'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "+w:n:r:mHcd:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'w':
+                opts.workers = atoi(optarg);
+                break;
+            case 'n':
+                opts.execs = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                opts.rules = strtoul(optarg, NULL, 10);
+                break;
+            case 'm':
+                opts.matrix = 1;
+                break;
+            case 'H':
+                opts.hash = 1;
+                break;
+            case 'C':
+                opts.cold = 1;
+                break;
+            case 'c':
+                opts.csv = 1;
+                break;
+            case 'd':
+                opts.device = optarg;
+                break;
+            case 'h':
+                print_help();
+                return 0;
+            default:
+                print_help();
+                return 1;
+        }
+    }
+
+    if (optind < argc) {
+        opts.argv = &argv[optind];
+    }
+
+    if (opts.workers < 1 || opts.workers > BENCH_MAX_WORKERS || opts.execs == 0) {
+        fprintf(stderr, "错误: 无效的 worker 数或 exec 次数\n");
+        return 1;
+    }
+
+    if (opts.cold && !opts.hash) {
+        fprintf(stderr, "错误: --cold 需要与 --hash 一起使用\n");
+        return 1;
+    }
+
+    print_header(&opts);
+
+    // 模块未加载
+    if (stat(opts.device, &st) != 0) {
+        if (opts.rules || opts.matrix) {
+            fprintf(stderr, "错误: 设备 %s 不存在，无法加载规则\n", opts.device);
+            return 1;
+        }
+        if (bench_run(&opts, "unloaded", 0, &result) != 0) {
+            return 1;
+        }
+        print_result(&opts, &result);
+        return 0;
+    }
+
+    fd = open(opts.device, O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "错误: 无法打开设备 %s: %s\n", opts.device, strerror(errno));
+        return 1;
+    }
+
+    if (opts.matrix) {
+        ret = run_matrix(&opts, fd);
+    } else {
+        struct hips_config config;
+        const char *label = "loaded";
+
+        if (ioctl(fd, HIPS_IOCTL_GET_CONFIG, &config) == 0 && !config.enabled) {
+            label = "disabled";
+        } else if (opts.hash) {
+            label = opts.cold ? "hash-cold" : "hash-warm";
+        }
+        ret = run_with_rules(&opts, fd, label, opts.rules);
+    }
+
+    close(fd);
+    return ret == 0 ? 0 : 1;
+}
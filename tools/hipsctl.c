@@ -7,10 +7,30 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <getopt.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include "../include/hips.h"
 
 #define HIPS_DEVICE "/dev/hips"
 
+// 指标导出
+#define HIPS_METRICS_FILE       "/proc/hips/metrics"
+#define METRICS_DEFAULT_LISTEN  "127.0.0.1:9464"
+#define METRICS_REQUEST_MAX     4096    // 请求头的最大长度
+#define METRICS_CONTENT_TYPE    "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+// top 视图
+#define TOP_DEFAULT_INTERVAL    1.0     // 刷新间隔（秒）
+#define TOP_DEFAULT_RULES       10      // 显示的规则数
+
+// 批量模式
+#define BATCH_MAX_ARGS      32      // 每行最多的参数个数
+#define BATCH_IOC_PRIORITY  50      // IOC 行生成的阻止规则的优先级
+
 // 帮助信息
 void print_help(void)
 {
@@ -20,6 +40,11 @@ void print_help(void)
     printf("  -h, --help     显示此帮助信息\n");
     printf("  -v, --version  显示版本信息\n");
     printf("  -d, --device   指定设备文件 (默认: %s)\n", HIPS_DEVICE);
+    printf("  -n, --netns    add-rule 的网络命名空间 (inode 号或 /proc/<pid>/ns/net 等路径)\n");
+    printf("  -c, --cgroup   add-rule 的 cgroup (cgroup ID 或 /sys/fs/cgroup/... 目录)\n");
+    printf("  -e, --expires  add-rule 的过期时间 (Unix 秒，或 +N[s|m|h|d] 表示从现在起)\n");
+    printf("  -b, --batch    批量模式，从标准输入读取命令或 IOC (同 import -)\n");
+    printf("  -s, --shadow   add-rule/import 的规则加入影子规则集，只抽样评估并记录分歧，不执行\n");
     printf("\n命令:\n");
     printf("  status          显示模块状态\n");
     printf("  enable          启用模块\n");
@@ -30,17 +55,46 @@ void print_help(void)
     printf("  add-rule        添加规则\n");
     printf("  del-rule        删除规则\n");
     printf("  list-rules      列出所有规则\n");
+    printf("  import <文件>   批量导入，文件为 - 时读取标准输入\n");
+    printf("  shadow status   显示影子规则集的规则数、分歧事件和匹配开销\n");
+    printf("  shadow promote  把影子规则集提升为生效规则集（原生效规则集成为影子规则集）\n");
+    printf("  shadow clear    清空影子规则集\n");
+    printf("  top [间隔秒数] [规则数] [刷新次数]\n");
+    printf("                  每个间隔显示各钩子评估速率和耗时分位数、命中最多的规则、缓存命中率和事件丢弃率\n");
+    printf("  metrics-serve [地址:端口|unix:路径]\n");
+    printf("                  以 HTTP 提供 %s (默认监听 %s)\n", HIPS_METRICS_FILE,
+           METRICS_DEFAULT_LISTEN);
     printf("\n规则格式:\n");
     printf("  add-rule <类型> <动作> <优先级> <目标> [描述]\n");
-    printf("  类型: exec|dns|network\n");
+    printf("  类型: exec|dns|network|hash\n");
     printf("  动作: block|allow|log\n");
     printf("  优先级: 数字 (0-999)\n");
-    printf("  目标: 文件路径|域名|IP地址\n");
+    printf("  目标: 文件路径|域名|IP地址|SHA-256 (hash 规则按可执行文件内容匹配)\n");
+    printf("  add-rule network <动作> <优先级> <地址/前缀> [proto tcp|udp|N] [port A[-B]] [dir in|out|any] [描述]\n");
+    printf("  带前缀或关键字的网络规则为结构化规则，可匹配入站连接\n");
+    printf("  add-rule <类型> log <优先级> <目标> [sample N] [limit N] [描述]\n");
+    printf("  记录规则每 CPU 每 N 个事件记录一个、每秒最多记录 N 个，略过的事件定期汇总为一条记录\n");
+    printf("\n批量格式 (import / -b)，每行一条，# 开头为注释:\n");
+    printf("  add-rule <类型> <动作> <优先级> <目标> [...]   同 add-rule 命令，描述可用双引号\n");
+    printf("  del-rule <规则ID>\n");
+    printf("  <IOC>           地址[/前缀]、可执行文件路径、SHA-256 或域名，生成优先级 %d 的阻止规则\n",
+           BATCH_IOC_PRIORITY);
     printf("\n示例:\n");
     printf("  hipsctl status\n");
     printf("  hipsctl add-rule exec block 100 /usr/bin/malware.exe 恶意软件\n");
     printf("  hipsctl add-rule dns block 50 evil.com 恶意域名\n");
+    printf("  hipsctl add-rule hash block 100 $(sha256sum /tmp/dropper | cut -d' ' -f1) 样本\n");
     printf("  hipsctl add-rule network block 75 192.168.1.100 恶意IP\n");
+    printf("  hipsctl add-rule network block 80 10.0.0.0/8 proto tcp port 1-1024 dir out 内网低端口\n");
+    printf("  hipsctl -n /var/run/netns/web add-rule network block 75 10.0.0.8 仅限该容器\n");
+    printf("  hipsctl -c /sys/fs/cgroup/tenant-a add-rule exec block 100 /usr/bin/curl 仅限该租户\n");
+    printf("  hipsctl -e +7d add-rule dns block 50 c2.example.net 威胁情报\n");
+    printf("  hipsctl add-rule exec log 50 /usr/bin/sudo limit 20 记录sudo命令使用\n");
+    printf("  hipsctl -e +1d import feed.txt\n");
+    printf("  zcat iocs.gz | hipsctl -b\n");
+    printf("  hipsctl -s import new-feed.txt && hipsctl shadow status\n");
+    printf("  hipsctl top 2 20\n");
+    printf("  hipsctl metrics-serve unix:/run/hips/metrics.sock\n");
 }
 
 // 版本信息
@@ -184,8 +238,18 @@ int show_stats(const char *device)
         printf("  执行阻止: %llu\n", stats.exec_blocks);
         printf("  DNS阻止: %llu\n", stats.dns_blocks);
         printf("  网络阻止: %llu\n", stats.network_blocks);
+        printf("  DNS NXDOMAIN 应答: %llu\n", stats.dns_nxdomain);
+        printf("  DNS sinkhole 应答: %llu\n", stats.dns_sinkhole);
+        printf("  DNS 丢弃: %llu\n", stats.dns_dropped);
+        printf("  入口丢弃: %llu\n", stats.ingress_drops);
+        printf("  日志丢弃: %llu\n", stats.log_dropped);
+        printf("  日志抑制: %llu\n", stats.log_suppressed);
         printf("  总事件数: %llu\n", stats.total_events);
         printf("  最后事件: %llu\n", stats.last_event_time);
+        if (stats.replica_nodes) {
+            printf("  摘要索引副本: %llu 个节点, %llu 字节\n", stats.replica_nodes,
+                   stats.replica_bytes);
+        }
     } else {
         fprintf(stderr, "错误: 无法获取统计信息\n");
         close(fd);
@@ -214,7 +278,10 @@ int show_logs(const char *device)
     while (ioctl(fd, HIPS_IOCTL_GET_LOGS, &entry) == 0 && count < 100) {
         printf("[%llu] 规则ID: %u, 类型: %u, 动作: %u\n",
                entry.timestamp, entry.rule_id, entry.rule_type, entry.action);
-        printf("  进程: %s (PID: %u)\n", entry.process_name, entry.pid);
+        printf("  进程: %s (PID: %u, UID: %u)\n", entry.process_name, entry.pid, entry.uid);
+        if (entry.exe[0]) {
+            printf("  程序: %s\n", entry.exe);
+        }
         printf("  目标: %s\n", entry.target);
         printf("  详情: %s\n", entry.details);
         printf("----------------------------------------\n");
@@ -229,13 +296,208 @@ int show_logs(const char *device)
     return 0;
 }
 
-// 添加规则
-int add_rule(const char *device, int argc, char *argv[])
+// 解析规则作用范围：数字直接作为 ID，否则取路径的 inode 号
+// （/proc/<pid>/ns/net、/var/run/netns/<名称> 的 inode 号即网络命名空间 ID，
+//   cgroup v2 目录的 inode 号即 cgroup ID）
+int parse_scope(const char *arg, unsigned long long *id)
 {
-    int fd;
-    struct hips_rule rule;
+    struct stat st;
+    char *end;
+    unsigned long long value;
+    
+    value = strtoull(arg, &end, 10);
+    if (*arg != '\0' && *end == '\0') {
+        *id = value;
+        return 0;
+    }
+    
+    if (stat(arg, &st) < 0) {
+        fprintf(stderr, "错误: 无法访问 %s: %s\n", arg, strerror(errno));
+        return -1;
+    }
+    
+    *id = st.st_ino;
+    return 0;
+}
+
+// 解析过期时间：纯数字为 Unix 秒，"+N" 加可选单位 s/m/h/d 表示从现在起的时长
+int parse_expires(const char *arg, unsigned long long *expires_at)
+{
+    unsigned long long value;
+    char *end;
+    
+    if (*arg != '+') {
+        value = strtoull(arg, &end, 10);
+        if (*arg == '\0' || *end != '\0') {
+            fprintf(stderr, "错误: 无效的过期时间: %s\n", arg);
+            return -1;
+        }
+        *expires_at = value;
+        return 0;
+    }
+    
+    value = strtoull(arg + 1, &end, 10);
+    if (end == arg + 1) {
+        fprintf(stderr, "错误: 无效的过期时间: %s\n", arg);
+        return -1;
+    }
+    
+    switch (*end) {
+        case '\0':
+        case 's':
+            break;
+        case 'm':
+            value *= 60;
+            break;
+        case 'h':
+            value *= 3600;
+            break;
+        case 'd':
+            value *= 86400;
+            break;
+        default:
+            fprintf(stderr, "错误: 无效的时间单位: %s\n", arg);
+            return -1;
+    }
+    if (*end != '\0' && end[1] != '\0') {
+        fprintf(stderr, "错误: 无效的过期时间: %s\n", arg);
+        return -1;
+    }
+    
+    *expires_at = (unsigned long long)time(NULL) + value;
+    return 0;
+}
+
+// 是否为结构化网络规则的关键字
+static int is_net_keyword(const char *arg)
+{
+    return strcmp(arg, "proto") == 0 || strcmp(arg, "port") == 0 || strcmp(arg, "dir") == 0;
+}
+
+// 解析结构化网络规则：<地址/前缀> [proto P] [port A[-B]] [dir D]，返回描述参数的下标
+int parse_net_match(int argc, char *argv[], struct hips_net_match *net)
+{
+    char addr[64];
+    char *slash, *end;
+    unsigned long value;
+    unsigned int lo, hi;
+    int max_prefix;
+    int i, n;
+    
+    strncpy(addr, argv[3], sizeof(addr) - 1);
+    addr[sizeof(addr) - 1] = '\0';
+    slash = strchr(addr, '/');
+    if (slash) {
+        *slash = '\0';
+    }
+    
+    if (inet_pton(AF_INET, addr, net->addr) == 1) {
+        net->family = AF_INET;
+        max_prefix = 32;
+    } else if (inet_pton(AF_INET6, addr, net->addr) == 1) {
+        net->family = AF_INET6;
+        max_prefix = 128;
+    } else {
+        fprintf(stderr, "错误: 无效的地址: %s\n", argv[3]);
+        return -1;
+    }
+    
+    net->prefix_len = max_prefix;
+    if (slash) {
+        value = strtoul(slash + 1, &end, 10);
+        if (slash[1] == '\0' || *end != '\0' || value > (unsigned long)max_prefix) {
+            fprintf(stderr, "错误: 无效的前缀长度: %s\n", argv[3]);
+            return -1;
+        }
+        net->prefix_len = value;
+    }
+    
+    for (i = 4; i + 1 < argc && is_net_keyword(argv[i]); i += 2) {
+        if (strcmp(argv[i], "proto") == 0) {
+            if (strcmp(argv[i + 1], "tcp") == 0) {
+                net->protocol = IPPROTO_TCP;
+            } else if (strcmp(argv[i + 1], "udp") == 0) {
+                net->protocol = IPPROTO_UDP;
+            } else {
+                value = strtoul(argv[i + 1], &end, 10);
+                if (*end != '\0' || value > 255) {
+                    fprintf(stderr, "错误: 无效的协议: %s\n", argv[i + 1]);
+                    return -1;
+                }
+                net->protocol = value;
+            }
+        } else if (strcmp(argv[i], "port") == 0) {
+            // "80" 只解析出一个端口，"1-1024" 为端口范围
+            n = sscanf(argv[i + 1], "%u-%u", &lo, &hi);
+            if (n == 1) {
+                hi = lo;
+            }
+            if (n < 1 || lo > hi || hi > 65535) {
+                fprintf(stderr, "错误: 无效的端口: %s\n", argv[i + 1]);
+                return -1;
+            }
+            net->port_min = lo;
+            net->port_max = hi;
+        } else {
+            if (strcmp(argv[i + 1], "in") == 0) {
+                net->direction = HIPS_DIR_IN;
+            } else if (strcmp(argv[i + 1], "out") == 0) {
+                net->direction = HIPS_DIR_OUT;
+            } else if (strcmp(argv[i + 1], "any") == 0) {
+                net->direction = HIPS_DIR_ANY;
+            } else {
+                fprintf(stderr, "错误: 无效的方向: %s\n", argv[i + 1]);
+                return -1;
+            }
+        }
+    }
     
-    if (argc < 5) {
+    if (i < argc && is_net_keyword(argv[i])) {
+        fprintf(stderr, "错误: %s 缺少参数\n", argv[i]);
+        return -1;
+    }
+    
+    return i;
+}
+
+// 解析记录规则的日志抽样和每秒上限：[sample N] [limit N]，返回描述参数的下标
+static int parse_log_limits(int argc, char *argv[], int i, struct hips_rule *rule)
+{
+    unsigned long value;
+    char *end;
+    
+    while (i + 1 < argc && (strcmp(argv[i], "sample") == 0 || strcmp(argv[i], "limit") == 0)) {
+        value = strtoul(argv[i + 1], &end, 10);
+        if (argv[i + 1][0] == '\0' || *end != '\0' || value != (__u32)value) {
+            fprintf(stderr, "错误: 无效的%s: %s\n",
+                    argv[i][0] == 's' ? "抽样间隔" : "每秒上限", argv[i + 1]);
+            return -1;
+        }
+        if (argv[i][0] == 's') {
+            rule->log_sample = value;
+        } else {
+            rule->log_rate = value;
+        }
+        i += 2;
+    }
+    
+    if ((rule->log_sample > 1 || rule->log_rate) && rule->action != HIPS_ACTION_LOG) {
+        fprintf(stderr, "错误: sample 和 limit 只适用于 log 动作的规则\n");
+        return -1;
+    }
+    
+    return i;
+}
+
+// 解析 add-rule 参数：<类型> <动作> <优先级> <目标> [网络匹配条件] [sample N] [limit N] [描述]
+int parse_rule(int argc, char *argv[], __u32 netns_ino, __u64 cgroup_id, __u64 expires_at,
+               struct hips_rule *rule)
+{
+    int desc;
+    
+    memset(rule, 0, sizeof(*rule));
+    
+    if (argc < 4) {
         fprintf(stderr, "错误: 参数不足\n");
         fprintf(stderr, "用法: add-rule <类型> <动作> <优先级> <目标> [描述]\n");
         return -1;
@@ -243,11 +505,13 @@ int add_rule(const char *device, int argc, char *argv[])
     
     // 解析规则类型
     if (strcmp(argv[0], "exec") == 0) {
-        rule.rule_type = HIPS_RULE_EXEC;
+        rule->rule_type = HIPS_RULE_EXEC;
     } else if (strcmp(argv[0], "dns") == 0) {
-        rule.rule_type = HIPS_RULE_DNS;
+        rule->rule_type = HIPS_RULE_DNS;
     } else if (strcmp(argv[0], "network") == 0) {
-        rule.rule_type = HIPS_RULE_NETWORK;
+        rule->rule_type = HIPS_RULE_NETWORK;
+    } else if (strcmp(argv[0], "hash") == 0) {
+        rule->rule_type = HIPS_RULE_HASH;
     } else {
         fprintf(stderr, "错误: 无效的规则类型: %s\n", argv[0]);
         return -1;
@@ -255,43 +519,76 @@ int add_rule(const char *device, int argc, char *argv[])
     
     // 解析动作
     if (strcmp(argv[1], "block") == 0) {
-        rule.action = HIPS_ACTION_BLOCK;
+        rule->action = HIPS_ACTION_BLOCK;
     } else if (strcmp(argv[1], "allow") == 0) {
-        rule.action = HIPS_ACTION_ALLOW;
+        rule->action = HIPS_ACTION_ALLOW;
     } else if (strcmp(argv[1], "log") == 0) {
-        rule.action = HIPS_ACTION_LOG;
+        rule->action = HIPS_ACTION_LOG;
     } else {
         fprintf(stderr, "错误: 无效的动作: %s\n", argv[1]);
         return -1;
     }
     
     // 解析优先级
-    if (sscanf(argv[2], "%u", &rule.priority) != 1) {
+    if (sscanf(argv[2], "%u", &rule->priority) != 1) {
         fprintf(stderr, "错误: 无效的优先级: %s\n", argv[2]);
         return -1;
     }
     
     // 设置目标
-    strncpy(rule.target, argv[3], sizeof(rule.target) - 1);
-    rule.target[sizeof(rule.target) - 1] = '\0';
+    strncpy(rule->target, argv[3], sizeof(rule->target) - 1);
+    rule->target[sizeof(rule->target) - 1] = '\0';
+    
+    // 带前缀或关键字的网络规则按结构化规则解析
+    desc = 4;
+    if (rule->rule_type == HIPS_RULE_NETWORK &&
+        (strchr(argv[3], '/') || (argc > 4 && is_net_keyword(argv[4])))) {
+        desc = parse_net_match(argc, argv, &rule->net);
+        if (desc < 0) {
+            return -1;
+        }
+        rule->flags |= HIPS_RULE_F_STRUCTURED;
+    }
+    
+    desc = parse_log_limits(argc, argv, desc, rule);
+    if (desc < 0) {
+        return -1;
+    }
     
     // 设置描述
-    if (argc > 4) {
-        strncpy(rule.description, argv[4], sizeof(rule.description) - 1);
-        rule.description[sizeof(rule.description) - 1] = '\0';
-    } else {
-        strcpy(rule.description, "");
+    if (argc > desc) {
+        strncpy(rule->description, argv[desc], sizeof(rule->description) - 1);
+        rule->description[sizeof(rule->description) - 1] = '\0';
     }
     
-    // 设置规则ID为0，让内核自动分配
-    rule.rule_id = 0;
+    // 规则ID为0，让内核自动分配
+    rule->netns_ino = netns_ino;
+    rule->cgroup_id = cgroup_id;
+    rule->expires_at = expires_at;
+    
+    return 0;
+}
+
+// 添加规则，flags 为附加的规则标志（如 HIPS_RULE_F_SHADOW）
+int add_rule(const char *device, __u32 netns_ino, __u64 cgroup_id, __u64 expires_at, __u32 flags,
+             int argc, char *argv[])
+{
+    int fd;
+    unsigned long cmd;
+    struct hips_rule rule;
+    
+    if (parse_rule(argc, argv, netns_ino, cgroup_id, expires_at, &rule) < 0) {
+        return -1;
+    }
+    rule.flags |= flags;
+    cmd = (rule.flags & HIPS_RULE_F_STRUCTURED) ? HIPS_IOCTL_ADD_NET_RULE : HIPS_IOCTL_ADD_RULE;
     
     fd = open_device(device);
     if (fd < 0) {
         return -1;
     }
     
-    if (ioctl(fd, HIPS_IOCTL_ADD_RULE, &rule) == 0) {
+    if (ioctl(fd, cmd, &rule) == 0) {
         printf("规则添加成功，ID: %u\n", rule.rule_id);
     } else {
         fprintf(stderr, "错误: 无法添加规则\n");
@@ -307,7 +604,7 @@ int add_rule(const char *device, int argc, char *argv[])
 int del_rule(const char *device, int argc, char *argv[])
 {
     int fd;
-    u32 rule_id;
+    __u32 rule_id;
     
     if (argc < 1) {
         fprintf(stderr, "错误: 请指定规则ID\n");
@@ -336,30 +633,961 @@ int del_rule(const char *device, int argc, char *argv[])
     return 0;
 }
 
-// 列出规则
+// 批量模式：复用一个设备描述符，攒满 HIPS_BATCH_MAX 条后一次提交
+
+struct batch {
+    int fd;
+    const char *source;             // 输入名，用于报错和 IOC 规则的描述
+    struct hips_rule rules[HIPS_BATCH_MAX];
+    __s32 rule_status[HIPS_BATCH_MAX];
+    unsigned long rule_lines[HIPS_BATCH_MAX];
+    int nrules;
+    __u32 ids[HIPS_BATCH_MAX];
+    __s32 id_status[HIPS_BATCH_MAX];
+    unsigned long id_lines[HIPS_BATCH_MAX];
+    int nids;
+    unsigned long added;
+    unsigned long deleted;
+    unsigned long failed;
+};
+
+// 提交攒下的添加请求，逐项报告失败
+static int batch_flush_rules(struct batch *b)
+{
+    struct hips_rule_batch req;
+    int i;
+    
+    if (b->nrules == 0) {
+        return 0;
+    }
+    
+    req.count = b->nrules;
+    req.reserved = 0;
+    req.rules = (__u64)(unsigned long)b->rules;
+    req.status = (__u64)(unsigned long)b->rule_status;
+    if (ioctl(b->fd, HIPS_IOCTL_ADD_RULES, &req) < 0) {
+        fprintf(stderr, "错误: 批量添加失败: %s\n", strerror(errno));
+        b->failed += b->nrules;
+        b->nrules = 0;
+        return -1;
+    }
+    
+    for (i = 0; i < b->nrules; i++) {
+        if (b->rule_status[i] == 0) {
+            b->added++;
+        } else {
+            fprintf(stderr, "%s:%lu: 添加失败: %s\n", b->source, b->rule_lines[i],
+                    strerror(-b->rule_status[i]));
+            b->failed++;
+        }
+    }
+    b->nrules = 0;
+    return 0;
+}
+
+// 提交攒下的删除请求
+static int batch_flush_ids(struct batch *b)
+{
+    struct hips_id_batch req;
+    int i;
+    
+    if (b->nids == 0) {
+        return 0;
+    }
+    
+    req.count = b->nids;
+    req.reserved = 0;
+    req.ids = (__u64)(unsigned long)b->ids;
+    req.status = (__u64)(unsigned long)b->id_status;
+    if (ioctl(b->fd, HIPS_IOCTL_DEL_RULES, &req) < 0) {
+        fprintf(stderr, "错误: 批量删除失败: %s\n", strerror(errno));
+        b->failed += b->nids;
+        b->nids = 0;
+        return -1;
+    }
+    
+    for (i = 0; i < b->nids; i++) {
+        if (b->id_status[i] == 0) {
+            b->deleted++;
+        } else {
+            fprintf(stderr, "%s:%lu: 删除规则 %u 失败: %s\n", b->source, b->id_lines[i],
+                    b->ids[i], strerror(-b->id_status[i]));
+            b->failed++;
+        }
+    }
+    b->nids = 0;
+    return 0;
+}
+
+// 按空白切分一行，双引号内的空白保留（用于带空格的描述），返回参数个数
+static int split_line(char *line, char *argv[], int max)
+{
+    int argc = 0;
+    char *p = line;
+    
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+            p++;
+        }
+        if (*p == '\0' || *p == '#') {
+            break;
+        }
+        if (argc == max) {
+            return -1;
+        }
+        
+        if (*p == '"') {
+            argv[argc++] = ++p;
+            while (*p && *p != '"') {
+                p++;
+            }
+        } else {
+            argv[argc++] = p;
+            while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+                p++;
+            }
+        }
+        if (*p) {
+            *p++ = '\0';
+        }
+    }
+    
+    return argc;
+}
+
+// IOC 行：单个地址（可带前缀）、可执行文件路径、SHA-256 或域名，生成对应类型的阻止规则；
+// 地址生成结构化网络规则，由分类器按前缀匹配
+static int parse_ioc(const char *ioc, struct batch *b, __u32 netns_ino, __u64 cgroup_id,
+                     __u64 expires_at, struct hips_rule *rule)
+{
+    char addr[64], *slash;
+    unsigned char buf[16];
+    char priority[16];
+    char *argv[4];
+    
+    strncpy(addr, ioc, sizeof(addr) - 1);
+    addr[sizeof(addr) - 1] = '\0';
+    slash = strchr(addr, '/');
+    if (slash) {
+        *slash = '\0';
+    }
+    
+    snprintf(priority, sizeof(priority), "%d", BATCH_IOC_PRIORITY);
+    argv[1] = "block";
+    argv[2] = priority;
+    argv[3] = (char *)ioc;
+    
+    if (inet_pton(AF_INET, addr, buf) == 1 || inet_pton(AF_INET6, addr, buf) == 1) {
+        argv[0] = "network";
+        if (parse_rule(4, argv, netns_ino, cgroup_id, expires_at, rule) < 0) {
+            return -1;
+        }
+        // 不带前缀的地址同样按结构化规则（主机前缀）处理
+        if (!(rule->flags & HIPS_RULE_F_STRUCTURED)) {
+            if (parse_net_match(4, argv, &rule->net) < 0) {
+                return -1;
+            }
+            rule->flags |= HIPS_RULE_F_STRUCTURED;
+        }
+    } else if (ioc[0] == '/') {
+        argv[0] = "exec";
+        if (parse_rule(4, argv, netns_ino, cgroup_id, expires_at, rule) < 0) {
+            return -1;
+        }
+    } else if (strlen(ioc) == 64 && strspn(ioc, "0123456789abcdefABCDEF") == 64) {
+        argv[0] = "hash";
+        if (parse_rule(4, argv, netns_ino, cgroup_id, expires_at, rule) < 0) {
+            return -1;
+        }
+    } else if (strchr(ioc, '.') && !strchr(ioc, '/')) {
+        argv[0] = "dns";
+        if (parse_rule(4, argv, netns_ino, cgroup_id, expires_at, rule) < 0) {
+            return -1;
+        }
+    } else {
+        fprintf(stderr, "错误: 无法识别的 IOC: %s\n", ioc);
+        return -1;
+    }
+    
+    snprintf(rule->description, sizeof(rule->description), "IOC (%s)", b->source);
+    return 0;
+}
+
+// 逐行读取命令（add-rule/del-rule）或 IOC，按输入顺序分批提交；
+// 添加和删除交替出现时先提交另一类，保证执行顺序与输入一致
+int run_batch(const char *device, const char *path, __u32 netns_ino, __u64 cgroup_id,
+              __u64 expires_at, __u32 flags)
+{
+    struct batch *b;
+    FILE *fp;
+    char *line = NULL;
+    size_t cap = 0;
+    char *argv[BATCH_MAX_ARGS];
+    unsigned long lineno = 0;
+    __u32 rule_id;
+    int argc, ret;
+    
+    if (strcmp(path, "-") == 0) {
+        fp = stdin;
+    } else {
+        fp = fopen(path, "r");
+        if (!fp) {
+            fprintf(stderr, "错误: 无法打开 %s: %s\n", path, strerror(errno));
+            return -1;
+        }
+    }
+    
+    b = calloc(1, sizeof(*b));
+    if (!b) {
+        fprintf(stderr, "错误: 内存不足\n");
+        if (fp != stdin) {
+            fclose(fp);
+        }
+        return -1;
+    }
+    b->source = fp == stdin ? "stdin" : path;
+    
+    b->fd = open_device(device);
+    if (b->fd < 0) {
+        free(b);
+        if (fp != stdin) {
+            fclose(fp);
+        }
+        return -1;
+    }
+    
+    while (getline(&line, &cap, fp) != -1) {
+        lineno++;
+        argc = split_line(line, argv, BATCH_MAX_ARGS);
+        if (argc == 0) {
+            continue;
+        }
+        if (argc < 0) {
+            fprintf(stderr, "%s:%lu: 参数过多\n", b->source, lineno);
+            b->failed++;
+            continue;
+        }
+        
+        if (strcmp(argv[0], "del-rule") == 0) {
+            if (argc != 2 || sscanf(argv[1], "%u", &rule_id) != 1) {
+                fprintf(stderr, "%s:%lu: 无效的 del-rule\n", b->source, lineno);
+                b->failed++;
+                continue;
+            }
+            batch_flush_rules(b);
+            b->ids[b->nids] = rule_id;
+            b->id_lines[b->nids++] = lineno;
+            if (b->nids == HIPS_BATCH_MAX) {
+                batch_flush_ids(b);
+            }
+            continue;
+        }
+        
+        if (strcmp(argv[0], "add-rule") == 0) {
+            ret = parse_rule(argc - 1, &argv[1], netns_ino, cgroup_id, expires_at,
+                             &b->rules[b->nrules]);
+        } else if (argc == 1) {
+            ret = parse_ioc(argv[0], b, netns_ino, cgroup_id, expires_at, &b->rules[b->nrules]);
+        } else {
+            fprintf(stderr, "错误: 批量模式只支持 add-rule、del-rule 和 IOC: %s\n", argv[0]);
+            ret = -1;
+        }
+        if (ret < 0) {
+            fprintf(stderr, "%s:%lu: 已跳过\n", b->source, lineno);
+            b->failed++;
+            continue;
+        }
+        
+        batch_flush_ids(b);
+        b->rules[b->nrules].flags |= flags;
+        b->rule_lines[b->nrules++] = lineno;
+        if (b->nrules == HIPS_BATCH_MAX) {
+            batch_flush_rules(b);
+        }
+    }
+    
+    batch_flush_rules(b);
+    batch_flush_ids(b);
+    
+    printf("批量处理完成: 添加 %lu 条，删除 %lu 条，失败 %lu 条\n", b->added, b->deleted, b->failed);
+    ret = b->failed ? -1 : 0;
+    
+    close(b->fd);
+    free(line);
+    free(b);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    return ret;
+}
+
+// 列出规则：按 ID 升序分页导出，每页 HIPS_BATCH_MAX 条
 int list_rules(const char *device)
 {
-    // 这里实现列出规则的逻辑
-    // 由于内核模块没有提供列出所有规则的IOCTL，这里简化实现
-    printf("规则列表功能暂未实现\n");
+    static const char *const types[] = {"?", "exec", "dns", "network", "hash"};
+    static const char *const actions[] = {"block", "allow", "log"};
+    struct hips_rule_dump dump;
+    struct hips_rule *rules;
+    unsigned long total = 0;
+    __u32 i;
+    int fd;
+    
+    fd = open_device(device);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    rules = calloc(HIPS_BATCH_MAX, sizeof(*rules));
+    if (!rules) {
+        fprintf(stderr, "错误: 内存不足\n");
+        close(fd);
+        return -1;
+    }
+    
+    printf("%-10s %-8s %-6s %-6s %-40s %s\n", "ID", "类型", "动作", "优先级", "目标", "描述");
+    
+    memset(&dump, 0, sizeof(dump));
+    do {
+        dump.count = HIPS_BATCH_MAX;
+        dump.rules = (__u64)(unsigned long)rules;
+        if (ioctl(fd, HIPS_IOCTL_DUMP_RULES, &dump) < 0) {
+            fprintf(stderr, "错误: 无法导出规则: %s\n", strerror(errno));
+            free(rules);
+            close(fd);
+            return -1;
+        }
+        
+        for (i = 0; i < dump.count; i++) {
+            struct hips_rule *rule = &rules[i];
+            
+            printf("%-10u %-8s %-6s %-6u %-40s %s%s", rule->rule_id,
+                   types[rule->rule_type <= HIPS_RULE_HASH ? rule->rule_type : 0],
+                   rule->action <= HIPS_ACTION_LOG ? actions[rule->action] : "?",
+                   rule->priority, rule->target, rule->description,
+                   (rule->flags & HIPS_RULE_F_SHADOW) ? " [影子]" : "");
+            if (rule->log_sample > 1) {
+                printf(" [抽样 1/%u]", rule->log_sample);
+            }
+            if (rule->log_rate) {
+                printf(" [上限 %u/秒]", rule->log_rate);
+            }
+            printf("\n");
+        }
+        total += dump.count;
+        dump.start_id = dump.next_id;
+    } while (dump.next_id != 0);
+    
+    printf("共 %lu 条规则\n", total);
+    
+    free(rules);
+    close(fd);
     return 0;
 }
 
+// 影子规则集：status 显示比较结果和开销，promote 提升为生效规则集，clear 清空
+int shadow_command(const char *device, int argc, char *argv[])
+{
+    struct hips_stats stats;
+    unsigned long cmd;
+    int fd;
+    
+    if (argc < 1) {
+        fprintf(stderr, "错误: 请指定 status、promote 或 clear\n");
+        return -1;
+    }
+    
+    if (strcmp(argv[0], "promote") == 0) {
+        cmd = HIPS_IOCTL_SHADOW_PROMOTE;
+    } else if (strcmp(argv[0], "clear") == 0) {
+        cmd = HIPS_IOCTL_SHADOW_CLEAR;
+    } else if (strcmp(argv[0], "status") == 0) {
+        cmd = HIPS_IOCTL_GET_STATS;
+    } else {
+        fprintf(stderr, "错误: 未知的影子规则集命令: %s\n", argv[0]);
+        return -1;
+    }
+    
+    fd = open_device(device);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    if (cmd == HIPS_IOCTL_GET_STATS) {
+        if (ioctl(fd, cmd, &stats) < 0) {
+            fprintf(stderr, "错误: 无法获取统计信息\n");
+            close(fd);
+            return -1;
+        }
+        printf("影子规则集:\n");
+        printf("  规则数: %llu\n", stats.shadow_rules);
+        printf("  抽样事件: %llu\n", stats.shadow_samples);
+        printf("  将阻止 (生效放行): %llu\n", stats.shadow_would_block);
+        printf("  将放行 (生效阻止): %llu\n", stats.shadow_would_allow);
+        if (stats.shadow_samples) {
+            printf("  生效规则集平均耗时: %llu ns\n", stats.shadow_live_ns / stats.shadow_samples);
+            printf("  影子规则集平均耗时: %llu ns\n", stats.shadow_ns / stats.shadow_samples);
+            printf("  影子规则集最大耗时: %llu ns\n", stats.shadow_max_ns);
+        }
+    } else if (ioctl(fd, cmd) < 0) {
+        fprintf(stderr, "错误: %s\n", errno == ENOENT ? "影子规则集为空" : strerror(errno));
+        close(fd);
+        return -1;
+    } else {
+        printf("%s\n", cmd == HIPS_IOCTL_SHADOW_PROMOTE ? "影子规则集已提升为生效规则集" :
+                                                        "影子规则集已清空");
+    }
+    
+    close(fd);
+    return 0;
+}
+
+// 取一次计数，命中过的规则逐页追加到 *hits（按 ID 升序），返回规则条数
+static long top_fetch(int fd, struct hips_metrics *m, struct hips_rule_hits **hits, size_t *cap)
+{
+    struct hips_metrics page;
+    struct hips_rule_hits *tmp;
+    size_t count = 0;
+    
+    memset(&page, 0, sizeof(page));
+    do {
+        if (*cap - count < HIPS_BATCH_MAX) {
+            tmp = realloc(*hits, (*cap + HIPS_BATCH_MAX) * sizeof(**hits));
+            if (!tmp) {
+                errno = ENOMEM;
+                return -1;
+            }
+            *hits = tmp;
+            *cap += HIPS_BATCH_MAX;
+        }
+        page.count = HIPS_BATCH_MAX;
+        page.rules = (__u64)(unsigned long)(*hits + count);
+        if (ioctl(fd, HIPS_IOCTL_GET_METRICS, &page) < 0) {
+            return -1;
+        }
+        // 计数取自首页，续页只补充规则
+        if (count == 0) {
+            memcpy(m, &page, sizeof(page));
+        }
+        count += page.count;
+        page.start_id = page.next_id;
+    } while (page.next_id != 0);
+    
+    return count;
+}
+
+// 直方图的分位数（纳秒），在所在桶内线性插值；落在最后一个桶时返回 -1
+static double top_percentile(const __u64 *lat, __u64 total, double q)
+{
+    double rank = q * total, lo, hi;
+    __u64 seen = 0;
+    int i;
+    
+    for (i = 0; i < HIPS_LAT_BUCKETS; i++) {
+        if (lat[i] && seen + lat[i] >= rank) {
+            if (i == HIPS_LAT_BUCKETS - 1) {
+                return -1;
+            }
+            hi = (double)(1ULL << (i + HIPS_LAT_SHIFT));
+            lo = i ? hi / 2 : 0;
+            return lo + (hi - lo) * (rank - seen) / lat[i];
+        }
+        seen += lat[i];
+    }
+    return 0;
+}
+
+static const char *top_ns(double ns, char *buf, size_t len)
+{
+    if (ns < 0) {
+        snprintf(buf, len, ">%.1fms", (double)(1ULL << (HIPS_LAT_BUCKETS - 2 + HIPS_LAT_SHIFT)) / 1e6);
+    } else if (ns < 1000) {
+        snprintf(buf, len, "%.0fns", ns);
+    } else if (ns < 1000000) {
+        snprintf(buf, len, "%.1fus", ns / 1e3);
+    } else {
+        snprintf(buf, len, "%.2fms", ns / 1e6);
+    }
+    return buf;
+}
+
+struct top_rule {
+    const struct hips_rule_hits *rule;
+    __u64 delta;
+};
+
+static int top_rule_cmp(const void *a, const void *b)
+{
+    const struct top_rule *x = a, *y = b;
+    
+    if (x->delta != y->delta) {
+        return x->delta < y->delta ? 1 : -1;
+    }
+    return x->rule->hits < y->rule->hits ? 1 : x->rule->hits > y->rule->hits ? -1 : 0;
+}
+
+static void top_render(const struct hips_metrics *cur, const struct hips_metrics *prev,
+                       const struct hips_rule_hits *hits, size_t count,
+                       const struct hips_rule_hits *prev_hits, size_t prev_count, int max_rules)
+{
+    static const char *const hooks[HIPS_HOOK_MAX] = {"exec", "dns", "network"};
+    static const char *const types[] = {"?", "exec", "dns", "network", "hash"};
+    static const char *const actions[] = {"block", "allow", "log"};
+    const struct hips_stats *s = &cur->stats, *p = &prev->stats;
+    double dt = (cur->timestamp - prev->timestamp) / 1e9;
+    __u64 lat[HIPS_LAT_BUCKETS], evals, lookups, logged, dropped;
+    struct top_rule *top;
+    char avg[16], p50[16], p99[16];
+    size_t i, j = 0, n = 0;
+    int hook, b;
+    
+    if (dt <= 0) {
+        dt = 1;
+    }
+    
+    if (isatty(STDOUT_FILENO)) {
+        printf("\033[H\033[2J");
+    }
+    printf("hips top - 间隔 %.1f 秒, 事件 %.0f/s, 阻止 exec %.0f/s dns %.0f/s 网络 %.0f/s, 入口丢弃 %.0f/s\n",
+           dt, (s->total_events - p->total_events) / dt, (s->exec_blocks - p->exec_blocks) / dt,
+           (s->dns_blocks - p->dns_blocks) / dt, (s->network_blocks - p->network_blocks) / dt,
+           (s->ingress_drops - p->ingress_drops) / dt);
+    
+    printf("\n%-8s %10s %10s %10s %9s %9s %9s\n", "钩子", "评估/s", "命中/s", "阻止/s", "平均", "p50", "p99");
+    for (hook = 0; hook < HIPS_HOOK_MAX; hook++) {
+        const struct hips_hook_stats *h = &cur->hooks[hook], *o = &prev->hooks[hook];
+        
+        evals = h->evals - o->evals;
+        for (b = 0; b < HIPS_LAT_BUCKETS; b++) {
+            lat[b] = h->lat[b] - o->lat[b];
+        }
+        if (evals) {
+            top_ns((double)(h->ns_sum - o->ns_sum) / evals, avg, sizeof(avg));
+            top_ns(top_percentile(lat, evals, 0.50), p50, sizeof(p50));
+            top_ns(top_percentile(lat, evals, 0.99), p99, sizeof(p99));
+        } else {
+            strcpy(avg, "-");
+            strcpy(p50, "-");
+            strcpy(p99, "-");
+        }
+        printf("%-8s %10.0f %10.0f %10.0f %9s %9s %9s\n", hooks[hook], evals / dt,
+               (h->matches - o->matches) / dt, (h->blocks - o->blocks) / dt, avg, p50, p99);
+    }
+    
+    lookups = (cur->digest_hits - prev->digest_hits) + (cur->digest_misses - prev->digest_misses);
+    printf("\n摘要缓存: ");
+    if (lookups) {
+        printf("命中率 %.1f%%", 100.0 * (cur->digest_hits - prev->digest_hits) / lookups);
+    } else {
+        printf("命中率 -");
+    }
+    printf(", 查找 %.0f/s, 异步计算 %.0f/s, 条目 %llu\n", lookups / dt,
+           (cur->digest_deferred - prev->digest_deferred) / dt, cur->digest_entries);
+    
+    logged = cur->log_events - prev->log_events;
+    dropped = s->log_dropped - p->log_dropped;
+    printf("事件日志: 记录 %.0f/s, 丢弃 %.0f/s", logged / dt, dropped / dt);
+    if (logged + dropped) {
+        printf(" (丢弃率 %.2f%%)", 100.0 * dropped / (logged + dropped));
+    }
+    printf(", 抑制 %.0f/s\n", (s->log_suppressed - p->log_suppressed) / dt);
+    
+    // 两次取样都按 ID 升序，归并求每条规则的增量；上次没有的规则上次尚未命中
+    top = calloc(count ? count : 1, sizeof(*top));
+    if (!top) {
+        return;
+    }
+    for (i = 0; i < count; i++) {
+        while (j < prev_count && prev_hits[j].rule_id < hits[i].rule_id) {
+            j++;
+        }
+        top[n].rule = &hits[i];
+        top[n].delta = hits[i].hits;
+        if (j < prev_count && prev_hits[j].rule_id == hits[i].rule_id) {
+            top[n].delta = hits[i].hits > prev_hits[j].hits ? hits[i].hits - prev_hits[j].hits : 0;
+        }
+        if (top[n].delta) {
+            n++;
+        }
+    }
+    qsort(top, n, sizeof(*top), top_rule_cmp);
+    
+    printf("\n%-10s %-8s %-6s %10s %12s %s\n", "规则ID", "类型", "动作", "命中/s", "累计", "目标");
+    for (i = 0; i < n && i < (size_t)max_rules; i++) {
+        const struct hips_rule_hits *r = top[i].rule;
+        
+        printf("%-10u %-8s %-6s %10.1f %12llu %s\n", r->rule_id,
+               types[r->rule_type <= HIPS_RULE_HASH ? r->rule_type : 0],
+               r->action <= HIPS_ACTION_LOG ? actions[r->action] : "?", top[i].delta / dt, r->hits,
+               r->target);
+    }
+    if (n == 0) {
+        printf("本周期没有规则命中\n");
+    }
+    if (!isatty(STDOUT_FILENO)) {
+        printf("\n");
+    }
+    fflush(stdout);
+    free(top);
+}
+
+// 实时视图：每个间隔用一次 HIPS_IOCTL_GET_METRICS 取样，显示与上次取样的差值
+int top_command(const char *device, int argc, char *argv[])
+{
+    struct hips_metrics cur, prev;
+    struct hips_rule_hits *hits = NULL, *prev_hits = NULL, *tmp;
+    size_t cap = 0, prev_cap = 0, cap_tmp;
+    long count, prev_count;
+    double interval = TOP_DEFAULT_INTERVAL;
+    struct timespec ts;
+    int max_rules = TOP_DEFAULT_RULES, iterations = 0, i, fd, ret = 0;
+    char *end;
+    
+    if (argc > 0) {
+        interval = strtod(argv[0], &end);
+        if (*end || interval < 0.1 || interval > 3600) {
+            fprintf(stderr, "错误: 无效的刷新间隔: %s\n", argv[0]);
+            return -1;
+        }
+    }
+    if (argc > 1) {
+        max_rules = strtol(argv[1], &end, 10);
+        if (*end || max_rules <= 0) {
+            fprintf(stderr, "错误: 无效的规则数: %s\n", argv[1]);
+            return -1;
+        }
+    }
+    if (argc > 2) {
+        iterations = strtol(argv[2], &end, 10);
+        if (*end || iterations < 0) {
+            fprintf(stderr, "错误: 无效的刷新次数: %s\n", argv[2]);
+            return -1;
+        }
+    }
+    
+    fd = open_device(device);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    prev_count = top_fetch(fd, &prev, &prev_hits, &prev_cap);
+    if (prev_count < 0) {
+        fprintf(stderr, "错误: 无法获取计数: %s\n", strerror(errno));
+        close(fd);
+        free(prev_hits);
+        return -1;
+    }
+    
+    ts.tv_sec = (time_t)interval;
+    ts.tv_nsec = (long)((interval - ts.tv_sec) * 1e9);
+    for (i = 0; iterations == 0 || i < iterations; i++) {
+        nanosleep(&ts, NULL);
+        
+        count = top_fetch(fd, &cur, &hits, &cap);
+        if (count < 0) {
+            fprintf(stderr, "错误: 无法获取计数: %s\n", strerror(errno));
+            ret = -1;
+            break;
+        }
+        top_render(&cur, &prev, hits, count, prev_hits, prev_count, max_rules);
+        
+        // 本次取样成为下次的基准
+        prev = cur;
+        tmp = prev_hits;
+        prev_hits = hits;
+        hits = tmp;
+        prev_count = count;
+        cap_tmp = prev_cap;
+        prev_cap = cap;
+        cap = cap_tmp;
+    }
+    
+    free(hits);
+    free(prev_hits);
+    close(fd);
+    return ret;
+}
+
+static int write_all(int fd, const char *buf, size_t len)
+{
+    ssize_t n;
+    
+    while (len > 0) {
+        n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// 读出整个指标文件，返回长度，调用者释放 *out
+static ssize_t read_metrics(char **out)
+{
+    size_t len = 0, cap = 65536;
+    char *buf, *tmp;
+    ssize_t n;
+    int fd;
+    
+    fd = open(HIPS_METRICS_FILE, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    buf = malloc(cap);
+    while (buf) {
+        if (len == cap) {
+            cap *= 2;
+            tmp = realloc(buf, cap);
+            if (!tmp) {
+                break;
+            }
+            buf = tmp;
+        }
+        n = read(fd, buf + len, cap - len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            close(fd);
+            if (n < 0) {
+                free(buf);
+                return -1;
+            }
+            *out = buf;
+            return len;
+        }
+        len += n;
+    }
+    
+    free(buf);
+    close(fd);
+    errno = ENOMEM;
+    return -1;
+}
+
+static void send_response(int fd, const char *status, const char *type, const char *body,
+                          size_t len, int head_only)
+{
+    char header[512];
+    int n;
+    
+    n = snprintf(header, sizeof(header),
+                 "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                 "Connection: close\r\n\r\n", status, type, len);
+    if (write_all(fd, header, n) == 0 && !head_only) {
+        write_all(fd, body, len);
+    }
+}
+
+// 处理一个连接：GET /metrics（或 /）返回指标文件的内容，每次请求重新读取
+static void serve_metrics_client(int fd)
+{
+    static const char *plain = "text/plain; charset=utf-8";
+    char req[METRICS_REQUEST_MAX];
+    char method[16], path[256];
+    struct timeval tv = { .tv_sec = 5 };
+    size_t len = 0;
+    ssize_t n;
+    char *body;
+    int head_only;
+    
+    // 慢速客户端不能拖住单线程的服务
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    
+    while (len < sizeof(req) - 1) {
+        n = read(fd, req + len, sizeof(req) - 1 - len);
+        if (n <= 0) {
+            return;
+        }
+        len += n;
+        req[len] = '\0';
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) {
+            break;
+        }
+    }
+    
+    if (sscanf(req, "%15s %255s", method, path) != 2) {
+        send_response(fd, "400 Bad Request", plain, "请求格式错误\n", strlen("请求格式错误\n"), 0);
+        return;
+    }
+    
+    head_only = strcmp(method, "HEAD") == 0;
+    if (strcmp(method, "GET") != 0 && !head_only) {
+        send_response(fd, "405 Method Not Allowed", plain, "仅支持 GET\n", strlen("仅支持 GET\n"), 0);
+        return;
+    }
+    if (strcmp(path, "/metrics") != 0 && strcmp(path, "/") != 0) {
+        send_response(fd, "404 Not Found", plain, "指标位于 /metrics\n",
+                      strlen("指标位于 /metrics\n"), head_only);
+        return;
+    }
+    
+    n = read_metrics(&body);
+    if (n < 0) {
+        char msg[256];
+        
+        snprintf(msg, sizeof(msg), "无法读取 %s: %s\n", HIPS_METRICS_FILE, strerror(errno));
+        send_response(fd, "503 Service Unavailable", plain, msg, strlen(msg), head_only);
+        return;
+    }
+    
+    send_response(fd, "200 OK", METRICS_CONTENT_TYPE, body, n, head_only);
+    free(body);
+}
+
+// 打开监听套接字：unix:路径 为本地套接字，否则为 [地址:]端口（默认地址 127.0.0.1）
+static int open_listener(const char *listen_addr)
+{
+    struct sockaddr_un sun;
+    struct sockaddr_in sin;
+    struct stat st;
+    char host[64] = "127.0.0.1";
+    const char *port = listen_addr, *colon;
+    char *end;
+    unsigned long val;
+    int fd, one = 1;
+    
+    if (strncmp(listen_addr, "unix:", 5) == 0) {
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        if (strlen(listen_addr + 5) == 0 || strlen(listen_addr + 5) >= sizeof(sun.sun_path)) {
+            fprintf(stderr, "错误: 无效的套接字路径: %s\n", listen_addr + 5);
+            return -1;
+        }
+        strcpy(sun.sun_path, listen_addr + 5);
+        
+        // 上次运行留下的套接字文件；路径上是其他文件时不删除
+        if (lstat(sun.sun_path, &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                fprintf(stderr, "错误: %s 已存在且不是套接字\n", sun.sun_path);
+                return -1;
+            }
+            unlink(sun.sun_path);
+        } else if (errno != ENOENT) {
+            fprintf(stderr, "错误: 无法检查 %s: %s\n", sun.sun_path, strerror(errno));
+            return -1;
+        }
+        
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            fprintf(stderr, "错误: 无法创建套接字: %s\n", strerror(errno));
+            return -1;
+        }
+        if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+            fprintf(stderr, "错误: 无法绑定 %s: %s\n", sun.sun_path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    } else {
+        colon = strrchr(listen_addr, ':');
+        if (colon) {
+            if ((size_t)(colon - listen_addr) >= sizeof(host)) {
+                fprintf(stderr, "错误: 无效的监听地址: %s\n", listen_addr);
+                return -1;
+            }
+            memcpy(host, listen_addr, colon - listen_addr);
+            host[colon - listen_addr] = '\0';
+            port = colon + 1;
+        }
+        
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        errno = 0;
+        val = strtoul(port, &end, 10);
+        if (errno || end == port || *end || val == 0 || val > 65535 ||
+            inet_pton(AF_INET, host, &sin.sin_addr) != 1) {
+            fprintf(stderr, "错误: 无效的监听地址: %s\n", listen_addr);
+            return -1;
+        }
+        sin.sin_port = htons(val);
+        
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            fprintf(stderr, "错误: 无法创建套接字: %s\n", strerror(errno));
+            return -1;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+            fprintf(stderr, "错误: 无法绑定 %s: %s\n", listen_addr, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+    
+    if (listen(fd, 16) < 0) {
+        fprintf(stderr, "错误: 无法监听 %s: %s\n", listen_addr, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 以 HTTP 导出 /proc/hips/metrics，供 Prometheus 等抓取。单线程，逐个处理连接
+int metrics_serve(const char *listen_addr)
+{
+    int lfd, fd;
+    
+    if (access(HIPS_METRICS_FILE, R_OK) < 0) {
+        fprintf(stderr, "错误: 无法读取 %s: %s\n", HIPS_METRICS_FILE, strerror(errno));
+        return -1;
+    }
+    
+    lfd = open_listener(listen_addr);
+    if (lfd < 0) {
+        return -1;
+    }
+    
+    // 抓取方提前断开时不退出
+    signal(SIGPIPE, SIG_IGN);
+    printf("在 %s 提供 %s\n", listen_addr, HIPS_METRICS_FILE);
+    fflush(stdout);
+    
+    for (;;) {
+        fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            fprintf(stderr, "错误: accept 失败: %s\n", strerror(errno));
+            close(lfd);
+            return -1;
+        }
+        serve_metrics_client(fd);
+        close(fd);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     const char *device = HIPS_DEVICE;
     const char *command = NULL;
+    unsigned long long netns_ino = 0;
+    unsigned long long cgroup_id = 0;
+    unsigned long long expires_at = 0;
+    __u32 rule_flags = 0;
+    int batch = 0;
     int opt;
     
     static struct option long_options[] = {
         {"help", no_argument, 0, 'h'},
         {"version", no_argument, 0, 'v'},
         {"device", required_argument, 0, 'd'},
+        {"netns", required_argument, 0, 'n'},
+        {"cgroup", required_argument, 0, 'c'},
+        {"expires", required_argument, 0, 'e'},
+        {"batch", no_argument, 0, 'b'},
+        {"shadow", no_argument, 0, 's'},
         {0, 0, 0, 0}
     };
     
     // 解析命令行选项
-    while ((opt = getopt_long(argc, argv, "hvd:", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "hvd:n:c:e:bs", long_options, NULL)) != -1) {
         switch (opt) {
             case 'h':
                 print_help();
@@ -370,12 +1598,37 @@ int main(int argc, char *argv[])
             case 'd':
                 device = optarg;
                 break;
+            case 'n':
+                if (parse_scope(optarg, &netns_ino) < 0) {
+                    return 1;
+                }
+                break;
+            case 'c':
+                if (parse_scope(optarg, &cgroup_id) < 0) {
+                    return 1;
+                }
+                break;
+            case 'e':
+                if (parse_expires(optarg, &expires_at) < 0) {
+                    return 1;
+                }
+                break;
+            case 'b':
+                batch = 1;
+                break;
+            case 's':
+                rule_flags |= HIPS_RULE_F_SHADOW;
+                break;
             default:
                 print_help();
                 return 1;
         }
     }
     
+    if (batch) {
+        return run_batch(device, "-", netns_ino, cgroup_id, expires_at, rule_flags) < 0 ? 1 : 0;
+    }
+    
     // 检查是否有命令
     if (optind >= argc) {
         fprintf(stderr, "错误: 请指定命令\n");
@@ -399,11 +1652,26 @@ int main(int argc, char *argv[])
     } else if (strcmp(command, "logs") == 0) {
         return show_logs(device);
     } else if (strcmp(command, "add-rule") == 0) {
-        return add_rule(device, argc - optind - 1, &argv[optind + 1]);
+        return add_rule(device, netns_ino, cgroup_id, expires_at, rule_flags,
+                        argc - optind - 1, &argv[optind + 1]);
     } else if (strcmp(command, "del-rule") == 0) {
         return del_rule(device, argc - optind - 1, &argv[optind + 1]);
     } else if (strcmp(command, "list-rules") == 0) {
         return list_rules(device);
+    } else if (strcmp(command, "import") == 0) {
+        if (optind + 1 >= argc) {
+            fprintf(stderr, "错误: 请指定文件\n");
+            return 1;
+        }
+        return run_batch(device, argv[optind + 1], netns_ino, cgroup_id, expires_at,
+                         rule_flags) < 0 ? 1 : 0;
+    } else if (strcmp(command, "shadow") == 0) {
+        return shadow_command(device, argc - optind - 1, &argv[optind + 1]);
+    } else if (strcmp(command, "top") == 0) {
+        return top_command(device, argc - optind - 1, &argv[optind + 1]) < 0 ? 1 : 0;
+    } else if (strcmp(command, "metrics-serve") == 0) {
+        return metrics_serve(optind + 1 < argc ? argv[optind + 1] : METRICS_DEFAULT_LISTEN) < 0 ?
+               1 : 0;
     } else {
         fprintf(stderr, "错误: 未知命令: %s\n", command);
         print_help();
@@ -0,0 +1,782 @@
+#ifndef HIPS_SHIM_H
+#define HIPS_SHIM_H
+
+/*
+ * 用户空间 shim：为规则存储与匹配代码提供最小的内核接口替身
+ * （list/spinlock/atomic/kmalloc/printk），使 src/hips_rules.c
+ * 可以在用户空间编译，用 perf、valgrind 和 sanitizer 分析。
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/types.h>
+#include <linux/version.h>
+
+// 基本类型（与内核一致，u64 为 unsigned long long）
+typedef __u8  u8;
+typedef __u16 u16;
+typedef __u32 u32;
+typedef __u64 u64;
+typedef __s32 s32;
+typedef __s64 s64;
+
+#define U32_MAX  ((u32)~0U)
+
+// 仅以指针形式出现在 hips_common.h 中的内核结构体
+struct sk_buff;
+struct sock;
+struct net;
+struct nf_hook_state;
+struct linux_binprm;
+struct task_struct;
+struct inode;
+struct file;
+struct seq_file;
+struct cdev;
+struct proc_dir_entry;
+
+#define __user
+#define __init
+#define __exit
+
+// 模块参数在用户空间只是普通静态变量，这里引用一次以免未使用告警
+#define module_param(name, type, perm) \
+    static void *const __hips_param_##name __attribute__((unused)) = &name
+#define module_param_named(name, value, type, perm)
+#define module_param_string(name, string, len, perm) \
+    static void *const __hips_param_str_##name __attribute__((unused)) = string
+#define MODULE_PARM_DESC(name, desc)
+
+#define TASK_COMM_LEN 16
+
+#define max(a, b)  ((a) > (b) ? (a) : (b))
+#define min_t(type, a, b)  ((type)(a) < (type)(b) ? (type)(a) : (type)(b))
+#define READ_ONCE(x)  __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define WRITE_ONCE(x, val)  __atomic_store_n(&(x), (val), __ATOMIC_RELAXED)
+#define smp_load_acquire(p)  __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v)  __atomic_store_n(p, (v), __ATOMIC_RELEASE)
+#define clamp(val, lo, hi)  ((val) < (lo) ? (lo) : (val) > (hi) ? (hi) : (val))
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+#define container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+// 内存分配
+typedef unsigned int gfp_t;
+
+#define GFP_KERNEL 0
+#define GFP_ATOMIC 1
+
+static inline void *kmalloc(size_t size, int flags)
+{
+    (void)flags;
+    return malloc(size);
+}
+
+static inline void *kmalloc_array(size_t n, size_t size, int flags)
+{
+    (void)flags;
+    return n && size > SIZE_MAX / n ? NULL : malloc(n * size);
+}
+
+static inline void *kzalloc(size_t size, int flags)
+{
+    (void)flags;
+    return calloc(1, size);
+}
+
+static inline void kfree(const void *ptr)
+{
+    free((void *)ptr);
+}
+
+static inline void *krealloc(const void *ptr, size_t size, int flags)
+{
+    (void)flags;
+    return realloc((void *)ptr, size);
+}
+
+static inline void *kvmalloc_array(size_t n, size_t size, int flags)
+{
+    return kmalloc_array(n, size, flags);
+}
+
+static inline void *kvcalloc(size_t n, size_t size, int flags)
+{
+    (void)flags;
+    return calloc(n, size);
+}
+
+static inline void kvfree(const void *ptr)
+{
+    free((void *)ptr);
+}
+
+// 用户空间只有一个“节点”，副本由调用者自行放置（见 bench/hips_microbench.c）
+#define nr_node_ids  1
+#define N_MEMORY     0
+#define for_each_node_state(node, state) \
+    for ((node) = 0; (node) < nr_node_ids; (node)++)
+
+static inline int numa_mem_id(void)
+{
+    return 0;
+}
+
+static inline void *vzalloc_node(size_t size, int node)
+{
+    (void)node;
+    return calloc(1, size);
+}
+
+static inline void vfree(const void *ptr)
+{
+    free((void *)ptr);
+}
+
+// 每 CPU 数据只在钩子中分配（规则命中计数），用户空间只需释放
+#define __percpu
+static inline void free_percpu(void *ptr)
+{
+    free(ptr);
+}
+
+static inline unsigned long roundup_pow_of_two(unsigned long n)
+{
+    return n <= 1 ? 1 : 1UL << (64 - __builtin_clzl(n - 1));
+}
+
+static inline u64 ktime_get_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline char *kstrdup(const char *s, int flags)
+{
+    (void)flags;
+    return s ? strdup(s) : NULL;
+}
+
+// 与内核 strscpy 相同：总是以 '\0' 结尾，截断时返回 -E2BIG
+static inline ssize_t strscpy(char *dst, const char *src, size_t size)
+{
+    size_t len;
+
+    if (size == 0) {
+        return -E2BIG;
+    }
+    len = strnlen(src, size - 1);
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+    return src[len] ? -E2BIG : (ssize_t)len;
+}
+
+static inline int kstrtou32(const char *s, unsigned int base, u32 *res)
+{
+    char *end;
+    unsigned long val;
+
+    if (!s || !*s || *s == '-') {
+        return -EINVAL;
+    }
+    errno = 0;
+    val = strtoul(s, &end, base);
+    if (*end == '\n') {
+        end++;
+    }
+    if (*end != '\0') {
+        return -EINVAL;
+    }
+    if (errno == ERANGE || val > UINT32_MAX) {
+        return -ERANGE;
+    }
+    *res = (u32)val;
+    return 0;
+}
+
+static inline int kstrtou64(const char *s, unsigned int base, u64 *res)
+{
+    char *end;
+    unsigned long long val;
+
+    if (!s || !*s || *s == '-') {
+        return -EINVAL;
+    }
+    errno = 0;
+    val = strtoull(s, &end, base);
+    if (*end == '\n') {
+        end++;
+    }
+    if (*end != '\0') {
+        return -EINVAL;
+    }
+    if (errno == ERANGE) {
+        return -ERANGE;
+    }
+    *res = val;
+    return 0;
+}
+
+static inline int hex_to_bin(unsigned char ch)
+{
+    if (ch >= '0' && ch <= '9') {
+        return ch - '0';
+    }
+    ch |= 0x20;
+    if (ch >= 'a' && ch <= 'f') {
+        return ch - 'a' + 10;
+    }
+    return -1;
+}
+
+static inline int hex2bin(u8 *dst, const char *src, size_t count)
+{
+    while (count--) {
+        int hi = hex_to_bin(*src++), lo;
+
+        if (hi < 0) {
+            return -EINVAL;
+        }
+        lo = hex_to_bin(*src++);
+        if (lo < 0) {
+            return -EINVAL;
+        }
+        *dst++ = (hi << 4) | lo;
+    }
+    return 0;
+}
+
+static inline char *bin2hex(char *dst, const void *src, size_t count)
+{
+    const unsigned char *p = src;
+
+    while (count--) {
+        *dst++ = "0123456789abcdef"[*p >> 4];
+        *dst++ = "0123456789abcdef"[*p++ & 0xf];
+    }
+    return dst;
+}
+
+// 地址解析：与内核 in4_pton/in6_pton 语义一致，遇到 delim 或 '\0' 结束
+static inline int __hips_pton(int family, const char *src, int srclen, u8 *dst,
+                              int delim, const char **end)
+{
+    char buf[INET6_ADDRSTRLEN];
+    int len = 0;
+
+    while ((srclen < 0 || len < srclen) && src[len] != '\0' && src[len] != delim) {
+        if (len >= (int)sizeof(buf) - 1) {
+            return 0;
+        }
+        buf[len] = src[len];
+        len++;
+    }
+    buf[len] = '\0';
+
+    if (inet_pton(family, buf, dst) != 1) {
+        return 0;
+    }
+    if (end) {
+        *end = src + len;
+    }
+    return 1;
+}
+
+static inline int in4_pton(const char *src, int srclen, u8 *dst, int delim, const char **end)
+{
+    return __hips_pton(AF_INET, src, srclen, dst, delim, end);
+}
+
+static inline int in6_pton(const char *src, int srclen, u8 *dst, int delim, const char **end)
+{
+    return __hips_pton(AF_INET6, src, srclen, dst, delim, end);
+}
+
+static inline void schedule(void)
+{
+    sched_yield();
+}
+
+#define cond_resched()  do {} while (0)
+
+// 日志：默认静默，避免百万级规则加载时刷屏
+extern int hips_user_verbose;
+
+#define KERN_DEBUG   ""
+#define KERN_INFO    ""
+#define KERN_WARNING ""
+#define KERN_ERR     ""
+
+#define printk(fmt, ...) \
+    do { \
+        if (hips_user_verbose) \
+            fprintf(stderr, fmt, ##__VA_ARGS__); \
+    } while (0)
+
+// 原子操作
+typedef struct {
+    int counter;
+} atomic_t;
+
+#define ATOMIC_INIT(i) { (i) }
+
+static inline int atomic_read(const atomic_t *v)
+{
+    return __atomic_load_n(&v->counter, __ATOMIC_RELAXED);
+}
+
+static inline void atomic_set(atomic_t *v, int i)
+{
+    __atomic_store_n(&v->counter, i, __ATOMIC_RELAXED);
+}
+
+static inline void atomic_inc(atomic_t *v)
+{
+    __atomic_fetch_add(&v->counter, 1, __ATOMIC_RELAXED);
+}
+
+static inline void atomic_dec(atomic_t *v)
+{
+    __atomic_fetch_sub(&v->counter, 1, __ATOMIC_RELAXED);
+}
+
+static inline int atomic_inc_return(atomic_t *v)
+{
+    return __atomic_add_fetch(&v->counter, 1, __ATOMIC_SEQ_CST);
+}
+
+// 自旋锁
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#else
+#define cpu_relax() do {} while (0)
+#endif
+
+typedef struct {
+    unsigned char locked;
+} spinlock_t;
+
+static inline void spin_lock_init(spinlock_t *lock)
+{
+    lock->locked = 0;
+}
+
+static inline void spin_lock(spinlock_t *lock)
+{
+    while (__atomic_test_and_set(&lock->locked, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&lock->locked, __ATOMIC_RELAXED)) {
+            cpu_relax();
+        }
+    }
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+    __atomic_clear(&lock->locked, __ATOMIC_RELEASE);
+}
+
+#define DEFINE_SPINLOCK(name)  spinlock_t name = { 0 }
+
+// 用户空间没有软中断，_bh 版本即普通自旋锁
+#define spin_lock_bh(lock)    spin_lock(lock)
+#define spin_unlock_bh(lock)  spin_unlock(lock)
+
+// RCU：用户空间构建不提供宽限期，读者不与释放并发（基准和 sanitizer 用例满足这一点）
+struct rcu_head {
+    struct rcu_head *next;
+};
+
+#define rcu_read_lock()    do {} while (0)
+#define rcu_read_unlock()  do {} while (0)
+#define kfree_rcu(ptr, field)  kfree(ptr)
+#define call_rcu(head, func)  (func)(head)
+#define synchronize_rcu()  do {} while (0)
+#define __rcu
+#define rcu_dereference(p)  __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define rcu_dereference_protected(p, c)  (p)
+#define rcu_access_pointer(p)  READ_ONCE(p)
+#define rcu_assign_pointer(p, v)  __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+#define RCU_INIT_POINTER(p, v)  ((p) = (v))
+#define rcu_dereference_check(p, c)  rcu_dereference(p)
+#define lockdep_is_held(lock)  1
+
+// xarray：两级页表实现的 u32 索引到指针的映射，只提供规则 ID 索引用到的接口。
+// 写者由内部锁串行，读者无锁
+struct xarray {
+    void ***dir;
+    spinlock_t lock;
+};
+
+typedef unsigned int xa_mark_t;
+#define XA_PRESENT  ((xa_mark_t)8U)
+
+void xa_init(struct xarray *xa);
+void xa_destroy(struct xarray *xa);
+void *xa_load(struct xarray *xa, unsigned long index);
+void *xa_store(struct xarray *xa, unsigned long index, void *entry, gfp_t gfp);
+void *xa_erase(struct xarray *xa, unsigned long index);
+int xa_insert(struct xarray *xa, unsigned long index, void *entry, gfp_t gfp);
+void xa_release(struct xarray *xa, unsigned long index);
+void *xa_find(struct xarray *xa, unsigned long *index, unsigned long max, xa_mark_t filter);
+void *xa_find_after(struct xarray *xa, unsigned long *index, unsigned long max, xa_mark_t filter);
+
+static inline bool xa_is_err(const void *entry)
+{
+    (void)entry;
+    return false;
+}
+
+// 双向链表
+struct list_head {
+    struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+
+#define LIST_HEAD(name) \
+    struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+    list->next = list;
+    list->prev = list;
+}
+
+static inline void __list_add(struct list_head *new, struct list_head *prev,
+                              struct list_head *next)
+{
+    next->prev = new;
+    new->next = next;
+    new->prev = prev;
+    prev->next = new;
+}
+
+static inline void list_add(struct list_head *new, struct list_head *head)
+{
+    __list_add(new, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *new, struct list_head *head)
+{
+    __list_add(new, head->prev, head);
+}
+
+static inline void list_del(struct list_head *entry)
+{
+    entry->next->prev = entry->prev;
+    entry->prev->next = entry->next;
+    entry->next = NULL;
+    entry->prev = NULL;
+}
+
+static inline void list_del_init(struct list_head *entry)
+{
+    entry->next->prev = entry->prev;
+    entry->prev->next = entry->next;
+    INIT_LIST_HEAD(entry);
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+    return head->next == head;
+}
+
+static inline void list_splice_init(struct list_head *list, struct list_head *head)
+{
+    if (!list_empty(list)) {
+        struct list_head *first = list->next;
+        struct list_head *last = list->prev;
+
+        first->prev = head;
+        last->next = head->next;
+        head->next->prev = last;
+        head->next = first;
+        INIT_LIST_HEAD(list);
+    }
+}
+
+#define list_entry(ptr, type, member) \
+    container_of(ptr, type, member)
+
+#define list_first_entry(ptr, type, member) \
+    list_entry((ptr)->next, type, member)
+
+#define list_next_entry(pos, member) \
+    list_entry((pos)->member.next, __typeof__(*(pos)), member)
+
+#define list_last_entry(ptr, type, member) \
+    list_entry((ptr)->prev, type, member)
+
+#define list_prev_entry(pos, member) \
+    list_entry((pos)->member.prev, __typeof__(*(pos)), member)
+
+#define list_for_each_entry_reverse(pos, head, member) \
+    for (pos = list_last_entry(head, __typeof__(*pos), member); \
+         &pos->member != (head); \
+         pos = list_prev_entry(pos, member))
+
+#define list_for_each_entry(pos, head, member) \
+    for (pos = list_first_entry(head, __typeof__(*pos), member); \
+         &pos->member != (head); \
+         pos = list_next_entry(pos, member))
+
+#define list_for_each_entry_safe(pos, n, head, member) \
+    for (pos = list_first_entry(head, __typeof__(*pos), member), \
+         n = list_next_entry(pos, member); \
+         &pos->member != (head); \
+         pos = n, n = list_next_entry(n, member))
+
+// 哈希链表
+struct hlist_node {
+    struct hlist_node *next, **pprev;
+};
+
+struct hlist_head {
+    struct hlist_node *first;
+};
+
+static inline void INIT_HLIST_NODE(struct hlist_node *n)
+{
+    n->next = NULL;
+    n->pprev = NULL;
+}
+
+static inline void hlist_add_head(struct hlist_node *n, struct hlist_head *h)
+{
+    n->next = h->first;
+    if (h->first) {
+        h->first->pprev = &n->next;
+    }
+    h->first = n;
+    n->pprev = &h->first;
+}
+
+static inline void hlist_del_init(struct hlist_node *n)
+{
+    if (n->pprev) {
+        *n->pprev = n->next;
+        if (n->next) {
+            n->next->pprev = n->pprev;
+        }
+        n->next = NULL;
+        n->pprev = NULL;
+    }
+}
+
+#define hlist_entry_safe(ptr, type, member) \
+    ({ __typeof__(ptr) ____ptr = (ptr); \
+       ____ptr ? container_of(____ptr, type, member) : NULL; })
+
+#define hlist_for_each_entry(pos, head, member) \
+    for (pos = hlist_entry_safe((head)->first, __typeof__(*(pos)), member); \
+         pos; \
+         pos = hlist_entry_safe((pos)->member.next, __typeof__(*(pos)), member))
+
+#define hlist_for_each_entry_safe(pos, n, head, member) \
+    for (pos = hlist_entry_safe((head)->first, __typeof__(*pos), member); \
+         pos && ({ n = pos->member.next; 1; }); \
+         pos = hlist_entry_safe(n, __typeof__(*pos), member))
+
+// 哈希表（linux/hashtable.h 的子集，键按 64 位处理）
+#define DECLARE_HASHTABLE(name, bits) \
+    struct hlist_head name[1 << (bits)]
+
+#define HASH_SIZE(name) (ARRAY_SIZE(name))
+#define HASH_BITS(name) (__builtin_ctz(HASH_SIZE(name)))
+
+static inline u32 hash_64(u64 val, unsigned int bits)
+{
+    return (u32)((val * 0x61C8864680B583EBULL) >> (64 - bits));
+}
+
+// jhash 替身（FNV-1a），只要求同一进程内结果一致
+static inline u32 jhash(const void *key, u32 length, u32 initval)
+{
+    const u8 *p = key;
+    u32 hash = 2166136261U ^ initval;
+    u32 i;
+
+    for (i = 0; i < length; i++) {
+        hash = (hash ^ p[i]) * 16777619U;
+    }
+    return hash;
+}
+
+static inline u32 jhash_3words(u32 a, u32 b, u32 c, u32 initval)
+{
+    u32 words[3] = {a, b, c};
+
+    return jhash(words, sizeof(words), initval);
+}
+
+static inline u32 jhash_2words(u32 a, u32 b, u32 initval)
+{
+    return jhash_3words(a, b, 0, initval);
+}
+
+#define hash_init(name) \
+    memset(name, 0, sizeof(name))
+
+#define hash_add(name, node, key) \
+    hlist_add_head(node, &name[hash_64(key, HASH_BITS(name))])
+
+#define hash_del(node) \
+    hlist_del_init(node)
+
+#define hash_for_each_possible(name, obj, member, key) \
+    hlist_for_each_entry(obj, &name[hash_64(key, HASH_BITS(name))], member)
+
+#define hash_for_each(name, bkt, obj, member) \
+    for ((bkt) = 0; (bkt) < HASH_SIZE(name); (bkt)++) \
+        hlist_for_each_entry(obj, &name[bkt], member)
+
+#define hash_for_each_safe(name, bkt, tmp, obj, member) \
+    for ((bkt) = 0; (bkt) < HASH_SIZE(name); (bkt)++) \
+        hlist_for_each_entry_safe(obj, tmp, &name[bkt], member)
+
+// RCU 链表：发布时用 release 语义写指针，摘除时保留 next 供正在遍历的读者继续
+static inline void list_add_rcu(struct list_head *entry, struct list_head *head)
+{
+    entry->next = head->next;
+    entry->prev = head;
+    head->next->prev = entry;
+    __atomic_store_n(&head->next, entry, __ATOMIC_RELEASE);
+}
+
+static inline void list_add_tail_rcu(struct list_head *entry, struct list_head *head)
+{
+    list_add_rcu(entry, head->prev);
+}
+
+static inline void list_del_rcu(struct list_head *entry)
+{
+    entry->next->prev = entry->prev;
+    __atomic_store_n(&entry->prev->next, entry->next, __ATOMIC_RELEASE);
+}
+
+#define list_for_each_entry_rcu(pos, head, member) \
+    for (pos = list_entry(rcu_dereference((head)->next), __typeof__(*pos), member); \
+         &pos->member != (head); \
+         pos = list_entry(rcu_dereference(pos->member.next), __typeof__(*pos), member))
+
+static inline void hlist_add_head_rcu(struct hlist_node *n, struct hlist_head *h)
+{
+    n->next = h->first;
+    n->pprev = &h->first;
+    if (h->first) {
+        h->first->pprev = &n->next;
+    }
+    __atomic_store_n(&h->first, n, __ATOMIC_RELEASE);
+}
+
+static inline void hlist_del_init_rcu(struct hlist_node *n)
+{
+    if (n->pprev) {
+        __atomic_store_n(n->pprev, n->next, __ATOMIC_RELEASE);
+        if (n->next) {
+            n->next->pprev = n->pprev;
+        }
+        n->pprev = NULL;
+    }
+}
+
+#define hlist_del_rcu(n)  hlist_del_init_rcu(n)
+
+#define hlist_for_each_entry_rcu(pos, head, member) \
+    for (pos = hlist_entry_safe(rcu_dereference((head)->first), __typeof__(*(pos)), member); \
+         pos; \
+         pos = hlist_entry_safe(rcu_dereference((pos)->member.next), __typeof__(*(pos)), member))
+
+#define hash_add_rcu(name, node, key) \
+    hlist_add_head_rcu(node, &name[hash_64(key, HASH_BITS(name))])
+
+#define hash_del_rcu(node) \
+    hlist_del_init_rcu(node)
+
+#define hash_for_each_possible_rcu(name, obj, member, key) \
+    hlist_for_each_entry_rcu(obj, &name[hash_64(key, HASH_BITS(name))], member)
+
+#define sizeof_field(type, member)  sizeof(((type *)0)->member)
+
+// rhltable：键相同的对象串在同一个链上，装载超过 3/4 时桶数加倍。
+// 写者由调用者串行；扩容后旧桶数组保留到销毁，读者不会访问已释放的桶（不自动收缩）
+struct rhash_head {
+    struct rhash_head *next;
+};
+
+struct rhlist_head {
+    struct rhash_head rhead;
+    struct rhlist_head *next;
+};
+
+struct rhashtable_params {
+    u16 key_len;
+    u16 key_offset;
+    u16 head_offset;
+    bool automatic_shrinking;
+};
+
+struct rhltable {
+    struct rhash_head **buckets;    // 最后一个槽位指向上一次扩容前的桶数组
+    u32 size;
+    u32 nelems;
+    struct rhashtable_params p;
+};
+
+int rhltable_init(struct rhltable *hlt, const struct rhashtable_params *params);
+void rhltable_destroy(struct rhltable *hlt);
+int rhltable_insert(struct rhltable *hlt, struct rhlist_head *list,
+                    const struct rhashtable_params params);
+int rhltable_remove(struct rhltable *hlt, struct rhlist_head *list,
+                    const struct rhashtable_params params);
+struct rhlist_head *rhltable_lookup(struct rhltable *hlt, const void *key,
+                                    const struct rhashtable_params params);
+
+#define rhl_for_each_entry_rcu(tpos, pos, list, member) \
+    for (pos = (list); \
+         pos && ((tpos) = container_of(pos, __typeof__(*(tpos)), member), 1); \
+         pos = rcu_dereference((pos)->next))
+
+// 工作队列：用户空间没有后台线程，schedule_work 直接运行工作函数
+struct work_struct {
+    void (*func)(struct work_struct *work);
+};
+
+#define DECLARE_WORK(name, fn)  struct work_struct name = { .func = (fn) }
+
+static inline bool schedule_work(struct work_struct *work)
+{
+    work->func(work);
+    return true;
+}
+
+static inline bool flush_work(struct work_struct *work)
+{
+    (void)work;
+    return false;
+}
+
+// 用户空间库初始化（对应 hips_init 中的规则表部分）
+int hips_user_init(void);
+void hips_user_exit(void);
+
+#endif /* HIPS_SHIM_H */
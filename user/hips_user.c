@@ -0,0 +1,374 @@
+#include "../src/hips_common.h"
+
+// 用户空间构建下的全局配置（内核中由 hips_main.c 定义）
+struct hips_global_config *hips_config = NULL;
+
+// 是否输出 printk 日志
+int hips_user_verbose = 0;
+
+// 初始化规则表
+int hips_user_init(void)
+{
+    if (hips_config) {
+        return 0;
+    }
+
+    hips_config = kzalloc(sizeof(struct hips_global_config), GFP_KERNEL);
+    if (!hips_config) {
+        return -ENOMEM;
+    }
+
+    spin_lock_init(&hips_config->config_lock);
+    hips_rules_init();
+
+    hips_config->config.enabled = 1;
+    hips_config->config.log_level = HIPS_LOG_INFO;
+    hips_config->config.max_rules = hips_max_rules;
+
+    return 0;
+}
+
+// 释放规则表
+void hips_user_exit(void)
+{
+    if (!hips_config) {
+        return;
+    }
+
+    hips_cleanup_rules();
+    kfree(hips_config);
+    hips_config = NULL;
+}
+
+// xarray：高 16 位选页，低 16 位为页内下标，页按需分配
+#define XA_PAGE_BITS   16
+#define XA_PAGE_SIZE   (1UL << XA_PAGE_BITS)
+#define XA_DIR_SIZE    (1UL << (32 - XA_PAGE_BITS))
+
+// 已预留但尚未存入的槽位，xa_load 视为空
+static char xa_zero_entry;
+#define XA_ZERO_ENTRY  ((void *)&xa_zero_entry)
+
+void xa_init(struct xarray *xa)
+{
+    xa->dir = calloc(XA_DIR_SIZE, sizeof(*xa->dir));
+    spin_lock_init(&xa->lock);
+}
+
+void xa_destroy(struct xarray *xa)
+{
+    unsigned long i;
+
+    if (!xa->dir) {
+        return;
+    }
+    for (i = 0; i < XA_DIR_SIZE; i++) {
+        free(xa->dir[i]);
+    }
+    free(xa->dir);
+    xa->dir = NULL;
+}
+
+// 与内核一致，xa_destroy 之后 xarray 仍可继续使用，目录在第一次写入时重新分配
+static void **xa_slot(struct xarray *xa, unsigned long index, bool create)
+{
+    void ***dir = __atomic_load_n(&xa->dir, __ATOMIC_ACQUIRE);
+    void **page;
+
+    if (!dir && create) {
+        dir = calloc(XA_DIR_SIZE, sizeof(*dir));
+        if (dir) {
+            __atomic_store_n(&xa->dir, dir, __ATOMIC_RELEASE);
+        }
+    }
+    if (!dir || index > 0xffffffffUL) {
+        return NULL;
+    }
+
+    page = __atomic_load_n(&dir[index >> XA_PAGE_BITS], __ATOMIC_ACQUIRE);
+    if (!page && create) {
+        page = calloc(XA_PAGE_SIZE, sizeof(void *));
+        if (!page) {
+            return NULL;
+        }
+        __atomic_store_n(&dir[index >> XA_PAGE_BITS], page, __ATOMIC_RELEASE);
+    }
+
+    return page ? &page[index & (XA_PAGE_SIZE - 1)] : NULL;
+}
+
+void *xa_load(struct xarray *xa, unsigned long index)
+{
+    void **slot = xa_slot(xa, index, false);
+    void *entry = slot ? __atomic_load_n(slot, __ATOMIC_ACQUIRE) : NULL;
+
+    return entry == XA_ZERO_ENTRY ? NULL : entry;
+}
+
+void *xa_store(struct xarray *xa, unsigned long index, void *entry, gfp_t gfp)
+{
+    void **slot;
+    void *old = NULL;
+
+    (void)gfp;
+    spin_lock(&xa->lock);
+    slot = xa_slot(xa, index, true);
+    if (slot) {
+        old = *slot;
+        __atomic_store_n(slot, entry, __ATOMIC_RELEASE);
+    }
+    spin_unlock(&xa->lock);
+
+    return old == XA_ZERO_ENTRY ? NULL : old;
+}
+
+void *xa_erase(struct xarray *xa, unsigned long index)
+{
+    void **slot;
+    void *old = NULL;
+
+    spin_lock(&xa->lock);
+    slot = xa_slot(xa, index, false);
+    if (slot) {
+        old = *slot;
+        __atomic_store_n(slot, NULL, __ATOMIC_RELEASE);
+    }
+    spin_unlock(&xa->lock);
+
+    return old == XA_ZERO_ENTRY ? NULL : old;
+}
+
+// 槽位空闲时存入条目（NULL 表示预留），已有条目或预留时返回 -EBUSY
+int xa_insert(struct xarray *xa, unsigned long index, void *entry, gfp_t gfp)
+{
+    void **slot;
+    int ret = 0;
+
+    (void)gfp;
+    spin_lock(&xa->lock);
+    slot = xa_slot(xa, index, true);
+    if (!slot) {
+        ret = -ENOMEM;
+    } else if (*slot) {
+        ret = -EBUSY;
+    } else {
+        *slot = entry ? entry : XA_ZERO_ENTRY;
+    }
+    spin_unlock(&xa->lock);
+
+    return ret;
+}
+
+// 取消预留，只清除仍处于预留状态的槽位
+void xa_release(struct xarray *xa, unsigned long index)
+{
+    void **slot;
+
+    spin_lock(&xa->lock);
+    slot = xa_slot(xa, index, false);
+    if (slot && *slot == XA_ZERO_ENTRY) {
+        *slot = NULL;
+    }
+    spin_unlock(&xa->lock);
+}
+
+// 查找下标不小于 *index、不大于 max 的第一个条目
+void *xa_find(struct xarray *xa, unsigned long *index, unsigned long max, xa_mark_t filter)
+{
+    unsigned long i = *index;
+    void **page, *entry;
+
+    (void)filter;
+    if (!xa->dir) {
+        return NULL;
+    }
+    if (max > 0xffffffffUL) {
+        max = 0xffffffffUL;
+    }
+
+    while (i <= max) {
+        page = __atomic_load_n(&xa->dir[i >> XA_PAGE_BITS], __ATOMIC_ACQUIRE);
+        if (!page) {
+            i = ((i >> XA_PAGE_BITS) + 1) << XA_PAGE_BITS;
+            continue;
+        }
+        entry = __atomic_load_n(&page[i & (XA_PAGE_SIZE - 1)], __ATOMIC_ACQUIRE);
+        if (entry && entry != XA_ZERO_ENTRY) {
+            *index = i;
+            return entry;
+        }
+        i++;
+    }
+
+    return NULL;
+}
+
+void *xa_find_after(struct xarray *xa, unsigned long *index, unsigned long max, xa_mark_t filter)
+{
+    unsigned long next = *index + 1;
+    void *entry;
+
+    if (*index >= max) {
+        return NULL;
+    }
+
+    entry = xa_find(xa, &next, max, filter);
+    if (entry) {
+        *index = next;
+    }
+    return entry;
+}
+
+// rhltable：桶内按 rhead 串起不同键的链头，同一键的对象挂在链头的 next 上
+#define RHL_MIN_SIZE 16
+
+static inline const void *rhl_key(const struct rhltable *hlt, const struct rhash_head *he)
+{
+    return (const char *)he - hlt->p.head_offset + hlt->p.key_offset;
+}
+
+static inline u32 rhl_bucket(const struct rhltable *hlt, const void *key, u32 size)
+{
+    return jhash(key, hlt->p.key_len, 0) & (size - 1);
+}
+
+static struct rhash_head **rhl_alloc(u32 size)
+{
+    return calloc(size + 1, sizeof(struct rhash_head *));
+}
+
+int rhltable_init(struct rhltable *hlt, const struct rhashtable_params *params)
+{
+    hlt->p = *params;
+    hlt->size = RHL_MIN_SIZE;
+    hlt->nelems = 0;
+    hlt->buckets = rhl_alloc(hlt->size);
+    return hlt->buckets ? 0 : -ENOMEM;
+}
+
+void rhltable_destroy(struct rhltable *hlt)
+{
+    struct rhash_head **buckets = hlt->buckets;
+    struct rhash_head **old;
+    u32 size = hlt->size;
+
+    while (buckets) {
+        old = (struct rhash_head **)buckets[size];
+        free(buckets);
+        buckets = old;
+        size /= 2;
+    }
+    hlt->buckets = NULL;
+}
+
+// 桶数加倍，各链头按键重新分桶后发布新数组
+static void rhl_grow(struct rhltable *hlt)
+{
+    u32 size = hlt->size * 2;
+    struct rhash_head **buckets = rhl_alloc(size);
+    struct rhash_head *he, *next;
+    u32 i, b;
+
+    if (!buckets) {
+        return;
+    }
+    for (i = 0; i < hlt->size; i++) {
+        for (he = hlt->buckets[i]; he; he = next) {
+            next = he->next;
+            b = rhl_bucket(hlt, rhl_key(hlt, he), size);
+            he->next = buckets[b];
+            buckets[b] = he;
+        }
+    }
+    buckets[size] = (struct rhash_head *)hlt->buckets;
+    __atomic_store_n(&hlt->buckets, buckets, __ATOMIC_RELEASE);
+    hlt->size = size;
+}
+
+struct rhlist_head *rhltable_lookup(struct rhltable *hlt, const void *key,
+                                    const struct rhashtable_params params)
+{
+    struct rhash_head **buckets = __atomic_load_n(&hlt->buckets, __ATOMIC_ACQUIRE);
+    struct rhash_head *he;
+
+    (void)params;
+    for (he = rcu_dereference(buckets[rhl_bucket(hlt, key, hlt->size)]); he;
+         he = rcu_dereference(he->next)) {
+        if (memcmp(rhl_key(hlt, he), key, hlt->p.key_len) == 0) {
+            return container_of(he, struct rhlist_head, rhead);
+        }
+    }
+    return NULL;
+}
+
+int rhltable_insert(struct rhltable *hlt, struct rhlist_head *list,
+                    const struct rhashtable_params params)
+{
+    const void *key = rhl_key(hlt, &list->rhead);
+    struct rhlist_head *first = rhltable_lookup(hlt, key, params);
+    struct rhash_head **bucket;
+
+    if (first) {
+        // 挂在已有链头之后
+        list->rhead.next = NULL;
+        list->next = first->next;
+        __atomic_store_n(&first->next, list, __ATOMIC_RELEASE);
+    } else {
+        bucket = &hlt->buckets[rhl_bucket(hlt, key, hlt->size)];
+        list->next = NULL;
+        list->rhead.next = *bucket;
+        __atomic_store_n(bucket, &list->rhead, __ATOMIC_RELEASE);
+    }
+
+    if (++hlt->nelems > hlt->size / 4 * 3) {
+        rhl_grow(hlt);
+    }
+    return 0;
+}
+
+int rhltable_remove(struct rhltable *hlt, struct rhlist_head *list,
+                    const struct rhashtable_params params)
+{
+    const void *key = rhl_key(hlt, &list->rhead);
+    struct rhash_head **pprev = &hlt->buckets[rhl_bucket(hlt, key, hlt->size)];
+    struct rhlist_head *first, **lprev;
+
+    (void)params;
+    for (; *pprev; pprev = &(*pprev)->next) {
+        first = container_of(*pprev, struct rhlist_head, rhead);
+        if (memcmp(rhl_key(hlt, *pprev), key, hlt->p.key_len) != 0) {
+            continue;
+        }
+        if (first == list) {
+            // 链头被移除时由同键的下一个对象接替
+            if (list->next) {
+                list->next->rhead.next = list->rhead.next;
+                __atomic_store_n(pprev, &list->next->rhead, __ATOMIC_RELEASE);
+            } else {
+                __atomic_store_n(pprev, list->rhead.next, __ATOMIC_RELEASE);
+            }
+            hlt->nelems--;
+            return 0;
+        }
+        for (lprev = &first->next; *lprev; lprev = &(*lprev)->next) {
+            if (*lprev == list) {
+                __atomic_store_n(lprev, list->next, __ATOMIC_RELEASE);
+                hlt->nelems--;
+                return 0;
+            }
+        }
+        break;
+    }
+    return -ENOENT;
+}
+
+// 用户空间构建没有 DNS 动态 IP 表，规则删除时无需使之失效
+void hips_dynip_flush(void)
+{
+}
+
+void hips_dynip_forget(u32 *rule_ids, int count)
+{
+    (void)rule_ids;
+    (void)count;
+}